@@ -29,6 +29,7 @@
 #include "client.h"
 #include "clientdevice.h"
 #include "messagestatisticsmodel.h"
+#include "sessionreplay.h"
 
 #include <common/message.h>
 #include <common/objectbroker.h>
@@ -50,6 +51,7 @@ Client::Client(QObject *parent)
     Message::resetNegotiatedDataVersion();
 
     connect(this, SIGNAL(disconnected()), SLOT(socketDisconnected()));
+    connect(this, SIGNAL(logTransmissionRate(quint64,quint64)), SLOT(updateBufferedBytes()));
 
     m_propertySyncer->setRequestInitialSync(true);
 
@@ -105,6 +107,13 @@ void Client::disconnectFromHost()
     }
 }
 
+SessionReplay *Client::sessionReplay() const
+{
+    if (!m_clientDevice)
+        return nullptr;
+    return qobject_cast<SessionReplay *>(m_clientDevice->device());
+}
+
 void Client::socketConnected()
 {
     Q_ASSERT(m_clientDevice->device());
@@ -127,6 +136,12 @@ void Client::socketDisconnected()
     resetClientDevice();
 }
 
+void Client::updateBufferedBytes()
+{
+    m_statModel->setBufferedBytes(bufferedBytes(), remoteBufferedBytes());
+    m_statModel->setProbeLatencies(remoteAverageLatencies(), remoteMaximumLatencies());
+}
+
 void Client::messageReceived(const Message &msg)
 {
     m_statModel->addMessage(msg.address(), msg.type(), msg.size());
@@ -211,11 +226,21 @@ void Client::messageReceived(const Message &msg)
         {
             quint8 version;
             msg >> version;
+            // other clients might have settled on a version we don't know already
+            if (version > Message::highestSupportedDataVersion()) {
+                emit persisitentConnectionError(tr("Data version mismatch.\n" \
+                                                   "Probe uses data version %1, supported is up to %2.").arg(
+                                                    version).arg(Message::highestSupportedDataVersion()));
+                disconnectFromHost();
+                return;
+            }
             Message::setNegotiatedDataVersion(version);
 
             m_initState |= ServerDataVersionNegotiated;
             break;
         }
+        case Protocol::CompressionDictionary:
+            return; // picked up already when reading the message
         default:
             qWarning() << Q_FUNC_INFO << "Got unhandled message:" << msg.type();
             return;
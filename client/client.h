@@ -37,6 +37,7 @@
 namespace GammaRay {
 class ClientDevice;
 class MessageStatisticsModel;
+class SessionReplay;
 
 /** Client-side connection endpoint. */
 class Client : public Endpoint
@@ -50,6 +51,9 @@ public:
     void connectToHost(const QUrl &url, int tryAgain = 0);
     void disconnectFromHost();
 
+    /** The session recording played back, if connected to one rather than to a probe. */
+    SessionReplay *sessionReplay() const;
+
     /**
      * Register a client-side QObject to send/receive messages to/from the server side.
      */
@@ -91,6 +95,7 @@ private slots:
     void socketConnected();
     void resetClientDevice();
     void socketDisconnected();
+    void updateBufferedBytes();
 
 private:
     enum InitState {
@@ -38,6 +38,7 @@
 #include "processtracker.h"
 #include "paintanalyzerclient.h"
 #include "remoteviewclient.h"
+#include "sessionreplaytoolbar.h"
 #include <toolmanagerclient.h>
 
 #include <common/objectbroker.h>
@@ -229,6 +230,10 @@ QMainWindow *ClientConnectionManager::createMainWindow()
     m_mainWindow = new MainWindow;
     m_mainWindow->setupFeedbackProvider();
     connect(m_mainWindow, SIGNAL(targetQuitRequested()), this, SLOT(targetQuitRequested()));
+    if (auto replay = m_client->sessionReplay()) {
+        m_mainWindow->addToolBar(Qt::BottomToolBarArea,
+                                 new SessionReplayToolBar(replay, m_mainWindow));
+    }
     m_ignorePersistentError = false;
     m_mainWindow->show();
     return m_mainWindow;
@@ -0,0 +1,64 @@
+/*
+  fileclientdevice.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "fileclientdevice.h"
+
+#include <QUrlQuery>
+
+using namespace GammaRay;
+
+FileClientDevice::FileClientDevice(QObject *parent)
+    : ClientDeviceImpl<SessionReplay>(parent)
+{
+    m_socket = new SessionReplay(this);
+}
+
+void FileClientDevice::connectToHost()
+{
+    // report the result asynchronously, like the socket based devices
+    QMetaObject::invokeMethod(this, "openRecording", Qt::QueuedConnection);
+}
+
+void FileClientDevice::disconnectFromHost()
+{
+    m_socket->close();
+}
+
+void FileClientDevice::openRecording()
+{
+    if (!m_socket->openRecording(m_serverAddress.toLocalFile())) {
+        emit persistentError(m_socket->errorString());
+        return;
+    }
+
+    const QUrlQuery query(m_serverAddress);
+    bool ok = false;
+    const auto position = query.queryItemValue(QStringLiteral("position")).toLongLong(&ok);
+    m_socket->setPosition(ok ? position : -1);
+    emit connected();
+}
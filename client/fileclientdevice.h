@@ -0,0 +1,53 @@
+/*
+  fileclientdevice.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_FILECLIENTDEVICE_H
+#define GAMMARAY_FILECLIENTDEVICE_H
+
+#include "clientdevice.h"
+#include "sessionreplay.h"
+
+namespace GammaRay {
+/** Offline "connection" to a recorded probe session.
+ *  The URL query can contain the playback position in ms, e.g. file:///tmp/session.grs?position=5000,
+ *  by default the state at the end of the recording is shown.
+ */
+class FileClientDevice : public ClientDeviceImpl<SessionReplay>
+{
+    Q_OBJECT
+public:
+    explicit FileClientDevice(QObject *parent = nullptr);
+    void connectToHost() override;
+    void disconnectFromHost() override;
+
+private slots:
+    void openRecording();
+};
+}
+
+#endif // GAMMARAY_FILECLIENTDEVICE_H
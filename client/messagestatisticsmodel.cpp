@@ -75,9 +75,21 @@ static const MetaEnum::Value<Protocol::MessageType> message_type_table[] = {
     M(ServerInfo),
     M(ProbeSettings),
     M(ServerAddress),
-    M(ServerLaunchError)
+    M(ServerLaunchError),
+    M(FlowControlCredit),
+    M(MessageFragment),
+    M(CompressionDictionary)
 };
 #undef M
+
+static const char *priority_names[] = {
+    QT_TRANSLATE_NOOP("GammaRay::MessageStatisticsModel", "Interactive"),
+    QT_TRANSLATE_NOOP("GammaRay::MessageStatisticsModel", "Model"),
+    QT_TRANSLATE_NOOP("GammaRay::MessageStatisticsModel", "Bulk"),
+    QT_TRANSLATE_NOOP("GammaRay::MessageStatisticsModel", "Stream")
+};
+Q_STATIC_ASSERT(Protocol::MESSAGE_PRIORITY_COUNT == (sizeof(priority_names) / sizeof(const char *)));
+
 Q_STATIC_ASSERT(Protocol::MESSAGE_TYPE_COUNT - 1 == (sizeof(message_type_table) / sizeof(MetaEnum::Value<Protocol::MessageType>)));
 
 MessageStatisticsModel::Info::Info()
@@ -100,6 +112,8 @@ MessageStatisticsModel::MessageStatisticsModel(QObject *parent)
     : QAbstractTableModel(parent)
     , m_totalCount(0)
     , m_totalSize(0)
+    , m_clientBufferedBytes(0)
+    , m_probeBufferedBytes(0)
 {
 }
 
@@ -113,6 +127,10 @@ void MessageStatisticsModel::clear()
     m_data.clear();
     m_totalCount = 0;
     m_totalSize = 0;
+    m_clientBufferedBytes = 0;
+    m_probeBufferedBytes = 0;
+    m_probeAverageLatencies.clear();
+    m_probeMaximumLatencies.clear();
     endResetModel();
 }
 
@@ -151,6 +169,38 @@ void MessageStatisticsModel::addMessage(Protocol::ObjectAddress addr, Protocol::
     }
 }
 
+void MessageStatisticsModel::setBufferedBytes(quint64 clientBytes, quint64 probeBytes)
+{
+    if (m_clientBufferedBytes == clientBytes && m_probeBufferedBytes == probeBytes)
+        return;
+    m_clientBufferedBytes = clientBytes;
+    m_probeBufferedBytes = probeBytes;
+    if (columnCount(QModelIndex()) > 0)
+        emit headerDataChanged(Qt::Horizontal, 0, columnCount(QModelIndex()) - 1);
+}
+
+quint64 MessageStatisticsModel::clientBufferedBytes() const
+{
+    return m_clientBufferedBytes;
+}
+
+quint64 MessageStatisticsModel::probeBufferedBytes() const
+{
+    return m_probeBufferedBytes;
+}
+
+void MessageStatisticsModel::setProbeLatencies(const QVector<quint32> &averageLatencies,
+                                               const QVector<quint32> &maximumLatencies)
+{
+    Q_ASSERT(averageLatencies.size() == maximumLatencies.size());
+    if (m_probeAverageLatencies == averageLatencies && m_probeMaximumLatencies == maximumLatencies)
+        return;
+    m_probeAverageLatencies = averageLatencies;
+    m_probeMaximumLatencies = maximumLatencies;
+    if (columnCount(QModelIndex()) > 0)
+        emit headerDataChanged(Qt::Horizontal, 0, columnCount(QModelIndex()) - 1);
+}
+
 int MessageStatisticsModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
@@ -243,7 +293,8 @@ QVariant MessageStatisticsModel::headerData(int section, Qt::Orientation orienta
                    arg(100.0 * (double)count / (double)m_totalCount, 0, 'f', 2).
                    arg(size).
                    arg(m_totalSize).
-                   arg(100.0 * (double)size / (double)m_totalSize, 0, 'f', 2);
+                   arg(100.0 * (double)size / (double)m_totalSize, 0, 'f', 2)
+                   + transportToolTip();
         }
     } else if (orientation == Qt::Vertical) {
         const auto &info = m_data.at(section);
@@ -292,3 +343,19 @@ quint64 MessageStatisticsModel::sizePerType(int msgType) const
     }
     return c;
 }
+
+QString MessageStatisticsModel::transportToolTip() const
+{
+    QString s = tr("\nBuffered: %1 bytes probe to client, %2 bytes client to probe").
+                arg(m_probeBufferedBytes).
+                arg(m_clientBufferedBytes);
+
+    const int count = qMin<int>(m_probeAverageLatencies.size(), Protocol::MESSAGE_PRIORITY_COUNT);
+    for (int i = 0; i < count; ++i) {
+        s += tr("\n%1 priority send latency: %2 ms average, %3 ms maximum").
+             arg(tr(priority_names[i])).
+             arg(m_probeAverageLatencies.at(i)).
+             arg(m_probeMaximumLatencies.at(i));
+    }
+    return s;
+}
@@ -47,6 +47,13 @@ public:
     void clear();
     void addObject(Protocol::ObjectAddress addr, const QString &name);
     void addMessage(Protocol::ObjectAddress addr, Protocol::MessageType msgType, int size);
+    /** Update the amount of data sent but not yet processed by the other side, per direction. */
+    void setBufferedBytes(quint64 clientBytes, quint64 probeBytes);
+    quint64 clientBufferedBytes() const;
+    quint64 probeBufferedBytes() const;
+    /** Update the average and maximum send queue latency per priority class on the probe side. */
+    void setProbeLatencies(const QVector<quint32> &averageLatencies,
+                           const QVector<quint32> &maximumLatencies);
 
     int columnCount(const QModelIndex &parent) const override;
     int rowCount(const QModelIndex &parent) const override;
@@ -55,6 +62,7 @@ public:
 
 private:
     int countPerType(int msgType) const;
+    QString transportToolTip() const;
     quint64 sizePerType(int msgType) const;
 
     struct Info {
@@ -69,6 +77,10 @@ private:
     QVector<Info> m_data;
     int m_totalCount;
     quint64 m_totalSize;
+    quint64 m_clientBufferedBytes;
+    quint64 m_probeBufferedBytes;
+    QVector<quint32> m_probeAverageLatencies;
+    QVector<quint32> m_probeMaximumLatencies;
 };
 }
 
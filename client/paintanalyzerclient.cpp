@@ -29,10 +29,75 @@
 #include "paintanalyzerclient.h"
 
 #include <common/endpoint.h>
+#include <common/message.h>
+
+#include <QDebug>
 
 using namespace GammaRay;
 
 PaintAnalyzerClient::PaintAnalyzerClient(const QString &name, QObject *parent)
     : PaintAnalyzerInterface(name, parent)
+    , m_streamId(0)
+    , m_commandCount(-1)
+{
+    connect(this, SIGNAL(commandStreamChunk(quint32,int,int,QByteArray)),
+            this, SLOT(commandChunkReceived(quint32,int,int,QByteArray)));
+}
+
+bool PaintAnalyzerClient::hasCommandDetails(quint32 streamId, int command) const
+{
+    return streamId == m_streamId && command >= 0 && command < m_commands.size();
+}
+
+PaintCommandRecord PaintAnalyzerClient::commandDetails(quint32 streamId, int command) const
+{
+    if (!hasCommandDetails(streamId, command))
+        return PaintCommandRecord();
+    return m_commands.at(command);
+}
+
+void PaintAnalyzerClient::requestCommandStream(quint32 streamId)
 {
+    if (streamId == 0 || streamId == m_streamId)
+        return; // nothing to show, or already received or in progress
+
+    m_streamId = streamId;
+    restartCommandStream();
+}
+
+void PaintAnalyzerClient::restartCommandStream()
+{
+    m_commandCount = -1;
+    m_commands.clear();
+    m_reader = PaintCommandStreamReader(Message::negotiatedDataVersion());
+    Endpoint::instance()->invokeObject(name(), "requestCommandStream", QVariantList() << m_streamId);
+}
+
+void PaintAnalyzerClient::commandChunkReceived(quint32 streamId, int firstCommand, int commandCount,
+                                               const QByteArray &chunk)
+{
+    if (streamId != m_streamId || m_commands.size() == m_commandCount)
+        return; // not the buffer we are interested in, or we have it completely already
+
+    if (firstCommand == 0 && !m_commands.isEmpty()) {
+        // the server started over for another client, follow along
+        m_commands.clear();
+        m_reader = PaintCommandStreamReader(Message::negotiatedDataVersion());
+    } else if (firstCommand != m_commands.size()) {
+        // we joined a transfer started by another client, or lost a chunk, the remaining ones
+        // can't be decoded without what we missed; ask again if our own request isn't pending anymore
+        if (!m_commands.isEmpty())
+            restartCommandStream();
+        return;
+    }
+
+    m_commandCount = commandCount;
+    if (!m_reader.read(chunk, &m_commands)) {
+        qWarning() << "Received malformed paint command stream for" << name();
+        m_commands.clear();
+        m_commandCount = 0;
+        return;
+    }
+    if (firstCommand < m_commands.size())
+        emit commandDetailsAvailable(streamId, firstCommand, m_commands.size() - 1);
 }
@@ -38,6 +38,24 @@ class PaintAnalyzerClient : public PaintAnalyzerInterface
     Q_INTERFACES(GammaRay::PaintAnalyzerInterface)
 public:
     explicit PaintAnalyzerClient(const QString &name, QObject *parent = nullptr);
+
+    bool hasCommandDetails(quint32 streamId, int command) const override;
+    PaintCommandRecord commandDetails(quint32 streamId, int command) const override;
+
+public slots:
+    void requestCommandStream(quint32 streamId) override;
+
+private slots:
+    void commandChunkReceived(quint32 streamId, int firstCommand, int commandCount, const QByteArray &chunk);
+
+private:
+    void restartCommandStream();
+
+    quint32 m_streamId;
+    // total number of commands in the stream, -1 while unknown
+    int m_commandCount;
+    QVector<PaintCommandRecord> m_commands;
+    PaintCommandStreamReader m_reader;
 };
 }
 
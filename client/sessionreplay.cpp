@@ -0,0 +1,709 @@
+/*
+  sessionreplay.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "sessionreplay.h"
+
+#include <QBuffer>
+
+using namespace GammaRay;
+
+static QByteArray indexKey(const Protocol::ModelIndex &index)
+{
+    QByteArray key;
+    key.reserve(index.size() * 2 * sizeof(qint32));
+    foreach (const auto &data, index) {
+        key.append(reinterpret_cast<const char *>(&data.row), sizeof(data.row));
+        key.append(reinterpret_cast<const char *>(&data.column), sizeof(data.column));
+    }
+    return key;
+}
+
+static Protocol::ModelIndex keyIndex(const QByteArray &key)
+{
+    Protocol::ModelIndex index;
+    index.reserve(key.size() / (2 * sizeof(qint32)));
+    for (int pos = 0; pos + 2 * int(sizeof(qint32)) <= key.size(); pos += 2 * sizeof(qint32)) {
+        Protocol::ModelIndexData data;
+        memcpy(&data.row, key.constData() + pos, sizeof(data.row));
+        memcpy(&data.column, key.constData() + pos + sizeof(qint32), sizeof(data.column));
+        index.push_back(data);
+    }
+    return index;
+}
+
+void SessionReplay::ModelState::invalidate(const Protocol::ModelIndex &parent)
+{
+    const auto key = indexKey(parent);
+
+    for (auto it = counts.begin(); it != counts.end();) {
+        if (it.key().startsWith(key))
+            it = counts.erase(it);
+        else
+            ++it;
+    }
+
+    // the content of the parent itself is unaffected
+    for (auto it = content.begin(); it != content.end();) {
+        if (it.key().size() > key.size() && it.key().startsWith(key))
+            it = content.erase(it);
+        else
+            ++it;
+    }
+
+    if (parent.isEmpty())
+        headers.clear();
+}
+
+/** Where @p index ended up, given the new places of the nodes that moved. Returns @c false
+ *  if it doesn't exist anymore.
+ */
+static bool remapIndex(const Protocol::ModelIndex &index,
+                       const QHash<QByteArray, Protocol::ModelIndex> &newPlaces,
+                       Protocol::ModelIndex *result)
+{
+    Protocol::ModelIndex node, newIndex;
+    foreach (const auto &data, index) {
+        // nodes not listed kept their row, in whatever place their parent ended up
+        node.push_back(Protocol::ModelIndexData(data.row, 0));
+        const auto it = newPlaces.constFind(indexKey(node));
+        if (it == newPlaces.constEnd()) {
+            newIndex.push_back(data);
+        } else {
+            if (it.value().isEmpty())
+                return false;
+            newIndex = it.value();
+            newIndex.last().column = data.column;
+        }
+        node.last().column = data.column;
+    }
+    *result = newIndex;
+    return true;
+}
+
+template<typename T>
+static QHash<QByteArray, T> remapKeys(const QHash<QByteArray, T> &values,
+                                      const QHash<QByteArray, Protocol::ModelIndex> &newPlaces)
+{
+    QHash<QByteArray, T> result;
+    result.reserve(values.size());
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        Protocol::ModelIndex index;
+        if (remapIndex(keyIndex(it.key()), newPlaces, &index))
+            result.insert(indexKey(index), it.value());
+    }
+    return result;
+}
+
+void SessionReplay::ModelState::remap(
+    const QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > &nodes)
+{
+    if (nodes.isEmpty())
+        return;
+
+    QHash<QByteArray, Protocol::ModelIndex> newPlaces;
+    newPlaces.reserve(nodes.size());
+    foreach (const auto &node, nodes)
+        newPlaces.insert(indexKey(node.first), node.second);
+
+    counts = remapKeys(counts, newPlaces);
+    content = remapKeys(content, newPlaces);
+}
+
+static Protocol::ModelIndex childIndex(const Protocol::ModelIndex &parent, int row)
+{
+    auto index = parent;
+    index.push_back(Protocol::ModelIndexData(row, 0));
+    return index;
+}
+
+void SessionReplay::ModelState::insertRows(const Protocol::ModelIndex &parent, int first, int last)
+{
+    const auto it = counts.find(indexKey(parent));
+    if (it == counts.end()) {
+        invalidate(parent);
+        return;
+    }
+
+    // the content of the new rows is recorded right after this
+    const int count = last - first + 1;
+    QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > nodes;
+    for (int row = first; row < it.value().first; ++row)
+        nodes.push_back(qMakePair(childIndex(parent, row), childIndex(parent, row + count)));
+    it.value().first += count;
+    remap(nodes);
+}
+
+void SessionReplay::ModelState::removeRows(const Protocol::ModelIndex &parent, int first, int last)
+{
+    const auto it = counts.find(indexKey(parent));
+    if (it == counts.end()) {
+        invalidate(parent);
+        return;
+    }
+
+    const int count = last - first + 1;
+    QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > nodes;
+    for (int row = first; row <= last; ++row)
+        nodes.push_back(qMakePair(childIndex(parent, row), Protocol::ModelIndex()));
+    for (int row = last + 1; row < it.value().first; ++row)
+        nodes.push_back(qMakePair(childIndex(parent, row), childIndex(parent, row - count)));
+    it.value().first = qMax(0, it.value().first - count);
+    remap(nodes);
+}
+
+void SessionReplay::ModelState::moveRows(const Protocol::ModelIndex &parent, int first, int last,
+                                         int destination)
+{
+    // same semantics as QAbstractItemModel::beginMoveRows() within a single parent
+    const int count = last - first + 1;
+    QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > nodes;
+    if (destination > last + 1) {
+        for (int row = first; row <= last; ++row) {
+            nodes.push_back(qMakePair(childIndex(parent, row),
+                                      childIndex(parent, destination - count + row - first)));
+        }
+        for (int row = last + 1; row < destination; ++row)
+            nodes.push_back(qMakePair(childIndex(parent, row), childIndex(parent, row - count)));
+    } else if (destination < first) {
+        for (int row = first; row <= last; ++row) {
+            nodes.push_back(qMakePair(childIndex(parent, row),
+                                      childIndex(parent, destination + row - first)));
+        }
+        for (int row = destination; row < first; ++row)
+            nodes.push_back(qMakePair(childIndex(parent, row), childIndex(parent, row + count)));
+    }
+    remap(nodes);
+}
+
+SessionReplay::SessionReplay(QObject *parent)
+    : QIODevice(parent)
+    , m_nextChunk(0)
+    , m_nextRecord(0)
+    , m_position(0)
+    , m_initialPosition(-1)
+    , m_greetingDone(false)
+    , m_rewinding(false)
+    , m_endpointAddress(Protocol::InvalidObjectAddress)
+    , m_propertySyncerAddress(Protocol::InvalidObjectAddress)
+{
+}
+
+SessionReplay::~SessionReplay()
+{
+}
+
+bool SessionReplay::openRecording(const QString &fileName)
+{
+    if (!m_reader.open(fileName)) {
+        setErrorString(m_reader.errorString());
+        return false;
+    }
+    if (m_reader.dataVersion() < Message::lowestSupportedDataVersion()
+        || m_reader.dataVersion() > Message::highestSupportedDataVersion()) {
+        setErrorString(tr("Unsupported data version %1 in session recording.")
+                       .arg(m_reader.dataVersion()));
+        return false;
+    }
+
+    SessionFileReader::Record record;
+    if (!peekRecord(record) || record.type != Protocol::ServerVersion) {
+        setErrorString(tr("Session recording does not start with a server greeting."));
+        return false;
+    }
+    m_endpointAddress = record.address;
+
+    QIODevice::open(QIODevice::ReadWrite);
+
+    // replay the greeting right away, everything else follows once the data version is settled
+    while (peekRecord(record) && record.address == m_endpointAddress) {
+        if (record.type != Protocol::ServerVersion && record.type != Protocol::ServerInfo
+            && record.type != Protocol::ObjectMapReply)
+            break;
+        ++m_nextRecord;
+
+        if (record.type == Protocol::ObjectMapReply) {
+            QVector<QPair<Protocol::ObjectAddress, QString> > objects;
+            Message::fromRawPayload(record.address, record.type, record.payload) >> objects;
+            foreach (const auto &object, objects) {
+                if (object.second == QLatin1String("com.kdab.GammaRay.PropertySyncer"))
+                    m_propertySyncerAddress = object.first;
+            }
+        }
+        sendRaw(record.address, record.type, record.payload);
+    }
+
+    return true;
+}
+
+qint64 SessionReplay::duration() const
+{
+    return m_reader.duration();
+}
+
+qint64 SessionReplay::position() const
+{
+    return m_position;
+}
+
+void SessionReplay::setPosition(qint64 position)
+{
+    if (!m_greetingDone) {
+        m_initialPosition = position;
+        return;
+    }
+
+    if (position >= 0 && position < m_position) {
+        // the model state can only be rebuilt by replaying from the start
+        const auto models = m_models.keys();
+        m_models.clear();
+        m_properties.clear();
+        m_records.clear();
+        m_nextChunk = 0;
+        m_nextRecord = 0;
+
+        m_rewinding = true;
+        replayTo(position);
+        m_rewinding = false;
+
+        // let the client fetch everything again
+        foreach (const auto address, models) {
+            if (m_monitoredObjects.contains(address))
+                send(Message(address, Protocol::ModelReset));
+        }
+        for (auto it = m_properties.constBegin(); it != m_properties.constEnd(); ++it) {
+            Message msg(m_propertySyncerAddress, Protocol::PropertyValuesChanged);
+            msg << it.key() << quint32(it.value().size());
+            for (auto valueIt = it.value().constBegin(); valueIt != it.value().constEnd(); ++valueIt)
+                msg << valueIt.key() << valueIt.value();
+            send(msg);
+        }
+    } else {
+        replayTo(position);
+    }
+
+    if (!m_outgoing.isEmpty())
+        emit readyRead();
+}
+
+bool SessionReplay::isSequential() const
+{
+    return true;
+}
+
+qint64 SessionReplay::bytesAvailable() const
+{
+    return m_outgoing.size() + QIODevice::bytesAvailable();
+}
+
+void SessionReplay::close()
+{
+    if (!isOpen())
+        return;
+    QIODevice::close();
+    emit disconnected();
+}
+
+qint64 SessionReplay::readData(char *data, qint64 maxSize)
+{
+    const auto size = qMin<qint64>(maxSize, m_outgoing.size());
+    memcpy(data, m_outgoing.constData(), size);
+    m_outgoing.remove(0, size);
+    return size;
+}
+
+qint64 SessionReplay::writeData(const char *data, qint64 maxSize)
+{
+    // replies must not be delivered from within the client's send call
+    const bool wasEmpty = m_incoming.isEmpty();
+    m_incoming.append(data, maxSize);
+    if (wasEmpty)
+        QMetaObject::invokeMethod(this, "processRequests", Qt::QueuedConnection);
+    return maxSize;
+}
+
+void SessionReplay::processRequests()
+{
+    QBuffer buffer(&m_incoming);
+    buffer.open(QIODevice::ReadOnly);
+    while (Message::canReadMessage(&buffer)) {
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray payload;
+        if (Message::readRawMessage(&buffer, address, type, payload, m_readScratchSpace,
+                                    &m_fragments))
+            handleRequest(Message::fromRawPayload(address, type, payload));
+    }
+    const auto consumed = buffer.pos();
+    buffer.close();
+    m_incoming.remove(0, consumed);
+
+    if (!m_outgoing.isEmpty())
+        emit readyRead();
+}
+
+void SessionReplay::send(const Message &msg)
+{
+    sendRaw(msg.address(), msg.type(), msg.rawPayload());
+}
+
+void SessionReplay::sendRaw(Protocol::ObjectAddress address, Protocol::MessageType type,
+                            const QByteArray &payload)
+{
+    QBuffer buffer(&m_outgoing);
+    buffer.open(QIODevice::WriteOnly | QIODevice::Append);
+    Message::writeRawMessage(&buffer, address, type, payload, m_writeScratchSpace);
+}
+
+bool SessionReplay::peekRecord(SessionFileReader::Record &record)
+{
+    while (m_nextRecord >= m_records.size()) {
+        if (m_nextChunk >= m_reader.chunkCount())
+            return false;
+        m_records = m_reader.readChunk(m_nextChunk++);
+        m_nextRecord = 0;
+    }
+    record = m_records.at(m_nextRecord);
+    return true;
+}
+
+void SessionReplay::replayTo(qint64 position)
+{
+    SessionFileReader::Record record;
+    while (peekRecord(record)) {
+        if (position >= 0 && record.time > position)
+            break;
+        ++m_nextRecord;
+        replayRecord(record);
+    }
+    const auto previousPosition = m_position;
+    m_position = position >= 0 ? position : m_reader.duration();
+    if (m_position != previousPosition)
+        emit positionChanged(m_position);
+
+    answerPendingRequests();
+}
+
+void SessionReplay::replayRecord(const SessionFileReader::Record &record)
+{
+    const auto msg = Message::fromRawPayload(record.address, record.type, record.payload);
+    bool forward = !m_rewinding && m_monitoredObjects.contains(record.address);
+
+    if (record.address == m_endpointAddress) {
+        // the greeting has been sent already
+        forward = !m_rewinding
+                  && (record.type == Protocol::ObjectAdded || record.type == Protocol::ObjectRemoved);
+    } else if (record.address == m_propertySyncerAddress) {
+        forward = false;
+        if (record.type == Protocol::PropertyValuesChanged) {
+            Protocol::ObjectAddress address;
+            quint32 size;
+            msg >> address >> size;
+            auto &values = m_properties[address];
+            for (quint32 i = 0; i < size; ++i) {
+                QByteArray name;
+                QVariant value;
+                msg >> name >> value;
+                values.insert(name, value);
+            }
+            forward = !m_rewinding;
+        }
+    } else {
+        switch (record.type) {
+        case Protocol::ModelRowColumnCountReply:
+        {
+            auto &model = m_models[record.address];
+            quint32 size;
+            msg >> size;
+            for (quint32 i = 0; i < size; ++i) {
+                Protocol::ModelIndex index;
+                qint32 rowCount, columnCount;
+                msg >> index >> rowCount >> columnCount;
+                if (rowCount >= 0 && columnCount >= 0)
+                    model.counts.insert(indexKey(index), qMakePair(rowCount, columnCount));
+            }
+            forward = false;
+            break;
+        }
+        case Protocol::ModelContentReply:
+        {
+            auto &model = m_models[record.address];
+            quint32 size;
+            msg >> size;
+            for (quint32 i = 0; i < size; ++i) {
+                Protocol::ModelIndex index;
+                ModelState::Content content;
+                msg >> index >> content.itemData >> content.flags;
+                model.content.insert(indexKey(index), content);
+            }
+            forward = false;
+            break;
+        }
+        case Protocol::ModelHeaderReply:
+        {
+            qint8 orientation;
+            qint32 section;
+            QHash<qint32, QVariant> data;
+            msg >> orientation >> section >> data;
+            m_models[record.address].headers.insert(qMakePair(orientation, section), data);
+            forward = false;
+            break;
+        }
+        case Protocol::ModelRowsAdded:
+        case Protocol::ModelRowsRemoved:
+        {
+            Protocol::ModelIndex parent;
+            qint32 first, last;
+            msg >> parent >> first >> last;
+            auto &model = m_models[record.address];
+            if (record.type == Protocol::ModelRowsAdded)
+                model.insertRows(parent, first, last);
+            else
+                model.removeRows(parent, first, last);
+            break;
+        }
+        case Protocol::ModelColumnsAdded:
+        case Protocol::ModelColumnsRemoved:
+        {
+            Protocol::ModelIndex parent;
+            msg >> parent;
+            m_models[record.address].invalidate(parent);
+            break;
+        }
+        case Protocol::ModelRowsMoved:
+        case Protocol::ModelColumnsMoved:
+        {
+            Protocol::ModelIndex sourceParent, destinationParent;
+            qint32 sourceStart, sourceEnd, destinationIndex;
+            msg >> sourceParent >> sourceStart >> sourceEnd >> destinationParent >> destinationIndex;
+            auto &model = m_models[record.address];
+            if (record.type == Protocol::ModelRowsMoved
+                && indexKey(sourceParent) == indexKey(destinationParent)) {
+                model.moveRows(sourceParent, sourceStart, sourceEnd, destinationIndex);
+                break;
+            }
+            model.invalidate(sourceParent);
+            model.invalidate(destinationParent);
+            break;
+        }
+        case Protocol::ModelLayoutChanged:
+        {
+            QVector<Protocol::ModelIndex> parents;
+            quint32 hint;
+            bool hasNewPlaces;
+            msg >> parents >> hint >> hasNewPlaces;
+            auto &model = m_models[record.address];
+            if (hasNewPlaces) {
+                // the recording follows the persistent indexes across the change
+                QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > nodes;
+                msg >> nodes;
+                model.remap(nodes);
+                break;
+            }
+            // otherwise the model has been recorded again afterwards
+            if (parents.isEmpty())
+                model.invalidate(Protocol::ModelIndex());
+            foreach (const auto &parent, parents)
+                model.invalidate(parent);
+            break;
+        }
+        case Protocol::ModelReset:
+            m_models[record.address] = ModelState();
+            break;
+        case Protocol::FlowControlCredit:
+            forward = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (forward)
+        sendRaw(record.address, record.type, record.payload);
+}
+
+void SessionReplay::handleRequest(const Message &msg)
+{
+    if (msg.address() == m_endpointAddress) {
+        switch (msg.type()) {
+        case Protocol::ObjectMonitored:
+        {
+            Protocol::ObjectAddress address;
+            msg >> address;
+            m_monitoredObjects.insert(address);
+            break;
+        }
+        case Protocol::ObjectUnmonitored:
+        {
+            Protocol::ObjectAddress address;
+            msg >> address;
+            m_monitoredObjects.remove(address);
+            break;
+        }
+        case Protocol::ClientDataVersionNegotiated:
+        {
+            // the payloads are replayed as recorded, so the client has to use that version
+            Message::setNegotiatedDataVersion(m_reader.dataVersion());
+            Message reply(m_endpointAddress, Protocol::ServerDataVersionNegotiated);
+            reply << m_reader.dataVersion();
+            send(reply);
+
+            m_greetingDone = true;
+            replayTo(m_initialPosition);
+            break;
+        }
+        default:
+            break;
+        }
+        return;
+    }
+
+    if (msg.address() == m_propertySyncerAddress) {
+        if (msg.type() != Protocol::PropertySyncRequest)
+            return; // the recording can't be modified
+
+        Protocol::ObjectAddress address;
+        msg >> address;
+        const auto values = m_properties.value(address);
+        if (values.isEmpty())
+            return;
+
+        Message reply(m_propertySyncerAddress, Protocol::PropertyValuesChanged);
+        reply << address << quint32(values.size());
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it)
+            reply << it.key() << it.value();
+        send(reply);
+        return;
+    }
+
+    Request request;
+    request.address = msg.address();
+    request.type = msg.type();
+    switch (msg.type()) {
+    case Protocol::ModelRowColumnCountRequest:
+    case Protocol::ModelContentRequest:
+    {
+        quint32 size;
+        msg >> size;
+        request.indexes.resize(size);
+        for (quint32 i = 0; i < size; ++i)
+            msg >> request.indexes[i];
+        break;
+    }
+    case Protocol::ModelHeaderRequest:
+        msg >> request.orientation >> request.section;
+        break;
+    case Protocol::ModelSyncBarrier:
+    {
+        qint32 barrierId;
+        msg >> barrierId;
+        Message reply(msg.address(), Protocol::ModelSyncBarrier);
+        reply << barrierId;
+        send(reply);
+        return;
+    }
+    default:
+        return; // the recording can't be modified
+    }
+
+    if (!answerRequest(request))
+        m_pendingRequests.push_back(request);
+}
+
+bool SessionReplay::answerRequest(Request &request)
+{
+    const auto model = m_models.value(request.address);
+
+    switch (request.type) {
+    case Protocol::ModelRowColumnCountRequest:
+    {
+        QVector<Protocol::ModelIndex> known, missing;
+        foreach (const auto &index, request.indexes) {
+            if (model.counts.contains(indexKey(index)))
+                known.push_back(index);
+            else
+                missing.push_back(index);
+        }
+
+        if (!known.isEmpty()) {
+            Message reply(request.address, Protocol::ModelRowColumnCountReply);
+            reply << quint32(known.size());
+            foreach (const auto &index, known) {
+                const auto counts = model.counts.value(indexKey(index));
+                reply << index << counts.first << counts.second;
+            }
+            send(reply);
+        }
+        request.indexes = missing;
+        return missing.isEmpty();
+    }
+    case Protocol::ModelContentRequest:
+    {
+        QVector<Protocol::ModelIndex> known, missing;
+        foreach (const auto &index, request.indexes) {
+            if (model.content.contains(indexKey(index)))
+                known.push_back(index);
+            else
+                missing.push_back(index);
+        }
+
+        if (!known.isEmpty()) {
+            Message reply(request.address, Protocol::ModelContentReply);
+            reply << quint32(known.size());
+            foreach (const auto &index, known) {
+                const auto content = model.content.value(indexKey(index));
+                reply << index << content.itemData << content.flags;
+            }
+            send(reply);
+        }
+        request.indexes = missing;
+        return missing.isEmpty();
+    }
+    case Protocol::ModelHeaderRequest:
+    {
+        const auto key = qMakePair(request.orientation, request.section);
+        if (!model.headers.contains(key))
+            return false;
+        Message reply(request.address, Protocol::ModelHeaderReply);
+        reply << request.orientation << request.section << model.headers.value(key);
+        send(reply);
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+void SessionReplay::answerPendingRequests()
+{
+    for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+        if (answerRequest(*it))
+            it = m_pendingRequests.erase(it);
+        else
+            ++it;
+    }
+}
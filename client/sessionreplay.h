@@ -0,0 +1,166 @@
+/*
+  sessionreplay.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_SESSIONREPLAY_H
+#define GAMMARAY_SESSIONREPLAY_H
+
+#include <common/message.h>
+#include <common/sessionfile.h>
+
+#include <QHash>
+#include <QIODevice>
+#include <QMap>
+#include <QSet>
+#include <QVariant>
+#include <QVector>
+
+namespace GammaRay {
+/** Plays back a recorded probe session, looking like a connection to a live probe.
+ *  The recorded messages are replayed up to a chosen position in time, and requests for
+ *  model content are answered from the content recorded along with the model changes.
+ *  The recording can't be modified, so all other requests are ignored.
+ */
+class SessionReplay : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit SessionReplay(QObject *parent = nullptr);
+    ~SessionReplay();
+
+    /** Opens the recording @p fileName and sends the recorded server greeting. */
+    bool openRecording(const QString &fileName);
+
+    /** Length of the recording, in ms. */
+    qint64 duration() const;
+    /** Current playback position, in ms since the start of the recording. */
+    qint64 position() const;
+    /** Moves the playback to @p position, -1 for the end of the recording.
+     *  Moving backwards resets all models to their state at that time.
+     */
+    void setPosition(qint64 position);
+
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+    void close() override;
+
+signals:
+    void disconnected();
+    /** Emitted whenever the playback moved to a different position. */
+    void positionChanged(qint64 position);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private slots:
+    void processRequests();
+
+private:
+    /** Recorded state of a remote model at the current position. */
+    struct ModelState
+    {
+        struct Content
+        {
+            Content()
+                : flags(0)
+            {
+            }
+
+            QMap<int, QVariant> itemData;
+            qint32 flags;
+        };
+
+        QHash<QByteArray, QPair<qint32, qint32> > counts;
+        QHash<QByteArray, Content> content;
+        QHash<QPair<qint8, qint32>, QHash<qint32, QVariant> > headers;
+
+        /** Forgets everything about @p parent and its descendants. */
+        void invalidate(const Protocol::ModelIndex &parent);
+        /** Moves everything recorded for the nodes in @p nodes (old and new index of their
+         *  first column) to their new place, along with their descendants.
+         */
+        void remap(const QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > &nodes);
+        void insertRows(const Protocol::ModelIndex &parent, int first, int last);
+        void removeRows(const Protocol::ModelIndex &parent, int first, int last);
+        void moveRows(const Protocol::ModelIndex &parent, int first, int last, int destination);
+    };
+
+    struct Request
+    {
+        Request()
+            : address(Protocol::InvalidObjectAddress)
+            , type(Protocol::InvalidMessageType)
+            , orientation(0)
+            , section(0)
+        {
+        }
+
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QVector<Protocol::ModelIndex> indexes;
+        qint8 orientation;
+        qint32 section;
+    };
+
+    void send(const Message &msg);
+    void sendRaw(Protocol::ObjectAddress address, Protocol::MessageType type,
+                 const QByteArray &payload);
+    /** Fetches the next record to be replayed, returns @c false at the end of the recording. */
+    bool peekRecord(SessionFileReader::Record &record);
+    void replayTo(qint64 position);
+    void replayRecord(const SessionFileReader::Record &record);
+    void handleRequest(const Message &msg);
+    /** Sends whatever part of @p request is known already, returns @c true if nothing is left. */
+    bool answerRequest(Request &request);
+    void answerPendingRequests();
+
+    SessionFileReader m_reader;
+    QVector<SessionFileReader::Record> m_records;
+    int m_nextChunk;
+    int m_nextRecord;
+    qint64 m_position;
+    qint64 m_initialPosition;
+    bool m_greetingDone;
+    bool m_rewinding;
+
+    Protocol::ObjectAddress m_endpointAddress;
+    Protocol::ObjectAddress m_propertySyncerAddress;
+    QSet<Protocol::ObjectAddress> m_monitoredObjects;
+    QHash<Protocol::ObjectAddress, ModelState> m_models;
+    QHash<Protocol::ObjectAddress, QMap<QByteArray, QVariant> > m_properties;
+    QVector<Request> m_pendingRequests;
+
+    QByteArray m_incoming;
+    QByteArray m_outgoing;
+    QByteArray m_readScratchSpace;
+    QByteArray m_writeScratchSpace;
+    Message::FragmentBuffer m_fragments;
+};
+}
+
+#endif // GAMMARAY_SESSIONREPLAY_H
@@ -0,0 +1,109 @@
+/*
+  sessionreplaytoolbar.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "sessionreplaytoolbar.h"
+#include "sessionreplay.h"
+
+#include <QAction>
+#include <QLabel>
+#include <QSlider>
+#include <QStyle>
+
+#include <limits>
+
+using namespace GammaRay;
+
+// playback step, in ms
+static const int StepSize = 1000;
+
+static QString formatTime(qint64 msecs)
+{
+    return QStringLiteral("%1:%2.%3")
+           .arg(msecs / 60000)
+           .arg((msecs / 1000) % 60, 2, 10, QLatin1Char('0'))
+           .arg((msecs / 100) % 10);
+}
+
+SessionReplayToolBar::SessionReplayToolBar(SessionReplay *replay, QWidget *parent)
+    : QToolBar(tr("Session Playback"), parent)
+    , m_replay(replay)
+    , m_slider(new QSlider(Qt::Horizontal, this))
+    , m_positionLabel(new QLabel(this))
+{
+    Q_ASSERT(m_replay);
+    setObjectName(QStringLiteral("sessionReplayToolBar"));
+
+    auto action = addAction(style()->standardIcon(QStyle::SP_MediaSeekBackward),
+                            tr("Step Backward"));
+    connect(action, SIGNAL(triggered()), SLOT(stepBackward()));
+
+    // moving backwards replays everything up to there, so only do that once the slider is released
+    m_slider->setRange(0, int(qMin<qint64>(m_replay->duration(), std::numeric_limits<int>::max())));
+    m_slider->setSingleStep(StepSize);
+    m_slider->setPageStep(10 * StepSize);
+    m_slider->setTracking(false);
+    addWidget(m_slider);
+    connect(m_slider, SIGNAL(valueChanged(int)), SLOT(seek(int)));
+
+    action = addAction(style()->standardIcon(QStyle::SP_MediaSeekForward), tr("Step Forward"));
+    connect(action, SIGNAL(triggered()), SLOT(stepForward()));
+
+    addWidget(m_positionLabel);
+
+    connect(m_replay, SIGNAL(positionChanged(qint64)), SLOT(positionChanged(qint64)));
+    positionChanged(m_replay->position());
+}
+
+SessionReplayToolBar::~SessionReplayToolBar()
+{
+}
+
+void SessionReplayToolBar::stepBackward()
+{
+    m_replay->setPosition(qMax<qint64>(0, m_replay->position() - StepSize));
+}
+
+void SessionReplayToolBar::stepForward()
+{
+    m_replay->setPosition(qMin(m_replay->duration(), m_replay->position() + StepSize));
+}
+
+void SessionReplayToolBar::seek(int position)
+{
+    if (position != m_replay->position())
+        m_replay->setPosition(position);
+}
+
+void SessionReplayToolBar::positionChanged(qint64 position)
+{
+    m_slider->blockSignals(true);
+    m_slider->setValue(int(position));
+    m_slider->blockSignals(false);
+    m_positionLabel->setText(tr("%1 / %2").arg(formatTime(position),
+                                               formatTime(m_replay->duration())));
+}
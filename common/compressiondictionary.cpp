@@ -0,0 +1,204 @@
+/*
+  compressiondictionary.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "compressiondictionary.h"
+
+#include <QHash>
+#include <QMutexLocker>
+#include <QSet>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace GammaRay;
+
+namespace {
+// dictionary content is selected in segments of this size, scored by how common
+// their grams (byte sequences of GramSize, the minimum LZ4 can make use of) are
+enum {
+    GramSize = sizeof(quint64),
+    SegmentSize = 64
+};
+
+struct Segment
+{
+    int sample;
+    int offset;
+    int size;
+    qint64 score;
+};
+
+bool operator<(const Segment &lhs, const Segment &rhs)
+{
+    return lhs.score > rhs.score;
+}
+}
+
+static quint64 gramAt(const QByteArray &data, int offset)
+{
+    quint64 gram;
+    memcpy(&gram, data.constData() + offset, sizeof(gram));
+    return gram;
+}
+
+static qint64 segmentScore(const QByteArray &sample, int offset, int size,
+                           const QHash<quint64, int> &frequencies)
+{
+    qint64 score = 0;
+    for (int i = offset; i + GramSize <= offset + size; ++i) {
+        // only grams occurring in several samples are worth anything
+        score += qMax(0, frequencies.value(gramAt(sample, i)) - 1);
+    }
+    return score;
+}
+
+CompressionDictionaryTrainer::CompressionDictionaryTrainer()
+    : m_sampleBytes(0)
+    , m_bytesSinceTraining(0)
+    , m_trainingInterval(InitialTrainingInterval)
+{
+}
+
+bool CompressionDictionaryTrainer::addSample(const QByteArray &payload)
+{
+    m_bytesSinceTraining += payload.size();
+
+    if (payload.size() >= GramSize && payload.size() <= MaximumSampleSize) {
+        m_samples.push_back(payload);
+        m_sampleBytes += payload.size();
+        int dropCount = 0;
+        while (m_sampleBytes > SampleBufferSize)
+            m_sampleBytes -= m_samples.at(dropCount++).size();
+        m_samples.remove(0, dropCount);
+    }
+
+    return m_bytesSinceTraining >= m_trainingInterval && !m_samples.isEmpty();
+}
+
+QVector<QByteArray> CompressionDictionaryTrainer::startTraining()
+{
+    m_bytesSinceTraining = 0;
+    m_trainingInterval = qMin<qint64>(m_trainingInterval * 4, MaximumTrainingInterval);
+    return m_samples;
+}
+
+QByteArray CompressionDictionaryTrainer::train(int maxSize)
+{
+    return train(startTraining(), maxSize);
+}
+
+QByteArray CompressionDictionaryTrainer::train(const QVector<QByteArray> &samples, int maxSize)
+{
+    int sampleBytes = 0;
+    foreach (const auto &sample, samples)
+        sampleBytes += sample.size();
+
+    // in how many samples each gram occurs
+    QHash<quint64, int> frequencies;
+    frequencies.reserve(sampleBytes);
+    foreach (const auto &sample, samples) {
+        QSet<quint64> grams;
+        grams.reserve(sample.size());
+        for (int i = 0; i + GramSize <= sample.size(); ++i)
+            grams.insert(gramAt(sample, i));
+        foreach (const auto gram, grams)
+            ++frequencies[gram];
+    }
+
+    QVector<Segment> segments;
+    for (int i = 0; i < samples.size(); ++i) {
+        const auto &sample = samples.at(i);
+        for (int offset = 0; offset + GramSize <= sample.size(); offset += SegmentSize / 2) {
+            const int size = qMin<int>(SegmentSize, sample.size() - offset);
+            const auto score = segmentScore(sample, offset, size, frequencies);
+            if (score > 0)
+                segments.push_back({ i, offset, size, score });
+        }
+    }
+    std::sort(segments.begin(), segments.end());
+
+    QVector<Segment> selected;
+    int dictionarySize = 0;
+    foreach (const auto &segment, segments) {
+        if (dictionarySize + segment.size > maxSize)
+            break;
+
+        // grams already in the dictionary don't count anymore, which mostly
+        // takes care of overlapping and duplicated segments
+        const auto &sample = samples.at(segment.sample);
+        if (segmentScore(sample, segment.offset, segment.size, frequencies) < segment.score / 2)
+            continue;
+        for (int i = segment.offset; i + GramSize <= segment.offset + segment.size; ++i)
+            frequencies.remove(gramAt(sample, i));
+
+        selected.push_back(segment);
+        dictionarySize += segment.size;
+    }
+
+    // later positions win in LZ4's hash table, so put the best segments last
+    QByteArray dictionary;
+    dictionary.reserve(dictionarySize);
+    for (int i = selected.size() - 1; i >= 0; --i) {
+        const auto &segment = selected.at(i);
+        dictionary.append(samples.at(segment.sample).constData() + segment.offset, segment.size);
+    }
+    return dictionary;
+}
+
+CompressionDictionaryBuilder::CompressionDictionaryBuilder(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CompressionDictionaryBuilder::~CompressionDictionaryBuilder()
+{
+}
+
+void CompressionDictionaryBuilder::build(const QVector<QByteArray> &samples)
+{
+    QMutexLocker lock(&m_mutex);
+    const bool wasPending = !m_samples.isEmpty();
+    m_samples = samples;
+    if (!wasPending)
+        QMetaObject::invokeMethod(this, "buildPending", Qt::QueuedConnection);
+}
+
+void CompressionDictionaryBuilder::buildPending()
+{
+    QVector<QByteArray> samples;
+    {
+        QMutexLocker lock(&m_mutex);
+        samples.swap(m_samples);
+    }
+    if (samples.isEmpty())
+        return;
+
+    const auto dictionary = CompressionDictionaryTrainer::train(samples);
+    if (!dictionary.isEmpty())
+        emit built(dictionary);
+}
@@ -0,0 +1,111 @@
+/*
+  compressiondictionary.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_COMPRESSIONDICTIONARY_H
+#define GAMMARAY_COMPRESSIONDICTIONARY_H
+
+#include "gammaray_common_export.h"
+
+#include <QByteArray>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+
+namespace GammaRay {
+/** Builds compression dictionaries from samples of message payloads.
+ *
+ *  Small model and property messages keep repeating the same type names, role ids and
+ *  class names, but each of them alone is too small for LZ4 to find anything to reuse.
+ *  With a dictionary containing the byte sequences common to many messages, LZ4 can
+ *  reference those instead.
+ */
+class GAMMARAY_COMMON_EXPORT CompressionDictionaryTrainer
+{
+public:
+    enum {
+        DictionarySize = 32 * 1024
+    };
+
+    CompressionDictionaryTrainer();
+
+    /** Adds @p payload as a sample. Returns @c true once enough new data has been seen
+     *  to make (re)training worthwhile, the interval grows with each training.
+     */
+    bool addSample(const QByteArray &payload);
+
+    /** Returns the samples collected so far for training, and restarts the interval. */
+    QVector<QByteArray> startTraining();
+
+    /** Builds a dictionary of at most @p maxSize bytes from the samples collected so far. */
+    QByteArray train(int maxSize = DictionarySize);
+    /** Builds a dictionary of at most @p maxSize bytes from @p samples, this can be called
+     *  from any thread.
+     */
+    static QByteArray train(const QVector<QByteArray> &samples, int maxSize = DictionarySize);
+
+private:
+    enum {
+        // the most recent samples to consider, larger ones compress well enough on their own
+        SampleBufferSize = 256 * 1024,
+        MaximumSampleSize = 16 * 1024,
+        InitialTrainingInterval = 64 * 1024,
+        MaximumTrainingInterval = 16 * 1024 * 1024
+    };
+
+    QVector<QByteArray> m_samples;
+    int m_sampleBytes;
+    qint64 m_bytesSinceTraining;
+    qint64 m_trainingInterval;
+};
+
+/** Trains dictionaries in the thread this lives in, so that can be kept out of the way. */
+class GAMMARAY_COMMON_EXPORT CompressionDictionaryBuilder : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CompressionDictionaryBuilder(QObject *parent = nullptr);
+    ~CompressionDictionaryBuilder();
+
+    /** Trains a dictionary from @p samples, this can be called from any thread.
+     *  If there is a training pending already, that uses @p samples instead.
+     */
+    void build(const QVector<QByteArray> &samples);
+
+signals:
+    void built(const QByteArray &dictionary);
+
+private slots:
+    void buildPending();
+
+private:
+    QMutex m_mutex;
+    QVector<QByteArray> m_samples;
+};
+}
+
+#endif // GAMMARAY_COMPRESSIONDICTIONARY_H
@@ -27,9 +27,15 @@
 */
 
 #include "endpoint.h"
+#include "compressiondictionary.h"
 #include "message.h"
+#include "messagetransport.h"
 #include "methodargument.h"
 #include "propertysyncer.h"
+#include "sessionfile.h"
+
+#include <QIODevice>
+#include <QThread>
 
 #include <iostream>
 
@@ -46,10 +52,24 @@ using namespace std;
 
 Endpoint *Endpoint::s_instance = nullptr;
 
+static bool isFlowControlMessage(const Message &msg)
+{
+    return msg.type() == Protocol::FlowControlCredit;
+}
+
 Endpoint::Endpoint(QObject *parent)
     : QObject(parent)
     , m_propertySyncer(new PropertySyncer(this))
-    , m_socket(nullptr)
+    , m_nextConnectionId(1)
+    , m_currentConnection(nullptr)
+    , m_targetConnection(nullptr)
+    , m_replyConnectionId(0)
+    , m_messagePriority(Protocol::MESSAGE_PRIORITY_COUNT)
+    , m_ioThread(nullptr)
+    , m_dictionaryTrainer(nullptr)
+    , m_dictionaryBuilder(nullptr)
+    , m_dictionaryBuilding(false)
+    , m_compressionDictionaryId(0)
     , m_myAddress(Protocol::InvalidObjectAddress +1)
     , m_bytesRead(0)
     , m_bytesWritten(0)
@@ -79,9 +99,29 @@ Endpoint::Endpoint(QObject *parent)
 
 Endpoint::~Endpoint()
 {
+    foreach (auto connection, m_connections) {
+        // processed when the I/O thread finishes
+        if (connection->transport)
+            connection->transport->deleteLater();
+        if (connection->recorder && m_ioThread)
+            connection->recorder->deleteLater();
+        else
+            delete connection->recorder;
+        delete connection;
+    }
+    if (m_dictionaryBuilder && m_ioThread)
+        m_dictionaryBuilder->deleteLater();
+    else
+        delete m_dictionaryBuilder;
+    if (m_ioThread) {
+        m_ioThread->quit();
+        m_ioThread->wait();
+    }
+
     for (auto it = m_addressMap.constBegin(); it != m_addressMap.constEnd(); ++it) {
         delete it.value();
     }
+    delete m_dictionaryTrainer;
 
     s_instance = nullptr;
 }
@@ -97,6 +137,50 @@ void Endpoint::send(const Message &msg)
     s_instance->doSendMessage(msg);
 }
 
+void Endpoint::sendReply(const Message &msg)
+{
+    Q_ASSERT(s_instance);
+    s_instance->m_targetConnection = s_instance->m_currentConnection;
+    s_instance->doSendMessage(msg);
+    s_instance->m_targetConnection = nullptr;
+}
+
+bool Endpoint::isRecorded(Protocol::ObjectAddress address)
+{
+    if (!s_instance)
+        return false;
+
+    foreach (auto connection, s_instance->m_connections) {
+        if (connection->recorder && s_instance->recordsObject(connection, address))
+            return true;
+    }
+    return false;
+}
+
+void Endpoint::record(const Message &msg)
+{
+    Q_ASSERT(s_instance);
+    foreach (auto connection, s_instance->m_connections) {
+        if (!connection->recorder || !s_instance->recordsObject(connection, msg.address()))
+            continue;
+        s_instance->m_targetConnection = connection;
+        s_instance->doSendMessage(msg);
+        s_instance->m_targetConnection = nullptr;
+    }
+}
+
+bool Endpoint::hasRemoteReceiver(Protocol::ObjectAddress address)
+{
+    if (!s_instance)
+        return false;
+
+    foreach (auto connection, s_instance->m_connections) {
+        if (!connection->recorder && s_instance->wantsMessage(connection, address))
+            return true;
+    }
+    return false;
+}
+
 void Endpoint::sendMessage(const Message &msg)
 {
     if (!isConnected())
@@ -108,18 +192,295 @@ void Endpoint::sendMessage(const Message &msg)
 void Endpoint::doSendMessage(const GammaRay::Message &msg)
 {
     Q_ASSERT(msg.address() != Protocol::InvalidObjectAddress);
-    msg.write(m_socket);
-    m_bytesWritten += msg.size();
+    const auto priority = m_messagePriority != Protocol::MESSAGE_PRIORITY_COUNT
+                          ? m_messagePriority
+                          : m_objectPriorities.value(msg.address(),
+                                                     Protocol::defaultPriority(msg.type()));
+
+    QVector<Connection *> receivers;
+    if (m_targetConnection) {
+        receivers.push_back(m_targetConnection);
+    } else if (m_replyConnectionId) {
+        foreach (auto connection, m_connections) {
+            if (connection->id == m_replyConnectionId)
+                receivers.push_back(connection);
+        }
+    } else {
+        receivers.reserve(m_connections.size());
+        foreach (auto connection, m_connections) {
+            if (wantsMessage(connection, msg.address()))
+                receivers.push_back(connection);
+        }
+    }
+
+    // recordings compress on their own
+    bool toRemote = false;
+    foreach (auto connection, receivers)
+        toRemote = toRemote || !connection->recorder;
+    const auto dictionaryId = toRemote ? compressionDictionaryFor(msg, priority) : quint8(0);
+
+    if (m_ioThread) {
+        MessageTransport::RawMessage rawMsg;
+        rawMsg.address = msg.address();
+        rawMsg.type = msg.type();
+        rawMsg.priority = priority;
+        rawMsg.dictionaryId = dictionaryId;
+        rawMsg.payload = msg.rawPayload();
+        // compress only once when fanning out to several endpoints
+        if (receivers.size() > 1)
+            rawMsg.encodedFrames.reset(new QVector<QByteArray>);
+        foreach (auto connection, receivers) {
+            if (connection->recorder)
+                connection->recorder->record(rawMsg.address, rawMsg.type, rawMsg.payload);
+            else
+                connection->transport->send(rawMsg);
+        }
+    } else {
+        foreach (auto connection, receivers) {
+            if (connection->recorder)
+                connection->recorder->record(msg.address(), msg.type(), msg.rawPayload());
+            else
+                Message::writeRawMessage(connection->socket, msg.address(), msg.type(),
+                                         msg.rawPayload(), m_writeScratchSpace, priority,
+                                         dictionaryId);
+        }
+    }
+
+    foreach (auto connection, receivers) {
+        // recordings are written as fast as they come in
+        if (connection->recorder)
+            continue;
+        m_bytesWritten += msg.size();
+        if (!isFlowControlMessage(msg))
+            connection->totalBytesSent += msg.size();
+    }
+}
+
+quint8 Endpoint::compressionDictionaryFor(const Message &msg, Protocol::MessagePriority priority)
+{
+    if (!m_dictionaryTrainer
+        || (priority != Protocol::ModelPriority && msg.type() != Protocol::PropertyValuesChanged))
+        return 0;
+
+    if (m_dictionaryTrainer->addSample(msg.rawPayload()) && !m_dictionaryBuilding
+        && m_compressionDictionaryId < MaximumCompressionDictionaries) {
+        // this takes a while, meanwhile messages keep using the current dictionary
+        m_dictionaryBuilding = true;
+        m_dictionaryBuilder->build(m_dictionaryTrainer->startTraining());
+    }
+    return m_compressionDictionaryId;
+}
+
+void Endpoint::compressionDictionaryBuilt(const QByteArray &dictionary)
+{
+    m_dictionaryBuilding = false;
+    m_compressionDictionary = dictionary;
+    Message::addCompressionDictionary(++m_compressionDictionaryId, m_compressionDictionary);
+
+    // everyone needs this before the first message compressed with it
+    const auto target = m_targetConnection;
+    const auto replyConnectionId = m_replyConnectionId;
+    m_targetConnection = nullptr;
+    m_replyConnectionId = 0;
+    sendCompressionDictionary();
+    m_targetConnection = target;
+    m_replyConnectionId = replyConnectionId;
+}
+
+void Endpoint::sendCompressionDictionary()
+{
+    if (!m_compressionDictionaryId)
+        return;
+    Message msg(m_myAddress, Protocol::CompressionDictionary);
+    msg << m_compressionDictionaryId << m_compressionDictionary;
+    doSendMessage(msg);
+}
+
+void Endpoint::enableCompressionDictionaries()
+{
+    Q_ASSERT(!m_dictionaryTrainer);
+    m_dictionaryTrainer = new CompressionDictionaryTrainer;
+    m_dictionaryBuilder = new CompressionDictionaryBuilder;
+    if (m_ioThread)
+        m_dictionaryBuilder->moveToThread(m_ioThread);
+    connect(m_dictionaryBuilder, SIGNAL(built(QByteArray)),
+            this, SLOT(compressionDictionaryBuilt(QByteArray)));
+}
+
+bool Endpoint::wantsMessage(const Connection *connection, Protocol::ObjectAddress address) const
+{
+    if (connection->recorder)
+        return recordsObject(connection, address);
+
+    if (m_monitoringRestrictedObjects.contains(address)
+        && !connection->monitoredObjects.contains(address))
+        return false;
+
+    return true;
 }
 
 void Endpoint::waitForMessagesWritten()
 {
-    m_socket->waitForBytesWritten(-1);
+    foreach (auto connection, m_connections) {
+        if (connection->recorder)
+            connection->recorder->flush();
+        else if (connection->transport)
+            connection->transport->flush();
+        else if (connection->socket)
+            connection->socket->waitForBytesWritten(-1);
+    }
 }
 
 bool Endpoint::isConnected()
 {
-    return s_instance && s_instance->m_socket;
+    return s_instance && !s_instance->m_connections.isEmpty();
+}
+
+int Endpoint::connectionCount() const
+{
+    int count = 0;
+    foreach (auto connection, m_connections) {
+        if (!connection->recorder)
+            ++count;
+    }
+    return count;
+}
+
+void Endpoint::addRecorder(SessionFileWriter *writer, const QStringList &objectNames)
+{
+    Q_ASSERT(writer);
+
+    auto connection = new Connection;
+    connection->id = m_nextConnectionId++;
+    connection->recorder = writer;
+    connection->recordedObjects = objectNames;
+    Q_ASSERT(!writer->parent());
+    if (m_ioThread)
+        writer->moveToThread(m_ioThread);
+    m_connections.push_back(connection);
+
+    // the recording starts with the same greeting a connecting client gets
+    m_currentConnection = connection;
+    connectionAdded();
+    m_currentConnection = nullptr;
+
+    foreach (const auto address, m_monitoringRestrictedObjects) {
+        if (recordsObject(connection, address))
+            setObjectMonitored(connection, address, true);
+    }
+}
+
+bool Endpoint::isRecording() const
+{
+    foreach (auto connection, m_connections) {
+        if (connection->recorder)
+            return true;
+    }
+    return false;
+}
+
+bool Endpoint::recordsObject(const Connection *connection, Protocol::ObjectAddress address) const
+{
+    Q_ASSERT(connection->recorder);
+    if (connection->recordedObjects.isEmpty() || address == m_myAddress
+        || address == m_propertySyncer->address())
+        return true;
+
+    const auto obj = m_addressMap.value(address, nullptr);
+    if (!obj)
+        return false;
+    foreach (const auto &name, connection->recordedObjects) {
+        if (obj->name.startsWith(name))
+            return true;
+    }
+    return false;
+}
+
+qint64 Endpoint::sendBudget()
+{
+    if (!isConnected())
+        return SendWindowSize;
+    return qMax<qint64>(0, SendWindowSize - static_cast<qint64>(s_instance->bufferedBytes()));
+}
+
+quint32 Endpoint::currentConnectionId()
+{
+    if (!s_instance || !s_instance->m_currentConnection)
+        return 0;
+    return s_instance->m_currentConnection->id;
+}
+
+Endpoint::ReplyGuard::ReplyGuard(quint32 connectionId)
+    : m_previousConnectionId(0)
+{
+    if (!s_instance)
+        return;
+    m_previousConnectionId = s_instance->m_replyConnectionId;
+    s_instance->m_replyConnectionId = connectionId;
+}
+
+Endpoint::ReplyGuard::~ReplyGuard()
+{
+    if (s_instance)
+        s_instance->m_replyConnectionId = m_previousConnectionId;
+}
+
+quint64 Endpoint::bufferedBytes() const
+{
+    // recordings have nothing buffered as far as flow control is concerned
+    quint64 buffered = 0;
+    foreach (auto connection, m_connections) {
+        if (!connection->recorder)
+            buffered = qMax(buffered, connection->bufferedBytes());
+    }
+    return buffered;
+}
+
+quint64 Endpoint::remoteBufferedBytes() const
+{
+    quint64 buffered = 0;
+    foreach (auto connection, m_connections)
+        buffered = qMax(buffered, connection->remoteBufferedBytes);
+    return buffered;
+}
+
+void Endpoint::setObjectPriority(Protocol::ObjectAddress address,
+                                 Protocol::MessagePriority priority)
+{
+    Q_ASSERT(address != Protocol::InvalidObjectAddress);
+    m_objectPriorities.insert(address, priority);
+}
+
+void Endpoint::setMethodPriority(Protocol::ObjectAddress address, const QByteArray &method,
+                                 Protocol::MessagePriority priority)
+{
+    Q_ASSERT(address != Protocol::InvalidObjectAddress);
+    Q_ASSERT(!method.isEmpty());
+    m_methodPriorities.insert(qMakePair(address, method), priority);
+}
+
+static void mergeLatencies(QVector<quint32> &latencies, const QVector<quint32> &other)
+{
+    if (latencies.size() < other.size())
+        latencies.resize(other.size());
+    for (int i = 0; i < other.size(); ++i)
+        latencies[i] = qMax(latencies.at(i), other.at(i));
+}
+
+QVector<quint32> Endpoint::remoteAverageLatencies() const
+{
+    QVector<quint32> latencies;
+    foreach (auto connection, m_connections)
+        mergeLatencies(latencies, connection->remoteAverageLatencies);
+    return latencies;
+}
+
+QVector<quint32> Endpoint::remoteMaximumLatencies() const
+{
+    QVector<quint32> latencies;
+    foreach (auto connection, m_connections)
+        mergeLatencies(latencies, connection->remoteMaximumLatencies);
+    return latencies;
 }
 
 quint16 Endpoint::defaultPort()
@@ -149,39 +510,261 @@ void Endpoint::logTransmissionRate()
     }
     m_bytesRead = 0;
     m_bytesWritten = 0;
+
+    foreach (auto connection, m_connections) {
+        if (connection->recorder)
+            continue;
+
+        bool hasLatencies = false;
+        if (connection->transport) {
+            const auto latencies = connection->transport->takeLatencyStatistics();
+            connection->averageLatencies.resize(latencies.size());
+            connection->maximumLatencies.resize(latencies.size());
+            for (int i = 0; i < latencies.size(); ++i) {
+                const auto &stats = latencies.at(i);
+                connection->averageLatencies[i] = stats.count ? stats.totalTime / stats.count : 0;
+                connection->maximumLatencies[i] = stats.maximumTime;
+                hasLatencies = hasLatencies || stats.count;
+            }
+        }
+
+        // make sure the other side gets its credit even when we are not receiving much
+        if (connection->totalBytesReceived != connection->totalBytesReceivedAtLastCredit
+            || connection->bufferedBytes() != connection->reportedBufferedBytes || hasLatencies)
+            sendFlowControlCredit(connection);
+    }
 }
 
 void Endpoint::setDevice(QIODevice *device)
 {
-    Q_ASSERT(!m_socket);
     Q_ASSERT(device);
-    m_socket = device;
-    connect(m_socket.data(), SIGNAL(readyRead()), SLOT(readyRead()));
-    connect(m_socket.data(), SIGNAL(disconnected()), SLOT(connectionClosed()));
-    if (m_socket->bytesAvailable())
+    // synchronous I/O only supports a single connection
+    Q_ASSERT(m_ioThread || connectionCount() == 0);
+
+    auto connection = new Connection;
+    connection->id = m_nextConnectionId++;
+    if (m_ioThread) {
+        connection->transport = new MessageTransport(device);
+        connect(connection->transport, SIGNAL(messagesReceived()), this,
+                SLOT(transportMessagesReceived()), Qt::QueuedConnection);
+        connect(connection->transport, SIGNAL(disconnected()), this, SLOT(connectionClosed()),
+                Qt::QueuedConnection);
+        connection->transport->moveToThread(m_ioThread);
+    } else {
+        connection->socket = device;
+        connect(device, SIGNAL(readyRead()), SLOT(readyRead()));
+        connect(device, SIGNAL(disconnected()), SLOT(connectionClosed()));
+    }
+    m_connections.push_back(connection);
+
+    m_currentConnection = connection;
+    connectionAdded();
+    // the new endpoint can't decompress anything without the current dictionary
+    m_targetConnection = connection;
+    sendCompressionDictionary();
+    m_targetConnection = nullptr;
+    m_currentConnection = nullptr;
+
+    if (connection->socket && connection->socket->bytesAvailable())
         readyRead();
 }
 
+void Endpoint::connectionAdded()
+{
+}
+
+void Endpoint::setIOThread(QThread *thread)
+{
+    Q_ASSERT(!m_ioThread);
+    Q_ASSERT(!isConnected());
+    Q_ASSERT(thread);
+    m_ioThread = thread;
+    m_ioThread->start();
+}
+
+QThread *Endpoint::ioThread() const
+{
+    return m_ioThread;
+}
+
+void Endpoint::setObjectMonitored(Protocol::ObjectAddress address, bool monitored)
+{
+    Q_ASSERT(m_currentConnection);
+    if (m_currentConnection)
+        setObjectMonitored(m_currentConnection, address, monitored);
+}
+
+void Endpoint::setObjectMonitored(Connection *connection, Protocol::ObjectAddress address,
+                                  bool monitored)
+{
+    const bool wasMonitored = isObjectMonitored(address);
+    if (monitored)
+        connection->monitoredObjects.insert(address);
+    else
+        connection->monitoredObjects.remove(address);
+
+    if (wasMonitored != isObjectMonitored(address))
+        objectMonitoredChanged(address, monitored);
+}
+
+bool Endpoint::isObjectMonitored(Protocol::ObjectAddress address) const
+{
+    foreach (auto connection, m_connections) {
+        if (connection->monitoredObjects.contains(address))
+            return true;
+    }
+    return false;
+}
+
+void Endpoint::objectMonitoredChanged(Protocol::ObjectAddress address, bool monitored)
+{
+    Q_UNUSED(address);
+    Q_UNUSED(monitored);
+}
+
+void Endpoint::restrictToMonitoringEndpoints(Protocol::ObjectAddress address)
+{
+    Q_ASSERT(address != Protocol::InvalidObjectAddress);
+    m_monitoringRestrictedObjects.insert(address);
+
+    foreach (auto connection, m_connections) {
+        if (connection->recorder && recordsObject(connection, address))
+            setObjectMonitored(connection, address, true);
+    }
+}
+
 Protocol::ObjectAddress Endpoint::endpointAddress() const
 {
     return m_myAddress;
 }
 
+Endpoint::Connection *Endpoint::senderConnection() const
+{
+    const auto obj = sender();
+    if (!obj)
+        return nullptr;
+    foreach (auto connection, m_connections) {
+        if (connection->transport == obj || connection->socket.data() == obj)
+            return connection;
+    }
+    return nullptr;
+}
+
 void Endpoint::readyRead()
 {
-    while (Message::canReadMessage(m_socket.data())) {
-        const auto msg = Message::readMessage(m_socket.data());
-        m_bytesRead += msg.size();
-        messageReceived(msg);
+    auto connection = senderConnection();
+    if (!connection) { // called directly from setDevice()
+        foreach (auto c, m_connections) {
+            if (c->socket)
+                connection = c;
+        }
+    }
+    if (!connection)
+        return;
+
+    while (Message::canReadMessage(connection->socket.data())) {
+        QString error;
+        const auto msg = Message::readMessage(connection->socket.data(), &connection->fragments,
+                                              &error);
+        if (!error.isEmpty()) {
+            cerr << "protocol error, closing connection: " << qPrintable(error) << endl;
+            connection->socket->close();
+            return;
+        }
+        if (msg.type() != Protocol::InvalidMessageType) // only a fragment so far
+            processIncomingMessage(connection, msg);
+        if (!m_connections.contains(connection)) // disconnected meanwhile
+            return;
+    }
+}
+
+void Endpoint::transportMessagesReceived()
+{
+    auto connection = senderConnection();
+    if (!connection)
+        return;
+
+    const auto msgs = connection->transport->takeReceivedMessages();
+    foreach (const auto &rawMsg, msgs) {
+        const auto msg = Message::fromRawPayload(rawMsg.address, rawMsg.type, rawMsg.payload);
+        processIncomingMessage(connection, msg);
+        if (!m_connections.contains(connection)) // disconnected meanwhile
+            return;
+    }
+}
+
+void Endpoint::processIncomingMessage(Connection *connection, const Message &msg)
+{
+    m_bytesRead += msg.size();
+
+    if (isFlowControlMessage(msg)) {
+        const bool wasExhausted = sendBudget() <= 0;
+        quint64 acknowledged;
+        msg >> acknowledged >> connection->remoteBufferedBytes
+            >> connection->remoteAverageLatencies >> connection->remoteMaximumLatencies;
+        connection->totalBytesAcknowledged = qMin(acknowledged, connection->totalBytesSent);
+        if (wasExhausted && sendBudget() > 0)
+            emit sendBudgetAvailable();
+        return;
     }
+
+    m_currentConnection = connection;
+    messageReceived(msg);
+    m_currentConnection = nullptr;
+    if (!m_connections.contains(connection))
+        return;
+
+    // acknowledge only after processing, so a busy receiver slows down the sender as well
+    connection->totalBytesReceived += msg.size();
+    if (connection->totalBytesReceived - connection->totalBytesReceivedAtLastCredit
+        >= CreditInterval)
+        sendFlowControlCredit(connection);
+}
+
+void Endpoint::sendFlowControlCredit(Connection *connection)
+{
+    connection->totalBytesReceivedAtLastCredit = connection->totalBytesReceived;
+    connection->reportedBufferedBytes = connection->bufferedBytes();
+
+    Message msg(endpointAddress(), Protocol::FlowControlCredit);
+    msg << connection->totalBytesReceived << connection->reportedBufferedBytes
+        << connection->averageLatencies << connection->maximumLatencies;
+    m_targetConnection = connection;
+    send(msg);
+    m_targetConnection = nullptr;
 }
 
 void Endpoint::connectionClosed()
 {
-    disconnect(m_socket.data(), SIGNAL(readyRead()), this, SLOT(readyRead()));
-    disconnect(m_socket.data(), SIGNAL(disconnected()), this, SLOT(connectionClosed()));
-    m_socket = nullptr;
-    emit disconnected();
+    auto connection = senderConnection();
+    if (!connection)
+        return;
+
+    const bool wasExhausted = sendBudget() <= 0;
+    m_connections.removeOne(connection);
+    if (m_currentConnection == connection)
+        m_currentConnection = nullptr;
+
+    if (connection->transport) {
+        connection->transport->deleteLater();
+    } else {
+        disconnect(connection->socket.data(), SIGNAL(readyRead()), this, SLOT(readyRead()));
+        disconnect(connection->socket.data(), SIGNAL(disconnected()), this, SLOT(connectionClosed()));
+    }
+
+    // objects nobody else is interested in aren't monitored anymore
+    foreach (const auto address, connection->monitoredObjects) {
+        if (!isObjectMonitored(address))
+            objectMonitoredChanged(address, false);
+    }
+    const auto connectionId = connection->id;
+    delete connection;
+    emit connectionRemoved(connectionId);
+
+    if (connectionCount() == 0)
+        emit disconnected();
+    else if (wasExhausted && sendBudget() > 0)
+        emit sendBudgetAvailable();
 }
 
 Protocol::ObjectAddress Endpoint::objectAddress(const QString &objectName) const
@@ -234,7 +817,15 @@ void Endpoint::invokeObject(const QString &objectName, const char *method,
     const QByteArray name(method);
     Q_ASSERT(!name.isEmpty());
     msg << name << args;
+
+    const auto it = m_methodPriorities.constFind(qMakePair(obj->address, name));
+    if (it == m_methodPriorities.constEnd()) {
+        send(msg);
+        return;
+    }
+    s_instance->m_messagePriority = it.value();
     send(msg);
+    s_instance->m_messagePriority = Protocol::MESSAGE_PRIORITY_COUNT;
 }
 
 void Endpoint::invokeObjectLocal(QObject *object, const char *method,
@@ -402,6 +993,14 @@ void Endpoint::removeObjectInfo(Endpoint::ObjectInfo *oi)
 {
     Q_ASSERT(m_addressMap.contains(oi->address));
     m_addressMap.remove(oi->address);
+    m_objectPriorities.remove(oi->address);
+    for (auto it = m_methodPriorities.begin(); it != m_methodPriorities.end();) {
+        if (it.key().first == oi->address)
+            it = m_methodPriorities.erase(it);
+        else
+            ++it;
+    }
+    m_monitoringRestrictedObjects.remove(oi->address);
     Q_ASSERT(m_nameMap.contains(oi->name));
     m_nameMap.remove(oi->name);
 
@@ -30,11 +30,14 @@
 #define GAMMARAY_ENDPOINT_H
 
 #include "gammaray_common_export.h"
+#include "message.h"
 #include "protocol.h"
 
 #include <QMetaMethod>
 #include <QObject>
 #include <QPointer>
+#include <QSet>
+#include <QStringList>
 #include <QTimer>
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
@@ -46,12 +49,17 @@ Q_DECLARE_LOGGING_CATEGORY(networkstatistics)
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
+class QThread;
 class QUrl;
 QT_END_NAMESPACE
 
 namespace GammaRay {
+class CompressionDictionaryBuilder;
+class CompressionDictionaryTrainer;
 class Message;
+class MessageTransport;
 class PropertySyncer;
+class SessionFileWriter;
 
 /*! Network protocol endpoint.
  *
@@ -68,9 +76,94 @@ public:
     /*! Send @p msg to the connected endpoint. */
     static void send(const Message &msg);
 
-    /*! Returns @c true if we are currently connected to another endpoint. */
+    /*! Send @p msg only to the endpoint that sent the message currently being processed.
+     *  Use this for replies other connected endpoints can't make sense of. Outside of message
+     *  processing this is the same as send().
+     */
+    static void sendReply(const Message &msg);
+
+    /*! Returns @c true if we are currently connected to another endpoint, or recording. */
     static bool isConnected();
 
+    /*! Returns @c true if messages from the object at @p address are being recorded.
+     *  @see addRecorder()
+     */
+    static bool isRecorded(Protocol::ObjectAddress address);
+    /*! Send @p msg only to the recordings of its object, not to connected endpoints.
+     *  Use this for data recordings need in addition to what is sent anyway, as nobody
+     *  can request it later on.
+     */
+    static void record(const Message &msg);
+    /*! Returns @c true if messages from the object at @p address are sent to any connected
+     *  endpoint, not counting recordings. Use this to avoid waiting for replies nobody sends.
+     */
+    static bool hasRemoteReceiver(Protocol::ObjectAddress address);
+
+    /*! Returns the number of bytes that can be sent before exceeding the flow control window.
+     *  Producers of large or high-rate data that can be dropped or delayed (frames, live
+     *  statistics, bulk transfers) should check this before sending, and wait for
+     *  sendBudgetAvailable() if it is exhausted.
+     *  With several connected endpoints this is limited by the slowest one, as everything
+     *  such producers send goes to all of them.
+     */
+    static qint64 sendBudget();
+
+    /*! Identifies the endpoint that sent the message currently being processed, for keeping
+     *  per-endpoint state. Ids are not reused, 0 means there is no such endpoint, e.g. outside
+     *  of message processing or in in-process mode.
+     *  @see connectionRemoved()
+     */
+    static quint32 currentConnectionId();
+
+    /*! Sends everything sent during its lifetime only to the endpoint identified by
+     *  @p connectionId, such as signals carrying the reply to an earlier request of that
+     *  endpoint. Nothing is sent if that endpoint disconnected meanwhile, a @p connectionId
+     *  of 0 doesn't restrict anything.
+     *  @see currentConnectionId()
+     */
+    class GAMMARAY_COMMON_EXPORT ReplyGuard
+    {
+    public:
+        explicit ReplyGuard(quint32 connectionId);
+        ~ReplyGuard();
+
+    private:
+        Q_DISABLE_COPY(ReplyGuard)
+        quint32 m_previousConnectionId;
+    };
+
+    /*! Number of bytes sent to the other endpoint which it has not processed yet.
+     *  With several connected endpoints this is the largest value among them.
+     */
+    quint64 bufferedBytes() const;
+    /*! Number of bytes the other endpoint sent to us which we have not processed yet, as last
+     *  reported by the other endpoint. With several connected endpoints this is the largest
+     *  value among them.
+     */
+    quint64 remoteBufferedBytes() const;
+
+    /*! Schedule all messages sent from the object at @p address with @p priority, rather than
+     *  the default priority for their message type.
+     *  Priorities are only taken into account when using an I/O thread.
+     *  @see setIOThread()
+     */
+    void setObjectPriority(Protocol::ObjectAddress address, Protocol::MessagePriority priority);
+    /*! Schedule calls of @p method sent from the object at @p address via invokeObject()
+     *  with @p priority, e.g. for signals carrying streamed data, while the other messages
+     *  of that object keep their priority.
+     *  @see setObjectPriority()
+     */
+    void setMethodPriority(Protocol::ObjectAddress address, const QByteArray &method,
+                           Protocol::MessagePriority priority);
+
+    /*! Average and maximum time in milliseconds messages of each priority class spent
+     *  in the send queue of the other endpoint during the last second, as reported by
+     *  the other endpoint. With several connected endpoints this is the largest value
+     *  among them.
+     */
+    QVector<quint32> remoteAverageLatencies() const;
+    QVector<quint32> remoteMaximumLatencies() const;
+
     static quint16 defaultPort();
     static quint16 broadcastPort();
 
@@ -161,7 +254,7 @@ public slots:
 signals:
     /*! Emitted when a connection to another endpoint was successfully established and passed the protocol version handshake step. */
     void connectionEstablished();
-    /*! Emitted when we lost the connection to the other endpoint. */
+    /*! Emitted when we lost the connection to the last connected endpoint. */
     void disconnected();
 
     /*! Emitted when a new object with name @p objectName has been registered at address @p objectAddress. */
@@ -170,12 +263,73 @@ signals:
 
     void logTransmissionRate(quint64 bytesRead, quint64 bytesWritten);
 
+    /*! Emitted when the send budget becomes available again after it had been exhausted. */
+    void sendBudgetAvailable();
+
+    /*! Emitted when the endpoint identified by @p connectionId disconnected.
+     *  @see currentConnectionId()
+     */
+    void connectionRemoved(quint32 connectionId);
+
 protected:
     ///@cond internal
     Endpoint(QObject *parent = nullptr);
-    /*! Call with the socket once you have established a connection to another endpoint, takes ownership of @p device. */
+    /*! Call with the socket once you have established a connection to another endpoint, takes ownership of @p device.
+     *  Several connections are only supported when using an I/O thread.
+     *  @see setIOThread(), connectionAdded()
+     */
     void setDevice(QIODevice *device);
 
+    /*! Called from setDevice() for a new connection, replies sent from here only go to
+     *  the new endpoint.
+     *  @see sendReply()
+     */
+    virtual void connectionAdded();
+
+    /*! Number of currently connected endpoints, not counting recordings. */
+    int connectionCount() const;
+
+    /*! Record all messages sent from objects whose names start with any of @p objectNames
+     *  (or all objects if empty) using @p writer, taking ownership of it. This behaves
+     *  like another connected endpoint monitoring those objects, but without flow control.
+     *  @p writer must not have a parent, it is moved to the I/O thread, if any.
+     */
+    void addRecorder(SessionFileWriter *writer, const QStringList &objectNames);
+    /*! Returns @c true if any recording has been added. */
+    bool isRecording() const;
+
+    /*! Perform socket I/O, message framing and compression for devices passed to setDevice()
+     *  in @p thread rather than in the thread this endpoint lives in. This also enables
+     *  scheduling outgoing messages by priority.
+     *  The thread is started here and stopped on destruction, ownership is not transferred.
+     */
+    void setIOThread(QThread *thread);
+    /*! The I/O thread set via setIOThread(), if any. */
+    QThread *ioThread() const;
+
+    /*! Train compression dictionaries on the model and property messages sent from here,
+     *  and compress those messages with them. The dictionaries are sent to the connected
+     *  endpoints as needed, so only one side of a connection should enable this.
+     *  Training happens in the I/O thread, if set before calling this.
+     */
+    void enableCompressionDictionaries();
+
+    /*! Record whether the endpoint that sent the message currently being processed
+     *  is interested in the object at @p address.
+     *  @see objectMonitoredChanged()
+     */
+    void setObjectMonitored(Protocol::ObjectAddress address, bool monitored);
+    /*! Returns @c true if any connected endpoint is interested in the object at @p address. */
+    bool isObjectMonitored(Protocol::ObjectAddress address) const;
+    /*! Called when the first connected endpoint becomes interested in the object at
+     *  @p address, or the last one loses interest, including by disconnecting.
+     */
+    virtual void objectMonitoredChanged(Protocol::ObjectAddress address, bool monitored);
+    /*! Only send messages from the object at @p address to endpoints interested in it,
+     *  rather than to all connected endpoints.
+     */
+    void restrictToMonitoringEndpoints(Protocol::ObjectAddress address);
+
     /*! The object address of the other endpoint. */
     Protocol::ObjectAddress endpointAddress() const;
 
@@ -222,12 +376,84 @@ protected:
 
 private slots:
     void readyRead();
+    void transportMessagesReceived();
     void logTransmissionRate();
     void connectionClosed();
     void handlerDestroyed(QObject *obj);
     void objectDestroyed(QObject *obj);
+    void compressionDictionaryBuilt(const QByteArray &dictionary);
 
 private:
+    enum {
+        SendWindowSize = 8 * 1024 * 1024,
+        CreditInterval = SendWindowSize / 4,
+        // retraining gets rarer over time, so this is only reached by very long sessions
+        MaximumCompressionDictionaries = 16
+    };
+
+    /*! State of a connection to another endpoint. */
+    struct Connection
+    {
+        Connection()
+            : id(0)
+            , transport(nullptr)
+            , recorder(nullptr)
+            , totalBytesSent(0)
+            , totalBytesReceived(0)
+            , totalBytesAcknowledged(0)
+            , totalBytesReceivedAtLastCredit(0)
+            , remoteBufferedBytes(0)
+            , reportedBufferedBytes(0)
+        {
+        }
+
+        quint64 bufferedBytes() const
+        {
+            return totalBytesSent - totalBytesAcknowledged;
+        }
+
+        quint32 id;
+        // either of those, depending on whether we have an I/O thread
+        QPointer<QIODevice> socket;
+        MessageTransport *transport;
+        // or this for recordings, which exclusively record objects starting with those names
+        SessionFileWriter *recorder;
+        QStringList recordedObjects;
+
+        Message::FragmentBuffer fragments;
+        QSet<Protocol::ObjectAddress> monitoredObjects;
+
+        // flow control, in bytes of message payload since the connection was established
+        quint64 totalBytesSent;
+        quint64 totalBytesReceived;
+        quint64 totalBytesAcknowledged;
+        quint64 totalBytesReceivedAtLastCredit;
+        quint64 remoteBufferedBytes;
+        quint64 reportedBufferedBytes;
+        QVector<quint32> averageLatencies;
+        QVector<quint32> maximumLatencies;
+        QVector<quint32> remoteAverageLatencies;
+        QVector<quint32> remoteMaximumLatencies;
+    };
+
+    /*! Flow control accounting for incoming messages, before passing them on. */
+    void processIncomingMessage(Connection *connection, const Message &msg);
+    void sendFlowControlCredit(Connection *connection);
+    void setObjectMonitored(Connection *connection, Protocol::ObjectAddress address,
+                            bool monitored);
+    /*! Returns @c true if the recording @p connection includes the object at @p address. */
+    bool recordsObject(const Connection *connection, Protocol::ObjectAddress address) const;
+    /*! Returns @c true if a message from @p address should be sent to @p connection. */
+    bool wantsMessage(const Connection *connection, Protocol::ObjectAddress address) const;
+    /*! The connection whose socket or transport emitted the signal currently handled. */
+    Connection *senderConnection() const;
+    /*! Compression dictionary to use for @p msg, 0 for none. This also feeds the dictionary
+     *  training, a newly trained dictionary is sent and used once the training finished.
+     */
+    quint8 compressionDictionaryFor(const Message &msg, Protocol::MessagePriority priority);
+    /*! Sends the current compression dictionary, if any. */
+    void sendCompressionDictionary();
+
     struct ObjectInfo
     {
         ObjectInfo()
@@ -257,7 +483,26 @@ private:
     QHash<QObject *, ObjectInfo *> m_objectMap;
     QMultiHash<QObject *, ObjectInfo *> m_handlerMap;
 
-    QPointer<QIODevice> m_socket;
+    QVector<Connection *> m_connections;
+    quint32 m_nextConnectionId;
+    // the connection the message currently being processed came from
+    Connection *m_currentConnection;
+    // if set, messages are only sent to this connection
+    Connection *m_targetConnection;
+    // if not 0, messages not sent to m_targetConnection only go to the connection with this id
+    quint32 m_replyConnectionId;
+    // if not MESSAGE_PRIORITY_COUNT, overrides the priority of the message being sent
+    Protocol::MessagePriority m_messagePriority;
+    QThread *m_ioThread;
+    CompressionDictionaryTrainer *m_dictionaryTrainer;
+    CompressionDictionaryBuilder *m_dictionaryBuilder;
+    bool m_dictionaryBuilding;
+    QByteArray m_compressionDictionary;
+    quint8 m_compressionDictionaryId;
+    QByteArray m_writeScratchSpace;
+    QHash<Protocol::ObjectAddress, Protocol::MessagePriority> m_objectPriorities;
+    QHash<QPair<Protocol::ObjectAddress, QByteArray>, Protocol::MessagePriority> m_methodPriorities;
+    QSet<Protocol::ObjectAddress> m_monitoringRestrictedObjects;
     Protocol::ObjectAddress m_myAddress;
     quint64 m_bytesRead;
     quint64 m_bytesWritten;
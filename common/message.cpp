@@ -33,34 +33,104 @@
 
 #include <QBuffer>
 #include <QDebug>
+#include <QMutex>
 #include <qendian.h>
 
-inline void compress(const QByteArray &src, QByteArray &dst)
+namespace {
+struct CompressionDictionary
+{
+    QByteArray data;
+    // LZ4 stream state with the dictionary loaded already, copied for every use
+    QByteArray streamState;
+};
+
+struct CompressionDictionaryRegistry
+{
+    QMutex mutex;
+    QHash<quint8, CompressionDictionary> dictionaries;
+};
+}
+
+Q_GLOBAL_STATIC(CompressionDictionaryRegistry, s_compressionDictionaries)
+
+static CompressionDictionary compressionDictionary(quint8 id)
+{
+    QMutexLocker lock(&s_compressionDictionaries()->mutex);
+    return s_compressionDictionaries()->dictionaries.value(id);
+}
+
+static const int compressionHeaderSize = sizeof(qint32) + sizeof(quint8);
+
+inline void compress(const QByteArray &src, QByteArray &dst, int acceleration,
+                     quint8 dictionaryId = 0, const CompressionDictionary *dictionary = nullptr)
 {
     const qint32 srcSz = src.size();
 
-    dst.resize(LZ4_compressBound(srcSz + sizeof(srcSz)));
+    dst.resize(LZ4_compressBound(srcSz) + compressionHeaderSize);
     *(qint32 *)dst.data() = srcSz; // save the source size
-
-    const int sz
-        = LZ4_compress_default(src.constData(), dst.data() + sizeof(int), srcSz, dst.size());
-    dst.resize(sz + sizeof(srcSz));
+    dst[sizeof(srcSz)] = char(dictionaryId);
+
+    int sz;
+    if (dictionary) {
+        LZ4_stream_t stream;
+        memcpy(&stream, dictionary->streamState.constData(), sizeof(stream));
+        sz = LZ4_compress_fast_continue(&stream, src.constData(), dst.data() + compressionHeaderSize,
+                                        srcSz, dst.size() - compressionHeaderSize, acceleration);
+    } else {
+        sz = LZ4_compress_fast(src.constData(), dst.data() + compressionHeaderSize, srcSz,
+                               dst.size() - compressionHeaderSize, acceleration);
+    }
+    dst.resize(sz > 0 ? sz + compressionHeaderSize : 0);
 }
 
-inline void uncompress(const QByteArray &src, QByteArray &dst)
+/** Returns @c false if @p src can't be decompressed, e.g. because it refers to an unknown
+ *  dictionary, @p error then says why.
+ */
+inline bool uncompress(const QByteArray &src, QByteArray &dst, QString *error)
 {
+    dst.resize(0);
+    if (src.size() < compressionHeaderSize) {
+        *error = QStringLiteral("truncated compressed payload");
+        return false;
+    }
+
     const qint32 dstSz = *(const qint32 *)src.constData(); // get the dest size
-    dst.resize(dstSz);
-    const int sz = LZ4_decompress_safe(src.constData() + sizeof(dstSz), dst.data(),
-                                       src.size()- sizeof(dstSz), dstSz);
-    if (sz <= 0)
+    const quint8 dictionaryId = src.at(sizeof(dstSz));
+    if (dstSz < 0) {
+        *error = QStringLiteral("invalid uncompressed size %1").arg(dstSz);
+        return false;
+    }
+
+    int sz;
+    if (dictionaryId) {
+        const auto dictionary = compressionDictionary(dictionaryId);
+        if (dictionary.data.isEmpty()) {
+            *error = QStringLiteral("unknown compression dictionary %1").arg(dictionaryId);
+            return false;
+        }
+        dst.resize(dstSz);
+        sz = LZ4_decompress_safe_usingDict(src.constData() + compressionHeaderSize, dst.data(),
+                                           src.size() - compressionHeaderSize, dstSz,
+                                           dictionary.data.constData(), dictionary.data.size());
+    } else {
+        dst.resize(dstSz);
+        sz = LZ4_decompress_safe(src.constData() + compressionHeaderSize, dst.data(),
+                                 src.size() - compressionHeaderSize, dstSz);
+    }
+    if (sz < 0 || sz != dstSz) {
         dst.resize(0);
-    else
-        dst.resize(sz);
+        *error = QStringLiteral("malformed compressed payload");
+        return false;
+    }
+    return true;
 }
 
 static quint8 s_streamVersion = GammaRay::Message::lowestSupportedDataVersion();
 static const int minimumUncompressedSize = 32;
+// without a dictionary, LZ4 hardly finds anything to reuse in payloads smaller than this
+static const int minimumUncompressedSizeWithoutDictionary = 128;
+// LZ4 acceleration factor for stream data, trading compression ratio for speed
+static const int streamAcceleration = 8;
 
 template<typename T> static T readNumber(QIODevice *device)
 {
@@ -183,31 +253,89 @@ bool Message::canReadMessage(QIODevice *device)
 }
 
 Message Message::readMessage(QIODevice *device)
+{
+    return readMessage(device, nullptr);
+}
+
+Message Message::readMessage(QIODevice *device, FragmentBuffer *fragments, QString *errorString)
 {
     Message msg;
+    if (!readRawMessage(device, msg.m_objectAddress, msg.m_messageType,
+                        msg.m_buffer->data.buffer(), msg.m_buffer->scratchSpace, fragments,
+                        errorString)) {
+        msg.m_objectAddress = Protocol::InvalidObjectAddress;
+        msg.m_messageType = Protocol::InvalidMessageType;
+    }
+    msg.m_buffer->resetStatus();
+
+    return msg;
+}
 
+bool Message::readRawMessage(QIODevice *device, Protocol::ObjectAddress &address,
+                             Protocol::MessageType &type, QByteArray &payload,
+                             QByteArray &scratchSpace, FragmentBuffer *fragments,
+                             QString *errorString)
+{
     Protocol::PayloadSize payloadSize = readNumber<qint32>(device);
 
-    msg.m_objectAddress = readNumber<Protocol::ObjectAddress>(device);
-    msg.m_messageType = readNumber<Protocol::MessageType>(device);
-    Q_ASSERT(msg.m_messageType != Protocol::InvalidMessageType);
-    Q_ASSERT(msg.m_objectAddress != Protocol::InvalidObjectAddress);
+    address = readNumber<Protocol::ObjectAddress>(device);
+    type = readNumber<Protocol::MessageType>(device);
+    Q_ASSERT(type != Protocol::InvalidMessageType);
+    Q_ASSERT(address != Protocol::InvalidObjectAddress);
     if (payloadSize < 0) {
         payloadSize = abs(payloadSize);
-        auto& uncompressedData = msg.m_buffer->scratchSpace;
+        auto& uncompressedData = scratchSpace;
         uncompressedData.resize(payloadSize);
         device->read(uncompressedData.data(), payloadSize);
-        uncompress(uncompressedData, msg.m_buffer->data.buffer());
-        Q_ASSERT(payloadSize == uncompressedData.size());
+        QString error;
+        if (!uncompress(uncompressedData, payload, &error)) {
+            if (errorString)
+                *errorString = error;
+            else
+                qWarning("Dropping message of type %d for object %d: %s", type, address,
+                         qPrintable(error));
+            return false;
+        }
+    } else if (payloadSize > 0) {
+        payload = device->read(payloadSize);
+        Q_ASSERT(payloadSize == payload.size());
     } else {
-        if (payloadSize > 0) {
-            msg.m_buffer->data.buffer() = device->read(payloadSize);
-            Q_ASSERT(payloadSize == msg.m_buffer->data.size());
+        payload.resize(0);
+    }
+
+    if (fragments) {
+        if (type == Protocol::MessageFragment) {
+            (*fragments)[address] += payload;
+            return false;
+        }
+
+        const auto it = fragments->find(address);
+        if (it != fragments->end()) {
+            payload.prepend(it.value());
+            fragments->erase(it);
         }
     }
+    Q_ASSERT(type != Protocol::MessageFragment);
+
+    // the next message might need this already, long before this one is dispatched
+    if (type == Protocol::CompressionDictionary) {
+        QDataStream stream(payload);
+        quint8 id;
+        QByteArray dictionary;
+        stream >> id >> dictionary;
+        addCompressionDictionary(id, dictionary);
+    }
+    return true;
+}
 
+Message Message::fromRawPayload(Protocol::ObjectAddress address, Protocol::MessageType type,
+                                const QByteArray &payload)
+{
+    Message msg;
+    msg.m_objectAddress = address;
+    msg.m_messageType = type;
+    msg.m_buffer->data.buffer() = payload;
     msg.m_buffer->resetStatus();
-
     return msg;
 }
 
@@ -248,13 +376,43 @@ void Message::resetNegotiatedDataVersion()
 
 void Message::write(QIODevice *device) const
 {
-    Q_ASSERT(m_objectAddress != Protocol::InvalidObjectAddress);
-    Q_ASSERT(m_messageType != Protocol::InvalidMessageType);
+    writeRawMessage(device, m_objectAddress, m_messageType, m_buffer->data.buffer(),
+                    m_buffer->scratchSpace);
+}
+
+QByteArray Message::rawPayload() const
+{
+    return m_buffer->data.buffer();
+}
+
+void Message::writeRawMessage(QIODevice *device, Protocol::ObjectAddress address,
+                              Protocol::MessageType type, const QByteArray &payload,
+                              QByteArray &scratchSpace)
+{
+    writeRawMessage(device, address, type, payload, scratchSpace, Protocol::defaultPriority(type), 0);
+}
+
+void Message::writeRawMessage(QIODevice *device, Protocol::ObjectAddress address,
+                              Protocol::MessageType type, const QByteArray &payload,
+                              QByteArray &scratchSpace, Protocol::MessagePriority priority,
+                              quint8 dictionaryId)
+{
+    Q_ASSERT(address != Protocol::InvalidObjectAddress);
+    Q_ASSERT(type != Protocol::InvalidMessageType);
     static const bool compressionEnabled = qgetenv("GAMMARAY_DISABLE_LZ4") != "1";
-    const int buffSize = m_buffer->data.size();
-    auto& compressedData = m_buffer->scratchSpace;
-    if (buffSize > minimumUncompressedSize && compressionEnabled)
-        compress(m_buffer->data.buffer(), compressedData);
+    const int buffSize = payload.size();
+    auto& compressedData = scratchSpace;
+    compressedData.resize(0);
+    const auto dictionary = dictionaryId ? compressionDictionary(dictionaryId)
+                                         : CompressionDictionary();
+    Q_ASSERT(!dictionaryId || !dictionary.streamState.isEmpty());
+    if (compressionEnabled && !dictionary.streamState.isEmpty()
+        && buffSize > minimumUncompressedSize) {
+        compress(payload, compressedData, 1, dictionaryId, &dictionary);
+    } else if (compressionEnabled && buffSize > minimumUncompressedSizeWithoutDictionary) {
+        compress(payload, compressedData,
+                 priority == Protocol::StreamPriority ? streamAcceleration : 1);
+    }
 
     const bool isCompressed = compressedData.size() && compressedData.size() < buffSize;
     if (isCompressed)
@@ -262,8 +420,8 @@ void Message::write(QIODevice *device) const
     else
         writeNumber<Protocol::PayloadSize>(device, buffSize);   // send uncompressed Buffer
 
-    writeNumber(device, m_objectAddress);
-    writeNumber(device, m_messageType);
+    writeNumber(device, address);
+    writeNumber(device, type);
 
     if (buffSize) {
         if (isCompressed) {
@@ -271,13 +429,29 @@ void Message::write(QIODevice *device) const
             Q_ASSERT(s == compressedData.size());
             Q_UNUSED(s);
         } else {
-            const int s = device->write(m_buffer->data.buffer());
-            Q_ASSERT(s == m_buffer->data.size());
+            const int s = device->write(payload);
+            Q_ASSERT(s == payload.size());
             Q_UNUSED(s);
         }
     }
 }
 
+void Message::addCompressionDictionary(quint8 id, const QByteArray &dictionary)
+{
+    Q_ASSERT(id != 0);
+
+    CompressionDictionary dict;
+    dict.data = dictionary;
+    dict.streamState.resize(sizeof(LZ4_stream_t));
+    auto stream = reinterpret_cast<LZ4_stream_t *>(dict.streamState.data());
+    LZ4_resetStream(stream);
+    // this keeps pointing to the data, which is shared by all copies of dict
+    LZ4_loadDict(stream, dict.data.constData(), dict.data.size());
+
+    QMutexLocker lock(&s_compressionDictionaries()->mutex);
+    s_compressionDictionaries()->dictionaries.insert(id, dict);
+}
+
 int Message::size() const
 {
     return m_buffer->data.size();
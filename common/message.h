@@ -34,6 +34,8 @@
 
 #include <QByteArray>
 #include <QDataStream>
+#include <QHash>
+#include <QString>
 
 #include <functional>
 #include <memory>
@@ -48,6 +50,14 @@ namespace GammaRay {
  * - sizeof(Protocol::ObjectAddress) server object address (big endian)
  * - sizeof(Protocol::MessageType) command type (big endian)
  * - size bytes message payload (encoding is user defined, QDataStream provided for convenience)
+ *
+ * A negative size indicates an LZ4 compressed payload, starting with the uncompressed size
+ * and the id of the compression dictionary used (0 for none).
+ *
+ * Large messages can be split into several frames, all but the last one having the type
+ * Protocol::MessageFragment, the last one has the actual message type. The payload of the
+ * message is the concatenation of the payloads of all frames. Fragments of messages to the same
+ * object address are never interleaved.
  */
 class GAMMARAY_COMMON_EXPORT Message
 {
@@ -110,6 +120,15 @@ public:
     /** Read the next message from @p device. */
     static Message readMessage(QIODevice *device);
 
+    /** Reassembly state for fragmented messages, keep one of those per connection. */
+    typedef QHash<Protocol::ObjectAddress, QByteArray> FragmentBuffer;
+    /** Read the next message from @p device, reassembling fragmented messages in @p fragments.
+     *  If only a fragment was available, an invalid message is returned. The same happens for
+     *  messages that can't be decoded, @p errorString is set then.
+     */
+    static Message readMessage(QIODevice *device, FragmentBuffer *fragments,
+                               QString *errorString = nullptr);
+
     static quint8 lowestSupportedDataVersion();
     static quint8 highestSupportedDataVersion();
 
@@ -120,6 +139,50 @@ public:
     /** Write this message to @p device. */
     void write(QIODevice *device) const;
 
+    /** Copy of the payload of a message to be sent, for handing it over to a transport thread.
+     *  @see writeRawMessage()
+     */
+    QByteArray rawPayload() const;
+    /** Reconstruct a received message from its address, type and payload.
+     *  @see readRawMessage()
+     */
+    static Message fromRawPayload(Protocol::ObjectAddress address, Protocol::MessageType type,
+                                  const QByteArray &payload);
+
+    /** Same as readMessage(), but without touching the message buffer pool, so this is safe
+     *  to be called from any thread. @p scratchSpace is reused between calls.
+     *  Returns @c false if only a fragment of a message was read, or if the message can't be
+     *  decoded (e.g. because it refers to an unknown compression dictionary). The latter is
+     *  a protocol error, described in @p errorString if given, the connection can't be
+     *  continued then.
+     */
+    static bool readRawMessage(QIODevice *device, Protocol::ObjectAddress &address,
+                               Protocol::MessageType &type, QByteArray &payload,
+                               QByteArray &scratchSpace, FragmentBuffer *fragments = nullptr,
+                               QString *errorString = nullptr);
+    /** Same as write(), but operating on a payload obtained from rawPayload(), so this is safe
+     *  to be called from any thread. @p scratchSpace is reused between calls.
+     */
+    static void writeRawMessage(QIODevice *device, Protocol::ObjectAddress address,
+                                Protocol::MessageType type, const QByteArray &payload,
+                                QByteArray &scratchSpace);
+    /** Same as above, but picking the compression by message class: stream data gets the
+     *  fastest compression, and messages are compressed against the dictionary
+     *  @p dictionaryId, unless that is 0.
+     *  @see addCompressionDictionary()
+     */
+    static void writeRawMessage(QIODevice *device, Protocol::ObjectAddress address,
+                                Protocol::MessageType type, const QByteArray &payload,
+                                QByteArray &scratchSpace, Protocol::MessagePriority priority,
+                                quint8 dictionaryId);
+
+    /** Makes @p dictionary available for compressing and decompressing payloads under
+     *  @p id (non-zero), can be called from any thread. This happens automatically when
+     *  reading a Protocol::CompressionDictionary message, which has to be sent before
+     *  any message using the dictionary.
+     */
+    static void addCompressionDictionary(quint8 id, const QByteArray &dictionary);
+
     /** Size of the uncompressed message payload. */
     int size() const;
 
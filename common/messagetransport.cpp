@@ -0,0 +1,231 @@
+/*
+  messagetransport.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "messagetransport.h"
+
+#include <QBuffer>
+#include <QIODevice>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <iostream>
+
+using namespace GammaRay;
+using namespace std;
+
+MessageTransport::MessageTransport(QIODevice *device)
+    : m_device(device)
+    , m_latencies(Protocol::MESSAGE_PRIORITY_COUNT)
+    , m_queues(Protocol::MESSAGE_PRIORITY_COUNT)
+    , m_sentBytes(Protocol::MESSAGE_PRIORITY_COUNT, 0)
+{
+    Q_ASSERT(device);
+    m_clock.start();
+
+    device->setParent(this);
+    connect(device, SIGNAL(readyRead()), SLOT(readyRead()));
+    connect(device, SIGNAL(bytesWritten(qint64)), SLOT(writePendingMessages()));
+    connect(device, SIGNAL(disconnected()), SIGNAL(disconnected()));
+
+    // there might be data available already before we get moved to the I/O thread
+    QMetaObject::invokeMethod(this, "readyRead", Qt::QueuedConnection);
+}
+
+MessageTransport::~MessageTransport()
+{
+}
+
+void MessageTransport::send(const RawMessage &msg)
+{
+    QMutexLocker lock(&m_mutex);
+    const bool wasEmpty = m_outgoing.isEmpty();
+    m_outgoing.push_back(msg);
+    m_outgoing.last().queueTime = m_clock.elapsed();
+    lock.unlock();
+
+    // a write is still pending otherwise, which will pick this up as well
+    if (wasEmpty)
+        QMetaObject::invokeMethod(this, "writePendingMessages", Qt::QueuedConnection);
+}
+
+QVector<MessageTransport::RawMessage> MessageTransport::takeReceivedMessages()
+{
+    QVector<RawMessage> msgs;
+    QMutexLocker lock(&m_mutex);
+    msgs.swap(m_incoming);
+    return msgs;
+}
+
+QVector<MessageTransport::LatencyStatistics> MessageTransport::takeLatencyStatistics()
+{
+    QVector<LatencyStatistics> latencies(Protocol::MESSAGE_PRIORITY_COUNT);
+    QMutexLocker lock(&m_mutex);
+    latencies.swap(m_latencies);
+    return latencies;
+}
+
+void MessageTransport::flush()
+{
+    if (QThread::currentThread() == thread())
+        writePendingMessagesAndWait();
+    else if (thread()->isRunning())
+        QMetaObject::invokeMethod(this, "writePendingMessagesAndWait", Qt::BlockingQueuedConnection);
+}
+
+void MessageTransport::scheduleOutgoingMessages()
+{
+    QVector<RawMessage> msgs;
+    {
+        QMutexLocker lock(&m_mutex);
+        msgs.swap(m_outgoing);
+    }
+
+    foreach (const auto &msg, msgs) {
+        auto &state = m_addressStates[msg.address];
+        // never let a message overtake an earlier one to the same object
+        if (state.pendingCount > 0)
+            state.priority = qMax(state.priority, msg.priority);
+        else
+            state.priority = msg.priority;
+        ++state.pendingCount;
+        m_queues[state.priority].enqueue(msg);
+    }
+}
+
+int MessageTransport::writeFrame(const RawMessage &msg, int offset)
+{
+    const bool isLastFrame = msg.payload.size() - offset <= FragmentSize;
+    const auto type = isLastFrame ? msg.type : Protocol::MessageFragment;
+    const int size = isLastFrame ? msg.payload.size() - offset : FragmentSize;
+
+    if (!msg.encodedFrames) {
+        Message::writeRawMessage(m_device, msg.address, type,
+                                 offset || !isLastFrame ? msg.payload.mid(offset, size) : msg.payload,
+                                 m_writeScratchSpace, msg.priority, msg.dictionaryId);
+        return size;
+    }
+
+    auto &frames = *msg.encodedFrames;
+    const int frameIndex = offset / FragmentSize;
+    if (frameIndex == frames.size()) {
+        QByteArray frame;
+        QBuffer buffer(&frame);
+        buffer.open(QIODevice::WriteOnly);
+        Message::writeRawMessage(&buffer, msg.address, type,
+                                 offset || !isLastFrame ? msg.payload.mid(offset, size) : msg.payload,
+                                 m_writeScratchSpace, msg.priority, msg.dictionaryId);
+        buffer.close();
+        frames.push_back(frame);
+    }
+    Q_ASSERT(frameIndex < frames.size());
+    m_device->write(frames.at(frameIndex));
+    return size;
+}
+
+bool MessageTransport::writeNextFrame()
+{
+    for (int i = 0; i < m_queues.size(); ++i) {
+        auto &queue = m_queues[i];
+        if (queue.isEmpty())
+            continue;
+
+        const auto &msg = queue.head();
+        int &sentBytes = m_sentBytes[i];
+        sentBytes += writeFrame(msg, sentBytes);
+        if (sentBytes < msg.payload.size())
+            return true;
+
+        // flow control messages are sent in reaction to the statistics, don't count those
+        if (msg.type != Protocol::FlowControlCredit) {
+            const auto latency = m_clock.elapsed() - msg.queueTime;
+            QMutexLocker lock(&m_mutex);
+            auto &stats = m_latencies[i];
+            stats.totalTime += latency;
+            stats.maximumTime = qMax(stats.maximumTime, latency);
+            ++stats.count;
+        }
+
+        const auto it = m_addressStates.find(msg.address);
+        Q_ASSERT(it != m_addressStates.end());
+        if (--it.value().pendingCount == 0)
+            m_addressStates.erase(it);
+
+        sentBytes = 0;
+        queue.dequeue();
+        return true;
+    }
+
+    return false;
+}
+
+void MessageTransport::writePendingMessages()
+{
+    scheduleOutgoingMessages();
+    if (!m_device)
+        return;
+
+    while (m_device->bytesToWrite() < MaxBytesToWrite && writeNextFrame()) {}
+}
+
+void MessageTransport::writePendingMessagesAndWait()
+{
+    scheduleOutgoingMessages();
+    if (!m_device)
+        return;
+
+    while (writeNextFrame()) {}
+    m_device->waitForBytesWritten(-1);
+}
+
+void MessageTransport::readyRead()
+{
+    QVector<RawMessage> msgs;
+    while (Message::canReadMessage(m_device.data())) {
+        RawMessage msg;
+        QString error;
+        if (Message::readRawMessage(m_device, msg.address, msg.type, msg.payload,
+                                    m_readScratchSpace, &m_fragments, &error)) {
+            msgs.push_back(msg);
+        } else if (!error.isEmpty()) {
+            cerr << "protocol error, closing connection: " << qPrintable(error) << endl;
+            m_device->close();
+            break;
+        }
+    }
+
+    if (msgs.isEmpty())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    const bool wasEmpty = m_incoming.isEmpty();
+    m_incoming += msgs;
+    lock.unlock();
+
+    if (wasEmpty)
+        emit messagesReceived();
+}
@@ -0,0 +1,180 @@
+/*
+  messagetransport.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_MESSAGETRANSPORT_H
+#define GAMMARAY_MESSAGETRANSPORT_H
+
+#include "message.h"
+#include "protocol.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+///@cond internal
+/** Socket I/O, message framing and (de)compression, running in a dedicated I/O thread.
+ *
+ *  The endpoint only exchanges raw message payloads with this via two queues,
+ *  which are handed over as a whole, so the lock is only held very briefly.
+ *
+ *  Outgoing messages are then scheduled by priority class, and large messages are sent
+ *  in fragments, so that small interactive messages don't have to wait behind big ones.
+ *  Messages to the same object address are never reordered though.
+ *
+ *  There is one transport per connected endpoint, all of them living in the same I/O thread.
+ */
+class MessageTransport : public QObject
+{
+    Q_OBJECT
+public:
+    struct RawMessage
+    {
+        RawMessage()
+            : address(Protocol::InvalidObjectAddress)
+            , type(Protocol::InvalidMessageType)
+            , priority(Protocol::InteractivePriority)
+            , dictionaryId(0)
+            , queueTime(0)
+        {
+        }
+
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        Protocol::MessagePriority priority;
+        /** Compression dictionary to use, chosen when the message is created. */
+        quint8 dictionaryId;
+        QByteArray payload;
+        qint64 queueTime;
+        /** Framed and compressed fragments of this message, when it is sent to several
+         *  endpoints. Filled by whichever transport gets to a fragment first, so the others
+         *  can write it as-is. Only accessed from the I/O thread.
+         */
+        QSharedPointer<QVector<QByteArray> > encodedFrames;
+    };
+
+    /** Time messages of one priority class spent in the send queue. */
+    struct LatencyStatistics
+    {
+        LatencyStatistics()
+            : totalTime(0)
+            , maximumTime(0)
+            , count(0)
+        {
+        }
+
+        qint64 totalTime;
+        qint64 maximumTime;
+        int count;
+    };
+
+    /** Takes ownership of @p device, move this to the I/O thread afterwards. */
+    explicit MessageTransport(QIODevice *device);
+    ~MessageTransport();
+
+    /** Queue a message for sending, can be called from any thread. */
+    void send(const RawMessage &msg);
+    /** Returns all messages received since the last call, can be called from any thread. */
+    QVector<RawMessage> takeReceivedMessages();
+    /** Returns the send queue latencies per priority class since the last call,
+     *  can be called from any thread.
+     */
+    QVector<LatencyStatistics> takeLatencyStatistics();
+
+    /** Writes all queued messages and blocks until they have been written to the device. */
+    void flush();
+
+signals:
+    /** Emitted when new messages are available via takeReceivedMessages(). */
+    void messagesReceived();
+    void disconnected();
+
+private slots:
+    void writePendingMessages();
+    void writePendingMessagesAndWait();
+    void readyRead();
+
+private:
+    enum {
+        FragmentSize = 64 * 1024,
+        // don't buffer more than this in the device, so higher priority messages can still overtake
+        MaxBytesToWrite = 4 * FragmentSize
+    };
+
+    void scheduleOutgoingMessages();
+    /** Writes the frame of @p msg starting at payload @p offset, returns the number of
+     *  payload bytes written.
+     */
+    int writeFrame(const RawMessage &msg, int offset);
+    /** Writes the next frame of the message with the highest priority, if any. */
+    bool writeNextFrame();
+
+    QPointer<QIODevice> m_device;
+    QElapsedTimer m_clock;
+
+    QMutex m_mutex;
+    QVector<RawMessage> m_outgoing;
+    QVector<RawMessage> m_incoming;
+    QVector<LatencyStatistics> m_latencies;
+
+    // only accessed from the I/O thread
+    struct AddressState
+    {
+        AddressState()
+            : priority(Protocol::InteractivePriority)
+            , pendingCount(0)
+        {
+        }
+
+        Protocol::MessagePriority priority;
+        int pendingCount;
+    };
+    QVector<QQueue<RawMessage> > m_queues;
+    QVector<int> m_sentBytes; // of the head message in each queue
+    QHash<Protocol::ObjectAddress, AddressState> m_addressStates;
+    Message::FragmentBuffer m_fragments;
+    QByteArray m_readScratchSpace;
+    QByteArray m_writeScratchSpace;
+};
+///@endcond
+}
+
+Q_DECLARE_TYPEINFO(GammaRay::MessageTransport::RawMessage, Q_MOVABLE_TYPE);
+Q_DECLARE_TYPEINFO(GammaRay::MessageTransport::LatencyStatistics, Q_MOVABLE_TYPE);
+
+#endif // GAMMARAY_MESSAGETRANSPORT_H
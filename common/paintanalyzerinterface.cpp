@@ -76,13 +76,13 @@ void PaintAnalyzerInterface::setHasStackTrace(bool hasStackTrace)
 namespace GammaRay {
 QDataStream& operator<<(QDataStream &stream, const PaintAnalyzerFrameData &data)
 {
-    stream << data.clipPath;
+    stream << data.commandStreamId << data.command;
     return stream;
 }
 
 QDataStream& operator>>(QDataStream &stream, PaintAnalyzerFrameData &data)
 {
-    stream >> data.clipPath;
+    stream >> data.commandStreamId >> data.command;
     return stream;
 }
 }
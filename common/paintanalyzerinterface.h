@@ -30,11 +30,11 @@
 #define GAMMARAY_PAINTANALYZERINTERFACE_H
 
 #include "gammaray_common_export.h"
+#include "paintcommandstream.h"
 
 #include <QDataStream>
 #include <QMetaType>
 #include <QObject>
-#include <QPainterPath>
 
 QT_BEGIN_NAMESPACE
 class QImage;
@@ -58,9 +58,30 @@ public:
     bool hasStackTrace() const;
     void setHasStackTrace(bool hasStackTrace);
 
+    /**
+     * Returns @c true if the details of @p command of the paint buffer identified by
+     * @p streamId are locally available.
+     */
+    virtual bool hasCommandDetails(quint32 streamId, int command) const = 0;
+    /** Returns the details of @p command if they are locally available. */
+    virtual PaintCommandRecord commandDetails(quint32 streamId, int command) const = 0;
+
+public Q_SLOTS:
+    /**
+     * Request the details of all commands of the paint buffer identified by @p streamId,
+     * commandDetailsAvailable() is emitted as they arrive.
+     */
+    virtual void requestCommandStream(quint32 streamId) = 0;
+
 Q_SIGNALS:
     void hasArgumentDetailsChanged(bool);
     void hasStackTraceChanged(bool);
+    void commandDetailsAvailable(quint32 streamId, int firstCommand, int lastCommand);
+    /**
+     * Transfers command details to the client, encoded by PaintCommandStreamWriter.
+     * @p commandCount is the total number of commands in the stream.
+     */
+    void commandStreamChunk(quint32 streamId, int firstCommand, int commandCount, const QByteArray &chunk);
 
 private:
     QString m_name;
@@ -70,7 +91,16 @@ private:
 
 struct PaintAnalyzerFrameData
 {
-    QPainterPath clipPath;
+    PaintAnalyzerFrameData()
+        : commandStreamId(0)
+        , command(-1)
+    {
+    }
+
+    /// identifies the paint buffer the frame shows, 0 if there is none
+    quint32 commandStreamId;
+    /// the last command painted in the frame, -1 if there is none
+    int command;
 };
 
 QDataStream &operator<<(QDataStream &stream, const GammaRay::PaintAnalyzerFrameData &data);
@@ -0,0 +1,456 @@
+/*
+  paintcommandstream.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "paintcommandstream.h"
+#include "metatypedeclarations.h"
+
+#include <QDataStream>
+#include <QLine>
+#include <QRect>
+
+#include <cmath>
+
+using namespace GammaRay;
+
+namespace {
+enum ValueKind {
+    NullValue,
+    PointValue,
+    PointFValue,
+    RectValue,
+    RectFValue,
+    LineValue,
+    LineFValue,
+    PathValue,
+    InternedValue
+};
+
+enum CommandFlag {
+    ClipChanged = 1
+};
+
+// coordinates are transferred in fixed point with this many steps per unit
+static const double CoordinateScale = 64.0;
+// beyond this the fixed point value can't be represented exactly
+static const double MaxFixedCoordinate = 4503599627370496.0; // 2^52
+
+static void writeVarUInt(QDataStream &stream, quint64 value)
+{
+    while (value >= 0x80) {
+        stream << static_cast<quint8>(value | 0x80);
+        value >>= 7;
+    }
+    stream << static_cast<quint8>(value);
+}
+
+static bool readVarUInt(QDataStream &stream, quint64 *value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        quint8 b;
+        stream >> b;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        *value |= static_cast<quint64>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+/* Coordinates are sent as zig-zag encoded difference to @p previous, shifted left by one.
+ * Values without an exact fixed point representation are sent as an odd marker followed
+ * by the raw double, without changing @p previous.
+ */
+static void writeCoordinate(QDataStream &stream, qreal value, qint64 &previous)
+{
+    const double scaled = value * CoordinateScale;
+    if (std::fabs(scaled) < MaxFixedCoordinate && scaled == std::floor(scaled)) {
+        const auto fixed = static_cast<qint64>(scaled);
+        const auto delta = fixed - previous;
+        const auto zigZag = (static_cast<quint64>(delta) << 1) ^ static_cast<quint64>(delta >> 63);
+        writeVarUInt(stream, zigZag << 1);
+        previous = fixed;
+    } else {
+        writeVarUInt(stream, 1);
+        stream << static_cast<double>(value);
+    }
+}
+
+static bool readCoordinate(QDataStream &stream, qreal *value, qint64 &previous)
+{
+    quint64 v;
+    if (!readVarUInt(stream, &v))
+        return false;
+    if (v & 1) {
+        if (v != 1)
+            return false;
+        double d;
+        stream >> d;
+        *value = d;
+        return stream.status() == QDataStream::Ok;
+    }
+    v >>= 1;
+    const auto delta = static_cast<qint64>(v >> 1) ^ -static_cast<qint64>(v & 1);
+    previous += delta;
+    *value = previous / CoordinateScale;
+    return true;
+}
+
+static bool isSamePath(const QPainterPath &p1, const QPainterPath &p2)
+{
+    // comparing default constructed and emptied paths isn't reliable
+    if (p1.isEmpty() || p2.isEmpty())
+        return p1.isEmpty() == p2.isEmpty();
+    return p1 == p2;
+}
+}
+
+PaintCommandStreamWriter::PaintCommandStreamWriter(quint8 dataVersion)
+    : m_dataVersion(dataVersion)
+    , m_lastX(0)
+    , m_lastY(0)
+{
+}
+
+void PaintCommandStreamWriter::write(const PaintCommandRecord &record)
+{
+    QDataStream stream(&m_chunk, QIODevice::WriteOnly | QIODevice::Append);
+    if (m_dataVersion)
+        stream.setVersion(m_dataVersion);
+
+    auto nameIt = m_names.constFind(record.name);
+    if (nameIt == m_names.constEnd()) {
+        writeVarUInt(stream, m_names.size());
+        stream << record.name;
+        m_names.insert(record.name, m_names.size());
+    } else {
+        writeVarUInt(stream, nameIt.value());
+    }
+
+    // neighbouring commands mostly share the same clip path
+    const bool clipChanged = !isSamePath(record.clipPath, m_clipPath);
+    stream << static_cast<quint8>(clipChanged ? ClipChanged : 0);
+    if (clipChanged) {
+        writeInterned(stream, QVariant::fromValue(record.clipPath));
+        m_clipPath = record.clipPath;
+    }
+
+    writeVarUInt(stream, record.arguments.size());
+    foreach (const auto &arg, record.arguments)
+        writeValue(stream, arg);
+}
+
+QByteArray PaintCommandStreamWriter::takeChunk()
+{
+    QByteArray chunk;
+    chunk.swap(m_chunk);
+    return chunk;
+}
+
+void PaintCommandStreamWriter::writeValue(QDataStream &stream, const QVariant &value)
+{
+    switch (value.type()) {
+    case QVariant::Invalid:
+        stream << static_cast<quint8>(NullValue);
+        break;
+    case QVariant::Point:
+        stream << static_cast<quint8>(PointValue);
+        writePoint(stream, value.toPoint());
+        break;
+    case QVariant::PointF:
+        stream << static_cast<quint8>(PointFValue);
+        writePoint(stream, value.toPointF());
+        break;
+    case QVariant::Rect:
+    case QVariant::RectF:
+    {
+        const auto rect = value.toRectF();
+        stream << static_cast<quint8>(value.type() == QVariant::Rect ? RectValue : RectFValue);
+        writePoint(stream, rect.topLeft());
+        // the size is not related to the previous coordinates
+        qint64 origin = 0;
+        writeCoordinate(stream, rect.width(), origin);
+        origin = 0;
+        writeCoordinate(stream, rect.height(), origin);
+        break;
+    }
+    case QVariant::Line:
+    case QVariant::LineF:
+    {
+        const auto line = value.toLineF();
+        stream << static_cast<quint8>(value.type() == QVariant::Line ? LineValue : LineFValue);
+        writePoint(stream, line.p1());
+        writePoint(stream, line.p2());
+        break;
+    }
+    default:
+        writeInterned(stream, value);
+        break;
+    }
+}
+
+void PaintCommandStreamWriter::writeInterned(QDataStream &stream, const QVariant &value)
+{
+    const bool isPath = value.userType() == qMetaTypeId<QPainterPath>();
+    const quint8 kind = isPath ? PathValue : InternedValue;
+    stream << kind;
+
+    // key by content, different pens/brushes/paths with equal content are sent once
+    QByteArray key;
+    {
+        QDataStream keyStream(&key, QIODevice::WriteOnly);
+        if (m_dataVersion)
+            keyStream.setVersion(m_dataVersion);
+        keyStream << kind;
+        if (isPath)
+            keyStream << value.value<QPainterPath>();
+        else
+            keyStream << value;
+    }
+
+    auto it = m_values.constFind(key);
+    if (it != m_values.constEnd()) {
+        writeVarUInt(stream, it.value());
+        return;
+    }
+
+    writeVarUInt(stream, m_values.size());
+    if (isPath)
+        writePath(stream, value.value<QPainterPath>());
+    else
+        stream << value;
+    m_values.insert(key, m_values.size());
+}
+
+void PaintCommandStreamWriter::writePath(QDataStream &stream, const QPainterPath &path)
+{
+    stream << static_cast<quint8>(path.fillRule());
+    writeVarUInt(stream, path.elementCount());
+    for (int i = 0; i < path.elementCount(); ++i) {
+        const auto e = path.elementAt(i);
+        stream << static_cast<quint8>(e.type);
+        writePoint(stream, QPointF(e.x, e.y));
+    }
+}
+
+void PaintCommandStreamWriter::writePoint(QDataStream &stream, const QPointF &point)
+{
+    writeCoordinate(stream, point.x(), m_lastX);
+    writeCoordinate(stream, point.y(), m_lastY);
+}
+
+PaintCommandStreamReader::PaintCommandStreamReader(quint8 dataVersion)
+    : m_dataVersion(dataVersion)
+    , m_lastX(0)
+    , m_lastY(0)
+{
+}
+
+bool PaintCommandStreamReader::read(const QByteArray &chunk, QVector<PaintCommandRecord> *records)
+{
+    QDataStream stream(chunk);
+    if (m_dataVersion)
+        stream.setVersion(m_dataVersion);
+
+    while (!stream.atEnd()) {
+        PaintCommandRecord record;
+
+        quint64 nameId;
+        if (!readVarUInt(stream, &nameId) || nameId > static_cast<quint64>(m_names.size()))
+            return false;
+        if (nameId == static_cast<quint64>(m_names.size())) {
+            QString name;
+            stream >> name;
+            m_names.push_back(name);
+        }
+        record.name = m_names.at(static_cast<int>(nameId));
+
+        quint8 flags;
+        stream >> flags;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        if (flags & ClipChanged) {
+            quint8 kind;
+            stream >> kind;
+            QVariant clip;
+            if (kind != PathValue || !readInterned(stream, kind, &clip))
+                return false;
+            m_clipPath = clip.value<QPainterPath>();
+        }
+        record.clipPath = m_clipPath;
+
+        quint64 argCount;
+        if (!readVarUInt(stream, &argCount) || argCount > static_cast<quint64>(chunk.size()))
+            return false;
+        record.arguments.reserve(static_cast<int>(argCount));
+        for (quint64 i = 0; i < argCount; ++i) {
+            QVariant arg;
+            if (!readValue(stream, &arg))
+                return false;
+            record.arguments.push_back(arg);
+        }
+
+        records->push_back(record);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+bool PaintCommandStreamReader::readValue(QDataStream &stream, QVariant *value)
+{
+    quint8 kind;
+    stream >> kind;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    switch (kind) {
+    case NullValue:
+        *value = QVariant();
+        return true;
+    case PointValue:
+    case PointFValue:
+    {
+        QPointF p;
+        if (!readPoint(stream, &p))
+            return false;
+        *value = kind == PointValue ? QVariant(p.toPoint()) : QVariant(p);
+        return true;
+    }
+    case RectValue:
+    case RectFValue:
+    {
+        QPointF topLeft;
+        qreal width, height;
+        qint64 origin = 0;
+        if (!readPoint(stream, &topLeft) || !readCoordinate(stream, &width, origin))
+            return false;
+        origin = 0;
+        if (!readCoordinate(stream, &height, origin))
+            return false;
+        const QRectF rect(topLeft, QSizeF(width, height));
+        *value = kind == RectValue ? QVariant(rect.toRect()) : QVariant(rect);
+        return true;
+    }
+    case LineValue:
+    case LineFValue:
+    {
+        QPointF p1, p2;
+        if (!readPoint(stream, &p1) || !readPoint(stream, &p2))
+            return false;
+        const QLineF line(p1, p2);
+        *value = kind == LineValue ? QVariant(line.toLine()) : QVariant(line);
+        return true;
+    }
+    case PathValue:
+    case InternedValue:
+        return readInterned(stream, kind, value);
+    }
+    return false;
+}
+
+bool PaintCommandStreamReader::readInterned(QDataStream &stream, quint8 kind, QVariant *value)
+{
+    quint64 id;
+    if (!readVarUInt(stream, &id) || id > static_cast<quint64>(m_values.size()))
+        return false;
+    if (id < static_cast<quint64>(m_values.size())) {
+        *value = m_values.at(static_cast<int>(id));
+        return true;
+    }
+
+    if (kind == PathValue) {
+        QPainterPath path;
+        if (!readPath(stream, &path))
+            return false;
+        *value = QVariant::fromValue(path);
+    } else {
+        stream >> *value;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+    }
+    m_values.push_back(*value);
+    return true;
+}
+
+bool PaintCommandStreamReader::readPath(QDataStream &stream, QPainterPath *path)
+{
+    quint8 fillRule;
+    quint64 elementCount;
+    stream >> fillRule;
+    if (!readVarUInt(stream, &elementCount))
+        return false;
+    if (fillRule != path->fillRule())
+        path->setFillRule(static_cast<Qt::FillRule>(fillRule));
+
+    QPointF curveData[2];
+    int curveDataCount = -1; // number of control points of the current curve, -1 outside of curves
+    for (quint64 i = 0; i < elementCount; ++i) {
+        quint8 type;
+        QPointF p;
+        stream >> type;
+        if (!readPoint(stream, &p))
+            return false;
+
+        if (curveDataCount >= 0 && type != QPainterPath::CurveToDataElement)
+            return false;
+        switch (type) {
+        case QPainterPath::MoveToElement:
+            path->moveTo(p);
+            break;
+        case QPainterPath::LineToElement:
+            path->lineTo(p);
+            break;
+        case QPainterPath::CurveToElement:
+            curveData[0] = p;
+            curveDataCount = 1;
+            break;
+        case QPainterPath::CurveToDataElement:
+            if (curveDataCount < 0)
+                return false;
+            if (curveDataCount == 1) {
+                curveData[1] = p;
+                curveDataCount = 2;
+            } else {
+                path->cubicTo(curveData[0], curveData[1], p);
+                curveDataCount = -1;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+    return curveDataCount < 0;
+}
+
+bool PaintCommandStreamReader::readPoint(QDataStream &stream, QPointF *point)
+{
+    qreal x, y;
+    if (!readCoordinate(stream, &x, m_lastX) || !readCoordinate(stream, &y, m_lastY))
+        return false;
+    *point = QPointF(x, y);
+    return true;
+}
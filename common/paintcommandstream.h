@@ -0,0 +1,119 @@
+/*
+  paintcommandstream.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_PAINTCOMMANDSTREAM_H
+#define GAMMARAY_PAINTCOMMANDSTREAM_H
+
+#include "gammaray_common_export.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QPainterPath>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QDataStream;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/** Details of a single recorded paint command, as transferred to the client. */
+struct PaintCommandRecord
+{
+    QString name;
+    QVector<QVariant> arguments;
+    /// clip area in effect after this command, in device coordinates
+    QPainterPath clipPath;
+};
+
+/**
+ * Encodes a sequence of PaintCommandRecords into chunks, which have to be decoded by
+ * PaintCommandStreamReader in the order they were produced:
+ * - command names, clip paths and all non-geometric arguments (pens, brushes, fonts, images, ...)
+ *   are interned, the first use of a value carries the value, later ones only its index
+ * - coordinates of points, rectangles, lines and path elements are sent as the difference to
+ *   the previous coordinate, as variable length integers in 1/64 units when that is lossless
+ * - the clip path is only sent for commands that change it
+ */
+class GAMMARAY_COMMON_EXPORT PaintCommandStreamWriter
+{
+public:
+    /**
+     * Creates a writer for a new stream, values are serialized with data stream version
+     * @p dataVersion, or the QDataStream default if that is 0.
+     */
+    explicit PaintCommandStreamWriter(quint8 dataVersion = 0);
+
+    void write(const PaintCommandRecord &record);
+    /** Returns the commands encoded since the last call. */
+    QByteArray takeChunk();
+
+private:
+    void writeValue(QDataStream &stream, const QVariant &value);
+    void writeInterned(QDataStream &stream, const QVariant &value);
+    void writePath(QDataStream &stream, const QPainterPath &path);
+    void writePoint(QDataStream &stream, const QPointF &point);
+
+    quint8 m_dataVersion;
+    QByteArray m_chunk;
+    QHash<QString, quint32> m_names;
+    QHash<QByteArray, quint32> m_values;
+    QPainterPath m_clipPath;
+    qint64 m_lastX;
+    qint64 m_lastY;
+};
+
+/** Decodes the chunks produced by PaintCommandStreamWriter. */
+class GAMMARAY_COMMON_EXPORT PaintCommandStreamReader
+{
+public:
+    /** Creates a reader for a new stream, see PaintCommandStreamWriter. */
+    explicit PaintCommandStreamReader(quint8 dataVersion = 0);
+
+    /**
+     * Decodes the next chunk and appends its commands to @p records.
+     * Returns @c false if the chunk is malformed, the stream can't be continued then.
+     */
+    bool read(const QByteArray &chunk, QVector<PaintCommandRecord> *records);
+
+private:
+    bool readValue(QDataStream &stream, QVariant *value);
+    bool readInterned(QDataStream &stream, quint8 kind, QVariant *value);
+    bool readPath(QDataStream &stream, QPainterPath *path);
+    bool readPoint(QDataStream &stream, QPointF *point);
+
+    quint8 m_dataVersion;
+    QVector<QString> m_names;
+    QVector<QVariant> m_values;
+    QPainterPath m_clipPath;
+    qint64 m_lastX;
+    qint64 m_lastY;
+};
+}
+
+#endif // GAMMARAY_PAINTCOMMANDSTREAM_H
@@ -63,6 +63,15 @@ PluginInfo::PluginInfo(const QString& path)
         qDebug("%s: %s not a library, nor a .desktop file.", Q_FUNC_INFO, qPrintable(path));
 }
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+PluginInfo::PluginInfo(const QString &path, const QJsonObject &metaData)
+{
+    init();
+    initFromJSON(metaData);
+    m_path = path;
+}
+#endif
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
 PluginInfo::PluginInfo(const QStaticPlugin &staticPlugin)
 {
@@ -47,6 +47,10 @@ class PluginInfo
 public:
     PluginInfo();
     explicit PluginInfo(const QString &path);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    /** Creates plugin info for @p path from previously read plugin meta data. */
+    PluginInfo(const QString &path, const QJsonObject &metaData);
+#endif
 #if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
     explicit PluginInfo(const QStaticPlugin &staticPlugin);
 #endif
@@ -36,6 +36,14 @@
 #include <QDir>
 #include <QPluginLoader>
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#endif
+
 #include <iostream>
 
 #define IF_DEBUG(x)
@@ -43,6 +51,68 @@
 using namespace GammaRay;
 using namespace std;
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0) && !defined(GAMMARAY_STATIC_PROBE)
+namespace {
+/**
+ * Persistent cache of the plugin meta data, keyed by plugin file path and
+ * validated by file size and modification time. This saves us from reading
+ * every plugin file on each probe startup, which is slow on flash storage.
+ */
+class PluginIndex
+{
+public:
+    PluginIndex()
+    {
+        const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+        if (cacheDir.isEmpty())
+            return;
+        m_fileName = cacheDir + QStringLiteral("/gammaray/pluginindex-") + QStringLiteral(GAMMARAY_PROBE_ABI) + QStringLiteral(".json");
+
+        QFile f(m_fileName);
+        if (f.open(QFile::ReadOnly))
+            m_entries = QJsonDocument::fromJson(f.readAll()).object();
+    }
+
+    ~PluginIndex()
+    {
+        // only keep entries for plugins that still exist
+        if (m_fileName.isEmpty() || m_usedEntries == m_entries)
+            return;
+
+        QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+        QSaveFile f(m_fileName);
+        if (!f.open(QFile::WriteOnly))
+            return;
+        f.write(QJsonDocument(m_usedEntries).toJson(QJsonDocument::Compact));
+        f.commit();
+    }
+
+    QJsonObject metaData(const QString &pluginFile)
+    {
+        const QFileInfo fi(pluginFile);
+        const qint64 size = fi.size();
+        const qint64 lastModified = fi.lastModified().toMSecsSinceEpoch();
+
+        QJsonObject entry = m_entries.value(pluginFile).toObject();
+        if (entry.value(QStringLiteral("size")).toDouble() != size
+            || entry.value(QStringLiteral("lastModified")).toDouble() != lastModified) {
+            entry = QJsonObject();
+            entry.insert(QStringLiteral("size"), size);
+            entry.insert(QStringLiteral("lastModified"), lastModified);
+            entry.insert(QStringLiteral("metaData"), QPluginLoader(pluginFile).metaData());
+        }
+        m_usedEntries.insert(pluginFile, entry);
+        return entry.value(QStringLiteral("metaData")).toObject();
+    }
+
+private:
+    QString m_fileName;
+    QJsonObject m_entries;
+    QJsonObject m_usedEntries;
+};
+}
+#endif
+
 PluginManagerBase::PluginManagerBase(QObject *parent)
     : m_parent(parent)
 {
@@ -101,12 +171,19 @@ void PluginManagerBase::scan(const QString &serviceType)
     }
 #endif
 
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0) && !defined(GAMMARAY_STATIC_PROBE)
+    PluginIndex index;
+#endif
     foreach (const QString &pluginPath, pluginPaths()) {
         const QDir dir(pluginPath);
         IF_DEBUG(cout << "checking plugin path: " << qPrintable(dir.absolutePath()) << endl);
         foreach (const QString &plugin, dir.entryList(pluginFilter(), QDir::Files)) {
             const QString pluginFile = dir.absoluteFilePath(plugin);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0) && !defined(GAMMARAY_STATIC_PROBE)
+            const PluginInfo pluginInfo(pluginFile, index.metaData(pluginFile));
+#else
             const PluginInfo pluginInfo(pluginFile);
+#endif
 
             if (!pluginInfo.isValid() || loadedPluginNames.contains(pluginInfo.id()))
                 continue;
@@ -51,6 +51,10 @@ public:
     /*! Detach GammaRay but keep host application running. */
     virtual void detachProbe() = 0;
 
+signals:
+    /*! Progress of the incremental discovery of existing objects after attaching. */
+    void objectDiscoveryProgress(int discoveredObjects, bool finished);
+
 private:
     Q_DISABLE_COPY(ProbeControllerInterface)
 };
@@ -54,7 +54,33 @@ QModelIndex toQModelIndex(const QAbstractItemModel *model, const Protocol::Model
 
 qint32 version()
 {
-    return 36;
+    return 39;
+}
+
+MessagePriority defaultPriority(MessageType type)
+{
+    switch (type) {
+    case ModelRowColumnCountReply:
+    case ModelContentReply:
+    case ModelContentChanged:
+    case ModelHeaderReply:
+    case ModelHeaderChanged:
+    case ModelRowsAdded:
+    case ModelRowsMoved:
+    case ModelRowsRemoved:
+    case ModelColumnsAdded:
+    case ModelColumnsMoved:
+    case ModelColumnsRemoved:
+    case ModelReset:
+    case ModelLayoutChanged:
+    // selections refer to rows announced by the model messages before them, so they
+    // must not overtake those
+    case SelectionModelSelect:
+    case SelectionModelCurrent:
+        return ModelPriority;
+    default:
+        return InteractivePriority;
+    }
 }
 
 qint32 broadcastFormatVersion()
@@ -56,6 +56,15 @@ static const ObjectAddress LauncherAddress = std::numeric_limits<ObjectAddress>:
 /*! Invalid message type. */
 static const MessageType InvalidMessageType = 0;
 
+/*! Scheduling priority classes for outgoing messages, in descending priority. */
+enum MessagePriority {
+    InteractivePriority, ///< small messages triggered by user interaction
+    ModelPriority, ///< remote model content
+    BulkPriority, ///< large transfers that are not time critical
+    StreamPriority, ///< continuous data such as remote view frames
+    MESSAGE_PRIORITY_COUNT
+};
+
 /*! Protocol message types. */
 enum BuildInMessageType {
     // object management
@@ -112,6 +121,11 @@ enum BuildInMessageType {
     ServerAddress,
     ServerLaunchError,
 
+    // transport, server <-> client
+    FlowControlCredit,
+    MessageFragment,
+    CompressionDictionary,
+
     MESSAGE_TYPE_COUNT // NOTE when changing this enum, also update MessageStatisticsModel!
 };
 
@@ -148,6 +162,9 @@ GAMMARAY_COMMON_EXPORT QModelIndex toQModelIndex(const QAbstractItemModel *model
 /*! Protocol version, must match exactly between client and server. */
 GAMMARAY_COMMON_EXPORT qint32 version();
 
+/*! Default scheduling priority of messages of type @p type. */
+GAMMARAY_COMMON_EXPORT MessagePriority defaultPriority(MessageType type);
+
 /*! Broadcast format version. */
 GAMMARAY_COMMON_EXPORT qint32 broadcastFormatVersion();
 }
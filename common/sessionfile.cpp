@@ -0,0 +1,278 @@
+/*
+  sessionfile.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "sessionfile.h"
+#include "message.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QThread>
+#include <QtEndian>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+SessionFileWriter::SessionFileWriter(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , m_file(fileName)
+{
+    m_clock.start();
+}
+
+SessionFileWriter::~SessionFileWriter()
+{
+    writePendingMessages();
+}
+
+bool SessionFileWriter::open(quint8 dataVersion)
+{
+    if (!m_file.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << quint32(SessionFile::FileMagic) << quint32(SessionFile::FormatVersion)
+           << Protocol::version() << dataVersion << QDateTime::currentMSecsSinceEpoch();
+    Q_ASSERT(header.size() == SessionFile::FileHeaderSize);
+    m_clock.restart();
+    return m_file.write(header) == header.size() && m_file.flush();
+}
+
+QString SessionFileWriter::errorString() const
+{
+    return m_file.errorString();
+}
+
+void SessionFileWriter::record(Protocol::ObjectAddress address, Protocol::MessageType type,
+                               const QByteArray &payload)
+{
+    Record record;
+    record.time = m_clock.elapsed();
+    record.address = address;
+    record.type = type;
+    record.payload = payload;
+
+    QMutexLocker lock(&m_mutex);
+    const bool wasEmpty = m_pending.isEmpty();
+    m_pending.push_back(record);
+    lock.unlock();
+
+    // a write is still pending otherwise, which will pick this up as well
+    if (wasEmpty)
+        QMetaObject::invokeMethod(this, "writePendingMessages", Qt::QueuedConnection);
+}
+
+void SessionFileWriter::flush()
+{
+    if (QThread::currentThread() == thread())
+        writePendingMessages();
+    else if (thread()->isRunning())
+        QMetaObject::invokeMethod(this, "writePendingMessages", Qt::BlockingQueuedConnection);
+}
+
+void SessionFileWriter::writePendingMessages()
+{
+    QVector<Record> records;
+    {
+        QMutexLocker lock(&m_mutex);
+        records.swap(m_pending);
+    }
+    if (records.isEmpty() || !m_file.isOpen())
+        return;
+
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    int messageCount = 0;
+    qint64 firstTime = 0;
+    foreach (const auto &record, records) {
+        if (messageCount == 0)
+            firstTime = record.time;
+        const qint64 time = qToBigEndian(record.time);
+        buffer.write(reinterpret_cast<const char *>(&time), sizeof(time));
+        Message::writeRawMessage(&buffer, record.address, record.type, record.payload,
+                                 m_scratchSpace);
+        ++messageCount;
+
+        if (data.size() >= ChunkSize) {
+            writeChunk(data, messageCount, firstTime, record.time);
+            buffer.seek(0);
+            data.clear();
+            messageCount = 0;
+        }
+    }
+    if (messageCount > 0)
+        writeChunk(data, messageCount, firstTime, records.last().time);
+    m_file.flush();
+}
+
+void SessionFileWriter::writeChunk(const QByteArray &data, int messageCount, qint64 firstTime,
+                                   qint64 lastTime)
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << quint32(SessionFile::ChunkMagic) << quint32(data.size()) << quint32(messageCount)
+           << firstTime << lastTime;
+    Q_ASSERT(header.size() == SessionFile::ChunkHeaderSize);
+    m_file.write(header);
+    m_file.write(data);
+}
+
+SessionFileReader::SessionFileReader()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_protocolVersion(0)
+    , m_dataVersion(0)
+    , m_startTime(0)
+{
+}
+
+SessionFileReader::~SessionFileReader()
+{
+}
+
+bool SessionFileReader::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QFile::ReadOnly)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data || m_size < SessionFile::FileHeaderSize) {
+        m_errorString = QObject::tr("Unable to map %1.").arg(fileName);
+        return false;
+    }
+
+    {
+        const auto header = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data),
+                                                    SessionFile::FileHeaderSize);
+        QDataStream stream(header);
+        quint32 magic, formatVersion;
+        stream >> magic >> formatVersion >> m_protocolVersion >> m_dataVersion >> m_startTime;
+        if (magic != SessionFile::FileMagic || formatVersion != SessionFile::FormatVersion) {
+            m_errorString = QObject::tr("%1 is not a GammaRay session recording.").arg(fileName);
+            return false;
+        }
+        if (m_protocolVersion != Protocol::version()) {
+            m_errorString = QObject::tr("%1 has been recorded with protocol version %2, expected %3.")
+                            .arg(fileName).arg(m_protocolVersion).arg(Protocol::version());
+            return false;
+        }
+    }
+
+    // index the chunks, skipping over their data
+    qint64 offset = SessionFile::FileHeaderSize;
+    while (offset + SessionFile::ChunkHeaderSize <= m_size) {
+        const auto header = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + offset),
+                                                    SessionFile::ChunkHeaderSize);
+        QDataStream stream(header);
+        quint32 magic;
+        ChunkInfo chunk;
+        stream >> magic >> chunk.size >> chunk.messageCount >> chunk.firstTime >> chunk.lastTime;
+        chunk.offset = offset + SessionFile::ChunkHeaderSize;
+        if (magic != SessionFile::ChunkMagic || chunk.offset + chunk.size > m_size)
+            break; // truncated, or still being written
+        m_chunks.push_back(chunk);
+        offset = chunk.offset + chunk.size;
+    }
+
+    return true;
+}
+
+QString SessionFileReader::errorString() const
+{
+    return m_errorString;
+}
+
+qint32 SessionFileReader::protocolVersion() const
+{
+    return m_protocolVersion;
+}
+
+quint8 SessionFileReader::dataVersion() const
+{
+    return m_dataVersion;
+}
+
+qint64 SessionFileReader::startTime() const
+{
+    return m_startTime;
+}
+
+qint64 SessionFileReader::duration() const
+{
+    if (m_chunks.isEmpty())
+        return 0;
+    return m_chunks.last().lastTime;
+}
+
+int SessionFileReader::chunkCount() const
+{
+    return m_chunks.size();
+}
+
+int SessionFileReader::findChunk(qint64 time) const
+{
+    const auto it = std::upper_bound(m_chunks.constBegin(), m_chunks.constEnd(), time,
+                                     [](qint64 time, const ChunkInfo &chunk) {
+        return time < chunk.firstTime;
+    });
+    return qMax<int>(0, std::distance(m_chunks.constBegin(), it) - 1);
+}
+
+QVector<SessionFileReader::Record> SessionFileReader::readChunk(int index) const
+{
+    Q_ASSERT(index >= 0 && index < m_chunks.size());
+    const auto &chunk = m_chunks.at(index);
+
+    auto data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + chunk.offset),
+                                        chunk.size);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QVector<Record> records;
+    records.reserve(chunk.messageCount);
+    QByteArray scratchSpace;
+    while (buffer.bytesAvailable() > qint64(sizeof(qint64))) {
+        Record record;
+        buffer.read(reinterpret_cast<char *>(&record.time), sizeof(record.time));
+        record.time = qFromBigEndian(record.time);
+        if (!Message::canReadMessage(&buffer)
+            || !Message::readRawMessage(&buffer, record.address, record.type, record.payload,
+                                        scratchSpace))
+            break;
+        records.push_back(record);
+    }
+    return records;
+}
@@ -0,0 +1,183 @@
+/*
+  sessionfile.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_SESSIONFILE_H
+#define GAMMARAY_SESSIONFILE_H
+
+#include "gammaray_common_export.h"
+#include "protocol.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+
+namespace GammaRay {
+/**
+ * Binary format of a recorded probe session, all integers in network byte order:
+ * - file header: magic number, format version (quint32), protocol version (qint32),
+ *   data stream version of the message payloads (quint8), start time in ms since epoch (qint64)
+ * - followed by any number of chunks, each consisting of
+ *   - chunk header: magic number, size of the chunk data (quint32), number of messages (quint32),
+ *     time stamp of the first and the last message in ms since the start (qint64 each)
+ *   - chunk data: for each message its time stamp (qint64) followed by the message
+ *     in the same format it is sent over the network (see Message)
+ *
+ * Chunks are only ever appended, so the file can be read while it is still being written,
+ * and a truncated last chunk (e.g. after a crash) doesn't affect the previous ones.
+ */
+namespace SessionFile {
+enum {
+    FileMagic = 0x47525346, // "GRSF"
+    ChunkMagic = 0x47525343, // "GRSC"
+    FormatVersion = 1,
+    FileHeaderSize = 4 + 4 + 4 + 1 + 8,
+    ChunkHeaderSize = 4 + 4 + 4 + 8 + 8
+};
+}
+
+/** Writes messages to a session recording file.
+ *  Messages are queued and written in chunks when control returns to the event loop of
+ *  the thread this lives in, so move it to a background thread to keep the file I/O and
+ *  compression out of the way.
+ */
+class GAMMARAY_COMMON_EXPORT SessionFileWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionFileWriter(const QString &fileName, QObject *parent = nullptr);
+    /** Writes all messages still queued. */
+    ~SessionFileWriter();
+
+    /** Creates the file and writes the file header, for message payloads in data stream
+     *  version @p dataVersion. Returns @c false on error.
+     */
+    bool open(quint8 dataVersion);
+    QString errorString() const;
+
+    /** Queue a message for writing, can be called from any thread. */
+    void record(Protocol::ObjectAddress address, Protocol::MessageType type,
+                const QByteArray &payload);
+
+    /** Writes all queued messages, blocks if this lives in another thread. */
+    void flush();
+
+private slots:
+    void writePendingMessages();
+
+private:
+    enum {
+        // messages are grouped into chunks of about this size
+        ChunkSize = 256 * 1024
+    };
+
+    struct Record
+    {
+        qint64 time;
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray payload;
+    };
+
+    void writeChunk(const QByteArray &data, int messageCount, qint64 firstTime, qint64 lastTime);
+
+    QFile m_file;
+    QElapsedTimer m_clock;
+    QMutex m_mutex;
+    QVector<Record> m_pending;
+    QByteArray m_scratchSpace;
+};
+
+/** Reads a session recording file written by SessionFileWriter.
+ *  The file is memory-mapped, and messages are only decoded chunk by chunk on demand.
+ */
+class GAMMARAY_COMMON_EXPORT SessionFileReader
+{
+public:
+    struct Record
+    {
+        Record()
+            : time(0)
+            , address(Protocol::InvalidObjectAddress)
+            , type(Protocol::InvalidMessageType)
+        {
+        }
+
+        qint64 time;
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray payload;
+    };
+
+    SessionFileReader();
+    ~SessionFileReader();
+
+    /** Maps @p fileName and indexes its chunks, returns @c false if this is not a valid recording. */
+    bool open(const QString &fileName);
+    QString errorString() const;
+
+    qint32 protocolVersion() const;
+    /** Data stream version of the message payloads. */
+    quint8 dataVersion() const;
+    /** Start of the recording, in ms since epoch. */
+    qint64 startTime() const;
+    /** Time stamp of the last recorded message, in ms since the start. */
+    qint64 duration() const;
+
+    int chunkCount() const;
+    /** Index of the last chunk starting at or before @p time, 0 if there is none. */
+    int findChunk(qint64 time) const;
+    /** Decodes all messages of chunk @p index. */
+    QVector<Record> readChunk(int index) const;
+
+private:
+    struct ChunkInfo
+    {
+        qint64 offset;
+        quint32 size;
+        quint32 messageCount;
+        qint64 firstTime;
+        qint64 lastTime;
+    };
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    QVector<ChunkInfo> m_chunks;
+    QString m_errorString;
+    qint32 m_protocolVersion;
+    quint8 m_dataVersion;
+    qint64 m_startTime;
+};
+}
+
+Q_DECLARE_TYPEINFO(GammaRay::SessionFileReader::Record, Q_MOVABLE_TYPE);
+
+#endif // GAMMARAY_SESSIONFILE_H
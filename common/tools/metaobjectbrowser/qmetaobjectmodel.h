@@ -48,6 +48,10 @@ namespace QMetaObjectModel
         ObjectInclusiveCountColumn,
         ObjectSelfAliveCountColumn,
         ObjectInclusiveAliveCountColumn,
+        ObjectPeakAliveCountColumn,
+        ObjectCreationRateColumn,
+        ObjectDestructionRateColumn,
+        ObjectAverageLifetimeColumn,
         _Last
     };
 }
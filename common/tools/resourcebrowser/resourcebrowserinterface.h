@@ -39,15 +39,33 @@ public:
     explicit ResourceBrowserInterface(QObject *parent = nullptr);
     virtual ~ResourceBrowserInterface();
 
+    /// maximum amount of data sent in response to a single requestResourceData() call
+    enum {
+        MaxChunkSize = 1024 * 1024
+    };
+
 public slots:
-    virtual void downloadResource(const QString &sourceFilePath, const QString &targetFilePath) = 0;
     virtual void selectResource(const QString &sourceFilePath, int line = -1, int column = -1) = 0;
+    /**
+     * Request up to @p size bytes of @p filePath starting at @p offset.
+     * The result is sent asynchronously via resourceDataReceived(), using the given @p requestId,
+     * and only to the client that requested it. Reusing @p requestId for the following chunk
+     * continues a transfer, the resource is kept open for that until its end has been sent
+     * or cancelResourceData() is called.
+     */
+    virtual void requestResourceData(int requestId, const QString &filePath, qint64 offset, int size) = 0;
+    /** Abandon the transfer identified by @p requestId. */
+    virtual void cancelResourceData(int requestId) = 0;
 
 signals:
     void resourceDeselected();
-    void resourceSelected(const QByteArray &contents, int line, int column);
-
-    void resourceDownloaded(const QString &targetFilePath, const QByteArray &contents);
+    /**
+     * The resource at @p filePath got selected, its content has to be requested
+     * via requestResourceData(). @p contentKey identifies the content of the resource.
+     */
+    void resourceSelected(const QString &filePath, const QByteArray &contentKey, qint64 size, int line, int column);
+    /** Reply to requestResourceData(), @p totalSize is -1 if the resource couldn't be read. */
+    void resourceDataReceived(int requestId, qint64 offset, qint64 totalSize, const QByteArray &data);
 };
 }
 
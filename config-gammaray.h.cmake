@@ -52,6 +52,8 @@
 #cmakedefine HAVE_SYS_ELF_H
 #cmakedefine HAVE_ELF
 
+#cmakedefine HAVE_PTRACE_INJECTOR
+
 #cmakedefine GAMMARAY_ENABLE_GPL_ONLY_FEATURES
 #cmakedefine GAMMARAY_CORE_ONLY_LAUNCHER
 #cmakedefine GAMMARAY_STATIC_PROBE
@@ -38,21 +38,28 @@
 #include "enumrepositoryserver.h"
 #include "enumutil.h"
 
+#include <common/modelevent.h>
 #include <common/objectid.h>
 #include <common/propertymodel.h>
 
 #include <QDebug>
 #include <QMetaEnum>
+#include <QTimer>
 
 using namespace GammaRay;
 
 AggregatedPropertyModel::AggregatedPropertyModel(QObject *parent)
     : QAbstractItemModel(parent)
     , m_rootAdaptor(nullptr)
+    , m_pollTimer(new QTimer(this))
     , m_inhibitAdaptorCreation(false)
     , m_readOnly(false)
+    , m_used(false)
 {
     qRegisterMetaType<GammaRay::PropertyAdaptor *>();
+
+    m_pollTimer->setInterval(1000);
+    connect(m_pollTimer, SIGNAL(timeout()), this, SLOT(pollProperties()));
 }
 
 AggregatedPropertyModel::~AggregatedPropertyModel()
@@ -78,6 +85,8 @@ void AggregatedPropertyModel::setObject(const ObjectInstance &oi)
 
     if (count)
         endInsertRows();
+
+    updatePollTimer();
 }
 
 void AggregatedPropertyModel::setReadOnly(bool readOnly)
@@ -85,6 +94,24 @@ void AggregatedPropertyModel::setReadOnly(bool readOnly)
     m_readOnly = readOnly;
 }
 
+void AggregatedPropertyModel::customEvent(QEvent *event)
+{
+    if (event->type() == ModelEvent::eventType()) {
+        m_used = static_cast<ModelEvent *>(event)->used();
+        updatePollTimer();
+    }
+    QAbstractItemModel::customEvent(event);
+}
+
+void AggregatedPropertyModel::updatePollTimer()
+{
+    // nobody would see the results of polling while no client uses us
+    if (m_used && m_rootAdaptor)
+        m_pollTimer->start();
+    else
+        m_pollTimer->stop();
+}
+
 void AggregatedPropertyModel::clear()
 {
     if (!m_rootAdaptor)
@@ -94,7 +121,9 @@ void AggregatedPropertyModel::clear()
     if (count)
         beginRemoveRows(QModelIndex(), 0, count - 1);
 
+    m_pollTimer->stop();
     m_parentChildrenMap.clear();
+    m_propertyCache.clear();
     delete m_rootAdaptor;
     m_rootAdaptor = nullptr;
 
@@ -115,8 +144,7 @@ QVariant AggregatedPropertyModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    const auto d = adaptor->propertyData(index.row());
-    return data(adaptor, d, index.column(), role);
+    return data(cachedProperty(adaptor, index.row()), index.column(), role);
 }
 
 QMap<int, QVariant> AggregatedPropertyModel::itemData(const QModelIndex &index) const
@@ -132,51 +160,92 @@ QMap<int, QVariant> AggregatedPropertyModel::itemData(const QModelIndex &index)
                                   Q_ARG(GammaRay::PropertyAdaptor*, adaptor));
         return res;
     }
-    const auto d = adaptor->propertyData(index.row());
+    const auto &d = cachedProperty(adaptor, index.row());
 
-    res.insert(Qt::DisplayRole, data(adaptor, d, index.column(), Qt::DisplayRole));
-    res.insert(PropertyModel::ActionRole, data(adaptor, d,
-                                               index.column(), PropertyModel::ActionRole));
+    res.insert(Qt::DisplayRole, data(d, index.column(), Qt::DisplayRole));
+    res.insert(PropertyModel::ActionRole, data(d, index.column(), PropertyModel::ActionRole));
     res.insert(PropertyModel::ObjectIdRole,
-               data(adaptor, d, index.column(), PropertyModel::ObjectIdRole));
+               data(d, index.column(), PropertyModel::ObjectIdRole));
     if (index.column() == 0) {
-        auto v = data(adaptor, d, index.column(), PropertyModel::PropertyFlagsRole);
+        auto v = data(d, index.column(), PropertyModel::PropertyFlagsRole);
         if (!v.isNull())
             res.insert(PropertyModel::PropertyFlagsRole, v);
-        v = data(adaptor, d, index.column(), PropertyModel::PropertyRevisionRole);
+        v = data(d, index.column(), PropertyModel::PropertyRevisionRole);
         if (!v.isNull())
             res.insert(PropertyModel::PropertyRevisionRole, v);
-        v = data(adaptor, d, index.column(), PropertyModel::NotifySignalRole);
+        v = data(d, index.column(), PropertyModel::NotifySignalRole);
         if (!v.isNull())
             res.insert(PropertyModel::NotifySignalRole, v);
     } else if (index.column() == 1) {
-        res.insert(Qt::EditRole, data(adaptor, d, index.column(), Qt::EditRole));
-        res.insert(Qt::DecorationRole, data(adaptor, d, index.column(), Qt::DecorationRole));
-        if (d.value().type() == QVariant::Bool)
-            res.insert(Qt::CheckStateRole, data(adaptor, d, index.column(), Qt::CheckStateRole));
+        res.insert(Qt::EditRole, data(d, index.column(), Qt::EditRole));
+        res.insert(Qt::DecorationRole, data(d, index.column(), Qt::DecorationRole));
+        if (d.data.value().type() == QVariant::Bool)
+            res.insert(Qt::CheckStateRole, data(d, index.column(), Qt::CheckStateRole));
     }
     return res;
 }
 
-QVariant AggregatedPropertyModel::data(PropertyAdaptor *adaptor, const PropertyData &d, int column,
-                                       int role) const
+const AggregatedPropertyModel::CachedProperty &AggregatedPropertyModel::cachedProperty(
+    PropertyAdaptor *adaptor, int row) const
 {
+    auto &rows = m_propertyCache[adaptor];
+    auto it = rows.find(row);
+    if (it == rows.end())
+        it = rows.insert(row, readProperty(adaptor, row));
+    return it.value();
+}
+
+AggregatedPropertyModel::CachedProperty AggregatedPropertyModel::readProperty(
+    PropertyAdaptor *adaptor, int row) const
+{
+    CachedProperty p;
+    p.data = adaptor->propertyData(row);
+
+    const auto &value = p.data.value();
+    // QMetaProperty::read sets QVariant::typeName to int for enums,
+    // so we need to handle that separately here
+    p.metaEnum = EnumUtil::metaEnum(value, p.data.typeName().toLatin1(), adaptor->object().metaObject());
+    QString enumStr;
+    if (p.metaEnum.isValid()) {
+        enumStr = QString::fromLatin1(p.metaEnum.valueToKeys(EnumUtil::enumToInt(value, p.metaEnum)));
+    } else if (EnumRepositoryServer::isEnum(value.userType())) {
+        const auto ev = EnumRepositoryServer::valueFromVariant(value);
+        enumStr = EnumRepositoryServer::definitionForId(ev.id()).valueToString(ev);
+    }
+
+    if (!enumStr.isEmpty())
+        p.displayValue = enumStr;
+    else if (value.type() != QVariant::Bool || (p.data.accessFlags() & PropertyData::Writable) == 0)
+        p.displayValue = VariantHandler::displayString(value);
+    return p;
+}
+
+void AggregatedPropertyModel::invalidateCache(PropertyAdaptor *adaptor)
+{
+    m_propertyCache.remove(adaptor);
+    foreach (auto child, m_parentChildrenMap.value(adaptor)) {
+        if (child)
+            invalidateCache(child);
+    }
+}
+
+void AggregatedPropertyModel::invalidateCache(PropertyAdaptor *adaptor, int row)
+{
+    auto it = m_propertyCache.find(adaptor);
+    if (it != m_propertyCache.end())
+        it.value().remove(row);
+}
+
+QVariant AggregatedPropertyModel::data(const CachedProperty &p, int column, int role) const
+{
+    const auto &d = p.data;
     switch (role) {
     case Qt::DisplayRole:
         switch (column) {
         case 0:
             return d.name();
         case 1:
-        {
-            // QMetaProperty::read sets QVariant::typeName to int for enums,
-            // so we need to handle that separately here
-            const QString enumStr = EnumUtil::enumToString(d.value(), d.typeName().toLatin1(), adaptor->object().metaObject());
-            if (!enumStr.isEmpty())
-                return enumStr;
-            if (d.value().type() == QVariant::Bool && (d.accessFlags() & PropertyData::Writable))
-                return QVariant();
-            return VariantHandler::displayString(d.value());
-        }
+            return p.displayValue;
         case 2:
             return d.typeName();
         case 3:
@@ -185,10 +254,9 @@ QVariant AggregatedPropertyModel::data(PropertyAdaptor *adaptor, const PropertyD
         break;
     case Qt::EditRole:
         if (column == 1) {
-            const auto me = EnumUtil::metaEnum(d.value(), d.typeName().toLatin1(), adaptor->object().metaObject());
-            if (me.isValid()) {
-                const auto num = EnumUtil::enumToInt(d.value(), me);
-                return QVariant::fromValue(EnumRepositoryServer::valueFromMetaEnum(num, me));
+            if (p.metaEnum.isValid()) {
+                const auto num = EnumUtil::enumToInt(d.value(), p.metaEnum);
+                return QVariant::fromValue(EnumRepositoryServer::valueFromMetaEnum(num, p.metaEnum));
             }
             return VariantHandler::serializableVariant(d.value());
         }
@@ -260,15 +328,18 @@ bool AggregatedPropertyModel::setData(const QModelIndex &index, const QVariant &
         } else {
             adaptor->writeProperty(index.row(), value);
         }
+        invalidateCache(adaptor, index.row());
         propagateWrite(adaptor);
         return true;
     }
     case Qt::CheckStateRole:
         adaptor->writeProperty(index.row(), value.toInt() == Qt::Checked);
+        invalidateCache(adaptor, index.row());
         propagateWrite(adaptor);
         return true;
     case PropertyModel::ResetActionRole:
         adaptor->resetProperty(index.row());
+        invalidateCache(adaptor, index.row());
         return true;
     }
 
@@ -292,7 +363,7 @@ int AggregatedPropertyModel::rowCount(const QModelIndex &parent) const
     auto &siblings = m_parentChildrenMap[adaptor];
     if (!m_inhibitAdaptorCreation && !siblings.at(parent.row())) {
         // TODO: remember we tried any of this
-        auto pd = adaptor->propertyData(parent.row());
+        const auto pd = cachedProperty(adaptor, parent.row()).data;
         if (!hasLoop(adaptor, pd.value())) {
             auto a = PropertyAdaptorFactory::create(pd.value(), adaptor);
             siblings[parent.row()] = a;
@@ -312,7 +383,7 @@ Qt::ItemFlags AggregatedPropertyModel::flags(const QModelIndex &index) const
         return baseFlags;
 
     auto adaptor = adaptorForIndex(index);
-    auto data = adaptor->propertyData(index.row());
+    const auto data = cachedProperty(adaptor, index.row()).data;
     const auto editable = (data.accessFlags() & PropertyData::Writable) && isParentEditable(adaptor);
     const auto booleanEditable = editable && data.value().type() == QVariant::Bool;
     if (booleanEditable)
@@ -370,6 +441,13 @@ void AggregatedPropertyModel::propertyChanged(int first, int last)
     Q_ASSERT(first >= 0);
     Q_ASSERT(last < adaptor->count());
 
+    propertiesChanged(adaptor, first, last);
+}
+
+void AggregatedPropertyModel::propertiesChanged(PropertyAdaptor *adaptor, int first, int last)
+{
+    for (int i = first; i <= last; ++i)
+        invalidateCache(adaptor, i);
     emit dataChanged(createIndex(first, 0, adaptor), createIndex(last, columnCount() - 1, adaptor));
     for (int i = first; i <= last; ++i)
         reloadSubTree(adaptor, i);
@@ -384,6 +462,9 @@ void AggregatedPropertyModel::propertyAdded(int first, int last)
     Q_ASSERT(first >= 0);
     Q_ASSERT(last < adaptor->count());
 
+    // rows are shifted, so all cached rows of this adaptor are invalid
+    invalidateCache(adaptor);
+
     auto idx = createIndex(first, 0, adaptor);
     beginInsertRows(idx.parent(), first, last);
     auto &children = m_parentChildrenMap[adaptor];
@@ -403,6 +484,8 @@ void AggregatedPropertyModel::propertyRemoved(int first, int last)
     Q_ASSERT(first >= 0);
     Q_ASSERT(last < adaptor->count());
 
+    invalidateCache(adaptor);
+
     auto idx = createIndex(first, 0, adaptor);
     beginRemoveRows(idx.parent(), first, last);
     auto &children = m_parentChildrenMap[adaptor];
@@ -430,7 +513,9 @@ void AggregatedPropertyModel::objectInvalidated(PropertyAdaptor *adaptor)
     auto parentAdaptor = adaptor->parentAdaptor();
     Q_ASSERT(parentAdaptor);
     Q_ASSERT(m_parentChildrenMap.contains(parentAdaptor));
-    reloadSubTree(parentAdaptor, m_parentChildrenMap.value(parentAdaptor).indexOf(adaptor));
+    const auto row = m_parentChildrenMap.value(parentAdaptor).indexOf(adaptor);
+    invalidateCache(parentAdaptor, row);
+    reloadSubTree(parentAdaptor, row);
 }
 
 bool AggregatedPropertyModel::hasLoop(PropertyAdaptor *adaptor, const QVariant &v) const
@@ -467,6 +552,7 @@ void AggregatedPropertyModel::reloadSubTree(PropertyAdaptor *parentAdaptor, int
         auto oldRowCount = m_parentChildrenMap.value(oldAdaptor).size();
         if (oldRowCount > 0)
             beginRemoveRows(createIndex(index, 0, parentAdaptor), 0, oldRowCount - 1);
+        invalidateCache(oldAdaptor);
         m_parentChildrenMap[parentAdaptor][index] = nullptr;
         m_parentChildrenMap.remove(oldAdaptor);
         delete oldAdaptor;
@@ -476,7 +562,7 @@ void AggregatedPropertyModel::reloadSubTree(PropertyAdaptor *parentAdaptor, int
 
     // re-add the sub-tree
     // TODO consolidate with code in rowCount()
-    auto pd = parentAdaptor->propertyData(index);
+    const auto pd = cachedProperty(parentAdaptor, index).data;
     if (hasLoop(parentAdaptor, pd.value())) {
         m_inhibitAdaptorCreation = false;
         return;
@@ -508,7 +594,7 @@ bool AggregatedPropertyModel::isParentEditable(PropertyAdaptor *adaptor) const
         const auto row = m_parentChildrenMap.value(parentAdaptor).indexOf(adaptor);
         Q_ASSERT(row >= 0);
 
-        const auto pd = parentAdaptor->propertyData(row);
+        const auto pd = cachedProperty(parentAdaptor, row).data;
         if ((pd.accessFlags() & PropertyData::Writable) == 0)
             return false;
     }
@@ -527,7 +613,39 @@ void AggregatedPropertyModel::propagateWrite(GammaRay::PropertyAdaptor* adaptor)
         Q_ASSERT(row >= 0);
 
         parentAdaptor->writeProperty(row, adaptor->object().variant());
+        invalidateCache(parentAdaptor, row);
     }
 
     propagateWrite(parentAdaptor);
 }
+
+void AggregatedPropertyModel::pollProperties()
+{
+    // properties without notify signal can only be checked for changes by reading them again,
+    // we do that only for the ones that have been read already, and in one go
+    QVector<QPair<PropertyAdaptor *, int> > changes;
+    for (auto it = m_propertyCache.begin(); it != m_propertyCache.end(); ++it) {
+        const auto adaptor = it.key();
+        if (!adaptor->object().isValid())
+            continue;
+        for (auto rowIt = it.value().begin(); rowIt != it.value().end(); ++rowIt) {
+            if (!rowIt.value().data.notifySignal().isEmpty())
+                continue;
+            const auto p = readProperty(adaptor, rowIt.key());
+            const auto &oldValue = rowIt.value().data.value();
+            // writable booleans have no display value, everything else is compared by that
+            if (p.displayValue != rowIt.value().displayValue
+                || p.data.value().userType() != oldValue.userType()
+                || (oldValue.type() == QVariant::Bool && p.data.value() != oldValue))
+                changes.push_back(qMakePair(adaptor, rowIt.key()));
+        }
+    }
+
+    // this modifies the cache, so we can't do it in the above loop
+    foreach (const auto &change, changes) {
+        // the adaptor might have been deleted as part of a previous sub-tree reload
+        if (!m_propertyCache.contains(change.first) || !m_parentChildrenMap.contains(change.first))
+            continue;
+        propertiesChanged(change.first, change.second, change.second);
+    }
+}
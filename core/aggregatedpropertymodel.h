@@ -30,14 +30,19 @@
 #define GAMMARAY_AGGREGATEDPROPERTYMODEL_H
 
 #include "gammaray_core_export.h"
+#include "propertydata.h"
 
 #include <QAbstractItemModel>
 #include <QHash>
+#include <QMetaEnum>
 #include <QVector>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class PropertyAdaptor;
-class PropertyData;
 class ObjectInstance;
 
 /** Generic property model. */
@@ -62,15 +67,32 @@ public:
     Qt::ItemFlags flags(const QModelIndex &index) const override;
     QMap<int, QVariant> itemData(const QModelIndex &index) const override;
 
+protected:
+    void customEvent(QEvent *event) override;
+
 private:
+    /** Property data read once and kept until it changes, see cachedProperty(). */
+    struct CachedProperty {
+        PropertyData data;
+        QMetaEnum metaEnum;
+        QVariant displayValue;
+    };
+
     void clear();
     PropertyAdaptor *adaptorForIndex(const QModelIndex &index) const;
     void addPropertyAdaptor(PropertyAdaptor *adaptor) const;
-    QVariant data(PropertyAdaptor *adaptor, const PropertyData &d, int column, int role) const;
+    const CachedProperty &cachedProperty(PropertyAdaptor *adaptor, int row) const;
+    CachedProperty readProperty(PropertyAdaptor *adaptor, int row) const;
+    void invalidateCache(PropertyAdaptor *adaptor);
+    void invalidateCache(PropertyAdaptor *adaptor, int row);
+    QVariant data(const CachedProperty &p, int column, int role) const;
     bool hasLoop(PropertyAdaptor *adaptor, const QVariant &v) const;
     void reloadSubTree(PropertyAdaptor *parentAdaptor, int index);
     bool isParentEditable(PropertyAdaptor *adaptor) const;
     void propagateWrite(PropertyAdaptor *adaptor);
+    void updatePollTimer();
+
+    void propertiesChanged(PropertyAdaptor *adaptor, int first, int last);
 
 private slots:
     void propertyChanged(int first, int last);
@@ -78,12 +100,18 @@ private slots:
     void propertyRemoved(int first, int last);
     void objectInvalidated();
     void objectInvalidated(GammaRay::PropertyAdaptor *adaptor);
+    void pollProperties();
 
 private:
     PropertyAdaptor *m_rootAdaptor;
     mutable QHash<PropertyAdaptor *, QVector<PropertyAdaptor *> > m_parentChildrenMap;
+    // properties are read at most once until they change, changes are detected by
+    // notify signals, or by polling for properties without one
+    mutable QHash<PropertyAdaptor *, QHash<int, CachedProperty> > m_propertyCache;
+    QTimer *m_pollTimer;
     bool m_inhibitAdaptorCreation;
     bool m_readOnly;
+    bool m_used;
 };
 }
 
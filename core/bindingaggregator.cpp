@@ -39,9 +39,12 @@
 #include <common/objectbroker.h>
 
 // Qt
+#include <QHash>
 #include <QMetaProperty>
 #include <QMetaObject>
 #include <QMutexLocker>
+#include <QPair>
+#include <QVector>
 
 using namespace GammaRay;
 
@@ -106,28 +109,182 @@ std::vector<std::unique_ptr<BindingNode>> BindingAggregator::bindingTreeForObjec
     return bindings;
 }
 
+namespace {
+/**
+ * Flat dependency graph over all bindings in the application.
+ *
+ * Every (object, property) pair is represented by exactly one node, so
+ * dependencies shared between many bindings are only queried from the
+ * providers once, unlike with bindingTreeForObject(), which expands them
+ * for each binding again.
+ */
+class BindingGraph
+{
+public:
+    void addBindingsFor(QObject *obj)
+    {
+        for (auto providerIt = s_providers()->cbegin(); providerIt != s_providers()->cend(); ++providerIt) {
+            auto bindings = (*providerIt)->findBindingsFor(obj);
+            for (auto nodeIt = bindings.begin(); nodeIt != bindings.end(); ++nodeIt) {
+                const int id = addNode(std::move(*nodeIt));
+                if (!m_nodes[id].isBinding) {
+                    m_nodes[id].isBinding = true;
+                    m_bindings.push_back(id);
+                }
+            }
+        }
+    }
+
+    /// Queries the dependencies of all nodes not yet expanded, including nodes added on the way.
+    void expand()
+    {
+        for (; m_expanded < static_cast<int>(m_nodes.size()); ++m_expanded) {
+            for (auto providerIt = s_providers()->cbegin(); providerIt != s_providers()->cend(); ++providerIt) {
+                auto dependencies = (*providerIt)->findDependenciesFor(m_nodes[m_expanded].binding.get());
+                for (auto depIt = dependencies.begin(); depIt != dependencies.end(); ++depIt) {
+                    const int depId = addNode(std::move(*depIt));
+                    if (!m_nodes[m_expanded].edges.contains(depId))
+                        m_nodes[m_expanded].edges.push_back(depId);
+                }
+            }
+        }
+    }
+
+    /**
+     * Marks all nodes that are part of, or depend on, a binding loop.
+     * This is Tarjan's strongly connected components algorithm, unrolled to
+     * not overflow the stack on long dependency chains.
+     */
+    void findLoops()
+    {
+        int nextIndex = 0;
+        QVector<int> sccStack;
+        QVector<QPair<int, int> > callStack; // node id, next edge to visit
+
+        for (int root = 0; root < static_cast<int>(m_nodes.size()); ++root) {
+            if (m_nodes[root].index >= 0)
+                continue;
+
+            callStack.push_back(qMakePair(root, 0));
+            while (!callStack.isEmpty()) {
+                const int v = callStack.last().first;
+                Node &node = m_nodes[v];
+                if (callStack.last().second == 0 && node.index < 0) {
+                    node.index = node.lowLink = nextIndex++;
+                    node.onStack = true;
+                    sccStack.push_back(v);
+                }
+
+                if (callStack.last().second < node.edges.size()) {
+                    const int w = node.edges.at(callStack.last().second++);
+                    if (m_nodes[w].index < 0)
+                        callStack.push_back(qMakePair(w, 0));
+                    else if (m_nodes[w].onStack)
+                        node.lowLink = qMin(node.lowLink, m_nodes[w].index);
+                    continue;
+                }
+
+                callStack.pop_back();
+                if (!callStack.isEmpty()) {
+                    Node &caller = m_nodes[callStack.last().first];
+                    caller.lowLink = qMin(caller.lowLink, node.lowLink);
+                }
+                if (node.lowLink == node.index)
+                    popComponent(v, sccStack);
+            }
+        }
+    }
+
+    void reportLoops() const
+    {
+        foreach (int id, m_bindings) {
+            const Node &node = m_nodes[id];
+            if (!node.reachesLoop)
+                continue;
+
+            BindingNode *bindingNode = node.binding.get();
+            Problem p;
+            p.severity = Problem::Error;
+            p.description = QStringLiteral("Object %1 / Property %2 has a binding loop.").arg(ObjectDataProvider::typeName(bindingNode->object())).arg(bindingNode->canonicalName());
+            p.object = ObjectId(bindingNode->object());
+            p.locations.push_back(bindingNode->sourceLocation());
+            p.problemId = QString("com.kdab.GammaRay.ObjectInspector.BindingLoopScan:%1.%2").arg(reinterpret_cast<quintptr>(bindingNode->object())).arg(bindingNode->propertyIndex());
+            p.findingCategory = Problem::Scan;
+            ProblemCollector::addProblem(p);
+        }
+    }
+
+private:
+    struct Node
+    {
+        std::unique_ptr<BindingNode> binding;
+        QVector<int> edges;
+        int index = -1;
+        int lowLink = -1;
+        bool onStack = false;
+        bool isBinding = false;
+        bool reachesLoop = false;
+    };
+
+    int addNode(std::unique_ptr<BindingNode> binding)
+    {
+        const auto key = qMakePair(binding->object(), binding->propertyIndex());
+        const auto it = m_nodeIds.constFind(key);
+        if (it != m_nodeIds.constEnd())
+            return it.value();
+
+        binding->setParent(nullptr); // loops are detected on the graph, not along the parent chain
+        binding->dependencies().clear();
+        Node node;
+        node.binding = std::move(binding);
+        m_nodes.push_back(std::move(node));
+        const int id = static_cast<int>(m_nodes.size()) - 1;
+        m_nodeIds.insert(key, id);
+        return id;
+    }
+
+    void popComponent(int root, QVector<int> &sccStack)
+    {
+        const int first = sccStack.lastIndexOf(root);
+        const QVector<int> component = sccStack.mid(first);
+        sccStack.resize(first);
+
+        bool reachesLoop = component.size() > 1 || m_nodes[root].edges.contains(root);
+        foreach (int id, component)
+            m_nodes[id].onStack = false;
+        // All components reachable from here have been completed already,
+        // so their reachesLoop flag is final.
+        for (auto idIt = component.constBegin(); !reachesLoop && idIt != component.constEnd(); ++idIt) {
+            foreach (int w, m_nodes[*idIt].edges) {
+                if (m_nodes[w].reachesLoop) {
+                    reachesLoop = true;
+                    break;
+                }
+            }
+        }
+        foreach (int id, component)
+            m_nodes[id].reachesLoop = reachesLoop;
+    }
+
+    std::vector<Node> m_nodes;
+    QHash<QPair<QObject*, int>, int> m_nodeIds;
+    QVector<int> m_bindings;
+    int m_expanded = 0;
+};
+}
+
 void BindingAggregator::scanForBindingLoops()
 {
     const QVector<QObject*> &allObjects = Probe::instance()->allQObjects();
 
     QMutexLocker lock(Probe::objectLock());
+    BindingGraph graph;
     foreach (QObject *obj, allObjects) {
         if (!Probe::instance()->isValidObject(obj))
             continue;
-
-        auto bindings = bindingTreeForObject(obj);
-        for (auto it = bindings.begin(); it != bindings.end(); ++it) {
-            auto &&bindingNode = *it;
-            if (bindingNode->isPartOfBindingLoop()) {
-                Problem p;
-                p.severity = Problem::Error;
-                p.description = QStringLiteral("Object %1 / Property %2 has a binding loop.").arg(ObjectDataProvider::typeName(bindingNode->object())).arg(bindingNode->canonicalName());
-                p.object = ObjectId(bindingNode->object());
-                p.locations.push_back(bindingNode->sourceLocation());
-                p.problemId = QString("com.kdab.GammaRay.ObjectInspector.BindingLoopScan:%1.%2").arg(reinterpret_cast<quintptr>(bindingNode->object())).arg(bindingNode->propertyIndex());
-                p.findingCategory = Problem::Scan;
-                ProblemCollector::addProblem(p);
-            }
-        }
+        graph.addBindingsFor(obj);
     }
+    graph.expand();
+    graph.findLoops();
+    graph.reportLoops();
 }
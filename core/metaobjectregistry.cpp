@@ -36,6 +36,7 @@
 #include <common/tools/metaobjectbrowser/qmetaobjectmodel.h>
 
 #include <QDebug>
+#include <QMutexLocker>
 #include <QThread>
 #include <QTimer>
 
@@ -82,10 +83,20 @@ static inline bool hasDynamicMetaObject(const QObject *object)
     return reinterpret_cast<const UnprotectedQObject *>(object)->data()->metaObject != nullptr;
 }
 
+/// interval at which per-class creation and destruction rates are sampled
+static const int RateSampleInterval = 1000;
+
 MetaObjectRegistry::MetaObjectRegistry(QObject *parent)
     : QObject(parent)
+    , m_rateTimer(new QTimer(this))
+    , m_lastRateSample(0)
+    , m_unresolvedCount(0)
+    , m_unresolvedTotalLifetime(0)
 {
     qRegisterMetaType<const QMetaObject *>();
+    m_clock.start();
+    m_rateTimer->setInterval(RateSampleInterval);
+    connect(m_rateTimer, SIGNAL(timeout()), this, SLOT(updateRates()));
     scanMetaTypes();
 }
 
@@ -116,6 +127,27 @@ QVariant MetaObjectRegistry::data(const QMetaObject *metaObject, MetaObjectData
         if (inheritsQObject(metaObject))
             return m_metaObjectInfoMap.value(metaObject).inclusiveAliveCount;
         return QStringLiteral("-");
+    case PeakAliveCount:
+        if (inheritsQObject(metaObject))
+            return m_metaObjectInfoMap.value(metaObject).peakAliveCount;
+        return QStringLiteral("-");
+    case CreationRate:
+        if (inheritsQObject(metaObject))
+            return qRound(m_metaObjectInfoMap.value(metaObject).creationRate * 10.0) / 10.0;
+        return QStringLiteral("-");
+    case DestructionRate:
+        if (inheritsQObject(metaObject))
+            return qRound(m_metaObjectInfoMap.value(metaObject).destructionRate * 10.0) / 10.0;
+        return QStringLiteral("-");
+    case AverageLifetime:
+    {
+        if (!inheritsQObject(metaObject))
+            return QStringLiteral("-");
+        const auto &info = m_metaObjectInfoMap.value(metaObject);
+        if (info.destroyedCount == 0)
+            return QVariant();
+        return static_cast<qlonglong>(info.totalLifetime / info.destroyedCount);
+    }
     }
     return QVariant();
 }
@@ -180,12 +212,23 @@ void MetaObjectRegistry::objectAdded(QObject *obj)
      * If this yields some performance issues, we might need to remove the inclusive
      * costs calculation altogether (a calculate-on-request pattern should be even slower)
      */
-    m_metaObjectMap.insert(obj, metaObject);
+    ObjectInfo objInfo;
+    objInfo.metaObject = metaObject;
+    const auto pending = m_pendingConstructions.find(obj);
+    if (pending != m_pendingConstructions.end()) {
+        objInfo.creationTime = pending.value();
+        m_pendingConstructions.erase(pending);
+    } else {
+        objInfo.creationTime = m_clock.elapsed();
+    }
+    m_metaObjectMap.insert(obj, objInfo);
     auto &info = m_metaObjectInfoMap[metaObject];
     ++info.selfCount;
     ++info.selfAliveCount;
+    info.peakAliveCount = std::max(info.peakAliveCount, info.selfAliveCount);
     if (info.isDynamic)
         addAliveInstance(obj, metaObject);
+    markCensusActive(metaObject);
 
     // increase inclusive counts
     const QMetaObject *current = metaObject;
@@ -254,7 +297,8 @@ void MetaObjectRegistry::objectRemoved(QObject *obj)
     Q_ASSERT(thread() == QThread::currentThread());
 
     // decrease counter
-    const QMetaObject *metaObject = m_metaObjectMap.take(obj);
+    const ObjectInfo objInfo = m_metaObjectMap.take(obj);
+    const QMetaObject *metaObject = objInfo.metaObject;
     if (!metaObject)
         return;
 
@@ -267,8 +311,11 @@ void MetaObjectRegistry::objectRemoved(QObject *obj)
 
     --info.selfAliveCount;
     assert(info.selfAliveCount >= 0);
+    ++info.destroyedCount;
+    info.totalLifetime += m_clock.elapsed() - objInfo.creationTime;
     if (info.isDynamic)
         removeAliveInstance(obj, metaObject);
+    markCensusActive(metaObject);
 
     // decrease inclusive counts
     const QMetaObject *current = metaObject;
@@ -287,6 +334,80 @@ void MetaObjectRegistry::objectRemoved(QObject *obj)
     }
 }
 
+void MetaObjectRegistry::objectConstructionStarted(QObject *obj)
+{
+    // the class is only resolved in objectAdded(), the hook runs in the QObject ctor
+    m_pendingConstructions.insert(obj, m_clock.elapsed());
+}
+
+void MetaObjectRegistry::objectConstructionAborted(QObject *obj, bool destroyed)
+{
+    const auto pending = m_pendingConstructions.find(obj);
+    if (pending == m_pendingConstructions.end())
+        return;
+    if (destroyed) {
+        ++m_unresolvedCount;
+        m_unresolvedTotalLifetime += m_clock.elapsed() - pending.value();
+    }
+    m_pendingConstructions.erase(pending);
+}
+
+int MetaObjectRegistry::unresolvedCount() const
+{
+    QMutexLocker lock(Probe::objectLock());
+    return m_unresolvedCount;
+}
+
+qint64 MetaObjectRegistry::unresolvedTotalLifetime() const
+{
+    QMutexLocker lock(Probe::objectLock());
+    return m_unresolvedTotalLifetime;
+}
+
+void MetaObjectRegistry::markCensusActive(const QMetaObject *metaObject)
+{
+    m_censusActive.insert(metaObject);
+    if (!m_rateTimer->isActive()) {
+        m_lastRateSample = m_clock.elapsed();
+        m_rateTimer->start();
+    }
+}
+
+void MetaObjectRegistry::updateRates()
+{
+    const auto now = m_clock.elapsed();
+    const auto elapsed = now - m_lastRateSample;
+    if (elapsed <= 0)
+        return;
+    m_lastRateSample = now;
+
+    // only classes that saw instances come or go recently are touched here, everything
+    // else is idle and already reports a rate of zero
+    for (auto it = m_censusActive.begin(); it != m_censusActive.end();) {
+        auto &info = m_metaObjectInfoMap[*it];
+        const auto created = info.selfCount - info.sampledSelfCount;
+        const auto destroyed = info.destroyedCount - info.sampledDestroyedCount;
+        info.sampledSelfCount = info.selfCount;
+        info.sampledDestroyedCount = info.destroyedCount;
+
+        const auto creationRate = created * 1000.0 / elapsed;
+        const auto destructionRate = destroyed * 1000.0 / elapsed;
+        const auto changed = creationRate != info.creationRate || destructionRate != info.destructionRate;
+        info.creationRate = creationRate;
+        info.destructionRate = destructionRate;
+        if (changed)
+            emit dataChanged(*it);
+
+        if (created == 0 && destroyed == 0)
+            it = m_censusActive.erase(it);
+        else
+            ++it;
+    }
+
+    if (m_censusActive.isEmpty())
+        m_rateTimer->stop();
+}
+
 bool MetaObjectRegistry::isKnownMetaObject(const QMetaObject *metaObject) const
 {
     return m_childParentMap.contains(metaObject);
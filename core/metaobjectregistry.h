@@ -29,13 +29,21 @@
 #ifndef GAMMARAY_METAOBJECTREGISTRY_H
 #define GAMMARAY_METAOBJECTREGISTRY_H
 
+#include "gammaray_core_export.h"
+
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QSet>
 #include <QVector>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 
-class MetaObjectRegistry : public QObject
+class GAMMARAY_CORE_EXPORT MetaObjectRegistry : public QObject
 {
     Q_OBJECT
 
@@ -47,6 +55,10 @@ public:
         SelfAliveCount,
         InclusiveCount,
         InclusiveAliveCount,
+        PeakAliveCount,
+        CreationRate,
+        DestructionRate,
+        AverageLifetime
     };
 
     explicit MetaObjectRegistry(QObject *parent = nullptr);
@@ -64,6 +76,26 @@ public:
 
     const QMetaObject *canonicalMetaObject(const QMetaObject *metaObject) const;
 
+    /**
+     * Called when the construction of @p obj starts, objectAdded() follows once it is fully
+     * constructed. Call from any thread, with Probe::objectLock() held.
+     */
+    void objectConstructionStarted(QObject *obj);
+    /**
+     * Called instead of objectAdded() for @p obj after objectConstructionStarted(), if it won't
+     * be added after all. If it got @p destroyed, it is counted as an unresolved instance.
+     * Call from any thread, with Probe::objectLock() held.
+     */
+    void objectConstructionAborted(QObject *obj, bool destroyed);
+
+    /**
+     * Number of objects destroyed before objectAdded() could resolve their class. Their
+     * meta object is gone by then, so they are not part of any per-class count.
+     */
+    int unresolvedCount() const;
+    /// Summed up lifetime of the unresolved objects, in milliseconds.
+    qint64 unresolvedTotalLifetime() const;
+
 public slots:
     void objectAdded(QObject *obj);
     void objectRemoved(QObject *obj);
@@ -73,6 +105,9 @@ signals:
     void afterMetaObjectAdded(const QMetaObject *metaObject);
     void dataChanged(const QMetaObject *metaObject);
 
+private slots:
+    void updateRates();
+
 private:
     const QMetaObject *addMetaObject(const QMetaObject *metaObject, bool mergeDynamic = false);
     bool inheritsQObject(const QMetaObject *metaObject) const;
@@ -80,6 +115,7 @@ private:
     bool isKnownMetaObject(const QMetaObject *metaObject) const;
     void addAliveInstance(QObject *obj, const QMetaObject *canonicalMO);
     void removeAliveInstance(QObject *obj, const QMetaObject *canonicalMO);
+    void markCensusActive(const QMetaObject *metaObject);
 
 private:
     QHash<const QMetaObject *, const QMetaObject *> m_childParentMap;
@@ -94,7 +130,14 @@ private:
             , selfCount(0)
             , selfAliveCount(0)
             , inclusiveCount(0)
-            , inclusiveAliveCount(0) {}
+            , inclusiveAliveCount(0)
+            , peakAliveCount(0)
+            , destroyedCount(0)
+            , totalLifetime(0)
+            , sampledSelfCount(0)
+            , sampledDestroyedCount(0)
+            , creationRate(0.0)
+            , destructionRate(0.0) {}
 
         /// @c true if this is a static meta object that can only become invalid by DLL unloading.
         bool isStatic;
@@ -116,13 +159,35 @@ private:
         int inclusiveCount;
         /// Inclusive instance count currently alive
         int inclusiveAliveCount;
+        /// Highest number of instances of a meta object alive at the same time
+        int peakAliveCount;
+        /// Number of instances of a meta object destroyed so far
+        int destroyedCount;
+        /// Sum of the lifetimes of all destroyed instances, in milliseconds
+        qint64 totalLifetime;
+        /// selfCount and destroyedCount at the last rate sample
+        int sampledSelfCount;
+        int sampledDestroyedCount;
+        /// Instances created/destroyed per second over the last sample interval
+        double creationRate;
+        double destructionRate;
         /// A copy of QMetaObject::className()
         QByteArray className;
     };
     QHash<const QMetaObject*, MetaObjectInfo> m_metaObjectInfoMap;
+    struct ObjectInfo
+    {
+        ObjectInfo()
+            : metaObject(nullptr)
+            , creationTime(0) {}
+
+        const QMetaObject *metaObject;
+        /// m_clock timestamp of when we saw the object being created
+        qint64 creationTime;
+    };
     /// canonical meta objects at creation time, so we can correctly decrement instance counts
     /// after destruction
-    QHash<QObject*, const QMetaObject*> m_metaObjectMap;
+    QHash<QObject*, ObjectInfo> m_metaObjectMap;
     /// name to canonical QMO map, for merging dynamic meta objects as produced by QML
     QHash<QByteArray, const QMetaObject*> m_metaObjectNameMap;
 
@@ -133,6 +198,20 @@ private:
     QHash<QObject*, const QMetaObject*> m_dynamicMetaObjectMap;
     /// QMO instance to canonical QMO mapping (for dynamic ones only)
     QHash<const QMetaObject*, const QMetaObject*> m_canonicalMetaObjectMap;
+
+    /// time base for object lifetimes and allocation rates
+    QElapsedTimer m_clock;
+    /// meta objects whose allocation rates need to be recomputed on the next sample
+    QSet<const QMetaObject*> m_censusActive;
+    QTimer *m_rateTimer;
+    qint64 m_lastRateSample;
+
+    /// creation times of objects between objectConstructionStarted() and objectAdded(),
+    /// guarded by the object lock
+    QHash<QObject*, qint64> m_pendingConstructions;
+    /// objects destroyed before objectAdded(), guarded by the object lock
+    int m_unresolvedCount;
+    qint64 m_unresolvedTotalLifetime;
 };
 }
 
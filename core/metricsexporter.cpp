@@ -0,0 +1,284 @@
+/*
+  metricsexporter.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "metricsexporter.h"
+#include "metaobjectregistry.h"
+#include "probe.h"
+#include "signalspycallbackset.h"
+
+#include <QEvent>
+#include <QFile>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QTimer>
+
+#include <iostream>
+
+using namespace GammaRay;
+
+static QAtomicInt s_signalCount;
+static QAtomicInt s_timerCount;
+static int s_timeoutMethodIndex = -1;
+
+static void countSignal(QObject *caller, int methodIndex, void **)
+{
+    s_signalCount.fetchAndAddRelaxed(1);
+    if (methodIndex == s_timeoutMethodIndex && qobject_cast<QTimer*>(caller))
+        s_timerCount.fetchAndAddRelaxed(1);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+// messages can be logged from any thread, and the handler stays installed as
+// long as anyone chained up to it, so this is independent of the exporter instance
+static QMutex s_messageMutex(QMutex::Recursive);
+static QHash<QByteArray, int> s_messageCounts;
+static QtMessageHandler s_previousMessageHandler = nullptr;
+static bool s_messageHandlerDisabled = false;
+
+static const char *messageTypeName(QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg:
+        return "debug";
+#if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
+    case QtInfoMsg:
+        return "info";
+#endif
+    case QtWarningMsg:
+        return "warning";
+    case QtCriticalMsg:
+        return "critical";
+    case QtFatalMsg:
+        return "fatal";
+    }
+    return "unknown";
+}
+
+static void countMessage(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+    ///WARNING: do not trigger any kind of debug output here
+    QMutexLocker lock(&s_messageMutex);
+    if (s_messageHandlerDisabled) // recursion through qt_message_output below
+        return;
+
+    QByteArray key(context.category ? context.category : "default");
+    key += ':';
+    key += messageTypeName(type);
+    ++s_messageCounts[key];
+
+    s_messageHandlerDisabled = true;
+    if (s_previousMessageHandler) {
+        s_previousMessageHandler(type, context, msg);
+    } else {
+        qInstallMessageHandler(nullptr);
+        qt_message_output(type, context, msg);
+        qInstallMessageHandler(countMessage);
+    }
+    s_messageHandlerDisabled = false;
+}
+#endif
+
+static void writeJsonString(QByteArray &out, const QByteArray &str)
+{
+    out += '"';
+    foreach (char c, str) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<uchar>(c) < 0x20) {
+            out += "\\u00";
+            out += QByteArray::number(static_cast<uchar>(c), 16).rightJustified(2, '0');
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+static void writeCounter(QByteArray &out, const char *name, int count, qint64 interval)
+{
+    out += '"';
+    out += name;
+    out += "\":{\"count\":";
+    out += QByteArray::number(count);
+    out += ",\"rate\":";
+    out += QByteArray::number(interval > 0 ? count * 1000.0 / interval : 0.0, 'f', 1);
+    out += '}';
+}
+
+MetricsExporter::MetricsExporter(const QString &target, int interval, Probe *probe)
+    : QObject(probe)
+    , m_probe(probe)
+    , m_device(nullptr)
+    , m_timer(new QTimer(this))
+    , m_lastSampleTime(0)
+    , m_paintEvents(0)
+{
+    if (target.startsWith(QLatin1String("local:"))) {
+        auto socket = new QLocalSocket(this);
+        socket->connectToServer(target.mid(6), QIODevice::WriteOnly);
+        m_device = socket;
+    } else {
+        auto file = new QFile(target, this);
+        if (!file->open(QIODevice::WriteOnly | QIODevice::Append)) {
+            std::cerr << "Unable to open metrics file " << qPrintable(target) << ": "
+                      << qPrintable(file->errorString()) << std::endl;
+            return;
+        }
+        m_device = file;
+    }
+
+    if (s_timeoutMethodIndex < 0)
+        s_timeoutMethodIndex = QTimer::staticMetaObject.indexOfSignal("timeout()");
+    SignalSpyCallbackSet callbacks;
+    callbacks.signalBeginCallback = countSignal;
+    probe->registerSignalSpyCallbackSet(callbacks);
+
+    probe->installGlobalEventFilter(this);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    {
+        QMutexLocker lock(&s_messageMutex);
+        const QtMessageHandler previousHandler = qInstallMessageHandler(countMessage);
+        if (previousHandler != countMessage)
+            s_previousMessageHandler = previousHandler;
+    }
+#endif
+
+    auto registry = probe->metaObjectRegistry();
+    addAllMetaObjects(nullptr);
+    connect(registry, SIGNAL(dataChanged(const QMetaObject*)),
+            this, SLOT(metaObjectChanged(const QMetaObject*)));
+
+    m_timer->setInterval(qMax(interval, 1));
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(writeSample()));
+    m_timer->start();
+    m_elapsed.start();
+    s_signalCount.fetchAndStoreRelaxed(0);
+    s_timerCount.fetchAndStoreRelaxed(0);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    QMutexLocker lock(&s_messageMutex);
+    const QtMessageHandler currentHandler = qInstallMessageHandler(s_previousMessageHandler);
+    if (currentHandler != countMessage) // someone chained up to us, keep forwarding
+        qInstallMessageHandler(currentHandler);
+    else
+        s_previousMessageHandler = nullptr;
+#endif
+}
+
+bool MetricsExporter::eventFilter(QObject *receiver, QEvent *event)
+{
+    if (event->type() == QEvent::Paint || event->type() == QEvent::UpdateRequest)
+        ++m_paintEvents;
+    return QObject::eventFilter(receiver, event);
+}
+
+void MetricsExporter::addAllMetaObjects(const QMetaObject *metaObject)
+{
+    foreach (auto child, m_probe->metaObjectRegistry()->childrenOf(metaObject)) {
+        m_changedMetaObjects.insert(child);
+        addAllMetaObjects(child);
+    }
+}
+
+void MetricsExporter::metaObjectChanged(const QMetaObject *metaObject)
+{
+    m_changedMetaObjects.insert(metaObject);
+}
+
+void MetricsExporter::writeSample()
+{
+    const qint64 now = m_elapsed.elapsed();
+    const qint64 interval = now - m_lastSampleTime;
+    m_lastSampleTime = now;
+
+    QByteArray out;
+    out.reserve(256);
+    out += "{\"time\":";
+    out += QByteArray::number(now);
+    out += ",\"interval\":";
+    out += QByteArray::number(interval);
+
+    out += ",\"objects\":{\"total\":";
+    {
+        QMutexLocker lock(Probe::objectLock());
+        out += QByteArray::number(m_probe->allQObjects().size());
+    }
+    out += ",\"types\":{";
+    bool first = true;
+    const auto registry = m_probe->metaObjectRegistry();
+    foreach (auto metaObject, m_changedMetaObjects) {
+        const int count = registry->data(metaObject, MetaObjectRegistry::SelfAliveCount).toInt();
+        auto it = m_reportedCounts.find(metaObject);
+        if (it != m_reportedCounts.end() ? it.value() == count : count == 0)
+            continue;
+        m_reportedCounts.insert(metaObject, count);
+        if (!first)
+            out += ',';
+        first = false;
+        writeJsonString(out, registry->data(metaObject, MetaObjectRegistry::ClassName).toByteArray());
+        out += ':';
+        out += QByteArray::number(count);
+    }
+    m_changedMetaObjects.clear();
+    out += "}},";
+
+    writeCounter(out, "signals", s_signalCount.fetchAndStoreRelaxed(0), interval);
+    out += ',';
+    writeCounter(out, "timers", s_timerCount.fetchAndStoreRelaxed(0), interval);
+    out += ',';
+    writeCounter(out, "paint", m_paintEvents, interval);
+    m_paintEvents = 0;
+
+    out += ",\"messages\":{";
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    QHash<QByteArray, int> messageCounts;
+    {
+        QMutexLocker lock(&s_messageMutex);
+        messageCounts.swap(s_messageCounts);
+    }
+    for (auto it = messageCounts.constBegin(); it != messageCounts.constEnd(); ++it) {
+        if (it != messageCounts.constBegin())
+            out += ',';
+        writeJsonString(out, it.key());
+        out += ':';
+        out += QByteArray::number(it.value());
+    }
+#endif
+    out += "}}\n";
+
+    if (!m_device->isWritable()) // socket not connected (anymore)
+        return;
+    m_device->write(out);
+    if (auto file = qobject_cast<QFile*>(m_device))
+        file->flush();
+}
@@ -0,0 +1,82 @@
+/*
+  metricsexporter.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_METRICSEXPORTER_H
+#define GAMMARAY_METRICSEXPORTER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+class QTimer;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+class Probe;
+
+/** Periodically writes performance metrics of the target as JSON lines to a file or
+ *  a local socket, for automated monitoring without a connected client.
+ *
+ *  Each sample contains the number of signal emissions, QTimer timeouts, paint events
+ *  and log messages (per category and type) since the previous sample, the total number
+ *  of tracked objects, and the alive instance count of all types that changed in
+ *  the meantime. The first sample contains all known types.
+ */
+class MetricsExporter : public QObject
+{
+    Q_OBJECT
+public:
+    /** @p target is a file name, or a local socket name when prefixed with "local:". */
+    explicit MetricsExporter(const QString &target, int interval, Probe *probe);
+    ~MetricsExporter();
+
+    bool eventFilter(QObject *receiver, QEvent *event) override;
+
+private slots:
+    void metaObjectChanged(const QMetaObject *metaObject);
+    void writeSample();
+
+private:
+    void addAllMetaObjects(const QMetaObject *metaObject);
+
+    Probe *m_probe;
+    QIODevice *m_device;
+    QTimer *m_timer;
+    QElapsedTimer m_elapsed;
+    qint64 m_lastSampleTime;
+
+    QSet<const QMetaObject*> m_changedMetaObjects;
+    QHash<const QMetaObject*, int> m_reportedCounts;
+    int m_paintEvents;
+};
+}
+
+#endif // GAMMARAY_METRICSEXPORTER_H
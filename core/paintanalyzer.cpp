@@ -39,6 +39,8 @@
 #include <core/stacktracemodel.h>
 #include <core/remote/serverproxymodel.h>
 
+#include <common/endpoint.h>
+#include <common/message.h>
 #include <common/metatypedeclarations.h>
 #include <common/objectbroker.h>
 #include <common/remoteviewframe.h>
@@ -46,6 +48,9 @@
 
 #include <QItemSelectionModel>
 #include <QSortFilterProxyModel>
+#include <QTimer>
+
+#include <algorithm>
 
 using namespace GammaRay;
 
@@ -67,6 +72,10 @@ PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
     , m_remoteView(new RemoteViewServer(name + QStringLiteral(".remoteView"), this))
     , m_argumentModel(new AggregatedPropertyModel(this))
     , m_stackTraceModel(new StackTraceModel(this))
+    , m_profiler(new PainterProfilingReplayer(this))
+    , m_commandStreamId(0)
+    , m_nextStreamCommand(-1)
+    , m_commandStreamTimer(new QTimer(this))
 {
 #ifdef HAVE_PRIVATE_QT_HEADERS
     m_paintBufferModel = new PaintBufferModel(this);
@@ -86,6 +95,12 @@ PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
     Probe::instance()->registerModel(name + QStringLiteral(".stackTrace"), m_stackTraceModel);
 
     connect(m_remoteView, SIGNAL(requestUpdate()), this, SLOT(repaint()));
+    connect(m_profiler, SIGNAL(costsChanged()), this, SLOT(updateCosts()));
+
+    m_commandStreamTimer->setSingleShot(true);
+    m_commandStreamTimer->setInterval(0);
+    connect(m_commandStreamTimer, SIGNAL(timeout()), this, SLOT(sendNextCommandChunk()));
+    connect(Endpoint::instance(), SIGNAL(sendBudgetAvailable()), m_commandStreamTimer, SLOT(start()));
 }
 
 PaintAnalyzer::~PaintAnalyzer()
@@ -96,7 +111,10 @@ void PaintAnalyzer::reset()
 {
     m_remoteView->sourceChanged();
 #ifdef HAVE_PRIVATE_QT_HEADERS
+    ++m_commandStreamId;
+    m_nextStreamCommand = -1;
     m_paintBufferModel->setPaintBuffer(PaintBuffer());
+    m_profiler->profile(PaintBuffer());
 #endif
 }
 
@@ -143,10 +161,10 @@ void PaintAnalyzer::repaint()
     }
     painter.end();
 
+    // the client obtains the command details (such as the clip path) via the command stream
     PaintAnalyzerFrameData data;
-    if (index.isValid()) {
-        data.clipPath = index.data(PaintBufferModelRoles::ClipPathRole).value<QPainterPath>();
-    }
+    data.commandStreamId = m_commandStreamId;
+    data.command = end - 1;
     RemoteViewFrame frame;
     frame.setImage(image);
     frame.setData(QVariant::fromValue(data));
@@ -195,6 +213,8 @@ void PaintAnalyzer::endAnalyzePainting()
     Q_ASSERT(m_paintBuffer);
     Q_ASSERT(m_paintBufferModel);
     m_paintBufferModel->setPaintBuffer(*m_paintBuffer);
+    ++m_commandStreamId;
+    m_nextStreamCommand = -1;
     delete m_paintBuffer;
     m_paintBuffer = nullptr;
     m_remoteView->resetView();
@@ -208,9 +228,14 @@ void PaintAnalyzer::endAnalyzePainting()
                                  QItemSelectionModel::Current);
     }
 
-    PainterProfilingReplayer profiler;
-    profiler.profile(m_paintBufferModel->buffer());
-    m_paintBufferModel->setCosts(profiler.costs());
+    m_profiler->profile(m_paintBufferModel->buffer());
+#endif
+}
+
+void PaintAnalyzer::updateCosts()
+{
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    m_paintBufferModel->setCosts(m_profiler->costs());
 #endif
 }
 
@@ -223,6 +248,67 @@ void GammaRay::PaintAnalyzer::setOrigin(const ObjectId &obj)
 #endif
 }
 
+bool PaintAnalyzer::hasCommandDetails(quint32 streamId, int command) const
+{
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    return streamId == m_commandStreamId && command >= 0 && command < m_paintBufferModel->rowCount();
+#else
+    Q_UNUSED(streamId);
+    Q_UNUSED(command);
+    return false;
+#endif
+}
+
+PaintCommandRecord PaintAnalyzer::commandDetails(quint32 streamId, int command) const
+{
+    if (!hasCommandDetails(streamId, command))
+        return PaintCommandRecord();
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    return m_paintBufferModel->commandRecord(command);
+#else
+    return PaintCommandRecord();
+#endif
+}
+
+void PaintAnalyzer::requestCommandStream(quint32 streamId)
+{
+    // requests for an outdated buffer are ignored, the client asks again for the current one
+    if (streamId != m_commandStreamId)
+        return;
+
+    // always start over, clients joining in the middle of a transfer can't decode the
+    // remaining chunks without the values interned in the previous ones
+    m_commandWriter = PaintCommandStreamWriter(Message::negotiatedDataVersion());
+    m_nextStreamCommand = 0;
+    m_commandStreamTimer->start();
+}
+
+void PaintAnalyzer::sendNextCommandChunk()
+{
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    // small enough for the client to show the first commands quickly
+    static const int ChunkCommands = 256;
+
+    // sendBudgetAvailable() resumes the transfer
+    if (m_nextStreamCommand < 0 || Endpoint::sendBudget() <= 0)
+        return;
+
+    const auto commandCount = m_paintBufferModel->rowCount();
+    const auto first = m_nextStreamCommand;
+    const auto last = std::min(first + ChunkCommands, commandCount);
+    for (int row = first; row < last; ++row)
+        m_commandWriter.write(m_paintBufferModel->commandRecord(row));
+    emit commandStreamChunk(m_commandStreamId, first, commandCount, m_commandWriter.takeChunk());
+
+    if (last < commandCount) {
+        m_nextStreamCommand = last;
+        m_commandStreamTimer->start();
+    } else {
+        m_nextStreamCommand = -1;
+    }
+#endif
+}
+
 bool PaintAnalyzer::isAvailable()
 {
 #ifdef HAVE_PRIVATE_QT_HEADERS
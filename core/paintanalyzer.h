@@ -41,12 +41,14 @@ class QItemSelectionModel;
 class QPaintDevice;
 class QRectF;
 class QSortFilterProxyModel;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
 class AggregatedPropertyModel;
 class PaintBuffer;
 class PaintBufferModel;
+class PainterProfilingReplayer;
 class RemoteViewServer;
 class StackTraceModel;
 
@@ -78,12 +80,20 @@ public:
      */
     void setOrigin(const ObjectId &obj);
 
+    bool hasCommandDetails(quint32 streamId, int command) const override;
+    PaintCommandRecord commandDetails(quint32 streamId, int command) const override;
+
+public slots:
+    void requestCommandStream(quint32 streamId) override;
+
 signals:
     /** Polling for updated analysis. */
     void requestUpdate();
 
 private slots:
     void repaint();
+    void updateCosts();
+    void sendNextCommandChunk();
 
 private:
     PaintBufferModel *m_paintBufferModel;
@@ -94,6 +104,14 @@ private:
     AggregatedPropertyModel *m_argumentModel;
     ObjectInstance m_currentArgument;
     StackTraceModel *m_stackTraceModel;
+    PainterProfilingReplayer *m_profiler;
+
+    // identifies the current paint buffer towards the client
+    quint32 m_commandStreamId;
+    PaintCommandStreamWriter m_commandWriter;
+    // next command to transfer, -1 if there is no transfer in progress
+    int m_nextStreamCommand;
+    QTimer *m_commandStreamTimer;
 };
 }
 
@@ -142,6 +142,7 @@ void PaintBufferModel::setPaintBuffer(const PaintBuffer &buffer)
     beginResetModel();
     m_buffer = buffer;
     m_privateBuffer = buffer.data();
+    m_clipPaths.clear();
     m_costs.clear();
     m_maxCost = 0.0;
     endResetModel();
@@ -155,7 +156,7 @@ PaintBuffer PaintBufferModel::buffer() const
 void PaintBufferModel::setCosts(const QVector<double>& costs)
 {
     m_costs = costs;
-    if (rowCount() > 0) {
+    if (rowCount() > 0 && !m_costs.isEmpty()) {
         m_maxCost = *std::max_element(m_costs.constBegin(), m_costs.constEnd());
         emit dataChanged(index(0, 2, QModelIndex()), index(rowCount() - 1, 2, QModelIndex()));
     }
@@ -495,14 +496,45 @@ QModelIndex PaintBufferModel::parent(const QModelIndex& child) const
     return createIndex(child.internalId(), 0, TopLevelId);
 }
 
+PaintCommandRecord PaintBufferModel::commandRecord(int row) const
+{
+    PaintCommandRecord record;
+    const auto cmd = m_privateBuffer->commands.at(row);
+    record.name = QString::fromLatin1(cmdTypes[cmd.id].name);
+    const auto argCount = std::max(1, cmdTypes[cmd.id].argumentCount);
+    for (int i = 0; i < argCount; ++i) {
+        const auto arg = argumentAt(cmd, i);
+        // images are only shown in the argument details, no need to send them along
+        if (arg.type() == QVariant::Image || arg.type() == QVariant::Pixmap)
+            record.arguments.push_back(QVariant());
+        else
+            record.arguments.push_back(arg);
+    }
+    while (!record.arguments.isEmpty() && !record.arguments.last().isValid())
+        record.arguments.pop_back();
+    record.clipPath = clipPath(row);
+    return record;
+}
+
 QPainterPath PaintBufferModel::clipPath(int row) const
+{
+    if (m_clipPaths.isEmpty())
+        computeClipPaths();
+    return m_clipPaths.value(row);
+}
+
+void PaintBufferModel::computeClipPaths() const
 {
     QPainterPath clip;
     QTransform t;
     std::vector<QPainterPath> clipStack;
     std::vector<QTransform> transformStack;
+    bool valid = true;
 
-    for (int i = 0; i <= row; ++i) {
+    const auto count = m_privateBuffer->commands.size();
+    m_clipPaths.reserve(count);
+    // the increment records the clip path of each command, also for those leaving it unchanged
+    for (int i = 0; i < count; m_clipPaths.push_back(valid ? clip : QPainterPath()), ++i) {
         const auto cmd = m_privateBuffer->commands.at(i);
 
         QPainterPath p;
@@ -513,8 +545,11 @@ QPainterPath PaintBufferModel::clipPath(int row) const
                 transformStack.push_back(t);
                 continue;
             case QPaintBufferPrivate::Cmd_Restore:
-                if (clipStack.empty() || transformStack.empty())
-                    return QPainterPath();
+                if (clipStack.empty() || transformStack.empty()) {
+                    // unbalanced restore, the clip state is unknown from here on
+                    valid = false;
+                    continue;
+                }
                 clip = clipStack.back();
                 clipStack.pop_back();
                 t = transformStack.back();
@@ -569,7 +604,6 @@ QPainterPath PaintBufferModel::clipPath(int row) const
                 break;
         }
     }
-    return clip;
 }
 
 #endif
@@ -33,6 +33,7 @@
 #include "paintbuffer.h"
 
 #include <common/modelroles.h>
+#include <common/paintcommandstream.h>
 
 #ifdef HAVE_PRIVATE_QT_HEADERS
 #include <QAbstractItemModel>
@@ -67,17 +68,23 @@ public:
     QModelIndex index(int row, int column, const QModelIndex & parent) const override;
     QModelIndex parent(const QModelIndex & child) const override;
 
+    /** Returns the details of the command in @p row, for transfer to the client. */
+    PaintCommandRecord commandRecord(int row) const;
+
 private:
     QVariant argumentAt(const QPaintBufferCommand &cmd, int index) const;
     QString argumentDisplayString(const QPaintBufferCommand &cmd) const;
     QVariant argumentDecoration(const QPaintBufferCommand &cmd) const;
 
     QPainterPath clipPath(int row) const;
+    void computeClipPaths() const;
 
     PaintBuffer m_buffer;
     QPaintBufferPrivate *m_privateBuffer;
     QVector<double> m_costs;
     double m_maxCost;
+    // clip path after each command, computed in one pass on first use
+    mutable QVector<QPainterPath> m_clipPaths;
 };
 }
 
@@ -30,13 +30,26 @@
 #include "painterprofilingreplayer.h"
 
 #include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#ifdef HAVE_PRIVATE_QT_HEADERS
+#include <private/qguiapplication_p.h>
+#include <qpa/qplatformintegration.h>
+#endif
 
 #include <algorithm>
-#include <memory>
+#include <numeric>
 
 using namespace GammaRay;
 
-#ifdef HAVE_PRIVATE_QT_HEADERS
+static const int MinimumRuns = 3;
+static const int MaximumRuns = 15;
+// stop sampling once the median absolute deviation is below this fraction of the total cost
+static const double MaximumRelativeDeviation = 0.05;
 
 namespace GammaRay {
 
@@ -58,65 +71,179 @@ public:
             QPainterReplayer::process(cmd);
     }
 };
+
+/** One timed replay of the entire paint buffer, into an image of its own. */
+class ProfilingRun : public QRunnable
+{
+public:
+    ProfilingRun(PainterProfilingReplayer *profiler, const PaintBuffer &buffer, int generation)
+        : m_profiler(profiler)
+        , m_buffer(buffer)
+        , m_generation(generation)
+    {
+    }
+
+    void run() override
+    {
+        const auto sourceSize = m_buffer.boundingRect().size().toSize();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+        const auto ratio = m_buffer.devicePixelRatioF();
+#else
+        const auto ratio = m_buffer.devicePixelRatio();
+#endif
+        // the raster backing store format, other formats need costly conversions while painting
+        QImage image(sourceSize * ratio, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(ratio);
+        image.fill(Qt::transparent);
+        QPainter p(&image);
+
+        Replayer replayer(&m_buffer, &p);
+        auto d = m_buffer.data();
+        const auto cmdSize = d->commands.size();
+        QVector<double> samples;
+        samples.reserve(cmdSize);
+        for (int i = 0; i < cmdSize; ++i) {
+            if ((i % 64) == 0 && m_profiler->m_generation.load() != m_generation)
+                return; // profiling got restarted meanwhile
+            const auto &cmd = d->commands.at(i);
+            QElapsedTimer t;
+            t.start();
+            replayer.process(cmd);
+            samples.push_back(t.nsecsElapsed());
+        }
+        p.end();
+
+        QMetaObject::invokeMethod(m_profiler, "addSamples", Qt::QueuedConnection,
+                                  Q_ARG(int, m_generation), Q_ARG(QVector<double>, samples));
+    }
+
+private:
+    PainterProfilingReplayer *m_profiler;
+    PaintBuffer m_buffer;
+    int m_generation;
+};
 #endif
 
 }
 
-PainterProfilingReplayer::PainterProfilingReplayer()
+PainterProfilingReplayer::PainterProfilingReplayer(QObject *parent)
+    : QObject(parent)
+    , m_threadPool(new QThreadPool(this))
+    , m_pendingRuns(0)
+    , m_threaded(false)
 {
+    qRegisterMetaType<QVector<double> >();
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    // paint buffers can contain pixmaps, which we can only use outside of the GUI thread with this
+    m_threaded = QGuiApplicationPrivate::platformIntegration()
+        && QGuiApplicationPrivate::platformIntegration()->hasCapability(QPlatformIntegration::ThreadedPixmaps);
+#endif
 }
 
 PainterProfilingReplayer::~PainterProfilingReplayer()
 {
+    m_generation.fetchAndAddOrdered(1);
+    m_threadPool->waitForDone();
 }
 
 void PainterProfilingReplayer::profile(const PaintBuffer& buffer)
 {
+    m_generation.fetchAndAddOrdered(1);
+    m_samples.clear();
+    m_costs.clear();
+    m_pendingRuns = 0;
+
 #ifdef USE_GAMMARAY_PAINTBUFFER
+    m_buffer = buffer;
     const auto sourceSize = buffer.boundingRect().size().toSize();
-    if (sourceSize.width() <= 0 || sourceSize.height() <= 0)
+    if (sourceSize.width() <= 0 || sourceSize.height() <= 0 || buffer.data()->commands.isEmpty())
         return;
 
-#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
-    const auto ratio = buffer.devicePixelRatioF();
+    const int parallelRuns = m_threaded ? qBound(1, QThread::idealThreadCount() - 1, MinimumRuns) : 1;
+    for (int i = 0; i < parallelRuns; ++i)
+        startRun();
 #else
-    const auto ratio = buffer.devicePixelRatio();
+    Q_UNUSED(buffer);
 #endif
-    QImage image(sourceSize * ratio, QImage::Format_ARGB32); // TODO use the right format, this has considerable impact on performance!
-    image.setDevicePixelRatio(ratio);
-    image.fill(Qt::transparent);
-    QPainter p(&image);
-
-    Replayer replayer(&buffer, &p);
-    auto d = buffer.data();
-    const auto cmdSize = d->commands.size();
-    const auto runs = 5;
-    std::unique_ptr<double[]> samples(new double[cmdSize * runs]);
-    for (int run = 0; run < runs; ++run) {
-        for (int i = 0; i < cmdSize; ++i) {
-            const auto &cmd = d->commands.at(i);
-            QElapsedTimer t;
-            t.start();
-            replayer.process(cmd);
-            samples[i * runs + run] = t.nsecsElapsed();
-        }
+}
+
+void PainterProfilingReplayer::startRun()
+{
+#ifdef USE_GAMMARAY_PAINTBUFFER
+    ++m_pendingRuns;
+    auto run = new ProfilingRun(this, m_buffer, m_generation.load());
+    if (m_threaded) {
+        m_threadPool->start(run);
+    } else {
+        // at least don't block the event loop for more than a single replay
+        run->run();
+        delete run;
     }
+#endif
+}
+
+void PainterProfilingReplayer::addSamples(int generation, const QVector<double> &samples)
+{
+    if (generation != m_generation.load())
+        return;
+    --m_pendingRuns;
+    m_samples.push_back(samples);
+    updateCosts();
+    emit costsChanged();
+
+    if (!hasConverged() && m_samples.size() + m_pendingRuns < MaximumRuns) {
+        if (m_threaded)
+            startRun();
+        else
+            QMetaObject::invokeMethod(this, "startRun", Qt::QueuedConnection);
+    }
+}
 
-    m_costs.reserve(cmdSize);
+static double median(QVector<double> &values)
+{
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values.at(values.size() / 2);
+}
+
+void PainterProfilingReplayer::updateCosts()
+{
+    const int cmdSize = m_samples.first().size();
+    m_costs.resize(cmdSize);
+    QVector<double> commandSamples(m_samples.size());
     for (int i = 0; i < cmdSize; ++i) {
-        std::nth_element(samples.get() + i * runs, samples.get() + i * runs + runs/2, samples.get() + i * runs + runs);
-        m_costs.push_back(samples[i * runs + runs/2]);
+        for (int run = 0; run < m_samples.size(); ++run)
+            commandSamples[run] = m_samples.at(run).at(i);
+        m_costs[i] = median(commandSamples);
     }
+
     const auto sum = std::accumulate(m_costs.constBegin(), m_costs.constEnd(), 0.0);
-    std::for_each(m_costs.begin(), m_costs.end(), [sum](double &c) { c = 100.0 * c / sum; });
-#else
-    Q_UNUSED(buffer);
-#endif
+    if (sum > 0.0)
+        std::for_each(m_costs.begin(), m_costs.end(), [sum](double &c) { c = 100.0 * c / sum; });
+}
+
+bool PainterProfilingReplayer::hasConverged() const
+{
+    if (m_samples.size() < MinimumRuns)
+        return false;
+
+    // compare the absolute deviation of all samples from the median with the total cost
+    const int cmdSize = m_samples.first().size();
+    double total = 0.0;
+    double deviation = 0.0;
+    QVector<double> commandSamples(m_samples.size());
+    for (int i = 0; i < cmdSize; ++i) {
+        for (int run = 0; run < m_samples.size(); ++run)
+            commandSamples[run] = m_samples.at(run).at(i);
+        const double commandMedian = median(commandSamples);
+        for (int run = 0; run < commandSamples.size(); ++run)
+            commandSamples[run] = qAbs(commandSamples.at(run) - commandMedian);
+        total += commandMedian;
+        deviation += median(commandSamples);
+    }
+    return total <= 0.0 || deviation / total < MaximumRelativeDeviation;
 }
 
 QVector<double> PainterProfilingReplayer::costs() const
 {
     return m_costs;
 }
-
-#endif
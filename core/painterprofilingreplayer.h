@@ -31,23 +31,58 @@
 
 #include "paintbuffer.h"
 
+#include <QAtomicInt>
+#include <QObject>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QThreadPool;
+QT_END_NAMESPACE
 
 namespace GammaRay {
 
-#ifdef HAVE_PRIVATE_QT_HEADERS
-class PainterProfilingReplayer
+class PaintBuffer;
+class ProfilingRun;
+
+/** Measures the relative cost of the commands in a paint buffer.
+ *  Replays run asynchronously on a thread pool where possible, and are repeated
+ *  until the per-command timings are stable. Costs are refined with every
+ *  completed replay, see costsChanged().
+ */
+class PainterProfilingReplayer : public QObject
 {
+    Q_OBJECT
 public:
-    PainterProfilingReplayer();
+    explicit PainterProfilingReplayer(QObject *parent = nullptr);
     ~PainterProfilingReplayer();
 
+    /** Starts profiling @p buffer, aborting any profiling still in progress. */
     void profile(const PaintBuffer &buffer);
+    /** Relative cost per command in percent, empty until the first replay finished. */
     QVector<double> costs() const;
 
+signals:
+    void costsChanged();
+
+private slots:
+    void startRun();
+    void addSamples(int generation, const QVector<double> &samples);
+
 private:
+    friend class ProfilingRun;
+    void updateCosts();
+    bool hasConverged() const;
+
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    PaintBuffer m_buffer;
+#endif
+    QThreadPool *m_threadPool;
+    QAtomicInt m_generation;
+    QVector<QVector<double> > m_samples;
     QVector<double> m_costs;
+    int m_pendingRuns;
+    bool m_threaded;
 };
-#endif
 
 }
 
@@ -45,6 +45,7 @@
 #include "util.h"
 #include "varianthandler.h"
 #include "metaobjectregistry.h"
+#include "metricsexporter.h"
 
 #include "remote/server.h"
 #include "remote/remotemodelserver.h"
@@ -68,6 +69,7 @@
 #include <QMouseEvent>
 #include <QUrl>
 #include <QThread>
+#include <QElapsedTimer>
 #include <QTimer>
 
 #ifdef HAVE_PRIVATE_QT_HEADERS
@@ -217,6 +219,8 @@ Probe::Probe(QObject *parent)
     , m_window(nullptr)
     , m_metaObjectRegistry(new MetaObjectRegistry(this))
     , m_queueTimer(new QTimer(this))
+    , m_discoveryTimer(new QTimer(this))
+    , m_discoverySlices(0)
     , m_server(nullptr)
 {
     Q_ASSERT(thread() == qApp->thread());
@@ -228,7 +232,10 @@ Probe::Probe(QObject *parent)
     m_server = new Server(this);
 
     ObjectBroker::setSelectionModelFactoryCallback(selectionModelFactory);
-    ObjectBroker::registerObject<ProbeControllerInterface *>(new ProbeController(this));
+    auto probeController = new ProbeController(this);
+    connect(this, SIGNAL(objectDiscoveryProgress(int,bool)),
+            probeController, SIGNAL(objectDiscoveryProgress(int,bool)));
+    ObjectBroker::registerObject<ProbeControllerInterface *>(probeController);
     m_toolManager = new ToolManager(this);
     ObjectBroker::registerObject<ToolManagerInterface *>(m_toolManager);
 
@@ -251,6 +258,11 @@ Probe::Probe(QObject *parent)
     connect(m_queueTimer, SIGNAL(timeout()),
             this, SLOT(processQueuedObjectChanges()));
 
+    m_discoveryTimer->setSingleShot(true);
+    m_discoveryTimer->setInterval(0);
+    connect(m_discoveryTimer, SIGNAL(timeout()),
+            this, SLOT(discoverQueuedObjects()));
+
     m_previousSignalSpyCallbackSet.signalBeginCallback
         = qt_signal_spy_callback_set.signal_begin_callback;
     m_previousSignalSpyCallbackSet.signalEndCallback
@@ -425,6 +437,14 @@ void Probe::delayedInit()
         }
     }
 
+    const auto metricsFile = ProbeSettings::value(QStringLiteral("MetricsFile")).toString();
+    if (!metricsFile.isEmpty()) {
+        ProbeGuard guard;
+        new MetricsExporter(metricsFile,
+                            ProbeSettings::value(QStringLiteral("MetricsInterval"), 1000).toInt(),
+                            this);
+    }
+
     if (ProbeSettings::value(QStringLiteral("InProcessUi"), false).toBool())
         showInProcessUi();
 }
@@ -695,6 +715,7 @@ void Probe::objectFullyConstructed(QObject *obj)
         // deleted already
         IF_DEBUG(cout << "stale fully constructed: " << hex << obj << endl;
                  )
+        m_metaObjectRegistry->objectConstructionAborted(obj, false);
         return;
     }
 
@@ -705,6 +726,7 @@ void Probe::objectFullyConstructed(QObject *obj)
         m_validObjects.remove(obj);
         IF_DEBUG(cout << "now filtered fully constructed: " << hex << obj << endl;
                  )
+        m_metaObjectRegistry->objectConstructionAborted(obj, false);
         return;
     }
 
@@ -790,6 +812,7 @@ void Probe::queueCreatedObject(QObject *obj)
     c.obj = obj;
     c.type = ObjectChange::Create;
     m_queuedObjectChanges.push_back(c);
+    m_metaObjectRegistry->objectConstructionStarted(obj);
     notifyQueuedObjectChanges();
 }
 
@@ -819,6 +842,7 @@ void Probe::purgeChangesForObject(QObject *obj)
         if (m_queuedObjectChanges.at(i).obj == obj
             && m_queuedObjectChanges.at(i).type == ObjectChange::Create) {
             m_queuedObjectChanges.remove(i);
+            m_metaObjectRegistry->objectConstructionAborted(obj, true);
             return;
         }
     }
@@ -922,17 +946,54 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
     return QObject::eventFilter(receiver, event);
 }
 
+// pre-condition: lock is held already, our thread
 void Probe::findExistingObjects()
 {
-    discoverObject(QCoreApplication::instance());
+    queueObjectDiscovery(QCoreApplication::instance());
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
     if (auto guiApp = qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
         foreach (auto window, guiApp->allWindows()) {
-            discoverObject(window);
+            queueObjectDiscovery(window);
         }
     }
 #endif
+
+    // we might not be called from the main thread here
+    QMetaObject::invokeMethod(this, "discoverQueuedObjects", Qt::QueuedConnection);
+}
+
+// pre-condition: lock is held already, our thread
+void Probe::queueObjectDiscovery(QObject *object)
+{
+    if (!object)
+        return;
+    objectAdded(object);
+    if (m_validObjects.contains(object))
+        m_discoveryQueue.push_back(object);
+}
+
+void Probe::discoverQueuedObjects()
+{
+    QMutexLocker lock(s_lock());
+
+    // walk the object trees in small time slices, so the target application stays responsive
+    QElapsedTimer sliceTimer;
+    sliceTimer.start();
+    while (!m_discoveryQueue.isEmpty() && sliceTimer.elapsed() < 5) {
+        QObject *obj = m_discoveryQueue.takeLast();
+        // only tracked objects are queued, so this also catches deleted ones
+        if (!m_validObjects.contains(obj))
+            continue;
+        foreach (QObject *child, obj->children())
+            queueObjectDiscovery(child);
+    }
+
+    const bool finished = m_discoveryQueue.isEmpty();
+    if (finished || ++m_discoverySlices % 20 == 0)
+        emit objectDiscoveryProgress(m_validObjects.size(), finished);
+    if (!finished)
+        m_discoveryTimer->start();
 }
 
 void Probe::discoverObject(QObject *object)
@@ -956,6 +1017,11 @@ void Probe::installGlobalEventFilter(QObject *filter)
     m_globalEventFilters.push_back(filter);
 }
 
+void Probe::removeGlobalEventFilter(QObject *filter)
+{
+    m_globalEventFilters.removeOne(filter);
+}
+
 bool Probe::needsObjectDiscovery() const
 {
     return s_listener()->trackDestroyed;
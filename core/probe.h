@@ -128,6 +128,11 @@ public:
      * this will filter out GammaRay-internal events and objects already for you.
      */
     void installGlobalEventFilter(QObject *filter);
+    /*!
+     * Remove a global event filter previously installed with installGlobalEventFilter().
+     * Filters that are destroyed before the probe need to be removed first.
+     */
+    void removeGlobalEventFilter(QObject *filter);
     /*!
      * Returns @c true if we haven't been able to track all objects from startup, ie. usually
      * when attaching at runtime.
@@ -260,6 +265,12 @@ signals:
     void objectDestroyed(QObject *obj);
     void objectReparented(QObject *obj);
 
+    /*!
+     * Emitted while existing objects are discovered incrementally after attaching,
+     * with the number of objects known so far.
+     */
+    void objectDiscoveryProgress(int discoveredObjects, bool finished);
+
     void aboutToDetach();
 
 protected:
@@ -273,6 +284,7 @@ private slots:
 
     void processQueuedObjectChanges();
     void handleObjectDestroyed(QObject *obj);
+    void discoverQueuedObjects();
 
 private:
     friend class ProbeCreator;
@@ -293,6 +305,7 @@ private:
     void notifyQueuedObjectChanges();
 
     void findExistingObjects();
+    void queueObjectDiscovery(QObject *object);
 
     /*! Check if we are capable of showing widgets. */
     static bool canShowWidgets();
@@ -327,6 +340,10 @@ private:
 
     QList<QObject *> m_pendingReparents;
     QTimer *m_queueTimer;
+    // tracked objects whose children still need to be discovered
+    QVector<QObject *> m_discoveryQueue;
+    QTimer *m_discoveryTimer;
+    int m_discoverySlices;
     QVector<QObject *> m_globalEventFilters;
     QVector<SignalSpyCallbackSet> m_signalSpyCallbacks;
     SignalSpyCallbackSet m_previousSignalSpyCallbackSet;
@@ -66,8 +66,9 @@ void ProblemCollector::addProblem(const Problem& problem)
 {
     auto self = instance();
 
-    auto i = std::find(self->m_problems.begin(), self->m_problems.end(), problem);
-    if (i != self->m_problems.end()) {
+    const auto indexIt = self->m_problemIndex.constFind(problem.problemId);
+    if (indexIt != self->m_problemIndex.constEnd()) {
+        auto i = self->m_problems.begin() + indexIt.value();
         // if an already reported problem is reported a second time, but with a different source location,
         // then the problem involves multiple source locations. So let's keep all of them.
         std::remove_copy_if(problem.locations.begin(), problem.locations.end(), std::back_inserter(i->locations),
@@ -76,19 +77,22 @@ void ProblemCollector::addProblem(const Problem& problem)
     }
 
     emit self->aboutToAddProblem(self->m_problems.size());
+    self->m_problemIndex.insert(problem.problemId, self->m_problems.size());
     self->m_problems.push_back(problem);
     emit self->problemAdded();
 }
 void ProblemCollector::removeProblem(const QString& problemId)
 {
     auto self = instance();
-    auto it = std::find_if(self->m_problems.begin(), self->m_problems.end(), [&](const Problem &problem) { return problem.problemId == problemId; });
-    if (it == self->m_problems.end())
+    const auto indexIt = self->m_problemIndex.find(problemId);
+    if (indexIt == self->m_problemIndex.end())
         return;
-    auto row = std::distance(self->m_problems.begin(), it);
+    const auto row = indexIt.value();
+    self->m_problemIndex.erase(indexIt);
 
     emit self->aboutToRemoveProblems(row);
-    self->m_problems.erase(it);
+    self->m_problems.remove(row);
+    self->updateProblemIndex(row);
     emit self->problemsRemoved();
 }
 
@@ -105,6 +109,8 @@ void ProblemCollector::clearScans()
             auto firstRow = std::distance(m_problems.begin(), firstToDeleteIt);
             auto count = std::distance(m_problems.begin(), it) - firstRow;
             emit aboutToRemoveProblems(firstRow, count);
+            for (auto removedIt = firstToDeleteIt; removedIt != it; ++removedIt)
+                m_problemIndex.remove(removedIt->problemId);
             firstToDeleteIt = it = m_problems.erase(firstToDeleteIt, it);
             emit problemsRemoved();
         } else if (it != m_problems.end()) {
@@ -114,6 +120,13 @@ void ProblemCollector::clearScans()
             break;
         }
     }
+    updateProblemIndex();
+}
+
+void ProblemCollector::updateProblemIndex(int first)
+{
+    for (int row = first; row < m_problems.size(); ++row)
+        m_problemIndex[m_problems.at(row).problemId] = row;
 }
 
 const QVector<Problem> & ProblemCollector::problems()
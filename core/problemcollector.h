@@ -38,6 +38,7 @@
 
 // Qt
 #include <QAbstractItemModel>
+#include <QHash>
 
 // Std
 #include <memory>
@@ -123,9 +124,13 @@ public slots:
 private:
     explicit ProblemCollector(QObject *parent);
     void clearScans();
+    /// Updates the row index of all problems starting at @p first.
+    void updateProblemIndex(int first = 0);
 
     QVector<Checker> m_availableCheckers;
     QVector<Problem> m_problems;
+    /// problemId -> row in m_problems
+    QHash<QString, int> m_problemIndex;
 
     friend class Probe;
     friend class AvailableCheckersModel;
@@ -40,6 +40,7 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QIcon>
+#include <QTimer>
 
 #include <iostream>
 
@@ -53,9 +54,18 @@ RemoteModelServer::RemoteModelServer(const QString &objectName, QObject *parent)
     , m_model(nullptr)
     , m_dummyBuffer(new QBuffer(&m_dummyData, this))
     , m_monitored(false)
+    , m_recordTimer(new QTimer(this))
+    , m_recordRoot(false)
+    , m_layoutCaptured(false)
 {
     setObjectName(objectName);
     m_dummyBuffer->open(QIODevice::WriteOnly);
+
+    // coalesce bursts of resets
+    m_recordTimer->setSingleShot(true);
+    m_recordTimer->setInterval(100);
+    connect(m_recordTimer, SIGNAL(timeout()), SLOT(recordModel()));
+
     registerServer();
 }
 
@@ -108,10 +118,15 @@ void RemoteModelServer::connectModel()
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
             SLOT(dataChanged(QModelIndex,QModelIndex)));
+    connect(m_model, SIGNAL(layoutAboutToBeChanged()), SLOT(layoutAboutToBeChanged()));
     connect(m_model, SIGNAL(layoutChanged()), SLOT(layoutChanged()));
 #else
     connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)),
             SLOT(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    connect(m_model,
+            SIGNAL(layoutAboutToBeChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)),
+            this,
+            SLOT(layoutAboutToBeChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)));
     connect(m_model,
             SIGNAL(layoutChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)),
             this,
@@ -145,11 +160,17 @@ void RemoteModelServer::disconnectModel()
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
     disconnect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
                this, SLOT(dataChanged(QModelIndex,QModelIndex)));
+    disconnect(m_model, SIGNAL(layoutAboutToBeChanged()),
+               this, SLOT(layoutAboutToBeChanged()));
     disconnect(m_model, SIGNAL(layoutChanged()),
                this, SLOT(layoutChanged()));
 #else
     disconnect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)),
                this, SLOT(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+    disconnect(m_model,
+               SIGNAL(layoutAboutToBeChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)),
+               this,
+               SLOT(layoutAboutToBeChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)));
     disconnect(m_model,
                SIGNAL(layoutChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)),
                this,
@@ -229,17 +250,9 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
         Q_ASSERT(orientation == Qt::Horizontal || orientation == Qt::Vertical);
         Q_ASSERT(section >= 0);
 
-        QHash<qint32, QVariant> data;
-        // TODO: add all roles
-        data.insert(Qt::DisplayRole,
-                    m_model->headerData(section, static_cast<Qt::Orientation>(orientation),
-                                        Qt::DisplayRole));
-        data.insert(Qt::ToolTipRole,
-                    m_model->headerData(section, static_cast<Qt::Orientation>(orientation),
-                                        Qt::ToolTipRole));
-
         Message msg(m_myAddress, Protocol::ModelHeaderReply);
-        msg << orientation << section << data;
+        msg << orientation << section
+            << headerData(static_cast<Qt::Orientation>(orientation), section);
         sendMessage(msg);
         break;
     }
@@ -269,7 +282,8 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
         msg >> barrierId;
         Message reply(m_myAddress, Protocol::ModelSyncBarrier);
         reply << barrierId;
-        sendMessage(reply);
+        // other clients have barriers of their own
+        sendReply(reply);
         break;
     }
     }
@@ -335,16 +349,187 @@ bool RemoteModelServer::canSerialize(const QVariant &value) const
     return QMetaType::save(stream, value.userType(), value.constData());
 }
 
+QHash<qint32, QVariant> RemoteModelServer::headerData(Qt::Orientation orientation,
+                                                     int section) const
+{
+    QHash<qint32, QVariant> data;
+    // TODO: add all roles
+    data.insert(Qt::DisplayRole, m_model->headerData(section, orientation, Qt::DisplayRole));
+    data.insert(Qt::ToolTipRole, m_model->headerData(section, orientation, Qt::ToolTipRole));
+    return data;
+}
+
+bool RemoteModelServer::isRecorded() const
+{
+    return m_model && Endpoint::isRecorded(m_myAddress);
+}
+
+void RemoteModelServer::scheduleRecording()
+{
+    if (!isRecorded())
+        return;
+
+    m_recordRoot = true;
+    if (!m_recordTimer->isActive())
+        m_recordTimer->start();
+}
+
+void RemoteModelServer::recordModel()
+{
+    if (m_recordRoot && isRecorded()) {
+        ProbeGuard g;
+        recordHeaders(Qt::Horizontal, 0, m_model->columnCount() - 1);
+        recordSubtree(QModelIndex());
+    }
+    m_recordRoot = false;
+}
+
+void RemoteModelServer::captureLayout(const QList<QPersistentModelIndex> &parents)
+{
+    m_layoutNodes.clear();
+    m_layoutCaptured = false;
+    if (m_recordRoot || !isRecorded())
+        return;
+
+    ProbeGuard g;
+    if (parents.isEmpty())
+        captureSubtree(QModelIndex());
+    foreach (const auto &parent, parents)
+        captureSubtree(parent);
+    m_layoutCaptured = true;
+}
+
+void RemoteModelServer::captureSubtree(const QModelIndex &parent)
+{
+    const QPersistentModelIndex persistentParent(parent);
+    const int rowCount = m_model->rowCount(parent);
+    for (int row = 0; row < rowCount; ++row) {
+        LayoutNode node;
+        const auto index = m_model->index(row, 0, parent);
+        node.index = index;
+        node.parent = persistentParent;
+        node.path = Protocol::fromQModelIndex(index);
+        m_layoutNodes.push_back(node);
+        captureSubtree(index);
+    }
+}
+
+void RemoteModelServer::recordRows(const QModelIndex &parent, int first, int last)
+{
+    // a pending recording of everything covers this anyway
+    if (m_recordRoot || !isRecorded())
+        return;
+
+    ProbeGuard g;
+    const int columnCount = m_model->columnCount(parent);
+
+    // new row/column counts of the parent, and those of the new rows
+    Message counts(m_myAddress, Protocol::ModelRowColumnCountReply);
+    counts << quint32(last - first + 2)
+           << Protocol::fromQModelIndex(parent) << qint32(m_model->rowCount(parent))
+           << qint32(columnCount);
+    QVector<QModelIndex> parents;
+    for (int row = first; row <= last; ++row) {
+        const auto index = m_model->index(row, 0, parent);
+        const int childRowCount = m_model->rowCount(index);
+        counts << Protocol::fromQModelIndex(index) << qint32(childRowCount)
+               << qint32(m_model->columnCount(index));
+        if (childRowCount > 0)
+            parents.push_back(index);
+    }
+    Endpoint::record(counts);
+
+    if (columnCount > 0)
+        recordContent(parent, first, last, 0, columnCount - 1);
+
+    // subtrees of new rows are entirely new as well
+    foreach (const auto &index, parents)
+        recordSubtree(index);
+}
+
+void RemoteModelServer::recordColumns(const QModelIndex &parent, int first, int last)
+{
+    if (m_recordRoot || !isRecorded())
+        return;
+
+    ProbeGuard g;
+    const int rowCount = m_model->rowCount(parent);
+    Message counts(m_myAddress, Protocol::ModelRowColumnCountReply);
+    counts << quint32(1) << Protocol::fromQModelIndex(parent) << qint32(rowCount)
+           << qint32(m_model->columnCount(parent));
+    Endpoint::record(counts);
+
+    if (!parent.isValid())
+        recordHeaders(Qt::Horizontal, first, last);
+    if (rowCount > 0)
+        recordContent(parent, 0, rowCount - 1, first, last);
+}
+
+void RemoteModelServer::recordSubtree(const QModelIndex &parent)
+{
+    const int rowCount = m_model->rowCount(parent);
+    const int columnCount = m_model->columnCount(parent);
+
+    // row/column counts of the parent and all its children
+    Message counts(m_myAddress, Protocol::ModelRowColumnCountReply);
+    counts << quint32(rowCount + 1)
+           << Protocol::fromQModelIndex(parent) << qint32(rowCount) << qint32(columnCount);
+    QVector<QModelIndex> parents;
+    for (int row = 0; row < rowCount; ++row) {
+        const auto index = m_model->index(row, 0, parent);
+        const int childRowCount = m_model->rowCount(index);
+        counts << Protocol::fromQModelIndex(index) << qint32(childRowCount)
+               << qint32(m_model->columnCount(index));
+        if (childRowCount > 0)
+            parents.push_back(index);
+    }
+    Endpoint::record(counts);
+
+    if (rowCount > 0 && columnCount > 0)
+        recordContent(parent, 0, rowCount - 1, 0, columnCount - 1);
+
+    foreach (const auto &index, parents)
+        recordSubtree(index);
+}
+
+void RemoteModelServer::recordContent(const QModelIndex &parent, int firstRow, int lastRow,
+                                      int firstColumn, int lastColumn)
+{
+    ProbeGuard g;
+    Message msg(m_myAddress, Protocol::ModelContentReply);
+    msg << quint32((lastRow - firstRow + 1) * (lastColumn - firstColumn + 1));
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            const auto index = m_model->index(row, column, parent);
+            msg << Protocol::fromQModelIndex(index) << filterItemData(m_model->itemData(index))
+                << qint32(m_model->flags(index));
+        }
+    }
+    Endpoint::record(msg);
+}
+
+void RemoteModelServer::recordHeaders(Qt::Orientation orientation, int first, int last)
+{
+    ProbeGuard g;
+    for (int section = first; section <= last; ++section) {
+        Message msg(m_myAddress, Protocol::ModelHeaderReply);
+        msg << qint8(orientation) << qint32(section) << headerData(orientation, section);
+        Endpoint::record(msg);
+    }
+}
+
 void RemoteModelServer::modelMonitored(bool monitored)
 {
     if (m_monitored == monitored)
         return;
     m_monitored = monitored;
     if (m_model) {
-        if (m_monitored)
+        if (m_monitored) {
             connectModel();
-        else
+            scheduleRecording();
+        } else {
             disconnectModel();
+        }
     }
 }
 
@@ -356,6 +541,9 @@ void RemoteModelServer::dataChanged(const QModelIndex &begin, const QModelIndex
     Message msg(m_myAddress, Protocol::ModelContentChanged);
     msg << Protocol::fromQModelIndex(begin) << Protocol::fromQModelIndex(end) << roles;
     sendMessage(msg);
+
+    if (begin.isValid() && end.isValid() && isRecorded())
+        recordContent(begin.parent(), begin.row(), end.row(), begin.column(), end.column());
 }
 
 void RemoteModelServer::headerDataChanged(Qt::Orientation orientation, int first, int last)
@@ -365,11 +553,15 @@ void RemoteModelServer::headerDataChanged(Qt::Orientation orientation, int first
     Message msg(m_myAddress, Protocol::ModelHeaderChanged);
     msg <<  qint8(orientation) << first << last;
     sendMessage(msg);
+
+    if (isRecorded())
+        recordHeaders(orientation, first, last);
 }
 
 void RemoteModelServer::rowsInserted(const QModelIndex &parent, int start, int end)
 {
     sendAddRemoveMessage(Protocol::ModelRowsAdded, parent, start, end);
+    recordRows(parent, start, end);
 }
 
 void RemoteModelServer::rowsAboutToBeMoved(const QModelIndex &sourceParent, int sourceStart,
@@ -403,6 +595,7 @@ void RemoteModelServer::rowsRemoved(const QModelIndex &parent, int start, int en
 void RemoteModelServer::columnsInserted(const QModelIndex &parent, int start, int end)
 {
     sendAddRemoveMessage(Protocol::ModelColumnsAdded, parent, start, end);
+    recordColumns(parent, start, end);
 }
 
 void RemoteModelServer::columnsMoved(const QModelIndex &sourceParent, int sourceStart,
@@ -420,6 +613,11 @@ void RemoteModelServer::columnsRemoved(const QModelIndex &parent, int start, int
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+void RemoteModelServer::layoutAboutToBeChanged()
+{
+    captureLayout(QList<QPersistentModelIndex>());
+}
+
 void RemoteModelServer::layoutChanged()
 {
     sendLayoutChanged();
@@ -427,6 +625,13 @@ void RemoteModelServer::layoutChanged()
 
 #else
 
+void RemoteModelServer::layoutAboutToBeChanged(const QList<QPersistentModelIndex> &parents,
+                                               QAbstractItemModel::LayoutChangeHint hint)
+{
+    Q_UNUSED(hint);
+    captureLayout(parents);
+}
+
 void RemoteModelServer::layoutChanged(const QList<QPersistentModelIndex> &parents,
                                       QAbstractItemModel::LayoutChangeHint hint)
 {
@@ -442,10 +647,34 @@ void RemoteModelServer::layoutChanged(const QList<QPersistentModelIndex> &parent
 void RemoteModelServer::sendLayoutChanged(const QVector< Protocol::ModelIndex > &parents,
                                           quint32 hint)
 {
-    if (!isConnected())
+    if (!isConnected()) {
+        m_layoutNodes.clear();
         return;
+    }
     Message msg(m_myAddress, Protocol::ModelLayoutChanged);
     msg << parents << hint;
+
+    // clients ignore this, recordings follow the nodes to their new place, instead of
+    // recording the entire model again
+    if (isRecorded()) {
+        msg << m_layoutCaptured;
+        if (m_layoutCaptured) {
+            QVector<QPair<Protocol::ModelIndex, Protocol::ModelIndex> > newPlaces;
+            foreach (const auto &node, m_layoutNodes) {
+                // descendants of moved nodes move along implicitly
+                if (node.index.isValid() && node.index.row() == node.path.last().row
+                    && node.parent == node.index.parent())
+                    continue;
+                newPlaces.push_back(qMakePair(node.path, Protocol::fromQModelIndex(node.index)));
+            }
+            msg << newPlaces;
+        } else {
+            scheduleRecording();
+        }
+    }
+    m_layoutNodes.clear();
+    m_layoutCaptured = false;
+
     sendMessage(msg);
 }
 
@@ -454,6 +683,7 @@ void RemoteModelServer::modelReset()
     if (!isConnected())
         return;
     sendMessage(Message(m_myAddress, Protocol::ModelReset));
+    scheduleRecording();
 }
 
 void RemoteModelServer::sendAddRemoveMessage(Protocol::MessageType type, const QModelIndex &parent,
@@ -496,7 +726,6 @@ void RemoteModelServer::registerServer()
     m_myAddress = Server::instance()->registerObject(objectName(), this, Server::ExportProperties);
     Server::instance()->registerMessageHandler(m_myAddress, this, "newRequest");
     Server::instance()->registerMonitorNotifier(m_myAddress, this, "modelMonitored");
-    connect(Endpoint::instance(), SIGNAL(disconnected()), this, SLOT(modelMonitored()));
 }
 
 bool RemoteModelServer::isConnected() const
@@ -509,6 +738,11 @@ void RemoteModelServer::sendMessage(const Message &msg) const
     Endpoint::send(msg);
 }
 
+void RemoteModelServer::sendReply(const Message &msg) const
+{
+    Endpoint::sendReply(msg);
+}
+
 bool RemoteModelServer::proxyDynamicSortFilter() const
 {
     if (auto proxy = qobject_cast<QSortFilterProxyModel *>(m_model))
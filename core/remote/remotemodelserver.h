@@ -32,12 +32,15 @@
 #include <common/protocol.h>
 
 #include <QObject>
+#include <QPersistentModelIndex>
 #include <QPointer>
 #include <QRegExp>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QBuffer;
 class QAbstractItemModel;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
@@ -86,6 +89,20 @@ private:
         const QVector<Protocol::ModelIndex> &parents = QVector<Protocol::ModelIndex>(),
         quint32 hint = 0);
     bool canSerialize(const QVariant &value) const;
+    QHash<qint32, QVariant> headerData(Qt::Orientation orientation, int section) const;
+
+    // session recordings can't request data later on, so the content is recorded along
+    // with the changes instead, removals and moves are replayed from the change messages alone
+    bool isRecorded() const;
+    void scheduleRecording();
+    void captureLayout(const QList<QPersistentModelIndex> &parents);
+    void captureSubtree(const QModelIndex &parent);
+    void recordRows(const QModelIndex &parent, int first, int last);
+    void recordColumns(const QModelIndex &parent, int first, int last);
+    void recordSubtree(const QModelIndex &parent);
+    void recordContent(const QModelIndex &parent, int firstRow, int lastRow, int firstColumn,
+                       int lastColumn);
+    void recordHeaders(Qt::Orientation orientation, int first, int last);
 
     // proxy model settings
     bool proxyDynamicSortFilter() const;
@@ -102,6 +119,7 @@ private:
     void registerServer();
     virtual bool isConnected() const;
     virtual void sendMessage(const Message &msg) const;
+    virtual void sendReply(const Message &msg) const;
     friend class FakeRemoteModelServer;
 
 private slots:
@@ -119,8 +137,11 @@ private slots:
                       const QModelIndex &destinationParent, int destinationColumn);
     void columnsRemoved(const QModelIndex &parent, int start, int end);
 #ifdef QT4_MOC_WORKAROUND // Qt4 moc doesn't understand QT_VERSION preprocessor conditionals
+    void layoutAboutToBeChanged();
     void layoutChanged();
 #else
+    void layoutAboutToBeChanged(const QList<QPersistentModelIndex> &parents,
+                                QAbstractItemModel::LayoutChangeHint hint);
     void layoutChanged(const QList<QPersistentModelIndex> &parents,
                        QAbstractItemModel::LayoutChangeHint hint);
 #endif
@@ -128,6 +149,7 @@ private slots:
     void modelReset();
 
     void modelDeleted();
+    void recordModel();
 
 private:
     QPointer<QAbstractItemModel> m_model;
@@ -141,6 +163,19 @@ private:
     QList<Protocol::ModelIndex> m_preOpIndexes;
     Protocol::ObjectAddress m_myAddress;
     bool m_monitored;
+    // the entire model needs to be recorded again, after a reset
+    QTimer *m_recordTimer;
+    bool m_recordRoot;
+    // first column nodes affected by an ongoing layout change, and where they were before,
+    // recordings replay the change from where they end up
+    struct LayoutNode
+    {
+        QPersistentModelIndex index;
+        QPersistentModelIndex parent;
+        Protocol::ModelIndex path;
+    };
+    QVector<LayoutNode> m_layoutNodes;
+    bool m_layoutCaptured;
 };
 }
 
@@ -47,7 +47,6 @@ SelectionModelServer::SelectionModelServer(const QString &objectName, QAbstractI
     m_myAddress = Server::instance()->registerObject(objectName, this, Server::ExportNothing);
     Server::instance()->registerMessageHandler(m_myAddress, this, "newMessage");
     Server::instance()->registerMonitorNotifier(m_myAddress, this, "modelMonitored");
-    connect(Endpoint::instance(), SIGNAL(disconnected()), this, SLOT(modelMonitored()));
 }
 
 SelectionModelServer::~SelectionModelServer()
@@ -30,12 +30,14 @@
 #include "server.h"
 #include "serverdevice.h"
 #include "probe.h"
+#include "probeguard.h"
 #include "probesettings.h"
 #include "multisignalmapper.h"
 
 #include <common/protocol.h>
 #include <common/message.h>
 #include <common/propertysyncer.h>
+#include <common/sessionfile.h>
 
 #ifdef Q_OS_ANDROID
 # include <QDir>
@@ -43,6 +45,7 @@
 
 #include <QDebug>
 #include <QTimer>
+#include <QThread>
 #include <QMetaMethod>
 
 #include <iostream>
@@ -50,6 +53,26 @@
 using namespace GammaRay;
 using namespace std;
 
+namespace {
+/** The network I/O thread, keeps its internal objects out of the object tracking. */
+class ServerIOThread : public QThread
+{
+public:
+    explicit ServerIOThread(QObject *parent)
+        : QThread(parent)
+    {
+        setObjectName(QStringLiteral("GammaRay I/O Thread"));
+    }
+
+protected:
+    void run() override
+    {
+        ProbeGuard guard;
+        exec();
+    }
+};
+}
+
 Server::Server(QObject *parent)
     : Endpoint(parent)
     , m_serverDevice(nullptr)
@@ -68,6 +91,13 @@ Server::Server(QObject *parent)
 
     connect(m_serverDevice, SIGNAL(newConnection()), this, SLOT(newConnection()));
 
+    // keep network transfers and compression out of the event loop of the inspected application
+    if (qgetenv("GAMMARAY_DISABLE_IO_THREAD") != "1")
+        setIOThread(new ServerIOThread(this));
+
+    // model and property messages keep repeating the same names, which only we get to see
+    enableCompressionDictionaries();
+
     m_broadcastTimer->setInterval(5 * 1000);
     m_broadcastTimer->setSingleShot(false);
 #ifndef Q_OS_ANDROID
@@ -84,6 +114,10 @@ Server::Server(QObject *parent)
     m_propertySyncer->setAddress(m_nextAddress);
     Endpoint::registerObject(QStringLiteral("com.kdab.GammaRay.PropertySyncer"), m_propertySyncer);
     registerMessageHandler(m_nextAddress, m_propertySyncer, "handleMessage");
+
+    const auto recordFile = ProbeSettings::value(QStringLiteral("RecordFile"), QString()).toString();
+    if (!recordFile.isEmpty())
+        startRecording(recordFile);
 }
 
 Server::~Server()
@@ -133,7 +167,8 @@ QUrl Server::serverAddress() const
 
 void Server::newConnection()
 {
-    if (isConnected()) {
+    // several clients can only be served with the I/O thread
+    if (connectionCount() > 0 && !ioThread()) {
         cerr << Q_FUNC_INFO << " connected already, refusing incoming connection." << endl;
         auto con = m_serverDevice->nextPendingConnection();
         con->close();
@@ -142,13 +177,37 @@ void Server::newConnection()
     }
 
     m_broadcastTimer->stop();
+    ProbeGuard guard;
     auto con = m_serverDevice->nextPendingConnection();
     connect(con, SIGNAL(disconnected()), con, SLOT(deleteLater()));
     setDevice(con);
 
+    emit connectionEstablished();
+}
+
+void Server::connectionAdded()
+{
     sendServerGreeting();
+}
 
-    emit connectionEstablished();
+void Server::startRecording(const QString &fileName)
+{
+    ProbeGuard guard;
+
+    // the data version can't change during the recording, so use the best one right away
+    Message::setNegotiatedDataVersion(Message::highestSupportedDataVersion());
+
+    auto writer = new SessionFileWriter(fileName);
+    if (!writer->open(Message::negotiatedDataVersion())) {
+        cerr << "Unable to record session to " << qPrintable(fileName) << ": "
+             << qPrintable(writer->errorString()) << endl;
+        delete writer;
+        Message::resetNegotiatedDataVersion();
+        return;
+    }
+
+    const auto objectNames = ProbeSettings::value(QStringLiteral("RecordObjects"), QString()).toString();
+    addRecorder(writer, objectNames.split(QLatin1Char(','), QString::SkipEmptyParts));
 }
 
 void Server::sendServerGreeting()
@@ -157,19 +216,19 @@ void Server::sendServerGreeting()
     {
         Message msg(endpointAddress(), Protocol::ServerVersion);
         msg << Protocol::version();
-        send(msg);
+        sendReply(msg);
     }
 
     {
         Message msg(endpointAddress(), Protocol::ServerInfo);
         msg << label() << key() << pid() << Message::highestSupportedDataVersion(); // TODO: expand with anything else needed here: Qt/GammaRay version, hostname, that kind of stuff
-        send(msg);
+        sendReply(msg);
     }
 
     {
         Message msg(endpointAddress(), Protocol::ObjectMapReply);
         msg << objectAddresses();
-        send(msg);
+        sendReply(msg);
     }
 }
 
@@ -181,11 +240,20 @@ void Server::messageReceived(const Message &msg)
         {
             quint8 version;
             msg >> version;
+            // the data version is shared by all connections, later clients get the one in use
+            // already, and have to disconnect if they don't support it
+            if (connectionCount() > 1 || isRecording()) {
+                if (version < Message::negotiatedDataVersion())
+                    cerr << "Client does not support data version "
+                         << int(Message::negotiatedDataVersion()) << " already in use, rejecting it."
+                         << endl;
+                version = Message::negotiatedDataVersion();
+            }
 
             {
                 Message msg(endpointAddress(), Protocol::ServerDataVersionNegotiated);
                 msg << version;
-                send(msg);
+                sendReply(msg);
             }
 
             Message::setNegotiatedDataVersion(version);
@@ -197,13 +265,7 @@ void Server::messageReceived(const Message &msg)
             Protocol::ObjectAddress addr;
             msg >> addr;
             Q_ASSERT(addr > Protocol::InvalidObjectAddress);
-            m_propertySyncer->setObjectEnabled(addr, msg.type() == Protocol::ObjectMonitored);
-            auto it = m_monitorNotifiers.constFind(addr);
-            if (it == m_monitorNotifiers.constEnd())
-                break;
-            // cout << Q_FUNC_INFO << " un/monitor " << (int)addr << endl;
-            QMetaObject::invokeMethod(it.value().first, it.value().second,
-                                      Q_ARG(bool, msg.type() == Protocol::ObjectMonitored));
+            setObjectMonitored(addr, msg.type() == Protocol::ObjectMonitored);
             break;
         }
         }
@@ -212,6 +274,17 @@ void Server::messageReceived(const Message &msg)
     }
 }
 
+void Server::objectMonitoredChanged(Protocol::ObjectAddress address, bool monitored)
+{
+    // recorded objects keep syncing their properties, a recording can't ask for them later on
+    m_propertySyncer->setObjectEnabled(address, monitored || isRecorded(address));
+    auto it = m_monitorNotifiers.constFind(address);
+    if (it == m_monitorNotifiers.constEnd())
+        return;
+    // cout << Q_FUNC_INFO << " un/monitor " << (int)address << endl;
+    QMetaObject::invokeMethod(it.value().first, it.value().second, Q_ARG(bool, monitored));
+}
+
 void Server::invokeObject(const QString &objectName, const char *method,
                           const QVariantList &args) const
 {
@@ -266,8 +339,17 @@ Protocol::ObjectAddress Server::registerObject(const QString &name, QObject *obj
         }
     }
 
-    if (exportOptions & ExportProperties)
+    if (exportOptions & ExportProperties) {
         m_propertySyncer->addObject(address, object);
+        if (isRecorded(address)) {
+            m_propertySyncer->setObjectEnabled(address, true);
+            Message request(m_propertySyncer->address(), Protocol::PropertySyncRequest);
+            request << address;
+            m_propertySyncer->handleMessage(Message::fromRawPayload(request.address(),
+                                                                    request.type(),
+                                                                    request.rawPayload()));
+        }
+    }
 
     return address;
 }
@@ -305,6 +387,7 @@ void Server::registerMonitorNotifier(Protocol::ObjectAddress address, QObject *r
     Q_ASSERT(monitorNotifier);
 
     m_monitorNotifiers.insert(address, qMakePair<QObject *, QByteArray>(receiver, monitorNotifier));
+    restrictToMonitoringEndpoints(address);
 }
 
 void Server::handlerDestroyed(Protocol::ObjectAddress objectAddress, const QString &objectName)
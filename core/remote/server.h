@@ -81,7 +81,9 @@ public:
      * of an object with address @p address changes on the client side.
      *
      * This is useful for example to disable expensive operations like sending large amounts of
-     * data if nobody is interested anyway.
+     * data if nobody is interested anyway. With several clients connected, this is called when
+     * the first client starts or the last one stops using the object, and messages from
+     * the object are only sent to clients using it.
      */
     void registerMonitorNotifier(Protocol::ObjectAddress address, QObject *receiver,
                                  const char *monitorNotifier);
@@ -109,7 +111,9 @@ public:
      QString errorString() const;
 
 protected:
+    void connectionAdded() override;
     void messageReceived(const Message &msg) override;
+    void objectMonitoredChanged(Protocol::ObjectAddress address, bool monitored) override;
     void handlerDestroyed(Protocol::ObjectAddress objectAddress,
                           const QString &objectName) override;
     void objectDestroyed(Protocol::ObjectAddress objectAddress, const QString &objectName,
@@ -126,6 +130,8 @@ private slots:
 
 private:
     void sendServerGreeting();
+    /** Record the session to @p fileName, as configured by the RecordFile/RecordObjects settings. */
+    void startRecording(const QString &fileName);
 
 private:
     ServerDevice *m_serverDevice;
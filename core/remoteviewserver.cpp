@@ -47,19 +47,24 @@ RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     : RemoteViewInterface(name, parent)
     , m_eventReceiver(nullptr)
     , m_updateTimer(new QTimer(this))
-    , m_clientActive(false)
     , m_sourceChanged(false)
-    , m_clientReady(true)
     , m_grabberReady(true)
     , m_pendingReset(false)
     , m_pendingCompleteFrame(false)
 {
     Server::instance()->registerMonitorNotifier(Endpoint::instance()->objectAddress(
                                                     name), this, "clientConnectedChanged");
+    // only frames, so resets and element picking replies don't queue up behind them
+    Server::instance()->setMethodPriority(Endpoint::instance()->objectAddress(name),
+                                          "frameUpdated", Protocol::StreamPriority);
 
     m_updateTimer->setSingleShot(true);
     m_updateTimer->setInterval(10);
     connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(requestUpdateTimeout()));
+
+    // don't grab new frames while the connection is still busy with the previous ones
+    connect(Endpoint::instance(), SIGNAL(sendBudgetAvailable()), this, SLOT(checkRequestUpdate()));
+    connect(Endpoint::instance(), SIGNAL(connectionRemoved(quint32)), this, SLOT(connectionRemoved(quint32)));
 }
 
 void RemoteViewServer::setEventReceiver(EventReceiver *receiver)
@@ -87,7 +92,20 @@ void RemoteViewServer::resetView()
 
 bool RemoteViewServer::isActive() const
 {
-    return m_clientActive;
+    for (auto it = m_clientViews.constBegin(); it != m_clientViews.constEnd(); ++it) {
+        if (it.value().active)
+            return true;
+    }
+    return false;
+}
+
+bool RemoteViewServer::isClientReady() const
+{
+    for (auto it = m_clientViews.constBegin(); it != m_clientViews.constEnd(); ++it) {
+        if (it.value().active && !it.value().ready)
+            return false;
+    }
+    return true;
 }
 
 void RemoteViewServer::setGrabberReady(bool ready)
@@ -100,7 +118,11 @@ void RemoteViewServer::setGrabberReady(bool ready)
 
 void RemoteViewServer::sendFrame(const RemoteViewFrame &frame)
 {
-    m_clientReady = false;
+    // only recorded, or nobody watching anymore, so there is no reply to wait for
+    const bool waitForReply = !Endpoint::isConnected()
+        || Endpoint::hasRemoteReceiver(Endpoint::instance()->objectAddress(name()));
+    for (auto it = m_clientViews.begin(); it != m_clientViews.end(); ++it)
+        it.value().ready = !waitForReply;
 
     const QSize frameImageSize = frame.image().size()
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
@@ -117,7 +139,19 @@ void RemoteViewServer::sendFrame(const RemoteViewFrame &frame)
 
 QRectF RemoteViewServer::userViewport() const
 {
-    return m_pendingCompleteFrame ? QRectF() : m_userViewport;
+    if (m_pendingCompleteFrame)
+        return QRectF();
+
+    // grab what any of the clients needs
+    QRectF viewport;
+    for (auto it = m_clientViews.constBegin(); it != m_clientViews.constEnd(); ++it) {
+        if (!it.value().active)
+            continue;
+        if (it.value().userViewport.isEmpty())
+            return QRectF();
+        viewport = viewport.united(it.value().userViewport);
+    }
+    return viewport;
 }
 
 void RemoteViewServer::sourceChanged()
@@ -136,7 +170,9 @@ void RemoteViewServer::requestCompleteFrame()
 
 void RemoteViewServer::clientViewUpdated()
 {
-    m_clientReady = true;
+    auto it = m_clientViews.find(Endpoint::currentConnectionId());
+    if (it != m_clientViews.end())
+        it.value().ready = true;
     m_sourceChanged = m_sourceChanged || m_pendingCompleteFrame;
     checkRequestUpdate();
 }
@@ -144,7 +180,7 @@ void RemoteViewServer::clientViewUpdated()
 void RemoteViewServer::checkRequestUpdate()
 {
     if (isActive() && !m_updateTimer->isActive() &&
-            m_clientReady && m_grabberReady && m_sourceChanged)
+            isClientReady() && m_grabberReady && m_sourceChanged && Endpoint::sendBudget() > 0)
         m_updateTimer->start();
 }
 
@@ -226,18 +262,21 @@ void RemoteViewServer::setViewActive(bool active)
         m_pendingReset = false;
     }
 
-    m_clientActive = active;
-    m_clientReady = active;
+    auto &view = m_clientViews[Endpoint::currentConnectionId()];
+    view.active = active;
+    view.ready = active;
     m_pendingCompleteFrame = false;
     if (active)
         sourceChanged();
-    else
+    else if (!isActive())
         m_updateTimer->stop();
+    else // the others might have been waiting for this one
+        checkRequestUpdate();
 }
 
 void RemoteViewServer::sendUserViewport(const QRectF &userViewport)
 {
-    m_userViewport = userViewport;
+    m_clientViews[Endpoint::currentConnectionId()].userViewport = userViewport;
     auto newlyRequestedRect = userViewport.intersected(m_lastTransmittedViewRect);
     if (!m_lastTransmittedImageRect.contains(newlyRequestedRect))
         sourceChanged();
@@ -245,8 +284,22 @@ void RemoteViewServer::sendUserViewport(const QRectF &userViewport)
 
 void RemoteViewServer::clientConnectedChanged(bool connected)
 {
-    if (!connected)
-        setViewActive(false);
+    // nobody watches anymore
+    if (!connected) {
+        m_clientViews.clear();
+        m_pendingCompleteFrame = false;
+        m_updateTimer->stop();
+    }
+}
+
+void RemoteViewServer::connectionRemoved(quint32 connectionId)
+{
+    if (!m_clientViews.remove(connectionId))
+        return;
+    if (isActive())
+        checkRequestUpdate();
+    else
+        m_updateTimer->stop();
 }
 
 void RemoteViewServer::requestUpdateTimeout()
@@ -35,6 +35,7 @@
 
 #include <common/remoteviewinterface.h>
 
+#include <QHash>
 #include <QPointer>
 
 QT_BEGIN_NAMESPACE
@@ -72,6 +73,7 @@ public:
     /// sends a new frame to the client
     void sendFrame(const RemoteViewFrame &frame);
 
+    /// the area of the source the clients show, empty if the complete source is needed
     QRectF userViewport() const;
 
 public slots:
@@ -101,21 +103,37 @@ private:
     void sendUserViewport(const QRectF &userViewport) override;
     void clientViewUpdated() override;
 
-    void checkRequestUpdate();
-
 private slots:
+    void checkRequestUpdate();
     void clientConnectedChanged(bool connected);
+    void connectionRemoved(quint32 connectionId);
     void requestUpdateTimeout();
 
 private:
+    /// state of a client view, per connection
+    struct ClientView
+    {
+        ClientView()
+            : active(false)
+            , ready(false)
+        {
+        }
+
+        QRectF userViewport;
+        bool active;
+        /// has processed the last frame we sent
+        bool ready;
+    };
+
+    bool isClientReady() const;
+
     QPointer<EventReceiver> m_eventReceiver;
     QTimer *m_updateTimer;
     QRectF m_lastTransmittedViewRect;
     QRectF m_lastTransmittedImageRect;
-    QRectF m_userViewport;
-    bool m_clientActive;
+    /// by Endpoint::currentConnectionId()
+    QHash<quint32, ClientView> m_clientViews;
     bool m_sourceChanged;
-    bool m_clientReady;
     bool m_grabberReady;
     bool m_pendingReset;
     bool m_pendingCompleteFrame;
@@ -44,6 +44,7 @@
 
 #include <QDebug>
 #include <QItemSelectionModel>
+#include <QSet>
 
 using namespace GammaRay;
 
@@ -77,13 +78,14 @@ MetaObjectBrowser::MetaObjectBrowser(Probe *probe, QObject *parent)
     ProblemCollector::registerProblemChecker("com.kdab.GammaRay.MetaObjectBrowser.QMetaObjectValidator",
                                              "QMetaObject Validator",
                                              "Checks for common errors with meta objects, like invocable functions with unregistered parameter types.",
-                                             &MetaObjectBrowser::scanForMetaObjectProblems,
+                                             [this]() { scanForMetaObjectProblems(); },
                                              /*enabled=*/ false
                                             );
 }
 
 void MetaObjectBrowser::rescanMetaTypes()
 {
+    m_validMetaObjects.clear();
     Probe::instance()->metaObjectRegistry()->scanMetaTypes();
 }
 
@@ -144,6 +146,8 @@ void MetaObjectBrowser::scanForMetaObjectProblems()
 
 void MetaObjectBrowser::doProblemScan(const QMetaObject *parent)
 {
+    // static meta objects don't change, so meta objects without issues don't need to be
+    // checked again on subsequent scans, until the tree gets rebuilt
     auto registry = Probe::instance()->metaObjectRegistry();
 
     QVector<const QMetaObject *> metaObjects = registry->childrenOf(parent);
@@ -152,8 +156,15 @@ void MetaObjectBrowser::doProblemScan(const QMetaObject *parent)
         if (!registry->isValid(mo) || !registry->isStatic(mo))
             continue;
 
+        if (m_validMetaObjects.contains(mo)) {
+            doProblemScan(mo);
+            continue;
+        }
+
         auto results = QMetaObjectValidator::check(mo);
-        if (results != QMetaObjectValidatorResult::NoIssue) {
+        if (results == QMetaObjectValidatorResult::NoIssue) {
+            m_validMetaObjects.insert(mo);
+        } else {
             //TODO do we want the Problem descriptions have more detail, i.e. have one problem listed
             //     for each method/property that has issues instead of one for each metaobject?
             Problem p;
@@ -31,6 +31,8 @@
 
 #include "toolfactory.h"
 
+#include <QSet>
+
 QT_BEGIN_NAMESPACE
 class QAbstractProxyModel;
 class QItemSelection;
@@ -58,12 +60,14 @@ private Q_SLOTS:
 private:
     void metaObjectSelected(const QMetaObject *mo);
 
-    static void scanForMetaObjectProblems();
-    static void doProblemScan(const QMetaObject *parent);
+    void scanForMetaObjectProblems();
+    void doProblemScan(const QMetaObject *parent);
 
     PropertyController *m_propertyController;
     MetaObjectTreeModel *m_motm;
     QAbstractProxyModel *m_model;
+    /// meta objects found without issues, these don't need to be checked again on later scans
+    QSet<const QMetaObject *> m_validMetaObjects;
 };
 
 class MetaObjectBrowserFactory : public QObject,
@@ -85,6 +85,14 @@ QVariant MetaObjectTreeModel::data(const QModelIndex &index, int role) const
             return registry()->data(object, MetaObjectRegistry::SelfAliveCount);
         case QMetaObjectModel::ObjectInclusiveAliveCountColumn:
             return registry()->data(object, MetaObjectRegistry::InclusiveAliveCount);
+        case QMetaObjectModel::ObjectPeakAliveCountColumn:
+            return registry()->data(object, MetaObjectRegistry::PeakAliveCount);
+        case QMetaObjectModel::ObjectCreationRateColumn:
+            return registry()->data(object, MetaObjectRegistry::CreationRate);
+        case QMetaObjectModel::ObjectDestructionRateColumn:
+            return registry()->data(object, MetaObjectRegistry::DestructionRate);
+        case QMetaObjectModel::ObjectAverageLifetimeColumn:
+            return registry()->data(object, MetaObjectRegistry::AverageLifetime);
         default:
             break;
         }
@@ -213,7 +221,7 @@ void GammaRay::MetaObjectTreeModel::emitPendingDataChanged()
         if (!index.isValid())
             continue;
         emit dataChanged(index.sibling(index.row(), QMetaObjectModel::ObjectSelfCountColumn),
-                         index.sibling(index.row(), QMetaObjectModel::ObjectInclusiveAliveCountColumn));
+                         index.sibling(index.row(), QMetaObjectModel::ObjectAverageLifetimeColumn));
     }
     m_pendingDataChanged.clear();
 }
@@ -30,19 +30,34 @@
 #include "resourcefiltermodel.h"
 
 #include "qt/resourcemodel.h"
+#include "common/endpoint.h"
 #include "common/objectbroker.h"
 
 #include <core/remote/serverproxymodel.h>
 
+#include <QDateTime>
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
 #include <QItemSelectionModel>
+#include <QTimer>
 #include <QUrl>
 
 using namespace GammaRay;
 
 ResourceBrowser::ResourceBrowser(Probe *probe, QObject *parent)
     : ResourceBrowserInterface(parent)
+    , m_requestTimer(new QTimer(this))
 {
+    m_requestTimer->setInterval(0);
+    connect(m_requestTimer, SIGNAL(timeout()), this, SLOT(processDataRequest()));
+    // don't read ahead of what the connection can take
+    connect(Endpoint::instance(), SIGNAL(sendBudgetAvailable()), m_requestTimer, SLOT(start()));
+    connect(Endpoint::instance(), SIGNAL(connectionRemoved(quint32)),
+            this, SLOT(connectionRemoved(quint32)));
+    Endpoint::instance()->setObjectPriority(Endpoint::instance()->objectAddress(objectName()),
+                                            Protocol::BulkPriority);
+
     auto *resourceModel = new ResourceModel(this);
     auto proxy = new ServerProxyModel<ResourceFilterModel>(this);
     proxy->setSourceModel(resourceModel);
@@ -52,17 +67,97 @@ ResourceBrowser::ResourceBrowser(Probe *probe, QObject *parent)
             this, SLOT(currentChanged(QModelIndex)));
 }
 
-void ResourceBrowser::downloadResource(const QString &sourceFilePath, const QString &targetFilePath)
+ResourceBrowser::~ResourceBrowser()
 {
-    const QFileInfo fi(sourceFilePath);
+    qDeleteAll(m_openFiles);
+}
 
-    if (fi.isFile()) {
-        QFile f(fi.absoluteFilePath());
-        if (f.open(QFile::ReadOnly))
-            emit resourceDownloaded(targetFilePath, f.readAll());
+void ResourceBrowser::requestResourceData(int requestId, const QString &filePath, qint64 offset,
+                                          int size)
+{
+    DataRequest request;
+    request.key = qMakePair(Endpoint::currentConnectionId(), requestId);
+    request.filePath = filePath;
+    request.offset = offset;
+    request.size = qBound(0, size, static_cast<int>(MaxChunkSize));
+    m_dataRequests.push_back(request);
+    m_requestTimer->start();
+}
+
+void ResourceBrowser::cancelResourceData(int requestId)
+{
+    const auto key = qMakePair(Endpoint::currentConnectionId(), requestId);
+    delete m_openFiles.take(key);
+    for (auto it = m_dataRequests.begin(); it != m_dataRequests.end();) {
+        if ((*it).key == key)
+            it = m_dataRequests.erase(it);
         else
-            qWarning() << "Failed to open" << fi.absoluteFilePath();
+            ++it;
+    }
+}
+
+void ResourceBrowser::connectionRemoved(quint32 connectionId)
+{
+    for (auto it = m_openFiles.begin(); it != m_openFiles.end();) {
+        if (it.key().first == connectionId) {
+            delete it.value();
+            it = m_openFiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_dataRequests.begin(); it != m_dataRequests.end();) {
+        if ((*it).key.first == connectionId)
+            it = m_dataRequests.erase(it);
+        else
+            ++it;
+    }
+}
+
+void ResourceBrowser::processDataRequest()
+{
+    // one chunk per event loop iteration, to not block the target application,
+    // sendBudgetAvailable() resumes once the connection caught up
+    if (m_dataRequests.isEmpty() || Endpoint::sendBudget() <= 0) {
+        m_requestTimer->stop();
+        return;
+    }
+    const auto request = m_dataRequests.takeFirst();
+
+    // continuing a transfer doesn't need to open and seek again
+    QFile *f = m_openFiles.take(request.key);
+    if (f && (f->fileName() != request.filePath || f->pos() != request.offset)) {
+        delete f;
+        f = nullptr;
+    }
+    if (!f) {
+        f = new QFile(request.filePath);
+        if (!f->open(QFile::ReadOnly) || !f->seek(request.offset)) {
+            qWarning() << "Failed to read" << request.filePath;
+            delete f;
+            Endpoint::ReplyGuard guard(request.key.first);
+            emit resourceDataReceived(request.key.second, request.offset, -1, QByteArray());
+            return;
+        }
     }
+
+    const auto data = f->read(request.size);
+    const auto totalSize = f->size();
+    if (data.isEmpty() || f->atEnd())
+        delete f;
+    else
+        m_openFiles.insert(request.key, f);
+
+    Endpoint::ReplyGuard guard(request.key.first);
+    emit resourceDataReceived(request.key.second, request.offset, totalSize, data);
+}
+
+QByteArray ResourceBrowser::contentKey(const QFileInfo &fi)
+{
+    // hashing the content would mean reading all of it on selection, which is what the chunked
+    // transfer avoids, so identify the content by its location, size and time stamp instead
+    return fi.absoluteFilePath().toUtf8() + '\n' + QByteArray::number(fi.size()) + '\n'
+           + QByteArray::number(fi.lastModified().toMSecsSinceEpoch());
 }
 
 void ResourceBrowser::selectResource(const QString &sourceFilePath, int line, int column)
@@ -94,11 +189,12 @@ void ResourceBrowser::currentChanged(const QModelIndex &current, int line, int c
         return;
     }
 
-    QFile f(fi.absoluteFilePath());
-    if (f.open(QFile::ReadOnly)) {
-        emit resourceSelected(f.readAll(), line, column);
-    } else {
-        qWarning() << "Failed to open" << fi.absoluteFilePath();
+    const auto filePath = fi.absoluteFilePath();
+    QFile f(filePath);
+    if (!f.open(QFile::ReadOnly)) {
+        qWarning() << "Failed to open" << filePath;
         emit resourceDeselected();
+        return;
     }
+    emit resourceSelected(filePath, contentKey(fi), fi.size(), line, column);
 }
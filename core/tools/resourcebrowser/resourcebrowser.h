@@ -32,8 +32,15 @@
 #include "toolfactory.h"
 #include <common/tools/resourcebrowser/resourcebrowserinterface.h>
 
+#include <QHash>
+#include <QPair>
+#include <QVector>
+
 QT_BEGIN_NAMESPACE
+class QFile;
+class QFileInfo;
 class QModelIndex;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
@@ -43,15 +50,36 @@ class ResourceBrowser : public ResourceBrowserInterface
     Q_INTERFACES(GammaRay::ResourceBrowserInterface)
 public:
     explicit ResourceBrowser(Probe *probe, QObject *parent = nullptr);
+    ~ResourceBrowser();
 
 public slots:
-    void downloadResource(const QString &sourceFilePath,
-                          const QString &targetFilePath) override;
     void selectResource(const QString &sourceFilePath, int line = -1,
                         int column = -1) override;
+    void requestResourceData(int requestId, const QString &filePath, qint64 offset,
+                             int size) override;
+    void cancelResourceData(int requestId) override;
 
 private slots:
     void currentChanged(const QModelIndex &current, int line = -1, int column = -1);
+    void processDataRequest();
+    void connectionRemoved(quint32 connectionId);
+
+private:
+    static QByteArray contentKey(const QFileInfo &fi);
+
+    // request ids are only unique per client
+    typedef QPair<quint32, int> RequestKey;
+
+    struct DataRequest {
+        RequestKey key;
+        QString filePath;
+        qint64 offset;
+        int size;
+    };
+    QVector<DataRequest> m_dataRequests;
+    QTimer *m_requestTimer;
+    // resources of unfinished transfers, to continue where the last chunk ended
+    QHash<RequestKey, QFile *> m_openFiles;
 };
 
 class ResourceBrowserFactory : public QObject, public StandardToolFactory<QObject, ResourceBrowser>
@@ -50,6 +50,7 @@
 
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
 #include <QUrl>
 #include <QStringList>
 #include <QVariant>
@@ -125,9 +126,18 @@ static void usage(const char *argv0)
         <<
     "     --no-listen                     \tdisables remote access entirely (implies --inprocess)"
         << endl;
+    out << "     --record <file>                 \trecord the session to <file> for offline inspection"
+        << endl;
+    out << "     --record-objects <names>        \tonly record the comma-separated remote objects" << endl;
+    out << "     --metrics <file>                \tperiodically write performance metrics to <file>"
+        << endl;
+    out << "                                     \tor local:<socket>, without UI (implies --inject-only)"
+        << endl;
+    out << "     --metrics-interval <ms>         \tmetrics sampling interval [default: 1000]" << endl;
     out << "     --list-probes                   \tlist all installed probes" << endl;
     out << "     --probe <abi>                   \tspecify which probe to use" << endl;
     out << "     --connect <host>[:port]         \tconnect to an already injected target" << endl;
+    out << "     --connect file://<file>         \tbrowse a recorded session" << endl;
     out
         <<
     "     --self-test [injector]          \trun self tests, of everything or the specified injector"
@@ -241,6 +251,20 @@ int main(int argc, char **argv)
             options.setProbeSetting(QStringLiteral("RemoteAccessEnabled"), false);
             options.setUiMode(LaunchOptions::InProcessUi);
         }
+        if (arg == QLatin1String("--record") && !args.isEmpty())
+            options.setProbeSetting(QStringLiteral("RecordFile"),
+                                    QFileInfo(args.takeFirst()).absoluteFilePath());
+        if (arg == QLatin1String("--record-objects") && !args.isEmpty())
+            options.setProbeSetting(QStringLiteral("RecordObjects"), args.takeFirst());
+        if (arg == QLatin1String("--metrics") && !args.isEmpty()) {
+            QString target = args.takeFirst();
+            if (!target.startsWith(QLatin1String("local:")))
+                target = QFileInfo(target).absoluteFilePath();
+            options.setProbeSetting(QStringLiteral("MetricsFile"), target);
+            options.setUiMode(LaunchOptions::NoUi);
+        }
+        if (arg == QLatin1String("--metrics-interval") && !args.isEmpty())
+            options.setProbeSetting(QStringLiteral("MetricsInterval"), args.takeFirst().toInt());
         if (arg == QLatin1String("--list-probes")) {
             foreach (const ProbeABI &abi, ProbeFinder::listProbeABIs())
                 out << abi.id() << " (" << abi.displayString() << ")" << endl;
@@ -26,6 +26,8 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <config-gammaray.h>
+
 #include "injectorfactory.h"
 
 #include "styleinjector.h"
@@ -36,6 +38,9 @@
 #include "lldbinjector.h"
 #include "preloadinjector.h"
 #endif
+#ifdef HAVE_PTRACE_INJECTOR
+#include "ptraceinjector.h"
+#endif
 
 #include <launcher/core/probeabi.h>
 
@@ -55,6 +60,11 @@ AbstractInjector::Ptr createInjector(const QString &name, const QString &executa
 #else
     Q_UNUSED(executableOverride);
 #endif
+#ifdef HAVE_PTRACE_INJECTOR
+    if (name == QLatin1String("ptrace")) {
+        return AbstractInjector::Ptr(new PtraceInjector);
+    }
+#endif
 
     if (name == QLatin1String("style")) {
         return AbstractInjector::Ptr(new StyleInjector);
@@ -117,6 +127,10 @@ AbstractInjector::Ptr defaultInjectorForAttach(QStringList *errorStrings)
 #if defined(Q_OS_MAC)
     return findFirstWorkingInjector(QStringList() << QStringLiteral("lldb")
                                                   << QStringLiteral("gdb"), errorStrings);
+#elif defined(HAVE_PTRACE_INJECTOR)
+    return findFirstWorkingInjector(QStringList() << QStringLiteral("ptrace")
+                                                  << QStringLiteral("gdb")
+                                                  << QStringLiteral("lldb"), errorStrings);
 #elif !defined(Q_OS_WIN)
     return findFirstWorkingInjector(QStringList() << QStringLiteral("gdb")
                                                   << QStringLiteral("lldb"), errorStrings);
@@ -131,6 +145,9 @@ QStringList availableInjectors()
     QStringList types;
 #ifndef Q_OS_WIN
     types << QStringLiteral("preload") << QStringLiteral("gdb") << QStringLiteral("lldb");
+#ifdef HAVE_PTRACE_INJECTOR
+    types << QStringLiteral("ptrace");
+#endif
 #else
     types << QStringLiteral("windll");
 #endif
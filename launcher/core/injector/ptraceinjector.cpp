@@ -0,0 +1,484 @@
+/*
+  ptraceinjector.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "ptraceinjector.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QVector>
+
+#if defined(Q_OS_LINUX) && defined(__x86_64__)
+#define GAMMARAY_PTRACE_INJECTOR_SUPPORTED
+
+#include <cerrno>
+#include <cstring>
+
+#include <dlfcn.h>
+#include <elf.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#endif
+
+using namespace GammaRay;
+
+#ifdef GAMMARAY_PTRACE_INJECTOR_SUPPORTED
+namespace {
+struct Mapping
+{
+    quintptr start;
+    quintptr offset;
+    QString path;
+};
+
+static QVector<Mapping> readMappings(int pid)
+{
+    QVector<Mapping> mappings;
+    QFile file(QStringLiteral("/proc/%1/maps").arg(pid));
+    if (!file.open(QFile::ReadOnly))
+        return mappings;
+
+    // format: start-end perms offset dev inode path
+    foreach (const QByteArray &line, file.readAll().split('\n')) {
+        const QList<QByteArray> fields = line.simplified().split(' ');
+        if (fields.size() < 6 || !fields.at(5).startsWith('/'))
+            continue;
+        Mapping m;
+        bool ok = false;
+        m.start = fields.at(0).left(fields.at(0).indexOf('-')).toULongLong(&ok, 16);
+        if (!ok)
+            continue;
+        m.offset = fields.at(2).toULongLong(&ok, 16);
+        if (!ok)
+            continue;
+        // paths may contain spaces, so take everything from the first '/' on
+        m.path = QString::fromLocal8Bit(line.mid(line.indexOf('/')));
+        mappings.push_back(m);
+    }
+    return mappings;
+}
+
+/** Looks up @p symbol in the dynamic symbol table of the ELF file @p fileName.
+ *  Returns the symbol value relative to the load bias, or 0 if not found.
+ *  @p firstLoadAddress is set to the virtual address of the first loadable segment.
+ */
+static quintptr findSymbol(const QString &fileName, const QByteArray &symbol, quintptr *firstLoadAddress)
+{
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly))
+        return 0;
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (!data || size < qint64(sizeof(ElfW(Ehdr))))
+        return 0;
+
+    const ElfW(Ehdr) *hdr = reinterpret_cast<const ElfW(Ehdr)*>(data);
+    if (memcmp(hdr->e_ident, ELFMAG, SELFMAG) != 0 || hdr->e_ident[EI_CLASS] != ELFCLASS64)
+        return 0;
+    if (qint64(hdr->e_phoff + hdr->e_phnum * sizeof(ElfW(Phdr))) > size
+        || qint64(hdr->e_shoff + hdr->e_shnum * sizeof(ElfW(Shdr))) > size)
+        return 0;
+
+    const ElfW(Phdr) *phdrs = reinterpret_cast<const ElfW(Phdr)*>(data + hdr->e_phoff);
+    *firstLoadAddress = 0;
+    for (int i = 0; i < hdr->e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_LOAD) {
+            *firstLoadAddress = phdrs[i].p_align > 1 ? phdrs[i].p_vaddr & ~(phdrs[i].p_align - 1) : phdrs[i].p_vaddr;
+            break;
+        }
+    }
+
+    const ElfW(Shdr) *shdrs = reinterpret_cast<const ElfW(Shdr)*>(data + hdr->e_shoff);
+    const ElfW(Shdr) *symtab = nullptr;
+    const ElfW(Shdr) *versym = nullptr;
+    for (int i = 0; i < hdr->e_shnum; ++i) {
+        if (shdrs[i].sh_type == SHT_DYNSYM)
+            symtab = &shdrs[i];
+        else if (shdrs[i].sh_type == SHT_GNU_versym)
+            versym = &shdrs[i];
+    }
+    if (!symtab || symtab->sh_link >= hdr->e_shnum || symtab->sh_entsize != sizeof(ElfW(Sym)))
+        return 0;
+    const ElfW(Shdr) *strtab = &shdrs[symtab->sh_link];
+    if (qint64(symtab->sh_offset + symtab->sh_size) > size || qint64(strtab->sh_offset + strtab->sh_size) > size)
+        return 0;
+    if (versym && qint64(versym->sh_offset + versym->sh_size) > size)
+        versym = nullptr;
+
+    const ElfW(Sym) *syms = reinterpret_cast<const ElfW(Sym)*>(data + symtab->sh_offset);
+    const char *strs = reinterpret_cast<const char*>(data + strtab->sh_offset);
+    const int count = symtab->sh_size / sizeof(ElfW(Sym));
+    quintptr hiddenVersion = 0;
+    for (int i = 0; i < count; ++i) {
+        if (syms[i].st_shndx == SHN_UNDEF || ELF64_ST_TYPE(syms[i].st_info) != STT_FUNC)
+            continue;
+        if (syms[i].st_name >= strtab->sh_size || symbol != strs + syms[i].st_name)
+            continue;
+        // prefer the default symbol version, compat versions are marked hidden
+        if (versym && (i + 1) * sizeof(ElfW(Versym)) <= versym->sh_size
+            && (reinterpret_cast<const ElfW(Versym)*>(data + versym->sh_offset)[i] & 0x8000)) {
+            hiddenVersion = syms[i].st_value;
+            continue;
+        }
+        return syms[i].st_value;
+    }
+    return hiddenVersion;
+}
+
+class PtraceSession
+{
+public:
+    explicit PtraceSession(int pid)
+        : m_pid(pid)
+        , m_attached(false)
+    {
+    }
+
+    ~PtraceSession()
+    {
+        detach();
+    }
+
+    /**
+     * Stops the main thread of the target, the one the probe is loaded from.
+     * Other threads keep running, so loading the probe can't deadlock on a lock
+     * one of them holds (gdb lets them run during inferior calls as well).
+     */
+    bool attach()
+    {
+        if (ptrace(PTRACE_ATTACH, m_pid, nullptr, nullptr) != 0)
+            return fail(QObject::tr("Failed to attach to process %1: %2").arg(m_pid).arg(qt_error_string(errno)));
+        m_attached = true;
+
+        // other signals might be reported before our SIGSTOP, pass them on
+        forever {
+            int status = 0;
+            if (waitpid(m_pid, &status, __WALL) != m_pid)
+                return fail(QObject::tr("Failed to wait for process %1: %2").arg(m_pid).arg(qt_error_string(errno)));
+            if (!WIFSTOPPED(status)) {
+                m_attached = false;
+                return fail(QObject::tr("Process %1 exited while attaching.").arg(m_pid));
+            }
+            if (WSTOPSIG(status) == SIGSTOP)
+                break;
+            ptrace(PTRACE_CONT, m_pid, nullptr, reinterpret_cast<void*>(static_cast<quintptr>(WSTOPSIG(status))));
+        }
+
+        if (ptrace(PTRACE_GETREGS, m_pid, nullptr, &m_savedRegs) != 0)
+            return fail(QObject::tr("Failed to read registers: %1").arg(qt_error_string(errno)));
+        return true;
+    }
+
+    void detach()
+    {
+        if (!m_attached)
+            return;
+        ptrace(PTRACE_SETREGS, m_pid, nullptr, &m_savedRegs);
+        ptrace(PTRACE_DETACH, m_pid, nullptr, nullptr);
+        m_attached = false;
+    }
+
+    /// Scratch memory below the red zone of the interrupted stack frame.
+    quintptr stackScratch() const
+    {
+        return m_savedRegs.rsp - 128;
+    }
+
+    bool writeMemory(quintptr address, const QByteArray &data)
+    {
+        for (int i = 0; i < data.size(); i += sizeof(long)) {
+            long word = 0;
+            if (data.size() - i < int(sizeof(long))) {
+                errno = 0;
+                word = ptrace(PTRACE_PEEKDATA, m_pid, reinterpret_cast<void*>(address + i), nullptr);
+                if (errno != 0)
+                    return fail(QObject::tr("Failed to read target memory: %1").arg(qt_error_string(errno)));
+            }
+            memcpy(&word, data.constData() + i, qMin<int>(sizeof(long), data.size() - i));
+            if (ptrace(PTRACE_POKEDATA, m_pid, reinterpret_cast<void*>(address + i), reinterpret_cast<void*>(word)) != 0)
+                return fail(QObject::tr("Failed to write target memory: %1").arg(qt_error_string(errno)));
+        }
+        return true;
+    }
+
+    QByteArray readString(quintptr address)
+    {
+        QByteArray str;
+        while (str.size() < 4096) {
+            errno = 0;
+            const long word = ptrace(PTRACE_PEEKDATA, m_pid, reinterpret_cast<void*>(address + str.size()), nullptr);
+            if (errno != 0)
+                break;
+            const char *chars = reinterpret_cast<const char*>(&word);
+            const int len = qstrnlen(chars, sizeof(long));
+            str.append(chars, len);
+            if (len < int(sizeof(long)))
+                break;
+        }
+        return str;
+    }
+
+    /**
+     * Calls @p function with up to two arguments on the stopped thread, using
+     * the stack below @p stackTop. The call returns to address 0, the resulting
+     * segmentation fault tells us it is done.
+     */
+    bool call(quintptr function, quintptr arg0, quintptr arg1, quintptr stackTop, quintptr *result)
+    {
+        user_regs_struct regs = m_savedRegs;
+        regs.rsp = (stackTop & ~quintptr(0xf)) - sizeof(quintptr);
+        regs.rip = function;
+        regs.rdi = arg0;
+        regs.rsi = arg1;
+        regs.rax = 0;
+        regs.orig_rax = -1; // don't let the kernel restart an interrupted system call in our stead
+        if (!writeMemory(regs.rsp, QByteArray(sizeof(quintptr), '\0')))
+            return false;
+        if (ptrace(PTRACE_SETREGS, m_pid, nullptr, &regs) != 0)
+            return fail(QObject::tr("Failed to write registers: %1").arg(qt_error_string(errno)));
+
+        int signal = 0;
+        forever {
+            if (ptrace(PTRACE_CONT, m_pid, nullptr, reinterpret_cast<void*>(static_cast<quintptr>(signal))) != 0)
+                return fail(QObject::tr("Failed to continue process: %1").arg(qt_error_string(errno)));
+            int status = 0;
+            if (waitpid(m_pid, &status, __WALL) != m_pid)
+                return fail(QObject::tr("Failed to wait for process %1: %2").arg(m_pid).arg(qt_error_string(errno)));
+            if (!WIFSTOPPED(status)) {
+                m_attached = false;
+                return fail(QObject::tr("Process %1 terminated during injection.").arg(m_pid));
+            }
+
+            signal = WSTOPSIG(status);
+            if (signal == SIGSEGV) {
+                if (ptrace(PTRACE_GETREGS, m_pid, nullptr, &regs) != 0)
+                    return fail(QObject::tr("Failed to read registers: %1").arg(qt_error_string(errno)));
+                if (regs.rip == 0) {
+                    *result = regs.rax;
+                    return true;
+                }
+            }
+            if (signal == SIGSEGV || signal == SIGBUS || signal == SIGILL || signal == SIGFPE || signal == SIGABRT)
+                return fail(QObject::tr("Process %1 crashed during injection (signal %2).").arg(m_pid).arg(signal));
+            if (signal == SIGSTOP)
+                signal = 0;
+        }
+    }
+
+    QString errorString() const
+    {
+        return m_errorString;
+    }
+
+private:
+    bool fail(const QString &error)
+    {
+        m_errorString = error;
+        return false;
+    }
+
+    int m_pid;
+    bool m_attached;
+    user_regs_struct m_savedRegs;
+    QString m_errorString;
+};
+
+/** Finds @p symbol in the first library mapped into @p pid whose file name matches one of @p libNames. */
+static quintptr findRemoteSymbol(int pid, const QVector<Mapping> &mappings, const QStringList &libNames, const QByteArray &symbol)
+{
+    foreach (const Mapping &m, mappings) {
+        if (m.offset != 0)
+            continue;
+        const QString fileName = QFileInfo(m.path).fileName();
+        bool match = false;
+        foreach (const QString &libName, libNames)
+            match = match || fileName.startsWith(libName);
+        if (!match)
+            continue;
+
+        // resolve through the target's root, in case it lives in a different mount namespace
+        quintptr firstLoadAddress = 0;
+        const quintptr offset = findSymbol(QStringLiteral("/proc/%1/root%2").arg(pid).arg(m.path), symbol, &firstLoadAddress);
+        if (offset)
+            return m.start - firstLoadAddress + offset;
+    }
+    return 0;
+}
+}
+#endif
+
+PtraceInjector::PtraceInjector()
+    : mExitCode(-1)
+    , mProcessError(QProcess::UnknownError)
+    , mExitStatus(QProcess::NormalExit)
+{
+}
+
+QString PtraceInjector::name() const
+{
+    return QStringLiteral("ptrace");
+}
+
+bool PtraceInjector::attach(int pid, const QString &probeDll, const QString &probeFunc)
+{
+#ifdef GAMMARAY_PTRACE_INJECTOR_SUPPORTED
+    Q_ASSERT(pid > 0);
+    mErrorString.clear();
+    if (targetAbi().isValid() && targetAbi().architecture() != QLatin1String("x86_64")) {
+        mErrorString = tr("The ptrace injector does not support the target architecture %1.").arg(targetAbi().architecture());
+        return false;
+    }
+
+    PtraceSession session(pid);
+    if (!session.attach()) {
+        mErrorString = session.errorString();
+        return false;
+    }
+
+    const QVector<Mapping> mappings = readMappings(pid);
+    const QStringList libc = QStringList() << QStringLiteral("libc.so") << QStringLiteral("libc-") << QStringLiteral("ld-musl");
+    // glibc >= 2.34 and musl have dlopen in libc, older glibc in libdl, which might not be loaded though
+    quintptr dlopenAddr = findRemoteSymbol(pid, mappings, libc, "dlopen");
+    quintptr dlerrorAddr = findRemoteSymbol(pid, mappings, libc, "dlerror");
+    if (!dlopenAddr) {
+        const QStringList libdl = QStringList() << QStringLiteral("libdl.so") << QStringLiteral("libdl-");
+        dlopenAddr = findRemoteSymbol(pid, mappings, libdl, "dlopen");
+        dlerrorAddr = findRemoteSymbol(pid, mappings, libdl, "dlerror");
+    }
+    if (!dlopenAddr) {
+        dlopenAddr = findRemoteSymbol(pid, mappings, libc, "__libc_dlopen_mode");
+        dlerrorAddr = 0;
+    }
+    if (!dlopenAddr) {
+        mErrorString = tr("Could not find dlopen in process %1.").arg(pid);
+        return false;
+    }
+
+    // place the probe path right below the red zone, and use the stack below for the calls
+    const QByteArray path = QFile::encodeName(probeDll) + '\0';
+    const quintptr pathAddr = (session.stackScratch() - path.size()) & ~quintptr(0xf);
+    quintptr handle = 0;
+    if (!session.writeMemory(pathAddr, path)
+        || !session.call(dlopenAddr, pathAddr, RTLD_NOW, pathAddr, &handle)) {
+        mErrorString = session.errorString();
+        return false;
+    }
+    if (!handle) {
+        quintptr error = 0;
+        if (dlerrorAddr && session.call(dlerrorAddr, 0, 0, pathAddr, &error) && error)
+            mErrorString = tr("Failed to load %1: %2").arg(probeDll, QString::fromLocal8Bit(session.readString(error)));
+        else
+            mErrorString = tr("Failed to load %1.").arg(probeDll);
+        return false;
+    }
+
+    const QString probePath = QFileInfo(probeDll).canonicalFilePath();
+    QVector<Mapping> probeMappings;
+    foreach (const Mapping &m, readMappings(pid)) {
+        if (QFileInfo(m.path).canonicalFilePath() == probePath)
+            probeMappings.push_back(m);
+    }
+    quintptr firstLoadAddress = 0;
+    const quintptr funcOffset = findSymbol(probeDll, probeFunc.toLatin1(), &firstLoadAddress);
+    if (probeMappings.isEmpty() || !funcOffset) {
+        mErrorString = tr("Could not find %1 in %2.").arg(probeFunc, probeDll);
+        return false;
+    }
+    quintptr base = probeMappings.first().start;
+    foreach (const Mapping &m, probeMappings) {
+        if (m.offset == 0)
+            base = m.start;
+    }
+
+    quintptr unused = 0;
+    if (!session.call(base - firstLoadAddress + funcOffset, 0, 0, pathAddr, &unused)) {
+        mErrorString = session.errorString();
+        return false;
+    }
+    session.detach();
+
+    mExitCode = 0;
+    emit started();
+    emit finished();
+    return true;
+#else
+    Q_UNUSED(pid);
+    Q_UNUSED(probeDll);
+    Q_UNUSED(probeFunc);
+    mErrorString = tr("The ptrace injector is not supported on this platform.");
+    return false;
+#endif
+}
+
+int PtraceInjector::exitCode()
+{
+    return mExitCode;
+}
+
+QProcess::ExitStatus PtraceInjector::exitStatus()
+{
+    return mExitStatus;
+}
+
+QProcess::ProcessError PtraceInjector::processError()
+{
+    return mProcessError;
+}
+
+QString PtraceInjector::errorString()
+{
+    return mErrorString;
+}
+
+bool PtraceInjector::selfTest()
+{
+#ifdef GAMMARAY_PTRACE_INJECTOR_SUPPORTED
+    // check for the Yama prtrace_scope setting, which can prevent attaching to work
+    QFile file(QStringLiteral("/proc/sys/kernel/yama/ptrace_scope"));
+    if (file.open(QFile::ReadOnly)) {
+        if (file.readAll().trimmed() != "0") {
+            mErrorString = tr(
+                "Yama security extension is blocking runtime attaching, see /proc/sys/kernel/yama/ptrace_scope");
+            return false;
+        }
+    }
+    return true;
+#else
+    mErrorString = tr("The ptrace injector is not supported on this platform.");
+    return false;
+#endif
+}
+
+void PtraceInjector::stop()
+{
+    // we never own the target process
+}
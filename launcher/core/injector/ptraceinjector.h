@@ -0,0 +1,61 @@
+/*
+  ptraceinjector.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_PTRACEINJECTOR_H
+#define GAMMARAY_PTRACEINJECTOR_H
+
+#include "abstractinjector.h"
+
+namespace GammaRay {
+/** Attach injector using ptrace directly, without an external debugger.
+ *  The target's dlopen is located via /proc/<pid>/maps and the dynamic symbol
+ *  tables of the mapped libraries, and then called on the stopped main thread.
+ */
+class PtraceInjector : public AbstractInjector
+{
+    Q_OBJECT
+public:
+    PtraceInjector();
+    QString name() const override;
+    bool attach(int pid, const QString &probeDll, const QString &probeFunc) override;
+    int exitCode() override;
+    QProcess::ExitStatus exitStatus() override;
+    QProcess::ProcessError processError() override;
+    QString errorString() override;
+    bool selfTest() override;
+    void stop() override;
+
+private:
+    int mExitCode;
+    QProcess::ProcessError mProcessError;
+    QProcess::ExitStatus mExitStatus;
+    QString mErrorString;
+};
+}
+
+#endif // GAMMARAY_PTRACEINJECTOR_H
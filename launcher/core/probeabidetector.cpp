@@ -30,12 +30,19 @@
 
 #include "probeabidetector.h"
 
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QFileInfo>
 #include <QProcess>
+#include <QSettings>
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
 #include <QStandardPaths>
 #endif
 
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
 using namespace GammaRay;
 
 ProbeABIDetector::ProbeABIDetector()
@@ -52,18 +59,64 @@ ProbeABI ProbeABIDetector::abiForProcess(qint64 pid) const
     return abiForQtCore(qtCoreForProcess(pid));
 }
 
+/** Identifies a specific build of a file, so cached results get invalidated when it is replaced. */
+static QString fileFingerprint(const QFileInfo &fi)
+{
+    QString fingerprint = QStringLiteral("%1:%2").arg(fi.lastModified().toMSecsSinceEpoch()).arg(fi.size());
+#ifdef Q_OS_UNIX
+    struct stat statBuf;
+    if (stat(QFile::encodeName(fi.canonicalFilePath()).constData(), &statBuf) == 0)
+        fingerprint += QStringLiteral(":%1").arg(statBuf.st_ino);
+#endif
+    return fingerprint;
+}
+
+/** Persistent cache shared between all launcher runs, detecting the ABI can involve running QtCore. */
+static QString persistentCacheFile()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (!cacheDir.isEmpty())
+        return cacheDir + QStringLiteral("/gammaray/probeabicache.ini");
+#endif
+    return QString();
+}
+
 ProbeABI ProbeABIDetector::abiForQtCore(const QString &path) const
 {
     QFileInfo fi(path);
     if (!fi.exists())
         return ProbeABI();
 
-    auto it = m_abiForQtCoreCache.constFind(fi.canonicalFilePath());
+    const QString canonicalPath = fi.canonicalFilePath();
+    const QString fingerprint = fileFingerprint(fi);
+    const QString cacheKey = canonicalPath + QLatin1Char('|') + fingerprint;
+    auto it = m_abiForQtCoreCache.constFind(cacheKey);
     if (it != m_abiForQtCoreCache.constEnd())
         return it.value();
 
-    const ProbeABI abi = detectAbiForQtCore(fi.canonicalFilePath());
-    m_abiForQtCoreCache.insert(fi.canonicalFilePath(), abi);
+    const QString cacheFile = persistentCacheFile();
+    // QSettings keys can't hold arbitrary paths, the path is stored in the value as well
+    const QString settingsKey = QStringLiteral("QtCoreABI/")
+        + QString::fromLatin1(QCryptographicHash::hash(canonicalPath.toUtf8(), QCryptographicHash::Sha1).toHex());
+    if (!cacheFile.isEmpty()) {
+        QSettings settings(cacheFile, QSettings::IniFormat);
+        const QStringList entry = settings.value(settingsKey).toStringList();
+        if (entry.size() == 3 && entry.at(0) == canonicalPath && entry.at(1) == fingerprint) {
+            const ProbeABI abi = ProbeABI::fromString(entry.at(2));
+            if (abi.isValid()) {
+                m_abiForQtCoreCache.insert(cacheKey, abi);
+                return abi;
+            }
+        }
+    }
+
+    const ProbeABI abi = detectAbiForQtCore(canonicalPath);
+    m_abiForQtCoreCache.insert(cacheKey, abi);
+    if (!cacheFile.isEmpty() && abi.isValid()) {
+        QSettings settings(cacheFile, QSettings::IniFormat);
+        settings.setValue(settingsKey, QStringList() << canonicalPath << fingerprint << abi.id());
+    }
     return abi;
 }
 
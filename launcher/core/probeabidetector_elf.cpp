@@ -33,11 +33,16 @@
 #include "libraryutil.h"
 
 #include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QPair>
 #include <QProcess>
 #include <QProcessEnvironment>
+#include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
 #ifdef HAVE_ELF_H
 #include <elf.h>
@@ -59,9 +64,243 @@ static QString qtCoreFromLdd(const QString &path)
     return QString();
 }
 
+#ifdef HAVE_ELF
+namespace {
+/** The parts of an ELF file relevant for resolving its dependencies. */
+struct ElfDependencyInfo
+{
+    ElfDependencyInfo()
+        : elfClass(ELFCLASSNONE)
+        , machine(EM_NONE)
+    {
+    }
+
+    int elfClass;
+    int machine;
+    QVector<QByteArray> needed;
+    QByteArray rpath;
+    QByteArray runpath;
+};
+}
+
+template<typename ElfEHdr, typename ElfPHdr, typename ElfDyn>
+static bool dependenciesFromELFHeader(const uchar *data, quint64 size, ElfDependencyInfo *info)
+{
+    if (size <= sizeof(ElfEHdr))
+        return false;
+    const ElfEHdr *hdr = reinterpret_cast<const ElfEHdr *>(data);
+    info->machine = hdr->e_machine;
+    if (hdr->e_phoff + hdr->e_phnum * sizeof(ElfPHdr) > size)
+        return false;
+
+    const ElfPHdr *phdrs = reinterpret_cast<const ElfPHdr *>(data + hdr->e_phoff);
+    const ElfPHdr *dynamic = nullptr;
+    for (int i = 0; i < hdr->e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_DYNAMIC)
+            dynamic = &phdrs[i];
+    }
+    if (!dynamic) // statically linked
+        return true;
+    if (dynamic->p_offset + dynamic->p_filesz > size)
+        return false;
+
+    // string table entries are virtual addresses, map them back to file offsets
+    const auto fileOffset = [phdrs, hdr](quint64 addr) -> quint64 {
+        for (int i = 0; i < hdr->e_phnum; ++i) {
+            if (phdrs[i].p_type == PT_LOAD && addr >= phdrs[i].p_vaddr && addr < phdrs[i].p_vaddr + phdrs[i].p_filesz)
+                return addr - phdrs[i].p_vaddr + phdrs[i].p_offset;
+        }
+        return 0;
+    };
+
+    const ElfDyn *dyns = reinterpret_cast<const ElfDyn *>(data + dynamic->p_offset);
+    const int dynCount = dynamic->p_filesz / sizeof(ElfDyn);
+    quint64 strTab = 0;
+    quint64 strSize = 0;
+    for (int i = 0; i < dynCount && dyns[i].d_tag != DT_NULL; ++i) {
+        if (dyns[i].d_tag == DT_STRTAB)
+            strTab = fileOffset(dyns[i].d_un.d_ptr);
+        else if (dyns[i].d_tag == DT_STRSZ)
+            strSize = dyns[i].d_un.d_val;
+    }
+    if (!strTab || strTab + strSize > size)
+        return false;
+
+    const char *strs = reinterpret_cast<const char *>(data + strTab);
+    const auto string = [strs, strSize](quint64 index) {
+        return index < strSize ? QByteArray(strs + index, qstrnlen(strs + index, strSize - index)) : QByteArray();
+    };
+    for (int i = 0; i < dynCount && dyns[i].d_tag != DT_NULL; ++i) {
+        switch (dyns[i].d_tag) {
+        case DT_NEEDED:
+            info->needed.push_back(string(dyns[i].d_un.d_val));
+            break;
+        case DT_RPATH:
+            info->rpath = string(dyns[i].d_un.d_val);
+            break;
+#ifdef DT_RUNPATH
+        case DT_RUNPATH:
+            info->runpath = string(dyns[i].d_un.d_val);
+            break;
+#endif
+        }
+    }
+    return true;
+}
+
+static bool dependenciesFromELF(const QString &path, ElfDependencyInfo *info)
+{
+    QFile f(path);
+    if (!f.open(QFile::ReadOnly))
+        return false;
+
+    const uchar *data = f.map(0, f.size());
+    if (!data || f.size() < EI_NIDENT)
+        return false;
+
+    if (qstrncmp(reinterpret_cast<const char *>(data), ELFMAG, SELFMAG) != 0) // no ELF signature
+        return false;
+
+    info->elfClass = data[EI_CLASS];
+    switch (data[EI_CLASS]) {
+    case ELFCLASS32:
+        return dependenciesFromELFHeader<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(data, f.size(), info);
+    case ELFCLASS64:
+        return dependenciesFromELFHeader<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(data, f.size(), info);
+    }
+    return false;
+}
+
+static void readLdSoConf(const QString &fileName, QStringList &dirs, int depth = 0)
+{
+    QFile f(fileName);
+    if (depth > 8 || !f.open(QFile::ReadOnly))
+        return;
+
+    forever {
+        QByteArray line = f.readLine();
+        if (line.isEmpty())
+            break;
+        line = line.left(line.indexOf('#')).trimmed();
+        if (line.isEmpty())
+            continue;
+
+        if (line.startsWith("include")) {
+            QString pattern = QString::fromLocal8Bit(line.mid(7).trimmed());
+            if (QDir::isRelativePath(pattern))
+                pattern = QFileInfo(fileName).absolutePath() + QLatin1Char('/') + pattern;
+            const QFileInfo patternInfo(pattern);
+            const QDir dir(patternInfo.absolutePath());
+            foreach (const QString &entry, dir.entryList(QStringList() << patternInfo.fileName(), QDir::Files, QDir::Name))
+                readLdSoConf(dir.filePath(entry), dirs, depth + 1);
+        } else if (!line.startsWith("hwcap")) {
+            dirs.push_back(QString::fromLocal8Bit(line));
+        }
+    }
+}
+
+/** Library directories searched after the ones specified by the executable and the environment. */
+static QStringList systemLibraryDirs(int elfClass)
+{
+    static const QStringList confDirs = []() {
+        QStringList dirs;
+        readLdSoConf(QStringLiteral("/etc/ld.so.conf"), dirs);
+        return dirs;
+    }();
+
+    QStringList dirs = confDirs;
+    if (elfClass == ELFCLASS64)
+        dirs << QStringLiteral("/lib64") << QStringLiteral("/usr/lib64");
+    dirs << QStringLiteral("/lib") << QStringLiteral("/usr/lib");
+    return dirs;
+}
+
+static QStringList expandSearchPath(const QByteArray &searchPath, const QString &origin)
+{
+    QStringList dirs;
+    foreach (const QByteArray &entry, searchPath.split(':')) {
+        if (entry.isEmpty())
+            continue;
+        QString dir = QString::fromLocal8Bit(entry);
+        dir.replace(QLatin1String("${ORIGIN}"), origin);
+        dir.replace(QLatin1String("$ORIGIN"), origin);
+        if (dir.contains(QLatin1Char('$'))) // $LIB and $PLATFORM are not supported
+            continue;
+        dirs.push_back(dir);
+    }
+    return dirs;
+}
+
+/**
+ * Finds QtCore by following DT_NEEDED entries the same way the dynamic linker would,
+ * without running ldd. The ld.so cache is not consulted, but the directories it is
+ * built from are. Returns an empty string if QtCore could not be located this way.
+ */
+static QString qtCoreFromELF(const QString &path)
+{
+    ElfDependencyInfo exeInfo;
+    if (!dependenciesFromELF(path, &exeInfo))
+        return QString();
+
+    const QString exeOrigin = QFileInfo(path).absolutePath();
+    const QStringList exeRPath = exeInfo.runpath.isEmpty() ? expandSearchPath(exeInfo.rpath, exeOrigin) : QStringList();
+    const QStringList envPath = expandSearchPath(qgetenv("LD_LIBRARY_PATH"), exeOrigin);
+    const QStringList systemDirs = systemLibraryDirs(exeInfo.elfClass);
+
+    QVector<QPair<QString, ElfDependencyInfo> > queue;
+    queue.push_back(qMakePair(path, exeInfo));
+    QSet<QByteArray> seen;
+    for (int i = 0; i < queue.size(); ++i) {
+        const QString origin = QFileInfo(queue.at(i).first).absolutePath();
+        const ElfDependencyInfo info = queue.at(i).second;
+
+        // DT_RPATH is only used if there is no DT_RUNPATH, and is inherited from the executable
+        QStringList searchDirs;
+        if (info.runpath.isEmpty())
+            searchDirs += expandSearchPath(info.rpath, origin) + exeRPath;
+        searchDirs += envPath;
+        searchDirs += expandSearchPath(info.runpath, origin);
+        searchDirs += systemDirs;
+
+        foreach (const QByteArray &needed, info.needed) {
+            if (seen.contains(needed))
+                continue;
+            seen.insert(needed);
+
+            const QString neededName = QString::fromLocal8Bit(needed);
+            QStringList candidates;
+            if (neededName.contains(QLatin1Char('/'))) {
+                candidates.push_back(neededName);
+            } else {
+                foreach (const QString &dir, searchDirs)
+                    candidates.push_back(dir + QLatin1Char('/') + neededName);
+            }
+
+            foreach (const QString &candidate, candidates) {
+                ElfDependencyInfo libInfo;
+                // skip libraries of a different architecture, like ld.so does
+                if (!QFile::exists(candidate) || !dependenciesFromELF(candidate, &libInfo)
+                    || libInfo.elfClass != exeInfo.elfClass || libInfo.machine != exeInfo.machine)
+                    continue;
+                if (ProbeABIDetector::containsQtCore(needed))
+                    return candidate;
+                queue.push_back(qMakePair(candidate, libInfo));
+                break;
+            }
+        }
+    }
+
+    return QString();
+}
+#endif
+
 QString ProbeABIDetector::qtCoreForExecutable(const QString &path) const
 {
-    // TODO: add fast version reading the ELF file directly?
+#ifdef HAVE_ELF
+    const QString qtCore = qtCoreFromELF(path);
+    if (!qtCore.isEmpty())
+        return qtCore;
+#endif
     return qtCoreFromLdd(path);
 }
 
@@ -111,6 +350,86 @@ static ProbeABI qtVersionFromFileName(const QString &path)
     return abi;
 }
 
+#if defined(HAVE_ELF) && defined(SHT_GNU_verdef)
+template<typename ElfEHdr, typename ElfSHdr, typename ElfVerdef, typename ElfVerdaux>
+static ProbeABI qtVersionFromELFHeader(const uchar *data, quint64 size)
+{
+    ProbeABI abi;
+    if (size <= sizeof(ElfEHdr))
+        return abi;
+    const ElfEHdr *hdr = reinterpret_cast<const ElfEHdr *>(data);
+    if (hdr->e_shoff + hdr->e_shnum * sizeof(ElfSHdr) > size)
+        return abi;
+
+    const ElfSHdr *shdrs = reinterpret_cast<const ElfSHdr *>(data + hdr->e_shoff);
+    for (int i = 0; i < hdr->e_shnum; ++i) {
+        if (shdrs[i].sh_type != SHT_GNU_verdef || shdrs[i].sh_link >= hdr->e_shnum)
+            continue;
+        const ElfSHdr &strTab = shdrs[shdrs[i].sh_link];
+        if (shdrs[i].sh_offset + shdrs[i].sh_size > size || strTab.sh_offset + strTab.sh_size > size)
+            return abi;
+
+        // QtCore defines a symbol version tag for every minor release, Qt_5.0 up to Qt_5.x
+        int major = 0;
+        int minor = -1;
+        quint64 offset = shdrs[i].sh_offset;
+        forever {
+            if (offset + sizeof(ElfVerdef) > shdrs[i].sh_offset + shdrs[i].sh_size)
+                break;
+            const ElfVerdef *def = reinterpret_cast<const ElfVerdef *>(data + offset);
+            const quint64 auxOffset = offset + def->vd_aux;
+            if (def->vd_cnt > 0 && auxOffset + sizeof(ElfVerdaux) <= size) {
+                const ElfVerdaux *aux = reinterpret_cast<const ElfVerdaux *>(data + auxOffset);
+                if (aux->vda_name < strTab.sh_size) {
+                    const char *name = reinterpret_cast<const char *>(data + strTab.sh_offset + aux->vda_name);
+                    const QList<QByteArray> version = QByteArray(name, qstrnlen(name, strTab.sh_size - aux->vda_name)).split('.');
+                    bool majorOk = false, minorOk = false;
+                    const int defMajor = version.size() == 2 && version.at(0).startsWith("Qt_") ? version.at(0).mid(3).toInt(&majorOk) : 0;
+                    const int defMinor = majorOk ? version.at(1).toInt(&minorOk) : 0;
+                    if (majorOk && minorOk && (defMajor > major || (defMajor == major && defMinor > minor))) {
+                        major = defMajor;
+                        minor = defMinor;
+                    }
+                }
+            }
+            if (def->vd_next == 0)
+                break;
+            offset += def->vd_next;
+        }
+        if (minor >= 0)
+            abi.setQtVersion(major, minor);
+        break;
+    }
+    return abi;
+}
+#endif
+
+static ProbeABI qtVersionFromELF(const QString &path)
+{
+#if defined(HAVE_ELF) && defined(SHT_GNU_verdef)
+    QFile f(path);
+    if (!f.open(QFile::ReadOnly))
+        return ProbeABI();
+
+    const uchar *data = f.map(0, f.size());
+    if (!data || f.size() < EI_NIDENT)
+        return ProbeABI();
+
+    if (qstrncmp(reinterpret_cast<const char *>(data), ELFMAG, SELFMAG) != 0) // no ELF signature
+        return ProbeABI();
+
+    switch (data[EI_CLASS]) {
+    case ELFCLASS32:
+        return qtVersionFromELFHeader<Elf32_Ehdr, Elf32_Shdr, Elf32_Verdef, Elf32_Verdaux>(data, f.size());
+    case ELFCLASS64:
+        return qtVersionFromELFHeader<Elf64_Ehdr, Elf64_Shdr, Elf64_Verdef, Elf64_Verdaux>(data, f.size());
+    }
+#else
+    Q_UNUSED(path);
+#endif
+    return ProbeABI();
+}
+
 static ProbeABI qtVersionFromExec(const QString &path)
 {
     ProbeABI abi;
@@ -194,6 +513,8 @@ ProbeABI ProbeABIDetector::detectAbiForQtCore(const QString &path) const
 
     // try to find the version
     ProbeABI abi = qtVersionFromFileName(path);
+    if (!abi.hasQtVersion())
+        abi = qtVersionFromELF(path);
     if (!abi.hasQtVersion())
         abi = qtVersionFromExec(path);
 
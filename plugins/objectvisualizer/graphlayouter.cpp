@@ -0,0 +1,290 @@
+/*
+  graphlayouter.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "graphlayouter.h"
+
+#include <QTimer>
+
+#include <cmath>
+
+using namespace GammaRay;
+
+// heat is the maximum step length of a node, relative to the edge length
+static const double CoolingFactor = 0.92;
+static const double MinimumHeat = 0.02;
+// nodes moving further than this push their tree neighbors along
+static const double RippleDistance = 0.2 * GraphLayouter::EdgeLength;
+static const double CellSize = 2.0 * GraphLayouter::EdgeLength;
+// time slice for a single relax() call, and minimum interval between position updates
+static const int SliceDuration = 10;
+static const int EmissionInterval = 40;
+
+static double length(const QPointF &p)
+{
+    return std::sqrt(p.x() * p.x() + p.y() * p.y());
+}
+
+GraphLayouter::GraphLayouter(QObject *parent)
+    : QObject(parent)
+    , m_positionCache(PositionCacheSize)
+    , m_relaxTimer(new QTimer(this))
+    , m_seed(1)
+{
+    m_relaxTimer->setSingleShot(true);
+    m_relaxTimer->setInterval(0);
+    connect(m_relaxTimer, SIGNAL(timeout()), this, SLOT(relax()));
+    m_lastEmission.start();
+}
+
+GraphLayouter::~GraphLayouter()
+{
+    qDeleteAll(m_nodes);
+}
+
+QPoint GraphLayouter::cellForPosition(const QPointF &pos)
+{
+    return QPoint(static_cast<int>(std::floor(pos.x() / CellSize)),
+                  static_cast<int>(std::floor(pos.y() / CellSize)));
+}
+
+quint64 GraphLayouter::cellKey(const QPoint &cell)
+{
+    return (quint64(quint32(cell.x())) << 32) | quint32(cell.y());
+}
+
+void GraphLayouter::addNode(qulonglong id, qulonglong parentId, int weight)
+{
+    if (m_nodes.contains(id))
+        return;
+
+    Node *node = new Node;
+    node->id = id;
+    node->weight = qMax(weight, 1);
+    node->parent = m_nodes.value(parentId);
+    if (node->parent)
+        node->parent->children.push_back(node);
+    m_nodes.insert(id, node);
+
+    QPointF pos;
+    if (const QPointF *cachedPos = m_positionCache.object(id)) {
+        pos = *cachedPos;
+    } else {
+        // place new nodes at a random spot next to their parent, or anywhere for new roots
+        m_seed = m_seed * 1103515245 + 12345;
+        const double angle = (m_seed >> 16) * (6.283185307179586 / 65536.0);
+        const double distance = node->parent ? double(EdgeLength)
+                                             : std::sqrt(double(m_nodes.size())) * EdgeLength;
+        if (node->parent)
+            pos = node->parent->pos;
+        pos += QPointF(std::cos(angle), std::sin(angle)) * distance;
+    }
+    node->cell = cellKey(cellForPosition(pos));
+    node->pos = pos;
+    m_grid[node->cell].push_back(node);
+    m_movedNodes.insert(node);
+
+    activate(node, 1.0, ActivationRadius);
+    activateSpatialNeighbors(node, 0.5);
+    scheduleRelax();
+}
+
+void GraphLayouter::removeNode(qulonglong id)
+{
+    m_positionCache.remove(id);
+    Node *node = m_nodes.take(id);
+    if (!node)
+        return;
+
+    m_grid[node->cell].removeOne(node);
+    m_activeNodes.remove(node);
+    m_movedNodes.remove(node);
+    foreach (Node *child, node->children)
+        child->parent = nullptr;
+    if (node->parent) {
+        node->parent->children.removeOne(node);
+        activate(node->parent, 0.5, ActivationRadius - 1);
+    }
+    activateSpatialNeighbors(node, 0.5);
+    delete node;
+    scheduleRelax();
+}
+
+void GraphLayouter::setNodeWeight(qulonglong id, int weight)
+{
+    Node *node = m_nodes.value(id);
+    if (!node || node->weight == weight)
+        return;
+    node->weight = qMax(weight, 1);
+    activate(node, 0.5, 1);
+    scheduleRelax();
+}
+
+void GraphLayouter::clear()
+{
+    foreach (Node *node, m_nodes)
+        m_positionCache.insert(node->id, new QPointF(node->pos));
+    qDeleteAll(m_nodes);
+    m_nodes.clear();
+    m_grid.clear();
+    m_activeNodes.clear();
+    m_movedNodes.clear();
+    m_relaxTimer->stop();
+}
+
+void GraphLayouter::activate(Node *node, double heat, int radius)
+{
+    node->heat = qMax(node->heat, heat);
+    m_activeNodes.insert(node);
+    if (radius <= 0)
+        return;
+    if (node->parent)
+        activate(node->parent, heat, radius - 1);
+    foreach (Node *child, node->children)
+        activate(child, heat, radius - 1);
+}
+
+void GraphLayouter::activateSpatialNeighbors(const Node *node, double heat)
+{
+    foreach (Node *other, m_grid.value(node->cell)) {
+        if (other != node)
+            activate(other, heat, 0);
+    }
+}
+
+QPointF GraphLayouter::forceOn(const Node *node) const
+{
+    QPointF force;
+
+    // attraction along tree edges
+    const auto attract = [&](const Node *other) {
+        const QPointF delta = other->pos - node->pos;
+        force += delta * (length(delta) / EdgeLength);
+    };
+    if (node->parent)
+        attract(node->parent);
+    foreach (const Node *child, node->children)
+        attract(child);
+
+    // repulsion from nearby nodes, heavier (ie. aggregated) nodes claim more space
+    const QPoint cell = cellForPosition(node->pos);
+    for (int x = cell.x() - 1; x <= cell.x() + 1; ++x) {
+        for (int y = cell.y() - 1; y <= cell.y() + 1; ++y) {
+            const auto it = m_grid.constFind(cellKey(QPoint(x, y)));
+            if (it == m_grid.constEnd())
+                continue;
+            foreach (const Node *other, it.value()) {
+                if (other == node)
+                    continue;
+                QPointF delta = node->pos - other->pos;
+                double distance = length(delta);
+                if (distance < 0.01) { // coincident nodes, separate in an arbitrary direction
+                    delta = QPointF(node->id < other->id ? 0.01 : -0.01, 0.01);
+                    distance = length(delta);
+                }
+                const double strength = EdgeLength * EdgeLength * std::sqrt(double(other->weight));
+                force += delta * (strength / (distance * distance));
+            }
+        }
+    }
+
+    return force;
+}
+
+void GraphLayouter::moveNode(Node *node, const QPointF &pos)
+{
+    node->pos = pos;
+    const quint64 cell = cellKey(cellForPosition(pos));
+    if (cell != node->cell) {
+        m_grid[node->cell].removeOne(node);
+        m_grid[cell].push_back(node);
+        node->cell = cell;
+    }
+    m_movedNodes.insert(node);
+}
+
+void GraphLayouter::relax()
+{
+    QElapsedTimer slice;
+    slice.start();
+
+    while (!m_activeNodes.isEmpty() && slice.elapsed() < SliceDuration) {
+        const QSet<Node*> nodes = m_activeNodes;
+        foreach (Node *node, nodes) {
+            const QPointF force = forceOn(node);
+            const double forceLength = length(force);
+            const double maxStep = node->heat * EdgeLength;
+            const double step = qMin(forceLength, maxStep);
+            if (step > 0.0)
+                moveNode(node, node->pos + force * (step / forceLength));
+
+            node->heat *= CoolingFactor;
+            if (step > RippleDistance) {
+                if (node->parent && !m_activeNodes.contains(node->parent))
+                    activate(node->parent, node->heat * 0.5, 0);
+                foreach (Node *child, node->children) {
+                    if (!m_activeNodes.contains(child))
+                        activate(child, node->heat * 0.5, 0);
+                }
+            }
+            if (node->heat < MinimumHeat || step < MinimumHeat * RippleDistance) {
+                node->heat = 0.0;
+                m_activeNodes.remove(node);
+            }
+        }
+    }
+
+    if (m_activeNodes.isEmpty() || m_lastEmission.elapsed() >= EmissionInterval)
+        emitPositions();
+
+    if (m_activeNodes.isEmpty())
+        emit layoutFinished();
+    else
+        scheduleRelax();
+}
+
+void GraphLayouter::emitPositions()
+{
+    m_lastEmission.restart();
+    if (m_movedNodes.isEmpty())
+        return;
+
+    QVector<LayoutPosition> positions;
+    positions.reserve(m_movedNodes.size());
+    foreach (const Node *node, m_movedNodes) {
+        const LayoutPosition p = { node->id, node->pos };
+        positions.push_back(p);
+    }
+    m_movedNodes.clear();
+    emit positionsChanged(positions);
+}
+
+void GraphLayouter::scheduleRelax()
+{
+    if (!m_relaxTimer->isActive())
+        m_relaxTimer->start();
+}
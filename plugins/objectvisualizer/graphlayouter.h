@@ -0,0 +1,147 @@
+/*
+  graphlayouter.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_OBJECTVISUALIZER_GRAPHLAYOUTER_H
+#define GAMMARAY_OBJECTVISUALIZER_GRAPHLAYOUTER_H
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMetaType>
+#include <QObject>
+#include <QPointF>
+#include <QSet>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/** Position of a single node, as reported by GraphLayouter. */
+struct LayoutPosition
+{
+    qulonglong id;
+    QPointF pos;
+};
+
+/** Incremental force-directed layout of a forest.
+ *
+ *  Rather than laying out the entire graph again on every change, only the neighborhood
+ *  of added or removed nodes is relaxed, and the movement then ripples outwards as far as
+ *  needed. Repulsion is only computed against nodes in adjacent cells of a uniform grid.
+ *
+ *  This is meant to live in a separate thread, all interaction happens via queued
+ *  slots and the positionsChanged() signal, which delivers positions of moved nodes
+ *  in batches while the layout is still converging.
+ */
+class GraphLayouter : public QObject
+{
+    Q_OBJECT
+public:
+    enum {
+        /// Ideal edge length, in layout coordinates.
+        EdgeLength = 1,
+        /// Number of tree hops around a change that are relaxed initially.
+        ActivationRadius = 2,
+        /// Maximum number of remembered positions of cleared nodes.
+        PositionCacheSize = 10000
+    };
+
+    explicit GraphLayouter(QObject *parent = nullptr);
+    ~GraphLayouter();
+
+public slots:
+    /** Adds node @p id as child of @p parentId (0 for a root node). @p weight
+     *  scales the space the node claims.
+     */
+    void addNode(qulonglong id, qulonglong parentId, int weight);
+    /** Removes node @p id for good, e.g. because its object got destroyed. Unlike clear(),
+     *  its position is not remembered.
+     */
+    void removeNode(qulonglong id);
+    void setNodeWeight(qulonglong id, int weight);
+    /** Removes all nodes. Their last positions are remembered, so nodes re-added
+     *  later on (e.g. after changing the level of detail) reappear in place. Only the
+     *  PositionCacheSize most recently cleared positions are kept.
+     */
+    void clear();
+
+signals:
+    /** Emitted with the new positions of nodes that moved since the last emission. */
+    void positionsChanged(const QVector<GammaRay::LayoutPosition> &positions);
+    /** Emitted when all pending changes have been laid out. */
+    void layoutFinished();
+
+private slots:
+    void relax();
+
+private:
+    struct Node
+    {
+        Node()
+            : id(0)
+            , parent(nullptr)
+            , cell(0)
+            , weight(1)
+            , heat(0.0) {}
+
+        qulonglong id;
+        Node *parent;
+        QVector<Node*> children;
+        QPointF pos;
+        quint64 cell;
+        int weight;
+        double heat;
+    };
+
+    static QPoint cellForPosition(const QPointF &pos);
+    static quint64 cellKey(const QPoint &cell);
+    void moveNode(Node *node, const QPointF &pos);
+    void activate(Node *node, double heat, int radius);
+    void activateSpatialNeighbors(const Node *node, double heat);
+    QPointF forceOn(const Node *node) const;
+    void emitPositions();
+    void scheduleRelax();
+
+    QHash<qulonglong, Node*> m_nodes;
+    QHash<quint64, QVector<Node*> > m_grid;
+    QSet<Node*> m_activeNodes;
+    QSet<Node*> m_movedNodes;
+    QCache<qulonglong, QPointF> m_positionCache;
+    QTimer *m_relaxTimer;
+    QElapsedTimer m_lastEmission;
+    quint32 m_seed;
+};
+}
+
+Q_DECLARE_METATYPE(GammaRay::LayoutPosition)
+Q_DECLARE_TYPEINFO(GammaRay::LayoutPosition, Q_MOVABLE_TYPE);
+Q_DECLARE_METATYPE(QVector<GammaRay::LayoutPosition>)
+
+#endif // GAMMARAY_OBJECTVISUALIZER_GRAPHLAYOUTER_H
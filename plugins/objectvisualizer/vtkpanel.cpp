@@ -43,7 +43,7 @@ using namespace GammaRay;
 VtkPanel::VtkPanel(VtkWidget *vtkWidget, QWidget *parent)
     : QToolBar(parent)
     , m_vtkWidget(vtkWidget)
-    , m_currentLayout("spanTree")
+    , m_currentLayout("incremental")
 {
     addWidget(new QLabel(tr("Layout:")));
     m_layoutBox = new QComboBox;
@@ -51,6 +51,7 @@ VtkPanel::VtkPanel(VtkWidget *vtkWidget, QWidget *parent)
     m_layoutBox->addItem(tr("Tree Layout"), "tree");
 #endif
 
+    m_layoutBox->addItem(tr("Incremental Layout"), "incremental");
     m_layoutBox->addItem(tr("Span Tree Layout"), "spanTree");
     m_layoutBox->addItem(tr("Force Directed Layout"), "forceDirected");
     m_layoutBox->addItem(tr("Force Directed Layout (3D)"), "forceDirected3D");
@@ -58,6 +59,13 @@ VtkPanel::VtkPanel(VtkWidget *vtkWidget, QWidget *parent)
     connect(m_layoutBox, SIGNAL(currentIndexChanged(int)), SLOT(layoutChanged(int)));
     addWidget(m_layoutBox);
 
+    addWidget(new QLabel(tr("Collapse:")));
+    m_aggregationBox = new QComboBox;
+    m_aggregationBox->addItem(tr("By Type"), VtkWidget::AggregateByType);
+    m_aggregationBox->addItem(tr("By Parent"), VtkWidget::AggregateByParent);
+    connect(m_aggregationBox, SIGNAL(currentIndexChanged(int)), SLOT(aggregationModeChanged(int)));
+    addWidget(m_aggregationBox);
+
     addWidget(new QLabel(tr("Stereo:")));
     m_stereoBox = new QComboBox;
     m_stereoBox->addItem(tr("Off"), 0);
@@ -101,14 +109,21 @@ void VtkPanel::layoutChanged(int index)
         return;
 
     // update
-    vtkGraphLayoutStrategy *strategy = layoutStrategyForName(layoutName);
-    m_vtkWidget->layoutView()->SetLayoutStrategy(strategy);
+    m_vtkWidget->setIncrementalLayout(layoutName == QLatin1String("incremental"));
+    if (vtkGraphLayoutStrategy *strategy = layoutStrategyForName(layoutName))
+        m_vtkWidget->layoutView()->SetLayoutStrategy(strategy);
     m_vtkWidget->layoutView()->ResetCamera();
     m_vtkWidget->layoutView()->Render();
     m_vtkWidget->GetInteractor()->Start();
     m_currentLayout = layoutName;
 }
 
+void VtkPanel::aggregationModeChanged(int index)
+{
+    m_vtkWidget->setAggregationMode(
+        static_cast<VtkWidget::AggregationMode>(m_aggregationBox->itemData(index).toInt()));
+}
+
 void VtkPanel::stereoModeChanged(int index)
 {
     const int stereoMode = m_stereoBox->itemData(index).toInt();
@@ -47,12 +47,14 @@ public:
 public slots:
     void layoutChanged(int);
     void stereoModeChanged(int);
+    void aggregationModeChanged(int);
 
 private:
     VtkWidget *m_vtkWidget;
 
     QComboBox *m_layoutBox;
     QComboBox *m_stereoBox;
+    QComboBox *m_aggregationBox;
     QString m_currentLayout;
 };
 }
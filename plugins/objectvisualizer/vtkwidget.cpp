@@ -33,7 +33,9 @@
 #include <QAbstractItemModel>
 #include <QDebug>
 #include <QItemSelectionModel>
+#include <QThread>
 #include <QTimer>
+#include <QWheelEvent>
 
 #include <vtkRenderer.h>
 #include <vtkRenderWindow.h>
@@ -55,7 +57,11 @@
 #include <vtkIdTypeArray.h>
 #include <vtkLookupTable.h>
 #include <vtkViewTheme.h>
+#include <vtkPoints.h>
+#include <vtkCamera.h>
+#include <vtkMath.h>
 
+#include <cmath>
 #include <iostream>
 
 using namespace GammaRay;
@@ -79,11 +85,36 @@ VtkWidget::VtkWidget(QWidget *parent)
     , m_selectionModel(nullptr)
     , m_repopulateTimer(new QTimer(this))
     , m_colorIndex(0)
+    , m_layoutThread(new QThread(this))
+    , m_incrementalLayout(true)
+    , m_resetCameraPending(true)
+    , m_levelOfDetailTimer(new QTimer(this))
+    , m_collapseDepth(2)
+    , m_aggregationMode(AggregateByType)
 {
     setupRenderer();
     setupGraph();
     show();
 
+    qRegisterMetaType<QVector<GammaRay::LayoutPosition> >();
+    auto layouter = new GraphLayouter;
+    layouter->moveToThread(m_layoutThread);
+    connect(m_layoutThread, SIGNAL(finished()), layouter, SLOT(deleteLater()));
+    connect(this, SIGNAL(layoutNodeAdded(qulonglong,qulonglong,int)),
+            layouter, SLOT(addNode(qulonglong,qulonglong,int)));
+    connect(this, SIGNAL(layoutNodeRemoved(qulonglong)), layouter, SLOT(removeNode(qulonglong)));
+    connect(this, SIGNAL(layoutNodeWeightChanged(qulonglong,int)),
+            layouter, SLOT(setNodeWeight(qulonglong,int)));
+    connect(this, SIGNAL(layoutCleared()), layouter, SLOT(clear()));
+    connect(layouter, SIGNAL(positionsChanged(QVector<GammaRay::LayoutPosition>)),
+            this, SLOT(updatePositions(QVector<GammaRay::LayoutPosition>)));
+    connect(layouter, SIGNAL(layoutFinished()), this, SLOT(layoutFinished()));
+    m_layoutThread->start();
+
+    m_levelOfDetailTimer->setInterval(200);
+    m_levelOfDetailTimer->setSingleShot(true);
+    connect(m_levelOfDetailTimer, SIGNAL(timeout()), SLOT(updateLevelOfDetail()));
+
     m_updateTimer->setInterval(0);
     m_updateTimer->setSingleShot(true);
     connect(m_updateTimer, SIGNAL(timeout()), SLOT(renderViewImpl()));
@@ -95,6 +126,8 @@ VtkWidget::VtkWidget(QWidget *parent)
 
 VtkWidget::~VtkWidget()
 {
+    m_layoutThread->quit();
+    m_layoutThread->wait();
     clear();
 
     DEBUG("")
@@ -123,6 +156,32 @@ void VtkWidget::setSelectionModel(QItemSelectionModel *selectionModel)
             SLOT(selectionChanged()));
 }
 
+void VtkWidget::setIncrementalLayout(bool incremental)
+{
+    const bool changed = m_incrementalLayout != incremental;
+    m_incrementalLayout = incremental;
+    if (incremental) {
+        m_view->SetLayoutStrategyToPassThrough();
+        m_resetCameraPending = true;
+        renderView();
+    }
+    if (!changed)
+        return;
+
+    // the level of detail only follows the zoom of the incremental layout, the VTK
+    // layout strategies get the full graph
+    m_collapseDepth = incremental ? 2 : -1;
+    repopulate();
+}
+
+void VtkWidget::setAggregationMode(AggregationMode mode)
+{
+    if (m_aggregationMode == mode)
+        return;
+    m_aggregationMode = mode;
+    repopulate();
+}
+
 void VtkWidget::setupRenderer()
 {
 }
@@ -144,6 +203,13 @@ void VtkWidget::mouseReleaseEvent(QMouseEvent *event)
     m_mousePressed = false;
 
     QVTKWidget::mouseReleaseEvent(event);
+    m_levelOfDetailTimer->start();
+}
+
+void VtkWidget::wheelEvent(QWheelEvent *event)
+{
+    QVTKWidget::wheelEvent(event);
+    m_levelOfDetailTimer->start();
 }
 
 void VtkWidget::setupGraph()
@@ -153,6 +219,10 @@ void VtkWidget::setupGraph()
     VTK_CREATE(vtkMutableDirectedGraph, graph);
     m_graph = graph;
 
+    // vertex positions provided by GraphLayouter
+    VTK_CREATE(vtkPoints, points);
+    m_graph->SetPoints(points);
+
     VTK_CREATE(vtkVariantArray, vertexPropertyArr);
     vertexPropertyArr->SetNumberOfValues(3);
     m_vertexPropertyArr = vertexPropertyArr;
@@ -161,7 +231,7 @@ void VtkWidget::setupGraph()
     vertexProp0Array->SetName("labels");
     m_graph->GetVertexData()->AddArray(vertexProp0Array);
 
-    // currently not used
+    // number of objects represented by a vertex
     VTK_CREATE(vtkIntArray, vertexProp1Array);
     vertexProp1Array->SetName("weight");
     m_graph->GetVertexData()->AddArray(vertexProp1Array);
@@ -181,7 +251,7 @@ void VtkWidget::setupGraph()
     graphLayoutView->AddRepresentationFromInput(graph);
     graphLayoutView->SetVertexLabelVisibility(true);
     graphLayoutView->SetVertexLabelArrayName("labels");
-    graphLayoutView->SetLayoutStrategyToSpanTree();
+    graphLayoutView->SetLayoutStrategyToPassThrough();
     graphLayoutView->SetVertexColorArrayName("Color");
     graphLayoutView->SetColorVertices(true);
     graphLayoutView->ApplyViewTheme(theme);
@@ -269,49 +339,138 @@ qulonglong VtkWidget::addObject(const QModelIndex &index)
 
 #endif
 
-    if (!objectId || m_objectIdMap.contains(objectId))
+    if (!objectId || m_objectIdMap.contains(objectId) || m_foldedObjects.contains(objectId))
         return 0;
 
     if (!filterAcceptsObject(index))
         return 0;
 
-    const QString label = index.data(ObjectVisualizerModel::ObjectDisplayName).toString();
-    const int weight = 1; // TODO: Make weight somewhat usable?
+    const int depth = visibleDepth(index);
+    if (m_collapseDepth >= 0 && depth > m_collapseDepth) {
+        addToAggregate(index, objectId, depth);
+    } else {
+        qulonglong parentId = 0;
+        if (index.parent().isValid())
+            parentId = index.parent().data(ObjectVisualizerModel::ObjectId).toULongLong();
+        addVertex(objectId, index.data(ObjectVisualizerModel::ObjectDisplayName).toString(),
+                  1, className, m_objectIdMap.contains(parentId) ? parentId : 0);
+    }
+
+    // recursively add our children
+    for (int i = 0; i < index.model()->rowCount(index); ++i)
+        addObject(index.child(i, 0));
+
+    renderView();
+    return objectId;
+}
+
+vtkIdType VtkWidget::addVertex(qulonglong id, const QString &label, int weight,
+                               const QString &className, qulonglong parentId)
+{
     m_vertexPropertyArr->SetValue(0, vtkUnicodeString::from_utf16(label.utf16()));
     m_vertexPropertyArr->SetValue(1, weight);
-    static int colorIndex = 0;
-    colorIndex = colorIndex % 10;
+    m_vertexPropertyArr->SetValue(2, colorForType(className));
 
+    const vtkIdType type = m_graph->AddVertex(m_vertexPropertyArr);
+    DEBUG("Add: " << type << " " << qPrintable(className))
+    m_objectIdMap[id] = type;
+    Q_ASSERT(type == m_vertexObjectIds.size());
+    m_vertexObjectIds.push_back(id);
+
+    // start out at the parent position until the layouter placed us
+    double pos[3] = { 0.0, 0.0, 0.0 };
+    if (parentId && m_objectIdMap.contains(parentId)) {
+        const vtkIdType parentType = m_objectIdMap.value(parentId);
+        m_graph->GetPoints()->GetPoint(parentType, pos);
+        m_graph->AddEdge(parentType, type);
+    }
+    m_graph->GetPoints()->InsertPoint(type, pos);
+
+    emit layoutNodeAdded(id, parentId, weight);
+    return type;
+}
+
+int VtkWidget::colorForType(const QString &className)
+{
     auto it = m_typeColorMap.constFind(className);
-    if (it != m_typeColorMap.constEnd()) {
-        m_vertexPropertyArr->SetValue(2, it.value());
-    } else {
-        m_vertexPropertyArr->SetValue(2, m_colorIndex);
-        m_typeColorMap.insert(className, m_colorIndex);
-        ++m_colorIndex;
+    if (it != m_typeColorMap.constEnd())
+        return it.value();
+    m_typeColorMap.insert(className, m_colorIndex);
+    return m_colorIndex++;
+}
+
+/// Depth of @p index below the top-most visible ancestor
+int VtkWidget::visibleDepth(const QModelIndex &index) const
+{
+    int depth = 0;
+    for (QModelIndex parent = index.parent(); parent.isValid(); parent = parent.parent()) {
+        const qulonglong parentId = parent.data(ObjectVisualizerModel::ObjectId).toULongLong();
+        if (!m_objectIdMap.contains(parentId) && !m_foldedObjects.contains(parentId))
+            break;
+        ++depth;
     }
+    return depth;
+}
 
-    const vtkIdType type = m_graph->AddVertex(m_vertexPropertyArr);
-    DEBUG("Add: " << type << " " << object->metaObject()->className())
-    m_objectIdMap[objectId] = type;
+void VtkWidget::addToAggregate(const QModelIndex &index, qulonglong objectId, int depth)
+{
+    QModelIndex ancestor = index;
+    for (int i = m_collapseDepth; i < depth; ++i)
+        ancestor = ancestor.parent();
+    const qulonglong ancestorId = ancestor.data(ObjectVisualizerModel::ObjectId).toULongLong();
+    const QString className = index.data(ObjectVisualizerModel::ClassName).toString();
+    const AggregateKey key(ancestorId,
+                           m_aggregationMode == AggregateByType ? className : QString());
+    m_foldedObjects.insert(objectId, key);
+
+    auto it = m_aggregates.find(key);
+    if (it == m_aggregates.end()) {
+        qulonglong &nodeId = m_aggregateIds[key];
+        if (!nodeId) // object ids are addresses, so small numbers won't collide with those
+            nodeId = m_aggregateIds.size();
+        Aggregate aggregate;
+        aggregate.nodeId = nodeId;
+        aggregate.label = m_aggregationMode == AggregateByType ? className : tr("Descendants");
+        aggregate.count = 1;
+        addVertex(nodeId, tr("%1 (1)").arg(aggregate.label), 1, key.second, ancestorId);
+        m_aggregates.insert(key, aggregate);
+        return;
+    }
 
-    // recursively add our children
-    for (int i = 0; i < index.model()->rowCount(index); ++i)
-        addObject(index.child(i, 0));
+    Aggregate &aggregate = it.value();
+    ++aggregate.count;
+    const vtkIdType type = m_objectIdMap.value(aggregate.nodeId);
+    const QString label = tr("%1 (%2)").arg(aggregate.label).arg(aggregate.count);
+    m_graph->GetVertexData()->GetAbstractArray("labels")->SetVariantValue(
+        type, vtkUnicodeString::from_utf16(label.utf16()));
+    m_graph->GetVertexData()->GetAbstractArray("weight")->SetVariantValue(type, aggregate.count);
+    m_graph->Modified();
+    emit layoutNodeWeightChanged(aggregate.nodeId, aggregate.count);
+}
 
-    // add edge to parent
-    if (index.parent().isValid()) {
-        const qulonglong parentId
-            = index.parent().data(ObjectVisualizerModel::ObjectId).toULongLong();
-        if (parentId) {
-            Q_ASSERT(m_objectIdMap.contains(parentId));
-            const vtkIdType parentType = m_objectIdMap.value(parentId);
-            m_graph->AddEdge(parentType, type);
-        }
+void VtkWidget::removeFromAggregate(qulonglong objectId)
+{
+    const AggregateKey key = m_foldedObjects.take(objectId);
+    auto it = m_aggregates.find(key);
+    if (it == m_aggregates.end())
+        return;
+
+    Aggregate &aggregate = it.value();
+    if (--aggregate.count == 0) {
+        removeObjectInternal(aggregate.nodeId);
+        emit layoutNodeRemoved(aggregate.nodeId);
+        m_aggregates.erase(it);
+        return;
     }
 
+    const vtkIdType type = m_objectIdMap.value(aggregate.nodeId);
+    const QString label = tr("%1 (%2)").arg(aggregate.label).arg(aggregate.count);
+    m_graph->GetVertexData()->GetAbstractArray("labels")->SetVariantValue(
+        type, vtkUnicodeString::from_utf16(label.utf16()));
+    m_graph->GetVertexData()->GetAbstractArray("weight")->SetVariantValue(type, aggregate.count);
+    m_graph->Modified();
+    emit layoutNodeWeightChanged(aggregate.nodeId, aggregate.count);
     renderView();
-    return objectId;
 }
 
 bool VtkWidget::removeObject(const QModelIndex &index)
@@ -320,6 +479,12 @@ bool VtkWidget::removeObject(const QModelIndex &index)
         removeObject(index.child(i, 0));
 
     const qulonglong objectId = index.data(ObjectVisualizerModel::ObjectId).toULongLong();
+    if (m_foldedObjects.contains(objectId)) {
+        removeFromAggregate(objectId);
+        return true;
+    }
+    // also when filtered out, so the layouter forgets its position
+    emit layoutNodeRemoved(objectId);
     return removeObjectInternal(objectId);
 }
 
@@ -333,21 +498,28 @@ bool VtkWidget::removeObjectInternal(qulonglong objectId)
     const int size = m_graph->GetNumberOfVertices();
     m_graph->RemoveVertex(type);
 
+    if (size <= m_graph->GetNumberOfVertices()) {
+        DEBUG("Warning: Should not happen: Could not remove vertice with id: " << type)
+        renderView();
+        return true;
+    }
+
     // VTK re-orders the vertex IDs after removal!
     // we have to copy this behavior to track the associated QObject instances
-    const vtkIdType lastId = m_objectIdMap.size() - 1;
+    const vtkIdType lastId = m_vertexObjectIds.size() - 1;
     DEBUG("Type: " << type << " Last: " << lastId)
     if (type != lastId) {
-        qulonglong lastObjectId = m_objectIdMap.key(lastId);
+        const qulonglong lastObjectId = m_vertexObjectIds.at(lastId);
         Q_ASSERT(lastObjectId);
         m_objectIdMap[lastObjectId] = type;
+        m_vertexObjectIds[type] = lastObjectId;
     }
+    m_vertexObjectIds.removeLast();
 
     // Remove object from our map
-    if (size > m_graph->GetNumberOfVertices())
-        Q_ASSERT(m_objectIdMap.remove(objectId) == 1);
-    else
-        DEBUG("Warning: Should not happen: Could not remove vertice with id: " << type)
+    const int removed = m_objectIdMap.remove(objectId);
+    Q_ASSERT(removed == 1);
+    Q_UNUSED(removed);
 
     renderView();
     return true;
@@ -361,12 +533,18 @@ void VtkWidget::renderView()
 
 void VtkWidget::clear()
 {
-    // TODO: there must be an easier/faster way to clean the graph data
-    // Just re-create the vtk graph data object?
-    Q_FOREACH(const qulonglong &objectId, m_objectIdMap) {
-        removeObjectInternal(objectId);
+    if (m_graph->GetNumberOfVertices() > 0) {
+        VTK_CREATE(vtkIdTypeArray, vertices);
+        vertices->SetNumberOfTuples(m_graph->GetNumberOfVertices());
+        for (vtkIdType i = 0; i < vertices->GetNumberOfTuples(); ++i)
+            vertices->SetValue(i, i);
+        m_graph->RemoveVertices(vertices);
     }
     m_objectIdMap.clear();
+    m_vertexObjectIds.clear();
+    m_aggregates.clear();
+    m_foldedObjects.clear();
+    emit layoutCleared();
 
     renderView();
 }
@@ -376,11 +554,77 @@ void VtkWidget::renderViewImpl()
     DEBUG("")
 
     m_view->Render();
+    // with the incremental layout, only follow the layout until it settled after a repopulate,
+    // so we don't interfere with the user navigating the scene
+    if (!m_incrementalLayout || m_resetCameraPending)
+        m_view->ResetCamera();
+}
+
+void VtkWidget::updatePositions(const QVector<LayoutPosition> &positions)
+{
+    vtkPoints *points = m_graph->GetPoints();
+    foreach (const LayoutPosition &p, positions) {
+        const auto it = m_objectIdMap.constFind(p.id);
+        if (it == m_objectIdMap.constEnd())
+            continue; // removed in the meantime
+        points->SetPoint(it.value(), p.pos.x(), p.pos.y(), 0.0);
+    }
+    points->Modified();
+    m_graph->Modified();
+
+    if (m_incrementalLayout)
+        renderView();
+}
+
+void VtkWidget::layoutFinished()
+{
+    if (!m_resetCameraPending)
+        return;
     m_view->ResetCamera();
+    renderView();
+    m_resetCameraPending = false;
+    m_levelOfDetailTimer->start();
+}
+
+/// Fold deeper subtrees into aggregate nodes the further we are zoomed out
+void VtkWidget::updateLevelOfDetail()
+{
+    if (!m_incrementalLayout || height() <= 0)
+        return;
+
+    vtkCamera *camera = m_view->GetRenderer()->GetActiveCamera();
+    double visibleHeight;
+    if (camera->GetParallelProjection())
+        visibleHeight = 2.0 * camera->GetParallelScale();
+    else
+        visibleHeight = 2.0 * camera->GetDistance()
+                        * std::tan(vtkMath::RadiansFromDegrees(camera->GetViewAngle() / 2.0));
+    if (visibleHeight <= 0.0)
+        return;
+    const double edgePixels = height() * GraphLayouter::EdgeLength / visibleHeight;
+
+    int collapseDepth;
+    if (edgePixels >= 24.0)
+        collapseDepth = -1;
+    else if (edgePixels >= 12.0)
+        collapseDepth = 4;
+    else if (edgePixels >= 6.0)
+        collapseDepth = 2;
+    else if (edgePixels >= 3.0)
+        collapseDepth = 1;
+    else
+        collapseDepth = 0;
+
+    if (collapseDepth == m_collapseDepth)
+        return;
+    DEBUG("Collapse depth: " << collapseDepth)
+    m_collapseDepth = collapseDepth;
+    repopulate();
 }
 
 void VtkWidget::selectionChanged()
 {
+    m_resetCameraPending = true;
     repopulate();
     resetCamera();
 }
@@ -28,19 +28,26 @@
 #ifndef GAMMARAY_OBJECTVISUALIZER_VTKWIDGET_H
 #define GAMMARAY_OBJECTVISUALIZER_VTKWIDGET_H
 
+#include "graphlayouter.h"
+
 #include <QVTKWidget.h>
 
 #include <vtkSmartPointer.h>
 
+#include <QHash>
 #include <QMap>
+#include <QPair>
 #include <QSet>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QItemSelectionModel;
 class QModelIndex;
 class QAbstractItemModel;
 class QMouseEvent;
+class QThread;
 class QTimer;
+class QWheelEvent;
 QT_END_NAMESPACE
 
 class vtkGraphLayoutStrategy;
@@ -54,6 +61,12 @@ class VtkWidget : public QVTKWidget
     Q_OBJECT
 
 public:
+    /// How objects below the collapse depth are combined into aggregate nodes.
+    enum AggregationMode {
+        AggregateByType,
+        AggregateByParent
+    };
+
     explicit VtkWidget(QWidget *parent = nullptr);
     virtual ~VtkWidget();
 
@@ -65,6 +78,10 @@ public:
     void setModel(QAbstractItemModel *model);
     void setSelectionModel(QItemSelectionModel *selectionModel);
 
+    /** Use the incremental GraphLayouter rather than the layout strategy of the view. */
+    void setIncrementalLayout(bool incremental);
+    void setAggregationMode(AggregationMode mode);
+
 public Q_SLOTS:
     void resetCamera();
 
@@ -86,15 +103,32 @@ private Q_SLOTS:
     void objectRowsAboutToBeRemoved(const QModelIndex &parent, int start, int end);
     void objectDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
 
+    void updatePositions(const QVector<GammaRay::LayoutPosition> &positions);
+    void layoutFinished();
+    void updateLevelOfDetail();
+
+Q_SIGNALS:
+    void layoutNodeAdded(qulonglong id, qulonglong parentId, int weight);
+    void layoutNodeRemoved(qulonglong id);
+    void layoutNodeWeightChanged(qulonglong id, int weight);
+    void layoutCleared();
+
 protected:
     virtual void mousePressEvent(QMouseEvent *event);
     virtual void mouseReleaseEvent(QMouseEvent *event);
+    virtual void wheelEvent(QWheelEvent *event);
 
     bool filterAcceptsObject(const QModelIndex &index) const;
 
 private:
     void setupGraph();
     void setupRenderer();
+    vtkIdType addVertex(qulonglong id, const QString &label, int weight, const QString &className,
+                        qulonglong parentId);
+    int colorForType(const QString &className);
+    int visibleDepth(const QModelIndex &index) const;
+    void addToAggregate(const QModelIndex &index, qulonglong objectId, int depth);
+    void removeFromAggregate(qulonglong objectId);
 
     bool m_mousePressed;
     QTimer *m_updateTimer;
@@ -104,10 +138,33 @@ private:
 
     // TODO: Instead of tracking all available objects, make Probe::m_validObjects public?
     QMap<qulonglong, vtkIdType> m_objectIdMap;
+    /// reverse of m_objectIdMap, indexed by vertex id
+    QVector<qulonglong> m_vertexObjectIds;
 
     int m_colorIndex;
     QMap<QString, int> m_typeColorMap;
 
+    QThread *m_layoutThread;
+    bool m_incrementalLayout;
+    bool m_resetCameraPending;
+    QTimer *m_levelOfDetailTimer;
+
+    /// objects deeper than this below a visible root are folded into aggregate nodes, -1 for none
+    int m_collapseDepth;
+    AggregationMode m_aggregationMode;
+    /// collapsed ancestor object id, and class name for AggregateByType
+    typedef QPair<qulonglong, QString> AggregateKey;
+    struct Aggregate
+    {
+        qulonglong nodeId;
+        QString label;
+        int count;
+    };
+    QHash<AggregateKey, Aggregate> m_aggregates;
+    QHash<qulonglong, AggregateKey> m_foldedObjects;
+    /// stable ids of aggregate nodes, so the layouter can restore their positions
+    QHash<AggregateKey, qulonglong> m_aggregateIds;
+
     vtkSmartPointer<vtkVariantArray> m_vertexPropertyArr;
     vtkGraphLayoutView *m_view;
     vtkSmartPointer<vtkMutableDirectedGraph> m_graph;
@@ -31,6 +31,8 @@
 #include <core/propertycontroller.h>
 #include <core/util.h>
 
+#include <common/endpoint.h>
+
 #include <Qt3DRender/QAttribute>
 #include <Qt3DRender/QBuffer>
 #include <Qt3DRender/QBufferDataGenerator>
@@ -39,7 +41,9 @@
 
 #include <Qt3DCore/QEntity>
 
+#include <QCryptographicHash>
 #include <QDebug>
+#include <QTimer>
 
 using namespace GammaRay;
 
@@ -47,7 +51,15 @@ Qt3DGeometryExtension::Qt3DGeometryExtension(GammaRay::PropertyController *contr
     : Qt3DGeometryExtensionInterface(controller->objectBaseName() + ".qt3dGeometry", controller)
     , PropertyControllerExtension(controller->objectBaseName() + ".qt3dGeometry")
     , m_geometry(nullptr)
+    , m_transferTimer(new QTimer(this))
 {
+    m_transferTimer->setInterval(0);
+    connect(m_transferTimer, SIGNAL(timeout()), this, SLOT(sendNextChunk()));
+    connect(Endpoint::instance(), SIGNAL(sendBudgetAvailable()), m_transferTimer, SLOT(start()));
+    connect(Endpoint::instance(), SIGNAL(connectionRemoved(quint32)),
+            this, SLOT(connectionRemoved(quint32)));
+    Endpoint::instance()->setObjectPriority(Endpoint::instance()->objectAddress(objectName()),
+                                            Protocol::BulkPriority);
 }
 
 Qt3DGeometryExtension::~Qt3DGeometryExtension()
@@ -87,7 +99,10 @@ bool Qt3DGeometryExtension::setQObject(QObject *object)
 void Qt3DGeometryExtension::updateGeometryData()
 {
     Qt3DGeometryData data;
+    QHash<QByteArray, QPointer<Qt3DRender::QBuffer> > buffers;
     if (!m_geometry || !m_geometry->geometry()) {
+        m_buffers.clear();
+        m_pendingTransfers.clear();
         setGeometryData(data);
         return;
     }
@@ -114,11 +129,10 @@ void Qt3DGeometryExtension::updateGeometryData()
             Qt3DGeometryBufferData buffer;
             buffer.name = Util::displayString(attr->buffer());
             buffer.type = attr->buffer()->type();
-            auto generator = attr->buffer()->dataGenerator();
-            if (generator)
-                buffer.data = (*generator.data())();
-            else
-                buffer.data = attr->buffer()->data();
+            // the content itself is only transferred on request, and can then be shared
+            // by all geometries using the same data
+            buffer.key = bufferKey(attr->buffer());
+            buffers.insert(buffer.key, attr->buffer());
 
             attrData.bufferIndex = data.buffers.size();
             bufferMap.insert(attr->buffer(), attrData.bufferIndex);
@@ -127,5 +141,137 @@ void Qt3DGeometryExtension::updateGeometryData()
         data.attributes.push_back(attrData);
     }
 
+    m_buffers = buffers;
+    for (auto it = m_pendingTransfers.begin(); it != m_pendingTransfers.end();) {
+        if (m_buffers.contains((*it).key))
+            ++it;
+        else
+            it = m_pendingTransfers.erase(it);
+    }
     setGeometryData(data);
 }
+
+QByteArray Qt3DGeometryExtension::bufferKey(Qt3DRender::QBuffer *buffer)
+{
+    const auto it = m_bufferKeys.constFind(buffer);
+    if (it != m_bufferKeys.constEnd())
+        return it.value();
+
+    // hashed once per content version, so identical content is only transferred once,
+    // no matter how many buffers or geometries share it
+    const auto key = QCryptographicHash::hash(bufferContent(buffer), QCryptographicHash::Sha1);
+    m_bufferKeys.insert(buffer, key);
+    connect(buffer, SIGNAL(dataChanged(QByteArray)), this, SLOT(bufferChanged()), Qt::UniqueConnection);
+    connect(buffer, SIGNAL(dataGeneratorChanged(Qt3DRender::QBufferDataGeneratorPtr)), this,
+            SLOT(bufferChanged()), Qt::UniqueConnection);
+    connect(buffer, SIGNAL(destroyed(QObject*)), this, SLOT(bufferDestroyed(QObject*)), Qt::UniqueConnection);
+    return key;
+}
+
+QByteArray Qt3DGeometryExtension::bufferContent(Qt3DRender::QBuffer *buffer)
+{
+    auto generator = buffer->dataGenerator();
+    if (generator)
+        return (*generator.data())();
+    return buffer->data();
+}
+
+void Qt3DGeometryExtension::bufferChanged()
+{
+    // new content, new key, so the client fetches it again
+    auto buffer = qobject_cast<Qt3DRender::QBuffer *>(sender());
+    const auto oldKey = m_bufferKeys.take(buffer);
+    if (oldKey.isEmpty() || !m_buffers.contains(oldKey))
+        return; // not part of the current geometry, gets a new key once it is again
+    updateGeometryData();
+}
+
+void Qt3DGeometryExtension::bufferDestroyed(QObject *obj)
+{
+    // obj is already being destroyed, we only need its address
+    m_bufferKeys.remove(reinterpret_cast<Qt3DRender::QBuffer *>(obj));
+}
+
+bool Qt3DGeometryExtension::hasBufferData(const QByteArray &key) const
+{
+    return m_buffers.value(key);
+}
+
+QByteArray Qt3DGeometryExtension::bufferData(const QByteArray &key) const
+{
+    const auto buffer = m_buffers.value(key);
+    if (!buffer)
+        return QByteArray();
+    return bufferContent(buffer);
+}
+
+void Qt3DGeometryExtension::requestBufferData(const QByteArray &key)
+{
+    if (!m_buffers.value(key))
+        return;
+
+    // chunks only go to the client that asked, a repeated request starts over
+    const auto connectionId = Endpoint::currentConnectionId();
+    for (auto it = m_pendingTransfers.begin(); it != m_pendingTransfers.end(); ++it) {
+        if ((*it).key == key && (*it).connectionId == connectionId) {
+            (*it).offset = 0;
+            return;
+        }
+    }
+
+    PendingTransfer transfer;
+    transfer.key = key;
+    transfer.connectionId = connectionId;
+    m_pendingTransfers.push_back(transfer);
+    m_transferTimer->start();
+}
+
+void Qt3DGeometryExtension::connectionRemoved(quint32 connectionId)
+{
+    for (auto it = m_pendingTransfers.begin(); it != m_pendingTransfers.end();) {
+        if ((*it).connectionId == connectionId)
+            it = m_pendingTransfers.erase(it);
+        else
+            ++it;
+    }
+}
+
+void Qt3DGeometryExtension::sendNextChunk()
+{
+    // send large buffers in pieces, so we don't block the event loop of the target for too long
+    static const int ChunkSize = 1024 * 1024;
+
+    if (m_pendingTransfers.isEmpty() || Endpoint::sendBudget() <= 0) {
+        m_transferTimer->stop(); // restarted once the connection has caught up
+        return;
+    }
+
+    auto &transfer = m_pendingTransfers.first();
+    if (!transfer.started) {
+        const auto buffer = m_buffers.value(transfer.key);
+        if (!buffer) {
+            m_pendingTransfers.removeFirst();
+            return;
+        }
+        // share the content with transfers of the same buffer to other clients
+        foreach (const auto &other, m_pendingTransfers) {
+            if (other.started && other.key == transfer.key) {
+                transfer.data = other.data;
+                break;
+            }
+        }
+        if (transfer.data.isNull())
+            transfer.data = bufferContent(buffer);
+        transfer.started = true;
+    }
+
+    const auto chunk = transfer.data.mid(static_cast<int>(transfer.offset), ChunkSize);
+    {
+        Endpoint::ReplyGuard guard(transfer.connectionId);
+        emit bufferDataChunk(transfer.key, transfer.offset, transfer.data.size(), chunk);
+    }
+
+    transfer.offset += chunk.size();
+    if (transfer.offset >= (uint)transfer.data.size())
+        m_pendingTransfers.removeFirst();
+}
@@ -33,10 +33,16 @@
 
 #include <core/propertycontrollerextension.h>
 
+#include <QHash>
+#include <QPointer>
+#include <QVector>
+
 QT_BEGIN_NAMESPACE
 namespace Qt3DRender {
+class QBuffer;
 class QGeometryRenderer;
 }
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
@@ -51,10 +57,39 @@ public:
 
     bool setQObject(QObject *object) override;
 
+    bool hasBufferData(const QByteArray &key) const override;
+    QByteArray bufferData(const QByteArray &key) const override;
+
+public slots:
+    void requestBufferData(const QByteArray &key) override;
+
+private slots:
+    void sendNextChunk();
+    void bufferChanged();
+    void bufferDestroyed(QObject *obj);
+    void connectionRemoved(quint32 connectionId);
+
 private:
     void updateGeometryData();
+    QByteArray bufferKey(Qt3DRender::QBuffer *buffer);
+    static QByteArray bufferContent(Qt3DRender::QBuffer *buffer);
 
     Qt3DRender::QGeometryRenderer *m_geometry;
+    // buffers of the current geometry, by key
+    QHash<QByteArray, QPointer<Qt3DRender::QBuffer> > m_buffers;
+    // content hash of each buffer, until its content changes
+    QHash<Qt3DRender::QBuffer *, QByteArray> m_bufferKeys;
+    struct PendingTransfer {
+        PendingTransfer() : connectionId(0), offset(0), started(false) {}
+        QByteArray key;
+        // the client that requested the buffer
+        quint32 connectionId;
+        QByteArray data;
+        uint offset;
+        bool started;
+    };
+    QVector<PendingTransfer> m_pendingTransfers;
+    QTimer *m_transferTimer;
 };
 }
 
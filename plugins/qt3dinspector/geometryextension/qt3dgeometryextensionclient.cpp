@@ -28,9 +28,93 @@
 
 #include "qt3dgeometryextensionclient.h"
 
+#include <common/endpoint.h>
+
+#include <algorithm>
+
 using namespace GammaRay;
 
 Qt3DGeometryExtensionClient::Qt3DGeometryExtensionClient(const QString &name, QObject *parent)
     : Qt3DGeometryExtensionInterface(name, parent)
+    , m_bufferCache(256 * 1024) // 256 MB
+{
+    connect(this, SIGNAL(bufferDataChunk(QByteArray,uint,uint,QByteArray)),
+            this, SLOT(bufferChunkReceived(QByteArray,uint,uint,QByteArray)));
+    connect(this, SIGNAL(geometryDataChanged()), this, SLOT(discardStaleTransfers()));
+}
+
+bool Qt3DGeometryExtensionClient::hasBufferData(const QByteArray &key) const
+{
+    return m_bufferCache.contains(key);
+}
+
+QByteArray Qt3DGeometryExtensionClient::bufferData(const QByteArray &key) const
+{
+    if (auto data = m_bufferCache.object(key))
+        return *data;
+    return QByteArray();
+}
+
+void Qt3DGeometryExtensionClient::requestBufferData(const QByteArray &key)
+{
+    if (m_bufferCache.contains(key)) {
+        emit bufferDataAvailable(key);
+        return;
+    }
+    if (m_pendingBuffers.contains(key))
+        return;
+
+    m_pendingBuffers.insert(key, QByteArray());
+    Endpoint::instance()->invokeObject(objectName(), "requestBufferData", QVariantList() << key);
+}
+
+void Qt3DGeometryExtensionClient::bufferChunkReceived(const QByteArray &key, uint offset,
+                                                      uint totalSize, const QByteArray &chunk)
+{
+    auto it = m_pendingBuffers.find(key);
+    if (it == m_pendingBuffers.end())
+        return;
+    if (offset == 0) {
+        m_restartedBuffers.remove(key);
+        it.value().clear();
+        it.value().reserve(totalSize);
+    } else if (offset != (uint)it.value().size()) {
+        // we missed the beginning, ask the server to start over and ignore everything until then
+        it.value().clear();
+        if (!m_restartedBuffers.contains(key)) {
+            m_restartedBuffers.insert(key);
+            Endpoint::instance()->invokeObject(objectName(), "requestBufferData",
+                                               QVariantList() << key);
+        }
+        return;
+    }
+    it.value().append(chunk);
+    if ((uint)it.value().size() < totalSize)
+        return;
+
+    // make sure we can hold at least the currently needed buffer
+    const int cost = std::max<int>(1, totalSize / 1024);
+    if (cost > m_bufferCache.maxCost())
+        m_bufferCache.setMaxCost(cost);
+    m_bufferCache.insert(key, new QByteArray(it.value()), cost);
+    m_pendingBuffers.erase(it);
+    emit bufferDataAvailable(key);
+}
+
+void Qt3DGeometryExtensionClient::discardStaleTransfers()
 {
+    // the server aborts transfers of buffers no longer in use by the current geometry
+    const auto buffers = geometryData().buffers;
+    for (auto it = m_pendingBuffers.begin(); it != m_pendingBuffers.end();) {
+        const auto key = it.key();
+        const bool inUse = std::any_of(buffers.begin(), buffers.end(), [key](const Qt3DGeometryBufferData &buffer) {
+            return buffer.key == key;
+        });
+        if (inUse) {
+            ++it;
+        } else {
+            m_restartedBuffers.remove(key);
+            it = m_pendingBuffers.erase(it);
+        }
+    }
 }
@@ -31,6 +31,10 @@
 
 #include "qt3dgeometryextensioninterface.h"
 
+#include <QCache>
+#include <QHash>
+#include <QSet>
+
 namespace GammaRay {
 class Qt3DGeometryExtensionClient : public Qt3DGeometryExtensionInterface
 {
@@ -38,6 +42,24 @@ class Qt3DGeometryExtensionClient : public Qt3DGeometryExtensionInterface
     Q_INTERFACES(GammaRay::Qt3DGeometryExtensionInterface)
 public:
     explicit Qt3DGeometryExtensionClient(const QString &name, QObject *parent);
+
+    bool hasBufferData(const QByteArray &key) const override;
+    QByteArray bufferData(const QByteArray &key) const override;
+
+public slots:
+    void requestBufferData(const QByteArray &key) override;
+
+private slots:
+    void bufferChunkReceived(const QByteArray &key, uint offset, uint totalSize, const QByteArray &chunk);
+    void discardStaleTransfers();
+
+private:
+    // received buffers, by buffer key, cost is the size in kB
+    QCache<QByteArray, QByteArray> m_bufferCache;
+    // partially received buffers
+    QHash<QByteArray, QByteArray> m_pendingBuffers;
+    // pending buffers requested again after missing the start of their transfer
+    QSet<QByteArray> m_restartedBuffers;
 };
 }
 
@@ -84,13 +84,13 @@ bool Qt3DGeometryAttributeData::operator==(const Qt3DGeometryAttributeData &rhs)
 QT_BEGIN_NAMESPACE
 static QDataStream &operator<<(QDataStream &out, const Qt3DGeometryBufferData &data)
 {
-    out << data.name << data.data << data.type;
+    out << data.name << data.key << data.type;
     return out;
 }
 
 static QDataStream &operator>>(QDataStream &in, Qt3DGeometryBufferData &data)
 {
-    in >> data.name >> data.data >> data.type;
+    in >> data.name >> data.key >> data.type;
     return in;
 }
 QT_END_NAMESPACE
@@ -102,7 +102,7 @@ Qt3DGeometryBufferData::Qt3DGeometryBufferData()
 
 bool Qt3DGeometryBufferData::operator==(const Qt3DGeometryBufferData &rhs) const
 {
-    return name == rhs.name && data == rhs.data;
+    return name == rhs.name && key == rhs.key && type == rhs.type;
 }
 
 QT_BEGIN_NAMESPACE
@@ -55,6 +55,9 @@ struct Qt3DGeometryBufferData
     bool operator==(const Qt3DGeometryBufferData &rhs) const;
 
     QString name;
+    /// hash of the buffer content, shared by all buffers with the same content
+    QByteArray key;
+    /// not transferred, obtain this via Qt3DGeometryExtensionInterface::bufferData()
     QByteArray data;
     Qt3DRender::QBuffer::BufferType type;
 };
@@ -79,8 +82,20 @@ public:
     Qt3DGeometryData geometryData() const;
     void setGeometryData(const Qt3DGeometryData &data);
 
+    /** Returns @c true if the content of the buffer identified by @p key is locally available. */
+    virtual bool hasBufferData(const QByteArray &key) const = 0;
+    /** Returns the content of the buffer identified by @p key if it is locally available. */
+    virtual QByteArray bufferData(const QByteArray &key) const = 0;
+
+public slots:
+    /** Request the content of the buffer identified by @p key, bufferDataAvailable() is emitted once it arrived. */
+    virtual void requestBufferData(const QByteArray &key) = 0;
+
 signals:
     void geometryDataChanged();
+    void bufferDataAvailable(const QByteArray &key);
+    /** Transfers buffer content to the client, in pieces of limited size. */
+    void bufferDataChunk(const QByteArray &key, uint offset, uint totalSize, const QByteArray &chunk);
 
 private:
     Qt3DGeometryData m_data;
@@ -189,6 +189,8 @@ Qt3DGeometryTab::Qt3DGeometryTab(PropertyWidget *parent)
         parent->objectBaseName() + ".qt3dGeometry");
     connect(m_interface, &Qt3DGeometryExtensionInterface::geometryDataChanged, this,
             &Qt3DGeometryTab::updateGeometry);
+    connect(m_interface, &Qt3DGeometryExtensionInterface::bufferDataAvailable, this,
+            &Qt3DGeometryTab::bufferDataAvailable);
 }
 
 Qt3DGeometryTab::~Qt3DGeometryTab()
@@ -404,7 +406,19 @@ void Qt3DGeometryTab::updateGeometry()
     if (!m_geometryRenderer)
         return;
 
-    const auto geo = m_interface->geometryData();
+    auto geo = m_interface->geometryData();
+    // buffer content is fetched on demand, wait until we have all of it
+    bool complete = true;
+    for (auto &bufferData : geo.buffers) {
+        if (m_interface->hasBufferData(bufferData.key)) {
+            bufferData.data = m_interface->bufferData(bufferData.key);
+        } else {
+            m_interface->requestBufferData(bufferData.key);
+            complete = false;
+        }
+    }
+    if (!complete)
+        return;
     m_bufferModel->setGeometryData(geo);
 
     auto geometry = new Qt3DRender::QGeometry();
@@ -488,6 +502,16 @@ void Qt3DGeometryTab::updateGeometry()
     resetCamera();
 }
 
+void Qt3DGeometryTab::bufferDataAvailable(const QByteArray &key)
+{
+    foreach (const auto &buffer, m_interface->geometryData().buffers) {
+        if (buffer.key == key) {
+            updateGeometry();
+            return;
+        }
+    }
+}
+
 void Qt3DGeometryTab::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
@@ -79,6 +79,7 @@ private:
     Qt3DCore::QComponent *createMaterial(Qt3DCore::QNode *parent);
     Qt3DCore::QComponent *createSkyboxMaterial(Qt3DCore::QNode *parent);
     void updateGeometry();
+    void bufferDataAvailable(const QByteArray &key);
     void resetCamera();
     void computeBoundingVolume(const Qt3DGeometryAttributeData &vertexAttr,
                                const QByteArray &bufferData);
@@ -29,6 +29,7 @@
 #include "quickinspector.h"
 
 #include "quickanchorspropertyadaptor.h"
+#include "quickitemboundscache.h"
 #include "quickitemmodel.h"
 #include "quickscenegraphmodel.h"
 #include "quickscreengrabber.h"
@@ -69,6 +70,7 @@
 
 #include <3rdparty/kde/krecursivefilterproxymodel.h>
 
+#include <QGuiApplication>
 #include <QQuickItem>
 #include <QQuickWindow>
 #include <QQuickView>
@@ -363,6 +365,7 @@ QuickInspector::QuickInspector(Probe *probe, QObject *parent)
     , m_currentSgNode(nullptr)
     , m_itemModel(new QuickItemModel(this))
     , m_sgModel(new QuickSceneGraphModel(this))
+    , m_itemBounds(new QuickItemBoundsCache(this))
     , m_itemPropertyController(new PropertyController(QStringLiteral("com.kdab.GammaRay.QuickItem"),
                                                       this))
     , m_sgPropertyController(new PropertyController(QStringLiteral(
@@ -395,6 +398,7 @@ QuickInspector::QuickInspector(Probe *probe, QObject *parent)
 
     connect(probe, &Probe::objectCreated, m_itemModel, &QuickItemModel::objectAdded);
     connect(probe, &Probe::objectDestroyed, m_itemModel, &QuickItemModel::objectRemoved);
+    connect(probe, &Probe::objectDestroyed, m_itemBounds, &QuickItemBoundsCache::objectDestroyed);
     connect(probe, SIGNAL(objectSelected(QObject*,QPoint)), SLOT(objectSelected(QObject*)));
     connect(probe, SIGNAL(nonQObjectSelected(void*,QString)), SLOT(objectSelected(void*,QString)));
 
@@ -410,6 +414,25 @@ QuickInspector::QuickInspector(Probe *probe, QObject *parent)
     connect(m_sgSelectionModel, &QItemSelectionModel::selectionChanged,
             this, &QuickInspector::sgSelectionChanged);
     connect(m_sgModel, &QuickSceneGraphModel::nodeDeleted, this, &QuickInspector::sgNodeDeleted);
+    // the scene graph model is only populated while in use, so the current node might be gone,
+    // or it can be selected now that the model is populated again
+    connect(m_sgModel, &QAbstractItemModel::modelReset, this, [this]() {
+        auto sourceIdx = m_sgModel->indexForNode(m_currentSgNode);
+        if (!sourceIdx.isValid()) {
+            if (m_currentSgNode)
+                sgNodeDeleted(m_currentSgNode);
+            m_currentSgNode = m_sgModel->sgNodeForItem(m_currentItem);
+            sourceIdx = m_sgModel->indexForNode(m_currentSgNode);
+            if (!sourceIdx.isValid())
+                return;
+        }
+        auto proxy = qobject_cast<const QAbstractProxyModel *>(m_sgSelectionModel->model());
+        m_sgSelectionModel->select(proxy->mapFromSource(sourceIdx),
+                                   QItemSelectionModel::Select
+                                   |QItemSelectionModel::Clear
+                                   |QItemSelectionModel::Rows
+                                   |QItemSelectionModel::Current);
+    });
 
     connect(m_remoteView, &RemoteViewServer::elementsAtRequested, this, &QuickInspector::requestElementsAt);
     connect(this, &QuickInspector::elementsAtReceived, m_remoteView, &RemoteViewServer::elementsAtReceived);
@@ -468,6 +491,7 @@ void QuickInspector::selectWindow(QQuickWindow *window)
     m_window = window;
     m_itemModel->setWindow(window);
     m_sgModel->setWindow(window);
+    m_itemBounds->setWindow(window);
     m_remoteView->setEventReceiver(m_window);
     m_remoteView->resetView();
     recreateOverlay();
@@ -813,6 +837,7 @@ void QuickInspector::requestElementsAt(const QPoint &pos, GammaRay::RemoteViewIn
         return;
 
     int bestCandidate;
+    m_itemBounds->update();
     const ObjectIds objects = recursiveItemsAt(m_window->contentItem(), pos, mode, bestCandidate);
 
     if (!objects.isEmpty()) {
@@ -835,13 +860,16 @@ ObjectIds QuickInspector::recursiveItemsAt(QQuickItem *parent, const QPointF &po
 
     bestCandidate = -1;
 
-    auto childItems = parent->childItems();
-    std::stable_sort(childItems.begin(), childItems.end(),
-                     [](QQuickItem *lhs, QQuickItem *rhs){return lhs->z() < rhs->z();}
-    );
+    // already sorted by z and cached by QtQuick itself
+    const auto childItems = QQuickItemPrivate::get(parent)->paintOrderChildItems();
+    // only usable for the window the cache is tracking
+    const bool useBounds = parent->window() == m_window;
 
     for (int i = childItems.size() - 1; i >= 0; --i) { // backwards to match z order
         const auto child = childItems.at(i);
+        // check against the cached bounds in our coordinates first, mapping pos into the child isn't free
+        if (useBounds && !m_itemBounds->subTreeBoundsInParent(child).contains(pos))
+            continue; // neither child nor any of its descendants can contain pos
         const auto requestedPoint = parent->mapToItem(child, pos);
         if (!child->childItems().isEmpty() && (child->contains(requestedPoint) || child->childrenRect().contains(requestedPoint))) {
             const int count = objects.count();
@@ -880,41 +908,48 @@ ObjectIds QuickInspector::recursiveItemsAt(QQuickItem *parent, const QPointF &po
 }
 
 
-void QuickInspector::scanForProblems()
+static void scanItemForProblems(QQuickItem *item, QQuickItem *contentItem, QVector<QRectF> &clipRects)
 {
-    const QVector<QObject*> &allObjects = Probe::instance()->allQObjects();
+    const auto rect = item->mapRectToScene(QRectF(0, 0, item->width(), item->height()));
+
+    foreach (const auto &ancestorRect, clipRects) {
+        if (!ancestorRect.contains(rect) && !rect.intersects(ancestorRect)) {
+            Problem p;
+            p.severity = Problem::Info;
+            p.description = QStringLiteral("QtQuick: %1 %2 (0x%3) is visible, but out of view.").arg(
+                ObjectDataProvider::typeName(item),
+                ObjectDataProvider::name(item),
+                QString::number(reinterpret_cast<quintptr>(item), 16)
+            );
+            p.object = ObjectId(item);
+            p.locations.push_back(ObjectDataProvider::creationLocation(item));
+            p.problemId = QStringLiteral("com.kdab.GammaRay.QuickItemChecker.OutOfView:%1").arg(reinterpret_cast<quintptr>(item));
+            p.findingCategory = Problem::Scan;
+            ProblemCollector::addProblem(p);
+            break;
+        }
+    }
 
-    QMutexLocker lock(Probe::objectLock());
-    foreach (QObject *obj, allObjects) {
-        QQuickItem *item;
-        if (!Probe::instance()->isValidObject(obj) || !(item = qobject_cast<QQuickItem*>(obj)))
-            continue;
+    const bool clipsChildren = item != contentItem && (item->parentItem() == contentItem || item->clip());
+    if (clipsChildren)
+        clipRects.push_back(rect);
+    foreach (QQuickItem *child, item->childItems())
+        scanItemForProblems(child, contentItem, clipRects);
+    if (clipsChildren)
+        clipRects.pop_back();
+}
 
-        QQuickItem *ancestor = item->parentItem();
-        auto rect = item->mapRectToScene(QRectF(0, 0, item->width(), item->height()));
-
-        while (ancestor && item->window() && ancestor != item->window()->contentItem()) {
-            if (ancestor->parentItem() == item->window()->contentItem() || ancestor->clip()) {
-                auto ancestorRect = ancestor->mapRectToScene(QRectF(0, 0, ancestor->width(), ancestor->height()));
-
-                if (!ancestorRect.contains(rect) && !rect.intersects(ancestorRect)) {
-                    Problem p;
-                    p.severity = Problem::Info;
-                    p.description = QStringLiteral("QtQuick: %1 %2 (0x%3) is visible, but out of view.").arg(
-                        ObjectDataProvider::typeName(item),
-                        ObjectDataProvider::name(item),
-                        QString::number(reinterpret_cast<quintptr>(item), 16)
-                    );
-                    p.object = ObjectId(item);
-                    p.locations.push_back(ObjectDataProvider::creationLocation(item));
-                    p.problemId = QStringLiteral("com.kdab.GammaRay.QuickItemChecker.OutOfView:%1").arg(reinterpret_cast<quintptr>(item));
-                    p.findingCategory = Problem::Scan;
-                    ProblemCollector::addProblem(p);
-                    break;
-                }
-            }
-            ancestor = ancestor->parentItem();
-        }
+void QuickInspector::scanForProblems()
+{
+    // Walk the item trees top-down, so the scene rect of each clipping ancestor is computed
+    // only once, instead of iterating over all objects and walking up the ancestors of each.
+    // This also means we don't need to hold the object lock here.
+    QVector<QRectF> clipRects;
+    foreach (QWindow *w, QGuiApplication::allWindows()) {
+        QQuickWindow *window = qobject_cast<QQuickWindow*>(w);
+        if (!window || !window->contentItem() || Probe::instance()->filterObject(window))
+            continue;
+        scanItemForProblems(window->contentItem(), window->contentItem(), clipRects);
     }
 }
 
@@ -927,6 +962,8 @@ bool QuickInspector::eventFilter(QObject *receiver, QEvent *event)
             QQuickWindow *window = qobject_cast<QQuickWindow*>(receiver);
             if (window && window->contentItem()) {
                 int bestCandidate;
+                if (window == m_window)
+                    m_itemBounds->update();
                 const ObjectIds objects = recursiveItemsAt(window->contentItem(), mouseEv->pos(),
                                                            RemoteViewInterface::RequestBest, bestCandidate);
                 m_probe->selectObject(objects.value(bestCandidate == -1 ? 0 : bestCandidate).asQObject());
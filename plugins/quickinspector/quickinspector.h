@@ -58,6 +58,7 @@ class PropertyController;
 class AbstractScreenGrabber;
 class GrabbedFrame;
 struct QuickDecorationsSettings;
+class QuickItemBoundsCache;
 class QuickItemModel;
 class QuickSceneGraphModel;
 class RemoteViewServer;
@@ -164,6 +165,7 @@ private:
     QItemSelectionModel *m_itemSelectionModel;
     QuickSceneGraphModel *m_sgModel;
     QItemSelectionModel *m_sgSelectionModel;
+    QuickItemBoundsCache *m_itemBounds;
     PropertyController *m_itemPropertyController;
     PropertyController *m_sgPropertyController;
     RemoteViewServer *m_remoteView;
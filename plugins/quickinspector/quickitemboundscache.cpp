@@ -0,0 +1,144 @@
+/*
+  quickitemboundscache.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quickitemboundscache.h"
+
+#include <QMutexLocker>
+#include <QQuickItem>
+#include <QQuickWindow>
+
+#include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
+
+using namespace GammaRay;
+
+QuickItemBoundsCache::QuickItemBoundsCache(QObject *parent)
+    : QObject(parent)
+{
+}
+
+QuickItemBoundsCache::~QuickItemBoundsCache()
+{
+}
+
+void QuickItemBoundsCache::setWindow(QQuickWindow *window)
+{
+    if (m_window)
+        disconnect(m_window, &QQuickWindow::beforeSynchronizing, this, &QuickItemBoundsCache::collectDirtyItems);
+
+    m_window = window;
+    m_bounds.clear();
+    {
+        QMutexLocker lock(&m_dirtyItemsMutex);
+        m_dirtyItems.clear();
+    }
+
+    if (m_window) {
+        // the dirty item list is reset during synchronization, so grab it right before that
+        connect(m_window, &QQuickWindow::beforeSynchronizing, this, &QuickItemBoundsCache::collectDirtyItems,
+                Qt::DirectConnection);
+    }
+}
+
+QRectF QuickItemBoundsCache::subTreeBounds(QQuickItem *item)
+{
+    return bounds(item).local;
+}
+
+QRectF QuickItemBoundsCache::subTreeBoundsInParent(QQuickItem *item)
+{
+    return bounds(item).inParent;
+}
+
+const QuickItemBoundsCache::Bounds &QuickItemBoundsCache::bounds(QQuickItem *item)
+{
+    Q_ASSERT(item);
+    const auto it = m_bounds.constFind(item);
+    if (it != m_bounds.constEnd())
+        return it.value();
+
+    Bounds b;
+    b.local = QRectF(0, 0, item->width(), item->height());
+    foreach (QQuickItem *child, item->childItems())
+        b.local |= subTreeBoundsInParent(child);
+    b.inParent = item->parentItem() ? item->mapRectToItem(item->parentItem(), b.local) : b.local;
+    return m_bounds.insert(item, b).value();
+}
+
+void QuickItemBoundsCache::objectDestroyed(QObject *obj)
+{
+    // obj is already being destroyed, so we can't cast it safely, but we only need the address
+    m_bounds.remove(reinterpret_cast<QQuickItem *>(obj));
+}
+
+void QuickItemBoundsCache::collectDirtyItems()
+{
+    // called from the render thread while the GUI thread is blocked
+    if (!m_window)
+        return;
+
+    // nothing cached, nothing to invalidate
+    if (m_bounds.isEmpty())
+        return;
+
+    QMutexLocker lock(&m_dirtyItemsMutex);
+    QQuickItem *item = QQuickWindowPrivate::get(m_window)->dirtyItemList;
+    while (item) {
+        m_dirtyItems.push_back(item);
+        item = QQuickItemPrivate::get(item)->nextDirtyItem;
+    }
+}
+
+void QuickItemBoundsCache::update()
+{
+    QVector<QPointer<QQuickItem> > dirtyItems;
+    {
+        QMutexLocker lock(&m_dirtyItemsMutex);
+        dirtyItems.swap(m_dirtyItems);
+    }
+    if (m_bounds.isEmpty() || !m_window)
+        return;
+
+    foreach (const auto &item, dirtyItems) {
+        if (item)
+            invalidate(item);
+    }
+
+    // changes since the last synchronization
+    QQuickItem *item = QQuickWindowPrivate::get(m_window)->dirtyItemList;
+    while (item) {
+        invalidate(item);
+        item = QQuickItemPrivate::get(item)->nextDirtyItem;
+    }
+}
+
+void QuickItemBoundsCache::invalidate(QQuickItem *item)
+{
+    // any change of an item affects the bounds of all its ancestors
+    for (; item; item = item->parentItem())
+        m_bounds.remove(item);
+}
@@ -0,0 +1,92 @@
+/*
+  quickitemboundscache.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_QUICKINSPECTOR_QUICKITEMBOUNDSCACHE_H
+#define GAMMARAY_QUICKINSPECTOR_QUICKITEMBOUNDSCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QPointer>
+#include <QRectF>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QQuickItem;
+class QQuickWindow;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/**
+ * Lazily computed bounding rects of entire item sub-trees, used to skip
+ * sub-trees that cannot contain a given point when picking items.
+ * Entries are invalidated based on the dirty state QtQuick tracks for
+ * synchronizing the scene graph, so this also covers transform changes.
+ */
+class QuickItemBoundsCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QuickItemBoundsCache(QObject *parent = nullptr);
+    ~QuickItemBoundsCache();
+
+    void setWindow(QQuickWindow *window);
+
+    /** Drops cached bounds affected by item changes since the last call. */
+    void update();
+
+    /** Bounding rect of @p item and all its descendants, in the coordinates of @p item. */
+    QRectF subTreeBounds(QQuickItem *item);
+    /** Same as subTreeBounds(), but in the coordinates of the parent item of @p item. */
+    QRectF subTreeBoundsInParent(QQuickItem *item);
+
+public slots:
+    /** Drops the cached bounds of @p obj, connect this to Probe::objectDestroyed. */
+    void objectDestroyed(QObject *obj);
+
+private slots:
+    void collectDirtyItems();
+
+private:
+    struct Bounds
+    {
+        QRectF local;
+        QRectF inParent;
+    };
+    const Bounds &bounds(QQuickItem *item);
+    void invalidate(QQuickItem *item);
+
+    QPointer<QQuickWindow> m_window;
+    QHash<QQuickItem *, Bounds> m_bounds;
+
+    // items synchronized by the render thread since our last query, protected by m_dirtyItemsMutex
+    QVector<QPointer<QQuickItem> > m_dirtyItems;
+    QMutex m_dirtyItemsMutex;
+};
+}
+
+#endif // GAMMARAY_QUICKINSPECTOR_QUICKITEMBOUNDSCACHE_H
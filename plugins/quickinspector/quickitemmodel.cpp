@@ -39,26 +39,116 @@
 #include <QQmlEngine>
 #include <QQmlContext>
 #include <QEvent>
+#include <QMutexLocker>
+#include <QTimer>
+
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+#include <private/qquickitem_p.h>
+#include <private/qquickitemchangelistener_p.h>
+#endif
 
 #include <algorithm>
 
 using namespace GammaRay;
 
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+namespace GammaRay {
+/**
+ * Forwards item changes relevant for QuickItemModel.
+ * A single instance is registered with all items of the current scene.
+ */
+class QuickItemChangeListener : public QQuickItemChangeListener
+{
+public:
+    static const QQuickItemPrivate::ChangeTypes changeTypes;
+
+    explicit QuickItemChangeListener(QuickItemModel *model)
+        : m_model(model)
+    {
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    void itemGeometryChanged(QQuickItem *item, QQuickGeometryChange, const QRectF &) override
+#else
+    void itemGeometryChanged(QQuickItem *item, const QRectF &, const QRectF &) override
+#endif
+    {
+        m_model->itemUpdated(item);
+    }
+
+    void itemVisibilityChanged(QQuickItem *item) override
+    {
+        m_model->itemUpdated(item);
+    }
+
+    void itemOpacityChanged(QQuickItem *item) override
+    {
+        m_model->itemUpdated(item);
+    }
+
+    void itemParentChanged(QQuickItem *item, QQuickItem *) override
+    {
+        m_model->itemReparented(item);
+    }
+
+    void itemChildAdded(QQuickItem *, QQuickItem *child) override
+    {
+        // the child might still be in its ctor here, so defer adding it
+        m_model->queueItemAddition(child);
+    }
+
+private:
+    QuickItemModel *m_model;
+};
+
+const QQuickItemPrivate::ChangeTypes QuickItemChangeListener::changeTypes
+    = QQuickItemPrivate::Geometry | QQuickItemPrivate::Visibility | QQuickItemPrivate::Opacity
+      | QQuickItemPrivate::Parent | QQuickItemPrivate::Children;
+}
+#endif
+
 QuickItemModel::QuickItemModel(QObject *parent)
     : ObjectModelBase<QAbstractItemModel>(parent)
 {
     m_clickEventFilter = new QuickEventMonitor(this);
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    m_itemChangeListener.reset(new QuickItemChangeListener(this));
+
+    m_pendingItemsTimer = new QTimer(this);
+    m_pendingItemsTimer->setSingleShot(true);
+    m_pendingItemsTimer->setInterval(0);
+    connect(m_pendingItemsTimer, &QTimer::timeout, this, &QuickItemModel::addPendingItems);
+
+    // one global filter rather than one filter installed on each item
+    if (Probe::instance())
+        Probe::instance()->installGlobalEventFilter(m_clickEventFilter);
+#endif
 }
 
 QuickItemModel::~QuickItemModel()
 {
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    if (Probe::instance())
+        Probe::instance()->removeGlobalEventFilter(m_clickEventFilter);
+    // items would otherwise keep notifying our listener after we are gone
+    if (m_window)
+        clear();
+#endif
 }
 
 void QuickItemModel::setWindow(QQuickWindow *window)
 {
     beginResetModel();
     clear();
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    if (m_window)
+        disconnect(m_window, nullptr, this, nullptr);
+#endif
     m_window = window;
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    m_activeFocusItem = window->activeFocusItem();
+    connect(window, &QQuickWindow::activeFocusItemChanged, this, &QuickItemModel::activeFocusItemChanged);
+#endif
     populateFromItem(window->contentItem());
     endResetModel();
 }
@@ -113,8 +203,15 @@ QMap<int, QVariant> QuickItemModel::itemData(const QModelIndex &index) const
 
 void QuickItemModel::clear()
 {
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    for (auto it = m_childParentMap.constBegin(); it != m_childParentMap.constEnd(); ++it)
+        disconnectItem(it.key());
+    m_pendingItems.clear();
+    m_itemFlags.clear();
+#else
     for (auto it = m_childParentMap.constBegin(); it != m_childParentMap.constEnd(); ++it)
         disconnect(it.key(), nullptr, this, nullptr);
+#endif
     m_childParentMap.clear();
     m_parentChildMap.clear();
 }
@@ -145,6 +242,12 @@ void QuickItemModel::populateFromItem(QQuickItem *item)
 void QuickItemModel::connectItem(QQuickItem *item)
 {
     Q_ASSERT(item);
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    QQuickItemPrivate::get(item)->addItemChangeListener(m_itemChangeListener.get(), QuickItemChangeListener::changeTypes);
+    // QQuickItemChangeListener has no focus notification, and focus changes inside a focus
+    // scope without active focus don't show up as active focus item changes of the window
+    connect(item, &QQuickItem::focusChanged, this, [this, item]() { updateFocusFlags(item); });
+#else
     auto itemUpdatedFunc = [this, item]() { itemUpdated(item); };
     std::array<QMetaObject::Connection, 8> connections = {{
         connect(item, &QQuickItem::parentChanged, this, [this, item]() { itemReparented(item); }),
@@ -159,11 +262,16 @@ void QuickItemModel::connectItem(QQuickItem *item)
     m_itemConnections.emplace(std::make_pair(item, std::move(connections))); // cant construct in-place, fails to compile under MSVC2010 :(
 
     item->installEventFilter(m_clickEventFilter);
+#endif
 }
 
 void QuickItemModel::disconnectItem(QQuickItem *item)
 {
     Q_ASSERT(item);
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    QQuickItemPrivate::get(item)->removeItemChangeListener(m_itemChangeListener.get(), QuickItemChangeListener::changeTypes);
+    disconnect(item, &QQuickItem::focusChanged, this, nullptr);
+#else
     auto it = m_itemConnections.find(item);
     if (it != m_itemConnections.end()) {
         foreach (auto connection, it->second) {
@@ -172,6 +280,7 @@ void QuickItemModel::disconnectItem(QQuickItem *item)
         m_itemConnections.erase(it);
     }
     item->removeEventFilter(m_clickEventFilter);
+#endif
 }
 
 QModelIndex QuickItemModel::indexForItem(QQuickItem *item) const
@@ -196,8 +305,11 @@ void QuickItemModel::objectAdded(QObject *obj)
     if (!item)
         return;
 
+#if !defined(HAVE_PRIVATE_QT_HEADERS)
     // detect if item is added to scene later
+    // with change listeners this is covered by the itemChildAdded notification of the new parent
     connect(item, &QQuickItem::windowChanged, this, [this, item]() { itemWindowChanged(item); });
+#endif
 
     addItem(item);
 }
@@ -279,16 +391,78 @@ void QuickItemModel::doRemoveSubtree(QQuickItem *item, bool danglingPointer)
 {
     m_childParentMap.remove(item);
     m_parentChildMap.remove(item);
+    m_itemFlags.remove(item);
     if (!danglingPointer) {
-        foreach (QQuickItem *child, item->childItems())
+        foreach (QQuickItem *child, item->childItems()) {
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+            if (m_childParentMap.contains(child))
+                disconnectItem(child);
+#endif
             doRemoveSubtree(child, false);
+        }
+    }
+}
+
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+void QuickItemModel::queueItemAddition(QQuickItem *item)
+{
+    m_pendingItems.push_back(item);
+    m_pendingItemsTimer->start();
+}
+
+void QuickItemModel::addPendingItems()
+{
+    const auto pendingItems = m_pendingItems;
+    m_pendingItems.clear();
+
+    QVector<QQuickItem *> items;
+    foreach (const auto &item, pendingItems) {
+        if (item)
+            items.push_back(item);
+    }
+    // add the entire sub-trees, children are not reported individually
+    for (int i = 0; i < items.size(); ++i) {
+        QQuickItem *item = items.at(i);
+        if (Probe::instance()) {
+            QMutexLocker lock(Probe::objectLock());
+            if (!Probe::instance()->isValidObject(item))
+                continue; // not fully constructed yet, we'll get an objectAdded() call for this later
+        }
+        addItem(item);
+        foreach (QQuickItem *child, item->childItems())
+            items.push_back(child);
     }
 }
 
+void QuickItemModel::activeFocusItemChanged()
+{
+    // focus changes also affect the enclosing focus scopes
+    QVector<QQuickItem *> items;
+    for (auto item = m_activeFocusItem.data(); item; item = item->parentItem())
+        items.push_back(item);
+    m_activeFocusItem = m_window ? m_window->activeFocusItem() : nullptr;
+    for (auto item = m_activeFocusItem.data(); item; item = item->parentItem())
+        items.push_back(item);
+
+    foreach (QQuickItem *item, items)
+        updateFocusFlags(item);
+}
+
+void QuickItemModel::updateFocusFlags(QQuickItem *item)
+{
+    if (!m_childParentMap.contains(item))
+        return;
+    const int oldFlags = m_itemFlags.value(item);
+    updateItemFlags(item);
+    if (oldFlags != m_itemFlags.value(item))
+        updateItem(item, QuickItemModelRole::ItemFlags);
+}
+#endif
+
 void QuickItemModel::itemReparented(QQuickItem *item)
 {
     Q_ASSERT(item);
-    if (!item->parentItem()) { // Item was not deleted, but removed from the scene.
+    if (!item->parentItem() || item->window() != m_window) { // Item was not deleted, but removed from the scene.
         removeItem(item, false);
         return;
     }
@@ -428,7 +602,16 @@ bool QuickEventMonitor::eventFilter(QObject *obj, QEvent *event)
     // exclude some event types which occur far too often and thus cost us bandwidth
     const bool isFrequentEventType = event->type() == QEvent::HoverMove;
     if (!isUnsafeEventType && !isFrequentEventType) {
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+        // we are installed as a global event filter, so only look at items of our scene
+        if (obj->thread() != m_model->thread())
+            return false;
+        QQuickItem *item = qobject_cast<QQuickItem *>(obj);
+        if (item && m_model->m_childParentMap.contains(item))
+            m_model->updateItem(item, QuickItemModelRole::ItemEvent);
+#else
         m_model->updateItem(qobject_cast<QQuickItem *>(obj), QuickItemModelRole::ItemEvent);
+#endif
     }
 
     return false;
@@ -29,6 +29,8 @@
 #ifndef GAMMARAY_QUICKINSPECTOR_QUICKITEMMODEL_H
 #define GAMMARAY_QUICKINSPECTOR_QUICKITEMMODEL_H
 
+#include <config-gammaray.h>
+
 #include <core/objectmodelbase.h>
 
 #include <QHash>
@@ -36,18 +38,21 @@
 #include <QVector>
 
 #include <array>
+#include <memory>
 #include <unordered_map>
 
 QT_BEGIN_NAMESPACE
 class QSignalMapper;
 class QQuickItem;
 class QQuickWindow;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
 
 //forward
 class QuickEventMonitor;
+class QuickItemChangeListener;
 
 /** QQ2 item tree model. */
 class QuickItemModel : public ObjectModelBase<QAbstractItemModel>
@@ -77,6 +82,7 @@ private slots:
 
 private:
     friend class QuickEventMonitor;
+    friend class QuickItemChangeListener;
     void updateItem(QQuickItem *item, int role);
     void recursivelyUpdateItem(QQuickItem *item);
     void updateItemFlags(QQuickItem *item);
@@ -110,14 +116,35 @@ private:
      */
     void doRemoveSubtree(QQuickItem *item, bool danglingPointer = false);
 
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    /**
+     * Queue item @p item (and its sub-tree) for addition on the next event loop iteration.
+     * Used when we learn about a new child item while it might still be under construction.
+     */
+    void queueItemAddition(QQuickItem *item);
+    void addPendingItems();
+
+    /// Updates the focus flags of the previous and the new active focus item
+    void activeFocusItemChanged();
+    /// Re-evaluates the focus flags of @p item, and reports them if they changed
+    void updateFocusFlags(QQuickItem *item);
+#endif
+
     QPointer<QQuickWindow> m_window;
 
     QHash<QQuickItem *, QQuickItem *> m_childParentMap;
     QHash<QQuickItem *, QVector<QQuickItem *> > m_parentChildMap;
 
-    // TODO: Merge these two?
     QHash<QQuickItem *, int> m_itemFlags;
+#if defined(HAVE_PRIVATE_QT_HEADERS)
+    // one change listener registration per item, rather than eight signal connections
+    std::unique_ptr<QuickItemChangeListener> m_itemChangeListener;
+    QVector<QPointer<QQuickItem> > m_pendingItems;
+    QTimer *m_pendingItemsTimer;
+    QPointer<QQuickItem> m_activeFocusItem;
+#else
     std::unordered_map<QQuickItem *, std::array<QMetaObject::Connection, 8>> m_itemConnections;
+#endif
 
     QuickEventMonitor *m_clickEventFilter;
 };
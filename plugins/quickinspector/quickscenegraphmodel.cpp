@@ -29,9 +29,13 @@
 #include "quickscenegraphmodel.h"
 
 #include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
 #include "quickitemmodelroles.h"
 
+#include <common/modelevent.h>
+
 #include <QQuickWindow>
+#include <QMutexLocker>
 #include <QThread>
 #include <QSGNode>
 
@@ -44,6 +48,9 @@ using namespace GammaRay;
 QuickSceneGraphModel::QuickSceneGraphModel(QObject *parent)
     : ObjectModelBase<QAbstractItemModel>(parent)
     , m_rootNode(nullptr)
+    , m_incrementalUpdate(false)
+    , m_active(false)
+    , m_lookupTablesDirty(true)
 {
 }
 
@@ -55,18 +62,40 @@ void QuickSceneGraphModel::setWindow(QQuickWindow *window)
 {
     beginResetModel();
     clear();
-    if (m_window)
+    if (m_window) {
+        disconnect(m_window, SIGNAL(beforeSynchronizing()), this, SLOT(collectDirtyItems()));
         disconnect(m_window, SIGNAL(afterRendering()), this, SLOT(updateSGTree()));
+        disconnect(m_window, SIGNAL(afterRendering()), this, SLOT(invalidateLookupTables()));
+    }
     m_window = window;
-    m_rootNode = currentRootNode();
+    m_lookupTablesDirty = true;
+    // nobody is looking at us, so don't bother tracking the scene graph at all, item/node
+    // lookups are then served from tables built on demand instead
+    m_rootNode = m_active ? currentRootNode() : nullptr;
     if (m_window && m_rootNode) {
+        connect(m_window, SIGNAL(beforeSynchronizing()), this, SLOT(collectDirtyItems()),
+                Qt::DirectConnection);
         updateSGTree(false);
         connect(m_window, SIGNAL(afterRendering()), this, SLOT(updateSGTree()));
+    } else if (m_window) {
+        connect(m_window, SIGNAL(afterRendering()), this, SLOT(invalidateLookupTables()));
     }
 
     endResetModel();
 }
 
+void QuickSceneGraphModel::customEvent(QEvent *event)
+{
+    if (event->type() == ModelEvent::eventType()) {
+        const bool used = static_cast<ModelEvent *>(event)->used();
+        if (used != m_active) {
+            m_active = used;
+            setWindow(m_window);
+        }
+    }
+    ObjectModelBase<QAbstractItemModel>::customEvent(event);
+}
+
 void QuickSceneGraphModel::updateSGTree(bool emitSignals)
 {
     auto root = currentRootNode();
@@ -77,13 +106,59 @@ void QuickSceneGraphModel::updateSGTree(bool emitSignals)
         if (m_window && m_rootNode)
             updateSGTree(false);
         endResetModel();
-    } else {
+        return;
+    }
+
+    QVector<QPointer<QQuickItem> > dirtyItems;
+    {
+        QMutexLocker lock(&m_dirtyItemsMutex);
+        dirtyItems.swap(m_dirtyItems);
+    }
+
+    if (!emitSignals) { // full update
         m_childParentMap[m_rootNode] = nullptr;
         m_parentChildMap[nullptr].resize(1);
         m_parentChildMap[nullptr][0] = m_rootNode;
 
         populateFromNode(m_rootNode, emitSignals);
         collectItemNodes(m_window->contentItem());
+        removePrunedItemNodes();
+        return;
+    }
+
+    // incremental update: the node structure can only have changed below items the
+    // render thread synchronized since the last time we looked
+    foreach (const auto &item, dirtyItems) {
+        if (!item || item->window() != m_window)
+            continue;
+        updateItemNode(item);
+        if (QSGNode *itemNode = m_itemItemNodeMap.value(item))
+            m_dirtyItemNodes.insert(itemNode);
+    }
+
+    m_incrementalUpdate = true;
+    // copy, populateFromNode() might prune some of these
+    const auto dirtyItemNodes = m_dirtyItemNodes;
+    foreach (QSGNode *node, dirtyItemNodes) {
+        if (m_childParentMap.contains(node))
+            populateFromNode(node, emitSignals);
+    }
+    m_incrementalUpdate = false;
+    m_dirtyItemNodes.clear();
+    removePrunedItemNodes();
+}
+
+void QuickSceneGraphModel::collectDirtyItems()
+{
+    // called from the render thread while the GUI thread is blocked
+    if (!m_window)
+        return;
+
+    QMutexLocker lock(&m_dirtyItemsMutex);
+    QQuickItem *item = QQuickWindowPrivate::get(m_window)->dirtyItemList;
+    while (item) {
+        m_dirtyItems.push_back(item);
+        item = QQuickItemPrivate::get(item)->nextDirtyItem;
     }
 }
 
@@ -165,6 +240,11 @@ void QuickSceneGraphModel::clear()
 {
     m_childParentMap.clear();
     m_parentChildMap.clear();
+    m_itemItemNodeMap.clear();
+    m_itemNodeItemMap.clear();
+    m_prunedItemNodes.clear();
+    QMutexLocker lock(&m_dirtyItemsMutex);
+    m_dirtyItems.clear();
 }
 
 // indexForNode() is expensive, so only use it when really needed
@@ -230,7 +310,8 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
             ++i;
             ++j;
         } else { // already known node, no change
-            populateFromNode(*j, emitSignals);
+            if (needsUpdate(*j))
+                populateFromNode(*j, emitSignals);
             ++i;
             ++j;
         }
@@ -300,6 +381,14 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
 
 #undef GET_INDEX
 
+bool QuickSceneGraphModel::needsUpdate(QSGNode *node) const
+{
+    // the sub-tree of an item that wasn't synchronized is unchanged, any changes further
+    // down are covered by the corresponding child items being dirty themselves
+    return !m_incrementalUpdate || !m_itemNodeItemMap.contains(node)
+           || m_dirtyItemNodes.contains(node);
+}
+
 void QuickSceneGraphModel::collectItemNodes(QQuickItem *item)
 {
     if (!item)
@@ -317,6 +406,24 @@ void QuickSceneGraphModel::collectItemNodes(QQuickItem *item)
         collectItemNodes(child);
 }
 
+void QuickSceneGraphModel::updateItemNode(QQuickItem *item)
+{
+    QSGNode *oldItemNode = m_itemItemNodeMap.value(item);
+    // Explicitly avoid calling priv->itemNode() here, see above.
+    QSGNode *itemNode = QQuickItemPrivate::get(item)->itemNodeInstance;
+    if (oldItemNode == itemNode)
+        return;
+
+    if (oldItemNode && m_itemNodeItemMap.value(oldItemNode) == item)
+        m_itemNodeItemMap.remove(oldItemNode);
+    if (itemNode) {
+        m_itemItemNodeMap.insert(item, itemNode);
+        m_itemNodeItemMap.insert(itemNode, item);
+    } else {
+        m_itemItemNodeMap.remove(item);
+    }
+}
+
 QModelIndex QuickSceneGraphModel::indexForNode(QSGNode *node) const
 {
     if (!node)
@@ -333,18 +440,20 @@ QModelIndex QuickSceneGraphModel::indexForNode(QSGNode *node) const
     return createIndex(row, 0, node);
 }
 
-QSGNode *QuickSceneGraphModel::sgNodeForItem(QQuickItem *item) const
+QSGNode *QuickSceneGraphModel::sgNodeForItem(QQuickItem *item)
 {
-    return m_itemItemNodeMap[item];
+    updateLookupTables();
+    return m_itemItemNodeMap.value(item);
 }
 
-QQuickItem *QuickSceneGraphModel::itemForSgNode(QSGNode *node) const
+QQuickItem *QuickSceneGraphModel::itemForSgNode(QSGNode *node)
 {
+    updateLookupTables();
     while (node && !m_itemNodeItemMap.contains(node)) {
         // If there's no entry for node, take its parent
-        node = m_childParentMap[node];
+        node = m_childParentMap.value(node);
     }
-    return m_itemNodeItemMap[node];
+    return m_itemNodeItemMap.value(node);
 }
 
 bool QuickSceneGraphModel::verifyNodeValidity(QSGNode *node)
@@ -378,4 +487,48 @@ void QuickSceneGraphModel::pruneSubTree(QSGNode *node)
         pruneSubTree(child);
     m_parentChildMap.remove(node);
     m_childParentMap.remove(node);
+    m_dirtyItemNodes.remove(node);
+    // the node might just be moving elsewhere, so only drop the item mapping once we are done
+    if (m_itemNodeItemMap.contains(node))
+        m_prunedItemNodes.push_back(node);
+}
+
+void QuickSceneGraphModel::invalidateLookupTables()
+{
+    m_lookupTablesDirty = true;
+}
+
+void QuickSceneGraphModel::updateLookupTables()
+{
+    if (m_rootNode || !m_lookupTablesDirty)
+        return;
+    m_lookupTablesDirty = false;
+
+    // m_parentChildMap stays empty, so the model itself remains empty while inactive,
+    // we only fill the maps needed for looking up items and nodes
+    clear();
+    if (!m_window)
+        return;
+    collectNodeParents(currentRootNode());
+    collectItemNodes(m_window->contentItem());
+}
+
+void QuickSceneGraphModel::collectNodeParents(QSGNode *node)
+{
+    for (QSGNode *child = node->firstChild(); child; child = child->nextSibling()) {
+        m_childParentMap.insert(child, node);
+        collectNodeParents(child);
+    }
+}
+
+void QuickSceneGraphModel::removePrunedItemNodes()
+{
+    foreach (QSGNode *node, m_prunedItemNodes) {
+        if (m_childParentMap.contains(node))
+            continue;
+        QQuickItem *item = m_itemNodeItemMap.take(node);
+        if (item && m_itemItemNodeMap.value(item) == node)
+            m_itemItemNodeMap.remove(item);
+    }
+    m_prunedItemNodes.clear();
 }
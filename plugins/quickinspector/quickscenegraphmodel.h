@@ -34,7 +34,9 @@
 #include "core/objectmodelbase.h"
 
 #include <QHash>
+#include <QMutex>
 #include <QPointer>
+#include <QSet>
 #include <QVector>
 
 QT_BEGIN_NAMESPACE
@@ -59,23 +61,35 @@ public:
     QModelIndex parent(const QModelIndex &child) const override;
     QModelIndex index(int row, int column, const QModelIndex &parent) const override;
     QModelIndex indexForNode(QSGNode *node) const;
-    QSGNode *sgNodeForItem(QQuickItem *item) const;
-    QQuickItem *itemForSgNode(QSGNode *node) const;
+    QSGNode *sgNodeForItem(QQuickItem *item);
+    QQuickItem *itemForSgNode(QSGNode *node);
     bool verifyNodeValidity(QSGNode *node);
 
 signals:
     void nodeDeleted(QSGNode *node);
 
+protected:
+    void customEvent(QEvent *event) override;
+
 private slots:
     void updateSGTree(bool emitSignals = true);
+    void collectDirtyItems();
+    void invalidateLookupTables();
 
 private:
     void clear();
     QSGNode *currentRootNode() const;
     void populateFromNode(QSGNode *node, bool emitSignals);
+    /// Returns @c true if the sub-tree of @p node might have changed since the last update
+    bool needsUpdate(QSGNode *node) const;
     void collectItemNodes(QQuickItem *item);
+    void updateItemNode(QQuickItem *item);
     bool recursivelyFindChild(QSGNode *root, QSGNode *child) const;
     void pruneSubTree(QSGNode *node);
+    void removePrunedItemNodes();
+    /// Rebuilds the item/node lookup tables on demand while we don't track the scene graph
+    void updateLookupTables();
+    void collectNodeParents(QSGNode *node);
 
     QPointer<QQuickWindow> m_window;
 
@@ -84,6 +98,16 @@ private:
     QHash<QSGNode *, QVector<QSGNode *> > m_parentChildMap;
     QHash<QQuickItem *, QSGNode *> m_itemItemNodeMap;
     QHash<QSGNode *, QQuickItem *> m_itemNodeItemMap;
+
+    // items synced by the render thread since our last update, protected by m_dirtyItemsMutex
+    QVector<QPointer<QQuickItem> > m_dirtyItems;
+    QMutex m_dirtyItemsMutex;
+    // item nodes of dirty items during an incremental update, empty otherwise
+    QSet<QSGNode *> m_dirtyItemNodes;
+    QVector<QSGNode *> m_prunedItemNodes;
+    bool m_incrementalUpdate;
+    bool m_active;
+    bool m_lookupTablesDirty;
 };
 }
 
@@ -33,6 +33,7 @@
 
 #include <core/remote/serverproxymodel.h>
 
+#include <common/endpoint.h>
 #include <common/objectbroker.h>
 #include <common/objectid.h>
 
@@ -68,6 +69,9 @@ SignalMonitor::~SignalMonitor()
 
 void SignalMonitor::timeout()
 {
+    // the client interpolates anyway, so skip updates rather than adding to a congested connection
+    if (Endpoint::sendBudget() <= 0)
+        return;
     emit clock(RelativeClock::sinceAppStart()->mSecs());
 }
 
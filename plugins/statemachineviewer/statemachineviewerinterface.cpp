@@ -38,6 +38,8 @@ StateMachineViewerInterface::StateMachineViewerInterface(QObject *parent)
     qRegisterMetaTypeStreamOperators<TransitionId>();
     qRegisterMetaType<StateMachineConfiguration>();
     qRegisterMetaTypeStreamOperators<StateMachineConfiguration>();
+    qRegisterMetaType<TransitionCounts>();
+    qRegisterMetaTypeStreamOperators<TransitionCounts>();
     qRegisterMetaType<StateType>();
     qRegisterMetaTypeStreamOperators<StateType>();
     ObjectBroker::registerObject<StateMachineViewerInterface *>(this);
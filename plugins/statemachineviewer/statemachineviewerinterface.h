@@ -108,6 +108,31 @@ inline QDataStream &operator>>(QDataStream &in, StateType &value)
 
 typedef QVector<StateId> StateMachineConfiguration;
 
+/** How often a transition has been triggered since the state machine was selected. */
+struct TransitionCount
+{
+    TransitionCount()
+        : count(0)
+    {}
+
+    TransitionId transition;
+    quint32 count;
+};
+
+inline QDataStream &operator<<(QDataStream &out, const TransitionCount &value)
+{
+    out << value.transition << value.count;
+    return out;
+}
+
+inline QDataStream &operator>>(QDataStream &in, TransitionCount &value)
+{
+    in >> value.transition >> value.count;
+    return in;
+}
+
+typedef QVector<TransitionCount> TransitionCounts;
+
 class StateMachineViewerInterface : public QObject
 {
     Q_OBJECT
@@ -129,6 +154,8 @@ signals:
     void stateConfigurationChanged(const GammaRay::StateMachineConfiguration &config);
     void maximumDepthChanged(int depth);
     void transitionTriggered(GammaRay::TransitionId transition, const QString &label);
+    /// Trigger counts of all transitions that changed since the last emission.
+    void transitionCountsChanged(const GammaRay::TransitionCounts &counts);
     void stateAdded(GammaRay::StateId state, GammaRay::StateId parent, bool hasChildren,
                     const QString &label, GammaRay::StateType type, bool connectToInitial);
     void stateEntered(GammaRay::StateId state);
@@ -144,6 +171,7 @@ QT_BEGIN_NAMESPACE
 QT_END_NAMESPACE
 Q_DECLARE_METATYPE(GammaRay::TransitionId)
 Q_DECLARE_METATYPE(GammaRay::StateMachineConfiguration)
+Q_DECLARE_METATYPE(GammaRay::TransitionCounts)
 Q_DECLARE_METATYPE(GammaRay::StateType)
 QT_BEGIN_NAMESPACE
 Q_DECLARE_INTERFACE(GammaRay::StateMachineViewerInterface, "com.kdab.GammaRay.StateMachineViewer")
@@ -43,6 +43,8 @@
 
 #include <QStateMachine>
 #include <QItemSelectionModel>
+#include <QStringList>
+#include <QTimer>
 
 #ifdef HAVE_QT_SCXML
 #include <QScxmlStateMachine>
@@ -59,7 +61,16 @@ StateMachineViewerServer::StateMachineViewerServer(Probe *probe, QObject *parent
     : StateMachineViewerInterface(parent)
     , m_stateModel(new StateModel(this))
     , m_transitionModel(new TransitionModel(this))
+    , m_updateTimer(new QTimer(this))
+    , m_pendingLogEntries(0)
+    , m_skippedLogEntries(0)
+    , m_hasLastTransition(false)
 {
+    m_transitionLog.resize(TransitionLogSize);
+    m_updateTimer->setSingleShot(true);
+    m_updateTimer->setInterval(StateMachineUpdateInterval);
+    connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(sendUpdates()));
+
     auto proxyModel = new ServerProxyModel<QIdentityProxyModel>(this);
     proxyModel->setSourceModel(m_stateModel);
     proxyModel->addRole(StateModel::StateIdRole);
@@ -102,6 +113,21 @@ void StateMachineViewerServer::repopulateGraph()
     m_recursionGuard.clear();
 
     emit graphRepopulated();
+
+    // bring the client up to date with what happened so far
+    if (!m_transitionCounts.isEmpty()) {
+        TransitionCounts counts;
+        counts.reserve(m_transitionCounts.size());
+        for (auto it = m_transitionCounts.constBegin(); it != m_transitionCounts.constEnd(); ++it) {
+            TransitionCount count;
+            count.transition = TransitionId(it.key());
+            count.count = it.value();
+            counts.push_back(count);
+        }
+        m_changedTransitionCounts.clear();
+        emit transitionCountsChanged(counts);
+    }
+    sendTransitionLog(m_transitionLog.size());
 }
 
 StateMachineDebugInterface *StateMachineViewerServer::selectedStateMachine() const
@@ -155,6 +181,7 @@ void StateMachineViewerServer::setSelectedStateMachine(StateMachineDebugInterfac
     }
 
     m_stateModel->setStateMachine(machine);
+    clearUpdates();
 
     setFilteredStates(QVector<State>());
 
@@ -227,19 +254,116 @@ void StateMachineViewerServer::stateSelectionChanged()
 
 void StateMachineViewerServer::handleTransitionTriggered(Transition transition)
 {
-    emit transitionTriggered(TransitionId(transition), selectedStateMachine()->transitionLabel(transition));
+    m_lastTransition = transition;
+    m_hasLastTransition = true;
+    ++m_transitionCounts[transition];
+    m_changedTransitionCounts.insert(transition);
+    logEvent(tr("Transition triggered: %1").arg(cachedTransitionLabel(transition)));
+    scheduleUpdate();
 }
 
 void StateMachineViewerServer::stateEntered(State state)
 {
-    emit message(tr("State entered: %1").arg(selectedStateMachine()->stateLabel(state)));
-    stateConfigurationChanged();
+    logEvent(tr("State entered: %1").arg(cachedStateLabel(state)));
+    scheduleUpdate();
 }
 
 void StateMachineViewerServer::stateExited(State state)
 {
-    emit message(tr("State exited: %1").arg(selectedStateMachine()->stateLabel(state)));
+    logEvent(tr("State exited: %1").arg(cachedStateLabel(state)));
+    scheduleUpdate();
+}
+
+QString StateMachineViewerServer::cachedStateLabel(State state)
+{
+    auto it = m_stateLabelCache.constFind(state);
+    if (it == m_stateLabelCache.constEnd())
+        it = m_stateLabelCache.insert(state, selectedStateMachine()->stateLabel(state));
+    return it.value();
+}
+
+QString StateMachineViewerServer::cachedTransitionLabel(Transition transition)
+{
+    auto it = m_transitionLabelCache.constFind(transition);
+    if (it == m_transitionLabelCache.constEnd())
+        it = m_transitionLabelCache.insert(transition,
+                                           selectedStateMachine()->transitionLabel(transition));
+    return it.value();
+}
+
+void StateMachineViewerServer::logEvent(const QString &message)
+{
+    m_transitionLog.enqueue(message);
+    if (m_pendingLogEntries < MaximumLogEntriesPerUpdate)
+        ++m_pendingLogEntries;
+    else
+        ++m_skippedLogEntries;
+}
+
+void StateMachineViewerServer::sendTransitionLog(int count)
+{
+    if (count <= 0)
+        return;
+
+    QStringList lines;
+    if (m_skippedLogEntries > 0)
+        lines.push_back(tr("(%n event(s) skipped)", "", m_skippedLogEntries));
+    const QList<QString> entries = m_transitionLog.entries();
+    for (int i = qMax(0, entries.size() - count); i < entries.size(); ++i)
+        lines.push_back(entries.at(i));
+    m_pendingLogEntries = 0;
+    m_skippedLogEntries = 0;
+
+    emit message(lines.join(QStringLiteral("\n")));
+}
+
+void StateMachineViewerServer::scheduleUpdate()
+{
+    if (!m_updateTimer->isActive())
+        m_updateTimer->start();
+}
+
+/// Sends the coalesced changes of the last update interval.
+void StateMachineViewerServer::sendUpdates()
+{
+    if (!selectedStateMachine())
+        return;
+
     stateConfigurationChanged();
+
+    if (m_hasLastTransition) {
+        emit transitionTriggered(TransitionId(m_lastTransition),
+                                 cachedTransitionLabel(m_lastTransition));
+        m_hasLastTransition = false;
+    }
+
+    if (!m_changedTransitionCounts.isEmpty()) {
+        TransitionCounts counts;
+        counts.reserve(m_changedTransitionCounts.size());
+        foreach (quintptr transition, m_changedTransitionCounts) {
+            TransitionCount count;
+            count.transition = TransitionId(transition);
+            count.count = m_transitionCounts.value(transition);
+            counts.push_back(count);
+        }
+        m_changedTransitionCounts.clear();
+        emit transitionCountsChanged(counts);
+    }
+
+    sendTransitionLog(m_pendingLogEntries);
+}
+
+void StateMachineViewerServer::clearUpdates()
+{
+    m_updateTimer->stop();
+    m_transitionLog.clear();
+    m_pendingLogEntries = 0;
+    m_skippedLogEntries = 0;
+    m_hasLastTransition = false;
+    m_transitionCounts.clear();
+    m_changedTransitionCounts.clear();
+    m_stateLabelCache.clear();
+    m_transitionLabelCache.clear();
 }
 
 void StateMachineViewerServer::stateConfigurationChanged()
@@ -47,6 +47,7 @@ class QAbstractItemModel;
 class QAbstractProxyModel;
 class QItemSelectionModel;
 class QModelIndex;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
@@ -72,6 +73,7 @@ private slots:
     void stateExited(State state);
     void stateConfigurationChanged();
     void handleTransitionTriggered(Transition transition);
+    void sendUpdates();
 
     void stateSelectionChanged();
 
@@ -91,7 +93,20 @@ private slots:
     void objectSelected(QObject *obj);
 
 private:
+    enum {
+        /// Number of state machine events kept in the transition log
+        TransitionLogSize = 256,
+        /// Number of log entries sent per update, busy machines easily produce thousands per second
+        MaximumLogEntriesPerUpdate = 32
+    };
+
     bool mayAddState(State state);
+    void logEvent(const QString &message);
+    void sendTransitionLog(int count);
+    void scheduleUpdate();
+    void clearUpdates();
+    QString cachedStateLabel(State state);
+    QString cachedTransitionLabel(Transition transition);
 
     QAbstractProxyModel *m_stateMachinesModel;
     StateModel *m_stateModel;
@@ -103,6 +118,19 @@ private:
 
     QVector<State> m_recursionGuard;
     QVector<State> m_lastStateConfig;
+
+    // state machine events are collected here and sent in batches by sendUpdates()
+    QTimer *m_updateTimer;
+    RingBuffer<QString> m_transitionLog;
+    int m_pendingLogEntries;
+    int m_skippedLogEntries;
+    Transition m_lastTransition;
+    // SCXML states and transitions are indexes, so 0 is valid and they overlap each other
+    bool m_hasLastTransition;
+    QHash<quintptr, quint32> m_transitionCounts;
+    QSet<quintptr> m_changedTransitionCounts;
+    QHash<quintptr, QString> m_stateLabelCache;
+    QHash<quintptr, QString> m_transitionLabelCache;
 };
 
 class StateMachineViewerFactory : public QObject,
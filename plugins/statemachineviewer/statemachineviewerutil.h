@@ -29,6 +29,11 @@
 
 #include <QQueue>
 
+namespace GammaRay {
+/// Interval in ms in which state machine changes are coalesced, roughly one frame
+static const int StateMachineUpdateInterval = 16;
+}
+
 template<class T>
 class RingBuffer
 {
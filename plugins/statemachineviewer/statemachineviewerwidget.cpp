@@ -221,6 +221,8 @@ StateMachineViewerWidget::StateMachineViewerWidget(QWidget *parent, Qt::WindowFl
     connect(m_interface, SIGNAL(statusChanged(bool,bool)), this, SLOT(statusChanged(bool,bool)));
     connect(m_interface, SIGNAL(transitionTriggered(GammaRay::TransitionId,QString)),
             this, SLOT(transitionTriggered(GammaRay::TransitionId,QString)));
+    connect(m_interface, SIGNAL(transitionCountsChanged(GammaRay::TransitionCounts)),
+            this, SLOT(transitionCountsChanged(GammaRay::TransitionCounts)));
 
     connect(m_interface, SIGNAL(aboutToRepopulateGraph()), this, SLOT(clearGraph()));
     connect(m_interface, SIGNAL(graphRepopulated()), this, SLOT(repopulateView()));
@@ -391,6 +393,7 @@ void StateMachineViewerWidget::transitionAdded(const TransitionId transitionId,
     transition->setLabel(label);
     transition->setFlags(KDSME::Element::ElementIsSelectable);
     m_idToTransitionMap[transitionId] = transition;
+    m_transitionLabels[transitionId] = label;
 }
 
 void StateMachineViewerWidget::statusChanged(const bool haveStateMachine, const bool running)
@@ -415,6 +418,19 @@ void StateMachineViewerWidget::transitionTriggered(TransitionId transitionId, co
         m_machine->runtimeController()->setLastTransition(m_idToTransitionMap.value(transitionId));
 }
 
+void StateMachineViewerWidget::transitionCountsChanged(const TransitionCounts &counts)
+{
+    // the server only sends aggregated counts, show them as part of the transition labels
+    foreach (const TransitionCount &count, counts) {
+        KDSME::Transition *transition = m_idToTransitionMap.value(count.transition);
+        if (!transition)
+            continue;
+        const QString label = m_transitionLabels.value(count.transition);
+        transition->setLabel(label.isEmpty() ? tr("[%1]").arg(count.count)
+                                             : tr("%1 [%2]").arg(label).arg(count.count));
+    }
+}
+
 void StateMachineViewerWidget::clearGraph()
 {
     IF_DEBUG(qDebug() << Q_FUNC_INFO);
@@ -423,6 +439,7 @@ void StateMachineViewerWidget::clearGraph()
 
     m_idToStateMap.clear();
     m_idToTransitionMap.clear();
+    m_transitionLabels.clear();
 }
 
 void StateMachineViewerWidget::repopulateView()
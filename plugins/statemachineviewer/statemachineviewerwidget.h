@@ -72,6 +72,7 @@ private slots:
                          const GammaRay::StateId targetId, const QString &label);
     void statusChanged(const bool haveStateMachine, const bool running);
     void transitionTriggered(GammaRay::TransitionId transitionId, const QString &label);
+    void transitionCountsChanged(const GammaRay::TransitionCounts &counts);
     void stateModelReset();
 
     void repopulateView();
@@ -99,6 +100,7 @@ private:
 
     QHash<StateId, KDSME::State *> m_idToStateMap;
     QHash<TransitionId, KDSME::Transition *> m_idToTransitionMap;
+    QHash<TransitionId, QString> m_transitionLabels;
     KDSME::StateMachine *m_machine;
     bool m_showLog;
 };
@@ -27,6 +27,7 @@
 */
 #include "statemodel.h"
 #include "statemachinedebuginterface.h"
+#include "statemachineviewerutil.h"
 #include "statemachinewatcher.h"
 
 #include <core/objectmodelbase.h>
@@ -36,6 +37,7 @@
 #include <QDebug>
 #include <QStateMachine>
 #include <QStringList>
+#include <QTimer>
 
 #include <algorithm>
 
@@ -49,6 +51,7 @@ class StateModelPrivate
     explicit StateModelPrivate(StateModel *qq)
         : q_ptr(qq)
         , m_stateMachine(nullptr)
+        , m_updateTimer(nullptr)
     {
     }
 
@@ -65,6 +68,8 @@ class StateModelPrivate
     StateModel * const q_ptr;
     StateMachineDebugInterface *m_stateMachine;
     QVector<State> m_lastConfiguration;
+    /// coalesces configuration updates, busy machines change it far more often than we can display
+    QTimer *m_updateTimer;
 
     QVector<State> children(State parent) const;
 
@@ -73,6 +78,7 @@ class StateModelPrivate
 
 // private slots:
     void stateConfigurationChanged();
+    void updateConfiguration();
     void handleMachineDestroyed(QObject *);
 };
 }
@@ -115,6 +121,15 @@ QModelIndex StateModelPrivate::indexForState(State state) const
 
 void StateModelPrivate::stateConfigurationChanged()
 {
+    if (!m_updateTimer->isActive())
+        m_updateTimer->start();
+}
+
+void StateModelPrivate::updateConfiguration()
+{
+    if (!m_stateMachine)
+        return;
+
     QVector<State> newConfig = m_stateMachine->configuration();
     // states which became active
     QVector<State> difference;
@@ -139,6 +154,7 @@ void StateModelPrivate::handleMachineDestroyed(QObject *)
 
     q->beginResetModel();
     m_stateMachine = nullptr;
+    m_updateTimer->stop();
     q->endResetModel();
 }
 
@@ -146,6 +162,12 @@ StateModel::StateModel(QObject *parent)
     : QAbstractItemModel(parent)
     , d_ptr(new StateModelPrivate(this))
 {
+    Q_D(StateModel);
+    d->m_updateTimer = new QTimer(this);
+    d->m_updateTimer->setSingleShot(true);
+    d->m_updateTimer->setInterval(StateMachineUpdateInterval);
+    connect(d->m_updateTimer, SIGNAL(timeout()), this, SLOT(updateConfiguration()));
+
     QHash<int, QByteArray> _roleNames = roleNames();
     _roleNames.insert(TransitionsRole, "transitions");
     _roleNames.insert(IsInitialStateRole, "isInitial");
@@ -173,6 +195,7 @@ void StateModel::setStateMachine(StateMachineDebugInterface *stateMachine)
     }
 
     beginResetModel();
+    d->m_updateTimer->stop();
     d->m_stateMachine = stateMachine;
     d->m_lastConfiguration = (stateMachine ? stateMachine->configuration() : QVector<State>());
     endResetModel();
@@ -75,6 +75,7 @@ protected:
 
 private:
     Q_PRIVATE_SLOT(d_func(), void stateConfigurationChanged())
+    Q_PRIVATE_SLOT(d_func(), void updateConfiguration())
     Q_PRIVATE_SLOT(d_func(), void handleMachineDestroyed(QObject*))
 };
 }
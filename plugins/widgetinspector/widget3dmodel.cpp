@@ -34,6 +34,8 @@
 #include <QResizeEvent>
 #include <QMenu>
 #include <QMetaObject>
+#include <QPainter>
+#include <QPaintEvent>
 
 #include <common/objectmodel.h>
 #include <core/objecttreemodel.h>
@@ -128,6 +130,7 @@ bool Widget3DWidget::eventFilter(QObject *obj, QEvent *ev)
         }
         case QEvent::Paint: {
             if (!mIsPainting) {
+                mDirtyRegion += static_cast<QPaintEvent*>(ev)->region();
                 mTextureDirty = true;
                 startUpdateTimer();
             }
@@ -142,6 +145,7 @@ bool Widget3DWidget::eventFilter(QObject *obj, QEvent *ev)
         case QEvent::Hide: {
             mTextureImage = QImage();
             mBackTextureImage = QImage();
+            mDirtyRegion = QRegion();
             mUpdateTimer->stop();
             Q_EMIT changed(QVector<int>() << Widget3DModel::TextureRole
                                           << Widget3DModel::BackTextureRole);
@@ -171,7 +175,8 @@ void GammaRay::Widget3DWidget::updateTimeout()
     if (mGeomDirty && updateGeometry()) {
         changedRoles << Widget3DModel::GeometryRole;
     }
-    if (mTextureDirty && updateTexture()) {
+    if (mTextureDirty) {
+        // only notify here, the texture is re-grabbed once it's actually requested
         changedRoles << Widget3DModel::TextureRole
                      << Widget3DModel::BackTextureRole;
     }
@@ -253,22 +258,43 @@ bool Widget3DWidget::updateTexture()
 
     mIsPainting = true;
 
+    if (mTextureImage.isNull() || mTextureImage.size() != mTextureGeometry.size()) {
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
-    const QImage::Format format = QImage::Format_RGBA8888;
+        const QImage::Format format = QImage::Format_RGBA8888;
 #else
-    const QImage::Format format = QImage::Format_ARGB32;
+        const QImage::Format format = QImage::Format_ARGB32;
 #endif
-    mTextureImage = QImage(mTextureGeometry.size(), format);
-    mTextureImage.fill(mQWidget->palette().button().color());
-
-    if (isWindow()) {
-        mQWidget->render(&mTextureImage, QPoint(0, 0), QRegion(mTextureGeometry));
-        mBackTextureImage = QImage(mTextureGeometry.size(), format);
-        mQWidget->render(&mBackTextureImage, QPoint(0, 0), QRegion(mTextureGeometry));
+        mTextureImage = QImage(mTextureGeometry.size(), format);
+        mTextureImage.fill(mQWidget->palette().button().color());
+
+        if (isWindow()) {
+            mQWidget->render(&mTextureImage, QPoint(0, 0), QRegion(mTextureGeometry));
+            mBackTextureImage = QImage(mTextureGeometry.size(), format);
+            mQWidget->render(&mBackTextureImage, QPoint(0, 0), QRegion(mTextureGeometry));
+        } else {
+            mQWidget->render(&mTextureImage, QPoint(0, 0), QRegion(mTextureGeometry), QWidget::DrawWindowBackground);
+            mBackTextureImage = mTextureImage;
+        }
     } else {
-        mQWidget->render(&mTextureImage, QPoint(0, 0), QRegion(mTextureGeometry), QWidget::DrawWindowBackground);
-        mBackTextureImage = mTextureImage;
+        // same size as before, only re-grab the parts that have been repainted since
+        const QVector<QRect> dirtyRects = mDirtyRegion.intersected(mTextureGeometry).rects();
+        {
+            QPainter p(&mTextureImage);
+            foreach (const QRect &rect, dirtyRects)
+                p.fillRect(rect, mQWidget->palette().button().color());
+        }
+        foreach (const QRect &rect, dirtyRects) {
+            if (isWindow()) {
+                mQWidget->render(&mTextureImage, rect.topLeft(), QRegion(rect));
+                mQWidget->render(&mBackTextureImage, rect.topLeft(), QRegion(rect));
+            } else {
+                mQWidget->render(&mTextureImage, rect.topLeft(), QRegion(rect), QWidget::DrawWindowBackground);
+            }
+        }
+        if (!isWindow())
+            mBackTextureImage = mTextureImage;
     }
+    mDirtyRegion = QRegion();
 
     mIsPainting = false;
 
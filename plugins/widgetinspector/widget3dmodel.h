@@ -31,6 +31,7 @@
 
 #include <QSortFilterProxyModel>
 #include <QRect>
+#include <QRegion>
 #include <QWidget>
 #include <QMap>
 #include <QPointer>
@@ -48,8 +49,10 @@ public:
     Widget3DWidget(QWidget *qWidget, const QPersistentModelIndex &modelIndex, Widget3DWidget *parent);
     ~Widget3DWidget();
 
-    inline QImage texture() const { return mTextureImage; }
-    inline QImage backTexture() const { return mBackTextureImage; }
+    // textures are grabbed lazily on first access after a change, so widgets
+    // the client does not look at are never rendered
+    inline QImage texture() { updateTexture(); return mTextureImage; }
+    inline QImage backTexture() { updateTexture(); return mBackTextureImage; }
     inline QRect geometry() const { return mGeometry; }
     inline QWidget *qWidget() const { return mQWidget; }
     inline Widget3DWidget *parentWidget() const { return static_cast<Widget3DWidget*>(parent()); }
@@ -88,6 +91,7 @@ private:
     QImage mBackTextureImage;
     QRect mTextureGeometry;
     QRect mGeometry;
+    QRegion mDirtyRegion;
     QVariantMap mMetaData;
     QTimer *mUpdateTimer;
     int mDepth;
@@ -430,33 +430,34 @@ GammaRay::ObjectIds WidgetInspectorServer::recursiveWidgetsAt(QWidget *parent, c
 
     bestCandidate = -1;
 
-    const auto childItems = parent->children();
+    const auto &childItems = parent->children();
     for (int i = childItems.size() - 1; i >= 0; --i) { // backwards to match z order
         auto c = childItems.at(i);
-        if (!c->isWidgetType() || c->metaObject()->className() == QLatin1String("GammaRay::OverlayWidget"))
+        if (!c->isWidgetType() || c == m_overlayWidget.data())
+            continue;
+        auto w = static_cast<QWidget *>(c);
+        // children are clipped to their parent, so nothing outside of it can be hit
+        if (!w->geometry().contains(pos, true))
             continue;
-        auto w = qobject_cast<QWidget *>(c);
         const QPoint p = w->mapFromParent(pos);
 
-        if (w->rect().contains(p, true)) {
-            const bool hasSubChildren = !w->children().isEmpty();
+        const bool hasSubChildren = !w->children().isEmpty();
 
-            if (hasSubChildren) {
-                const int count = objects.count();
-                int bc;
-                objects << recursiveWidgetsAt(w, p, mode, bc);
+        if (hasSubChildren) {
+            const int count = objects.count();
+            int bc;
+            objects << recursiveWidgetsAt(w, p, mode, bc);
 
-                if (bestCandidate == -1 && bc != -1) {
-                    bestCandidate = count + bc;
-                }
+            if (bestCandidate == -1 && bc != -1) {
+                bestCandidate = count + bc;
             }
-            else {
-                if (bestCandidate == -1 && isGoodCandidateWidget(w)) {
-                    bestCandidate = objects.count();
-                }
-
-                objects << ObjectId(w);
+        }
+        else {
+            if (bestCandidate == -1 && isGoodCandidateWidget(w)) {
+                bestCandidate = objects.count();
             }
+
+            objects << ObjectId(w);
         }
 
         if (bestCandidate != -1 && mode == RemoteViewInterface::RequestBest) {
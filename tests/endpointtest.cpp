@@ -0,0 +1,427 @@
+/*
+  endpointtest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <core/remote/server.h>
+
+#include <common/endpoint.h>
+#include <common/message.h>
+
+#include <QSignalSpy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QUrl>
+#include <QtTest/qtest.h>
+
+#include <limits>
+
+using namespace GammaRay;
+
+namespace {
+/** Minimal endpoint accepting several connections via an I/O thread. */
+class TestEndpoint : public Endpoint
+{
+    Q_OBJECT
+public:
+    explicit TestEndpoint(QThread *ioThread)
+        : lastConnectionId(0)
+    {
+        setIOThread(ioThread);
+        connect(&m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        m_server.listen(QHostAddress::LocalHost);
+    }
+
+    quint16 port() const
+    {
+        return m_server.serverPort();
+    }
+
+    quint32 lastConnectionId;
+
+    using Endpoint::connectionCount;
+    using Endpoint::restrictToMonitoringEndpoints;
+
+    bool isRemoteClient() const override
+    {
+        return false;
+    }
+
+    QUrl serverAddress() const override
+    {
+        return QUrl();
+    }
+
+protected:
+    void messageReceived(const Message &msg) override
+    {
+        lastConnectionId = currentConnectionId();
+        if (msg.address() != endpointAddress())
+            return;
+        if (msg.type() == Protocol::ObjectMonitored || msg.type() == Protocol::ObjectUnmonitored) {
+            Protocol::ObjectAddress address;
+            msg >> address;
+            setObjectMonitored(address, msg.type() == Protocol::ObjectMonitored);
+        }
+    }
+
+    void handlerDestroyed(Protocol::ObjectAddress, const QString &) override {}
+    void objectDestroyed(Protocol::ObjectAddress, const QString &, QObject *) override {}
+
+private slots:
+    void newConnection()
+    {
+        while (m_server.hasPendingConnections())
+            setDevice(m_server.nextPendingConnection());
+    }
+
+private:
+    QTcpServer m_server;
+};
+
+/** The other end of a connection, recording everything but flow control messages. */
+class Peer : public QObject
+{
+    Q_OBJECT
+public:
+    struct ReceivedMessage
+    {
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray payload;
+    };
+
+    explicit Peer(quint16 port)
+    {
+        connect(&m_socket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+        m_socket.connectToHost(QHostAddress::LocalHost, port);
+    }
+
+    bool waitForConnected()
+    {
+        return m_socket.waitForConnected(5000);
+    }
+
+    void send(const Message &msg)
+    {
+        msg.write(&m_socket);
+        m_socket.flush();
+    }
+
+    void sendCredit(quint64 acknowledged, quint64 remoteBuffered)
+    {
+        Message msg(1, Protocol::FlowControlCredit);
+        msg << acknowledged << remoteBuffered << QVector<quint32>() << QVector<quint32>();
+        send(msg);
+    }
+
+    void close()
+    {
+        m_socket.disconnectFromHost();
+    }
+
+    QVector<Protocol::ObjectAddress> addresses() const
+    {
+        QVector<Protocol::ObjectAddress> addresses;
+        foreach (const auto &msg, m_messages)
+            addresses.push_back(msg.address);
+        return addresses;
+    }
+
+    int count(Protocol::MessageType type) const
+    {
+        int count = 0;
+        foreach (const auto &msg, m_messages)
+            count += msg.type == type ? 1 : 0;
+        return count;
+    }
+
+    /** Index of the first message of @p type, or -1. */
+    int indexOf(Protocol::MessageType type) const
+    {
+        for (int i = 0; i < m_messages.size(); ++i) {
+            if (m_messages.at(i).type == type)
+                return i;
+        }
+        return -1;
+    }
+
+    QVector<ReceivedMessage> m_messages;
+
+private slots:
+    void readyRead()
+    {
+        while (Message::canReadMessage(&m_socket)) {
+            ReceivedMessage msg;
+            if (!Message::readRawMessage(&m_socket, msg.address, msg.type, msg.payload,
+                                         m_scratchSpace, &m_fragments))
+                continue;
+            if (msg.type != Protocol::FlowControlCredit)
+                m_messages.push_back(msg);
+        }
+    }
+
+private:
+    QTcpSocket m_socket;
+    Message::FragmentBuffer m_fragments;
+    QByteArray m_scratchSpace;
+};
+}
+
+class EndpointTest : public QObject
+{
+    Q_OBJECT
+private:
+    // incompressible, so the transport can't make large messages small
+    static Message payloadMessage(Protocol::ObjectAddress address, int size)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        quint32 state = address;
+        for (int i = 0; i < size; ++i) {
+            state = state * 1664525 + 1013904223;
+            data[i] = char(state >> 24);
+        }
+        Message msg(address, Protocol::MethodCall);
+        msg << data;
+        return msg;
+    }
+
+    static quint8 dataVersionReply(const Peer &peer)
+    {
+        const int index = peer.indexOf(Protocol::ServerDataVersionNegotiated);
+        if (index < 0)
+            return 0;
+        const auto &reply = peer.m_messages.at(index);
+        const auto msg = Message::fromRawPayload(reply.address, reply.type, reply.payload);
+        quint8 version;
+        msg >> version;
+        return version;
+    }
+
+private slots:
+    void testFanOut()
+    {
+        QThread ioThread;
+        TestEndpoint endpoint(&ioThread);
+        Peer peer1(endpoint.port());
+        Peer peer2(endpoint.port());
+        QVERIFY(peer1.waitForConnected());
+        QVERIFY(peer2.waitForConnected());
+        QTRY_COMPARE(endpoint.connectionCount(), 2);
+
+        Endpoint::send(payloadMessage(2, 16));
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer1.m_messages.size(), 2);
+        QTRY_COMPARE(peer2.m_messages.size(), 2);
+        QCOMPARE(peer1.addresses(), QVector<Protocol::ObjectAddress>() << 2 << 3);
+        QCOMPARE(peer2.addresses(), QVector<Protocol::ObjectAddress>() << 2 << 3);
+        QCOMPARE(peer1.m_messages.at(0).payload, peer2.m_messages.at(0).payload);
+
+        // messages fragmented by the transport are reassembled at each end
+        Endpoint::send(payloadMessage(2, 1024 * 1024));
+        QTRY_COMPARE(peer1.m_messages.size(), 3);
+        QTRY_COMPARE(peer2.m_messages.size(), 3);
+        QCOMPARE(peer1.m_messages.at(2).payload, peer2.m_messages.at(2).payload);
+
+        QSignalSpy removedSpy(&endpoint, SIGNAL(connectionRemoved(quint32)));
+        peer1.close();
+        QTRY_COMPARE(removedSpy.count(), 1);
+        QCOMPARE(endpoint.connectionCount(), 1);
+        QVERIFY(Endpoint::isConnected());
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer2.m_messages.size(), 4);
+    }
+
+    void testMonitoringRestriction()
+    {
+        QThread ioThread;
+        TestEndpoint endpoint(&ioThread);
+        endpoint.restrictToMonitoringEndpoints(2);
+        Peer peer1(endpoint.port());
+        Peer peer2(endpoint.port());
+        QVERIFY(peer1.waitForConnected());
+        QVERIFY(peer2.waitForConnected());
+        QTRY_COMPARE(endpoint.connectionCount(), 2);
+
+        QVERIFY(!Endpoint::hasRemoteReceiver(2));
+        Message monitor(1, Protocol::ObjectMonitored);
+        monitor << Protocol::ObjectAddress(2);
+        peer2.send(monitor);
+        QTRY_VERIFY(Endpoint::hasRemoteReceiver(2));
+
+        // streams of restricted objects are dropped for endpoints not interested in them
+        Endpoint::send(payloadMessage(2, 16));
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer2.m_messages.size(), 2);
+        QTRY_COMPARE(peer1.m_messages.size(), 1);
+        QCOMPARE(peer1.addresses(), QVector<Protocol::ObjectAddress>() << 3);
+        QCOMPARE(peer2.addresses(), QVector<Protocol::ObjectAddress>() << 2 << 3);
+
+        Message unmonitor(1, Protocol::ObjectUnmonitored);
+        unmonitor << Protocol::ObjectAddress(2);
+        peer2.send(unmonitor);
+        QTRY_VERIFY(!Endpoint::hasRemoteReceiver(2));
+    }
+
+    void testReplyGuard()
+    {
+        QThread ioThread;
+        TestEndpoint endpoint(&ioThread);
+        Peer peer1(endpoint.port());
+        Peer peer2(endpoint.port());
+        QVERIFY(peer1.waitForConnected());
+        QVERIFY(peer2.waitForConnected());
+        QTRY_COMPARE(endpoint.connectionCount(), 2);
+
+        Message request(1, Protocol::ObjectUnmonitored);
+        request << Protocol::ObjectAddress(2);
+        peer2.send(request);
+        QTRY_VERIFY(endpoint.lastConnectionId != 0);
+        const auto connectionId = endpoint.lastConnectionId;
+
+        {
+            Endpoint::ReplyGuard guard(connectionId);
+            Endpoint::send(payloadMessage(2, 16));
+        }
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer2.m_messages.size(), 2);
+        QTRY_COMPARE(peer1.m_messages.size(), 1);
+        QCOMPARE(peer1.addresses(), QVector<Protocol::ObjectAddress>() << 3);
+
+        // replies to endpoints that are gone are dropped
+        peer2.close();
+        QTRY_COMPARE(endpoint.connectionCount(), 1);
+        {
+            Endpoint::ReplyGuard guard(connectionId);
+            Endpoint::send(payloadMessage(2, 16));
+        }
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer1.m_messages.size(), 2);
+        QCOMPARE(peer1.addresses(), QVector<Protocol::ObjectAddress>() << 3 << 3);
+    }
+
+    void testFlowControl()
+    {
+        QThread ioThread;
+        TestEndpoint endpoint(&ioThread);
+        Peer peer1(endpoint.port());
+        Peer peer2(endpoint.port());
+        QVERIFY(peer1.waitForConnected());
+        QVERIFY(peer2.waitForConnected());
+        QTRY_COMPARE(endpoint.connectionCount(), 2);
+        endpoint.setObjectPriority(2, Protocol::BulkPriority);
+
+        const auto initialBudget = Endpoint::sendBudget();
+        QVERIFY(initialBudget > 0);
+        QSignalSpy budgetSpy(&endpoint, SIGNAL(sendBudgetAvailable()));
+        Endpoint::send(payloadMessage(2, int(initialBudget)));
+        QCOMPARE(Endpoint::sendBudget(), qint64(0));
+        QTRY_COMPARE(peer1.m_messages.size(), 1);
+        QTRY_COMPARE(peer2.m_messages.size(), 1);
+
+        // the budget is limited by the endpoint that is furthest behind
+        peer1.sendCredit(std::numeric_limits<quint64>::max(), 42);
+        QTRY_COMPARE(endpoint.remoteBufferedBytes(), quint64(42));
+        QCOMPARE(Endpoint::sendBudget(), qint64(0));
+        QCOMPARE(budgetSpy.count(), 0);
+
+        peer2.sendCredit(std::numeric_limits<quint64>::max(), 0);
+        QTRY_COMPARE(budgetSpy.count(), 1);
+        QCOMPARE(Endpoint::sendBudget(), initialBudget);
+        QCOMPARE(endpoint.bufferedBytes(), quint64(0));
+
+        // a slow endpoint disconnecting releases the budget as well
+        Endpoint::send(payloadMessage(2, int(initialBudget)));
+        QCOMPARE(Endpoint::sendBudget(), qint64(0));
+        peer1.sendCredit(std::numeric_limits<quint64>::max(), 0);
+        QTRY_COMPARE(peer1.m_messages.size(), 2);
+        peer2.close();
+        QTRY_COMPARE(budgetSpy.count(), 2);
+        QCOMPARE(Endpoint::sendBudget(), initialBudget);
+    }
+
+    void testScheduling()
+    {
+        QThread ioThread;
+        TestEndpoint endpoint(&ioThread);
+        Peer peer(endpoint.port());
+        QVERIFY(peer.waitForConnected());
+        QTRY_COMPARE(endpoint.connectionCount(), 1);
+        endpoint.setObjectPriority(2, Protocol::BulkPriority);
+        endpoint.setObjectPriority(3, Protocol::InteractivePriority);
+
+        // interactive messages overtake a large bulk transfer...
+        Endpoint::send(payloadMessage(2, 4 * 1024 * 1024));
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer.m_messages.size(), 2);
+        QCOMPARE(peer.addresses(), QVector<Protocol::ObjectAddress>() << 3 << 2);
+
+        // ...but never earlier messages to the same object
+        Endpoint::send(payloadMessage(2, 4 * 1024 * 1024));
+        Endpoint::send(payloadMessage(2, 16));
+        Endpoint::send(payloadMessage(3, 16));
+        QTRY_COMPARE(peer.m_messages.size(), 5);
+        QCOMPARE(peer.addresses(), QVector<Protocol::ObjectAddress>() << 3 << 2 << 3 << 2 << 2);
+        QCOMPARE(peer.m_messages.at(3).payload.size(), peer.m_messages.at(1).payload.size());
+    }
+
+    void testDataVersionNegotiation()
+    {
+        if (Message::lowestSupportedDataVersion() == Message::highestSupportedDataVersion())
+            QSKIP("Only one data version supported.");
+
+        qputenv("GAMMARAY_ServerAddress", "tcp://127.0.0.1");
+        Server server;
+        QVERIFY(server.listen());
+        const auto port = server.externalAddress().port();
+
+        Peer peer1(port);
+        QVERIFY(peer1.waitForConnected());
+        QTRY_VERIFY(peer1.indexOf(Protocol::ServerInfo) >= 0);
+        Message request1(1, Protocol::ClientDataVersionNegotiated);
+        request1 << Message::highestSupportedDataVersion();
+        peer1.send(request1);
+        QTRY_COMPARE(dataVersionReply(peer1), Message::highestSupportedDataVersion());
+
+        // a later client can't lower the version for everyone, it gets the one in use
+        // and has to disconnect if it doesn't support that
+        Peer peer2(port);
+        QVERIFY(peer2.waitForConnected());
+        QTRY_VERIFY(peer2.indexOf(Protocol::ServerInfo) >= 0);
+        Message request2(1, Protocol::ClientDataVersionNegotiated);
+        request2 << Message::lowestSupportedDataVersion();
+        peer2.send(request2);
+        QTRY_COMPARE(dataVersionReply(peer2), Message::highestSupportedDataVersion());
+        QCOMPARE(Message::negotiatedDataVersion(), Message::highestSupportedDataVersion());
+
+        // the reply only goes to the client that asked
+        QCOMPARE(peer1.count(Protocol::ServerDataVersionNegotiated), 1);
+    }
+};
+
+QTEST_MAIN(EndpointTest)
+
+#include "endpointtest.moc"
@@ -0,0 +1,150 @@
+/*
+  graphlayoutertest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <plugins/objectvisualizer/graphlayouter.h>
+
+#include <QHash>
+#include <QSignalSpy>
+#include <QtTest/qtest.h>
+
+#include <cmath>
+
+using namespace GammaRay;
+
+class GraphLayouterTest : public QObject
+{
+    Q_OBJECT
+private:
+    static double distance(const QPointF &a, const QPointF &b)
+    {
+        const QPointF d = a - b;
+        return std::sqrt(d.x() * d.x() + d.y() * d.y());
+    }
+
+    // latest reported position of each node
+    void trackPositions(GraphLayouter *layouter)
+    {
+        m_positions.clear();
+        connect(layouter, &GraphLayouter::positionsChanged,
+                this, [this](const QVector<LayoutPosition> &positions) {
+            foreach (const auto &p, positions)
+                m_positions.insert(p.id, p.pos);
+        });
+    }
+
+    static bool waitForLayout(QSignalSpy &finishedSpy)
+    {
+        finishedSpy.clear();
+        return finishedSpy.wait(5000) || finishedSpy.count() > 0;
+    }
+
+    QHash<qulonglong, QPointF> m_positions;
+
+private slots:
+    void testConvergence()
+    {
+        GraphLayouter layouter;
+        trackPositions(&layouter);
+        QSignalSpy finishedSpy(&layouter, SIGNAL(layoutFinished()));
+
+        layouter.addNode(1, 0, 1);
+        for (qulonglong id = 2; id <= 7; ++id)
+            layouter.addNode(id, 1, 1);
+        QVERIFY(waitForLayout(finishedSpy));
+
+        QCOMPARE(m_positions.size(), 7);
+        for (qulonglong id = 2; id <= 7; ++id) {
+            // children end up around the ideal edge length from their parent...
+            const double d = distance(m_positions.value(id), m_positions.value(1));
+            QVERIFY(d > 0.5 * GraphLayouter::EdgeLength);
+            QVERIFY(d < 3.0 * GraphLayouter::EdgeLength);
+            // ...and don't overlap each other
+            for (qulonglong other = id + 1; other <= 7; ++other)
+                QVERIFY(distance(m_positions.value(id), m_positions.value(other)) > 0.1);
+        }
+    }
+
+    void testRemoveNode()
+    {
+        GraphLayouter layouter;
+        trackPositions(&layouter);
+        QSignalSpy finishedSpy(&layouter, SIGNAL(layoutFinished()));
+
+        layouter.addNode(1, 0, 1);
+        layouter.addNode(2, 1, 1);
+        layouter.addNode(3, 1, 1);
+        layouter.addNode(4, 2, 1);
+        QVERIFY(waitForLayout(finishedSpy));
+        const QPointF pos = m_positions.value(4);
+
+        // removed nodes are gone for good, they don't take their old place when re-added
+        layouter.clear();
+        layouter.removeNode(4);
+        m_positions.clear();
+        layouter.addNode(1, 0, 1);
+        layouter.addNode(2, 1, 1);
+        layouter.addNode(3, 1, 1);
+        layouter.addNode(4, 2, 1);
+        QVERIFY(waitForLayout(finishedSpy));
+        QVERIFY(m_positions.value(4) != pos);
+
+        // removing a parent leaves its children as roots
+        layouter.removeNode(2);
+        layouter.setNodeWeight(2, 5);
+        QVERIFY(waitForLayout(finishedSpy));
+        layouter.removeNode(4);
+        layouter.removeNode(42);
+    }
+
+    void testClearKeepsPositions()
+    {
+        GraphLayouter layouter;
+        trackPositions(&layouter);
+        QSignalSpy finishedSpy(&layouter, SIGNAL(layoutFinished()));
+
+        layouter.addNode(1, 0, 1);
+        for (qulonglong id = 2; id <= 5; ++id)
+            layouter.addNode(id, 1, 1);
+        QVERIFY(waitForLayout(finishedSpy));
+        const auto positions = m_positions;
+
+        layouter.clear();
+        m_positions.clear();
+        layouter.addNode(1, 0, 1);
+        for (qulonglong id = 2; id <= 5; ++id)
+            layouter.addNode(id, 1, 1);
+        QVERIFY(waitForLayout(finishedSpy));
+
+        QCOMPARE(m_positions.size(), positions.size());
+        for (auto it = positions.constBegin(); it != positions.constEnd(); ++it)
+            QVERIFY(distance(m_positions.value(it.key()), it.value()) < 0.5 * GraphLayouter::EdgeLength);
+    }
+};
+
+QTEST_MAIN(GraphLayouterTest)
+
+#include "graphlayoutertest.moc"
@@ -0,0 +1,225 @@
+/*
+  messagetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <common/message.h>
+#include <common/compressiondictionary.h>
+
+#include <QtTest/qtest.h>
+#include <QBuffer>
+#include <QObject>
+
+using namespace GammaRay;
+
+class MessageTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testRoundTrip()
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadWrite);
+
+        {
+            Message msg(42, Protocol::MethodCall);
+            msg << QString(QStringLiteral("hello")) << QByteArray(1000, 'x');
+            msg.write(&buffer);
+        }
+
+        buffer.seek(0);
+        QVERIFY(Message::canReadMessage(&buffer));
+        const auto msg = Message::readMessage(&buffer);
+        QCOMPARE(msg.address(), Protocol::ObjectAddress(42));
+        QCOMPARE(msg.type(), Protocol::MessageType(Protocol::MethodCall));
+        QString s;
+        QByteArray b;
+        msg >> s >> b;
+        QCOMPARE(s, QStringLiteral("hello"));
+        QCOMPARE(b, QByteArray(1000, 'x'));
+        QVERIFY(!Message::canReadMessage(&buffer));
+    }
+
+    void testFragmentReassembly()
+    {
+        QByteArray payload;
+        {
+            Message msg(42, Protocol::ModelContentReply);
+            msg << QByteArray(100000, 'a') << qint32(23);
+            payload = msg.rawPayload();
+        }
+
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadWrite);
+        QByteArray scratchSpace;
+
+        // fragments of two messages to different objects, interleaved with a small message
+        Message::writeRawMessage(&buffer, 42, Protocol::MessageFragment, payload.left(40000), scratchSpace);
+        Message::writeRawMessage(&buffer, 43, Protocol::MessageFragment, QByteArray("abc"), scratchSpace);
+        Message::writeRawMessage(&buffer, 44, Protocol::MethodCall, QByteArray(), scratchSpace);
+        Message::writeRawMessage(&buffer, 42, Protocol::ModelContentReply, payload.mid(40000), scratchSpace);
+        Message::writeRawMessage(&buffer, 43, Protocol::MethodCall, QByteArray("def"), scratchSpace);
+
+        buffer.seek(0);
+        Message::FragmentBuffer fragments;
+
+        QVERIFY(Message::canReadMessage(&buffer));
+        QCOMPARE(Message::readMessage(&buffer, &fragments).type(), Protocol::InvalidMessageType);
+        QVERIFY(Message::canReadMessage(&buffer));
+        QCOMPARE(Message::readMessage(&buffer, &fragments).type(), Protocol::InvalidMessageType);
+
+        {
+            const auto msg = Message::readMessage(&buffer, &fragments);
+            QCOMPARE(msg.address(), Protocol::ObjectAddress(44));
+            QCOMPARE(msg.size(), 0);
+        }
+
+        {
+            const auto msg = Message::readMessage(&buffer, &fragments);
+            QCOMPARE(msg.address(), Protocol::ObjectAddress(42));
+            QCOMPARE(msg.type(), Protocol::MessageType(Protocol::ModelContentReply));
+            QCOMPARE(msg.size(), payload.size());
+            QByteArray b;
+            qint32 i;
+            msg >> b >> i;
+            QCOMPARE(b, QByteArray(100000, 'a'));
+            QCOMPARE(i, 23);
+        }
+
+        {
+            Protocol::ObjectAddress address;
+            Protocol::MessageType type;
+            QByteArray rawPayload;
+            QVERIFY(Message::readRawMessage(&buffer, address, type, rawPayload, scratchSpace, &fragments));
+            QCOMPARE(address, Protocol::ObjectAddress(43));
+            QCOMPARE(rawPayload, QByteArray("abcdef"));
+        }
+
+        QVERIFY(fragments.isEmpty());
+        QVERIFY(!Message::canReadMessage(&buffer));
+    }
+
+    void testDictionaryCompression()
+    {
+        // lots of small messages repeating the same names, as for the property view
+        auto payloadFor = [](int i) {
+            Message msg(42, Protocol::ModelContentReply);
+            msg << QStringLiteral("QQuickRectangle") << QStringLiteral("objectName")
+                << QVariant(i) << QStringLiteral("QQmlListProperty<QQuickItem>");
+            return msg.rawPayload();
+        };
+
+        CompressionDictionaryTrainer trainer;
+        int i = 0;
+        while (!trainer.addSample(payloadFor(i)))
+            ++i;
+        const auto dictionary = trainer.train();
+        QVERIFY(!dictionary.isEmpty());
+        QVERIFY(dictionary.size() <= CompressionDictionaryTrainer::DictionarySize);
+        Message::addCompressionDictionary(200, dictionary);
+
+        const auto payload = payloadFor(-1);
+        QByteArray plainData, dictionaryData, scratchSpace;
+        QBuffer plainBuffer(&plainData);
+        plainBuffer.open(QIODevice::ReadWrite);
+        Message::writeRawMessage(&plainBuffer, 42, Protocol::ModelContentReply, payload,
+                                 scratchSpace, Protocol::ModelPriority, 0);
+        QBuffer dictionaryBuffer(&dictionaryData);
+        dictionaryBuffer.open(QIODevice::ReadWrite);
+        Message::writeRawMessage(&dictionaryBuffer, 42, Protocol::ModelContentReply, payload,
+                                 scratchSpace, Protocol::ModelPriority, 200);
+        QVERIFY(dictionaryData.size() < plainData.size());
+
+        dictionaryBuffer.seek(0);
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray readPayload;
+        QVERIFY(Message::readRawMessage(&dictionaryBuffer, address, type, readPayload, scratchSpace));
+        QCOMPARE(readPayload, payload);
+    }
+
+    void testDictionaryAnnouncement()
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadWrite);
+        {
+            Message msg(1, Protocol::CompressionDictionary);
+            msg << quint8(201) << QByteArray("QQuickRectangleQQuickItem");
+            msg.write(&buffer);
+        }
+
+        buffer.seek(0);
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray payload, scratchSpace;
+        QVERIFY(Message::readRawMessage(&buffer, address, type, payload, scratchSpace));
+
+        // the dictionary is usable right away
+        data.clear();
+        buffer.seek(0);
+        const QByteArray content("QQuickItem QQuickRectangle QQuickItem QQuickRectangle QQuickItem");
+        Message::writeRawMessage(&buffer, 42, Protocol::MethodCall, content, scratchSpace,
+                                 Protocol::InteractivePriority, 201);
+        buffer.seek(0);
+        QVERIFY(Message::readRawMessage(&buffer, address, type, payload, scratchSpace));
+        QCOMPARE(payload, content);
+    }
+
+    void testUnknownDictionary()
+    {
+        Message::addCompressionDictionary(202, QByteArray("QQuickRectangleQQuickItem"));
+        QByteArray data, scratchSpace;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadWrite);
+        const QByteArray content("QQuickItem QQuickRectangle QQuickItem QQuickRectangle QQuickItem");
+        Message::writeRawMessage(&buffer, 42, Protocol::MethodCall, content, scratchSpace,
+                                 Protocol::InteractivePriority, 202);
+
+        // refer to a dictionary that was never announced instead
+        const int dictionaryIdOffset = sizeof(Protocol::PayloadSize) + sizeof(Protocol::ObjectAddress)
+                                       + sizeof(Protocol::MessageType) + sizeof(qint32);
+        QCOMPARE(quint8(data.at(dictionaryIdOffset)), quint8(202));
+        data[dictionaryIdOffset] = char(203);
+
+        buffer.seek(0);
+        Protocol::ObjectAddress address;
+        Protocol::MessageType type;
+        QByteArray payload;
+        QString error;
+        QVERIFY(!Message::readRawMessage(&buffer, address, type, payload, scratchSpace, nullptr,
+                                         &error));
+        QVERIFY(!error.isEmpty());
+        QVERIFY(payload.isEmpty());
+        QVERIFY(buffer.atEnd());
+    }
+};
+
+QTEST_MAIN(MessageTest)
+
+#include "messagetest.moc"
@@ -29,9 +29,12 @@
 #include "baseprobetest.h"
 #include "testhelpers.h"
 
+#include <core/metaobjectregistry.h>
 #include <core/tools/metaobjectbrowser/metaobjecttreemodel.h>
 #include <ui/tools/metaobjectbrowser/metaobjecttreeclientproxymodel.h>
 
+#include <common/tools/metaobjectbrowser/qmetaobjectmodel.h>
+
 #include <common/objectbroker.h>
 
 #include <3rdparty/qt/modeltest.h>
@@ -108,6 +111,45 @@ private slots:
 
         QVERIFY(!idx.parent().isValid());
     }
+
+    void testCensus()
+    {
+        createProbe();
+
+        auto srcModel = ObjectBroker::model("com.kdab.GammaRay.MetaObjectBrowserTreeModel");
+        QVERIFY(srcModel);
+        MetaObjectTreeClientProxyModel model;
+        model.setSourceModel(srcModel);
+        Probe::instance()->discoverObject(this);
+
+        const auto l = searchFixedIndexes(&model, QLatin1String("MetaObjectTreeModelTest"), Qt::MatchRecursive);
+        QCOMPARE(l.size(), 1);
+        const auto idx = l.at(0);
+
+        QCOMPARE(idx.sibling(idx.row(), QMetaObjectModel::ObjectPeakAliveCountColumn).data().toInt(), 1);
+        QVERIFY(idx.sibling(idx.row(), QMetaObjectModel::ObjectAverageLifetimeColumn).data().isNull());
+        QVERIFY(idx.sibling(idx.row(), QMetaObjectModel::ObjectPeakAliveCountColumn).data(Qt::BackgroundRole).isNull());
+
+        // rates are sampled once per second
+        QTRY_VERIFY(idx.sibling(idx.row(), QMetaObjectModel::ObjectCreationRateColumn).data().toDouble() > 0.0);
+        QCOMPARE(idx.sibling(idx.row(), QMetaObjectModel::ObjectDestructionRateColumn).data().toDouble(), 0.0);
+    }
+
+    void testShortLivedObjects()
+    {
+        createProbe();
+
+        auto registry = Probe::instance()->metaObjectRegistry();
+        const auto unresolvedCount = registry->unresolvedCount();
+
+        // created and destroyed before the probe processes the creation, so their class is
+        // never resolved and they must not be attributed to whatever was under construction
+        for (int i = 0; i < 10; ++i)
+            delete new QObject;
+
+        QCOMPARE(registry->unresolvedCount(), unresolvedCount + 10);
+        QVERIFY(registry->unresolvedTotalLifetime() >= 0);
+    }
 };
 
 QTEST_MAIN(MetaObjectTreeModelTest)
@@ -0,0 +1,200 @@
+/*
+  paintcommandstreamtest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <common/metatypedeclarations.h>
+#include <common/paintcommandstream.h>
+
+#include <QBrush>
+#include <QDataStream>
+#include <QLineF>
+#include <QPen>
+#include <QtTest/qtest.h>
+
+using namespace GammaRay;
+
+class PaintCommandStreamTest : public QObject
+{
+    Q_OBJECT
+private:
+    static PaintCommandRecord record(const char *name, const QVariant &arg = QVariant(),
+                                     const QPainterPath &clip = QPainterPath())
+    {
+        PaintCommandRecord r;
+        r.name = QString::fromLatin1(name);
+        if (arg.isValid())
+            r.arguments.push_back(arg);
+        r.clipPath = clip;
+        return r;
+    }
+
+    static void compareRecords(const QVector<PaintCommandRecord> &actual,
+                               const QVector<PaintCommandRecord> &expected)
+    {
+        QCOMPARE(actual.size(), expected.size());
+        for (int i = 0; i < expected.size(); ++i) {
+            QCOMPARE(actual.at(i).name, expected.at(i).name);
+            QCOMPARE(actual.at(i).clipPath, expected.at(i).clipPath);
+            QCOMPARE(actual.at(i).arguments.size(), expected.at(i).arguments.size());
+            for (int j = 0; j < expected.at(i).arguments.size(); ++j) {
+                const auto a = actual.at(i).arguments.at(j);
+                const auto e = expected.at(i).arguments.at(j);
+                QCOMPARE(a.userType(), e.userType());
+                if (e.userType() == qMetaTypeId<QPainterPath>())
+                    QCOMPARE(a.value<QPainterPath>(), e.value<QPainterPath>());
+                else
+                    QCOMPARE(a, e);
+            }
+        }
+    }
+
+    static int serializedSize(const QVariant &value)
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream << value;
+        return data.size();
+    }
+
+private slots:
+    void testRoundTrip()
+    {
+        QPainterPath clip1;
+        clip1.addRect(0, 0, 100, 50);
+        QPainterPath clip2;
+        clip2.addEllipse(QRectF(10.5, 10.25, 30, 20));
+        clip2.setFillRule(Qt::WindingFill);
+        QPainterPath path;
+        path.moveTo(1, 2);
+        path.lineTo(0.1, -3.3); // not representable in fixed point
+        path.cubicTo(5, 5, 10, 0, 1e20, 2);
+
+        QVector<PaintCommandRecord> expected;
+        expected.push_back(record("SetPen", QPen(Qt::red, 2.0)));
+        expected.push_back(record("SetBrush", QBrush(Qt::blue, Qt::Dense4Pattern), clip1));
+        expected.push_back(record("DrawPath", QVariant::fromValue(path), clip1));
+        expected.push_back(record("Save", QVariant(), clip2));
+        expected.push_back(record("SetPen", QPen(Qt::red, 2.0), clip2));
+        expected.push_back(record("Restore", QVariant(), clip1));
+        expected.push_back(record("ClipPath", QVariant::fromValue(clip2), clip2));
+
+        PaintCommandRecord multi = record("DrawPixmapRect", QRectF(-5.5, 3, 20, 10), clip2);
+        multi.arguments.push_back(QVariant());
+        multi.arguments.push_back(QRect(0, 0, 16, 8));
+        multi.arguments.push_back(QPointF(1.0 / 3.0, 7));
+        multi.arguments.push_back(QPoint(-42, 42));
+        multi.arguments.push_back(QLineF(0.5, 0.5, 99.5, 0.5));
+        multi.arguments.push_back(QLine(1, 2, 3, 4));
+        multi.arguments.push_back(QStringLiteral("some text"));
+        expected.push_back(multi);
+        expected.push_back(record("Restore"));
+
+        // decoding depends on state carried over between chunks
+        PaintCommandStreamWriter writer;
+        PaintCommandStreamReader reader;
+        QVector<PaintCommandRecord> actual;
+        for (int i = 0; i < expected.size(); ++i) {
+            writer.write(expected.at(i));
+            if (i % 3 == 2 || i == expected.size() - 1)
+                QVERIFY(reader.read(writer.takeChunk(), &actual));
+        }
+        compareRecords(actual, expected);
+        QVERIFY(writer.takeChunk().isEmpty());
+    }
+
+    void testInterning()
+    {
+        QPainterPath clip;
+        clip.addRect(0, 0, 640, 480);
+        const QPen pen(QBrush(Qt::darkGreen), 1.5, Qt::DashDotLine);
+
+        PaintCommandStreamWriter writer;
+        writer.write(record("SetPen", pen, clip));
+        const auto first = writer.takeChunk();
+        QVERIFY(first.size() > serializedSize(pen));
+
+        // repeated pens and unchanged clip paths only cost a reference
+        for (int i = 0; i < 100; ++i)
+            writer.write(record("SetPen", QPen(pen), clip));
+        const auto repeated = writer.takeChunk();
+        QVERIFY(repeated.size() <= 100 * 8);
+
+        PaintCommandStreamReader reader;
+        QVector<PaintCommandRecord> records;
+        QVERIFY(reader.read(first, &records));
+        QVERIFY(reader.read(repeated, &records));
+        QCOMPARE(records.size(), 101);
+        QCOMPARE(records.last().arguments.at(0).value<QPen>(), pen);
+        QCOMPARE(records.last().clipPath, clip);
+    }
+
+    void testDeltaGeometry()
+    {
+        // a grid of cells, as e.g. painted by item views
+        PaintCommandStreamWriter writer;
+        QVector<PaintCommandRecord> expected;
+        for (int row = 0; row < 20; ++row) {
+            for (int column = 0; column < 5; ++column) {
+                const auto r = record("DrawRectF", QRectF(column * 100.5, 10000 + row * 20, 100, 20));
+                expected.push_back(r);
+                writer.write(r);
+            }
+        }
+        const auto chunk = writer.takeChunk();
+        // 4 coordinates of 8 bytes each without delta encoding
+        QVERIFY(chunk.size() < expected.size() * 16);
+
+        PaintCommandStreamReader reader;
+        QVector<PaintCommandRecord> actual;
+        QVERIFY(reader.read(chunk, &actual));
+        compareRecords(actual, expected);
+    }
+
+    void testMalformed()
+    {
+        QPainterPath clip;
+        clip.addRect(0, 0, 10, 10);
+        PaintCommandStreamWriter writer;
+        writer.write(record("SetPen", QPen(Qt::red), clip));
+        const auto chunk = writer.takeChunk();
+
+        for (int size = 1; size < chunk.size(); ++size) {
+            PaintCommandStreamReader reader;
+            QVector<PaintCommandRecord> records;
+            QVERIFY(!reader.read(chunk.left(size), &records));
+        }
+
+        // a later chunk refers to values interned in an earlier one
+        writer.write(record("SetPen", QPen(Qt::red), clip));
+        PaintCommandStreamReader reader;
+        QVector<PaintCommandRecord> records;
+        QVERIFY(!reader.read(writer.takeChunk(), &records));
+    }
+};
+
+QTEST_MAIN(PaintCommandStreamTest)
+
+#include "paintcommandstreamtest.moc"
@@ -144,6 +144,38 @@ private slots:
         ProblemCollector::removeProblem(QStringLiteral("9skjlksdjb"));
     }
 
+    void testDuplicatesAfterRemoval()
+    {
+        QCOMPARE(ProblemCollector::instance()->problems().size(), 0);
+
+        Problem p1;
+        p1.problemId = QStringLiteral("first");
+        ProblemCollector::addProblem(p1);
+        Problem p2;
+        p2.problemId = QStringLiteral("second");
+        ProblemCollector::addProblem(p2);
+        Problem p3;
+        p3.problemId = QStringLiteral("third");
+        ProblemCollector::addProblem(p3);
+        QCOMPARE(ProblemCollector::instance()->problems().size(), 3);
+
+        ProblemCollector::removeProblem(QStringLiteral("first"));
+        QCOMPARE(ProblemCollector::instance()->problems().size(), 2);
+
+        Problem p4;
+        p4.problemId = QStringLiteral("third");
+        p4.locations << SourceLocation::fromOneBased(QUrl("A.qml"), 43, 21);
+        ProblemCollector::addProblem(p4);
+        QCOMPARE(ProblemCollector::instance()->problems().size(), 2);
+        QCOMPARE(ProblemCollector::instance()->problems().at(0).problemId, QStringLiteral("second"));
+        QCOMPARE(ProblemCollector::instance()->problems().at(0).locations.size(), 0);
+        QCOMPARE(ProblemCollector::instance()->problems().at(1).problemId, QStringLiteral("third"));
+        QCOMPARE(ProblemCollector::instance()->problems().at(1).locations.size(), 1);
+
+        ProblemCollector::removeProblem(QStringLiteral("second"));
+        ProblemCollector::removeProblem(QStringLiteral("third"));
+    }
+
     void testMultipleSourceLocations()
     {
         QCOMPARE(ProblemCollector::instance()->problems().size(), 0);
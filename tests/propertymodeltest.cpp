@@ -29,6 +29,8 @@
 #include <core/objectinstance.h>
 #include <core/aggregatedpropertymodel.h>
 
+#include <common/modelevent.h>
+
 #include "shared/propertytestobject.h"
 
 #include <3rdparty/qt/modeltest.h>
@@ -122,6 +124,34 @@ private slots:
         QCOMPARE(removeSpy.size(), 1);
     }
 
+    void testPolling()
+    {
+        PropertyTestObject obj;
+        AggregatedPropertyModel model;
+        Model::used(&model);
+        model.setObject(&obj);
+        QSignalSpy changeSpy(&model, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+        QVERIFY(changeSpy.isValid());
+
+        auto notifyIdx = searchFixedIndex(&model, "intProp");
+        QVERIFY(notifyIdx.isValid());
+        notifyIdx = notifyIdx.sibling(notifyIdx.row(), 1);
+        auto pollIdx = searchFixedIndex(&model, "readOnlyProp");
+        QVERIFY(pollIdx.isValid());
+        pollIdx = pollIdx.sibling(pollIdx.row(), 1);
+        QCOMPARE(notifyIdx.data(Qt::DisplayRole).toString(), QStringLiteral("0"));
+        QCOMPARE(pollIdx.data(Qt::DisplayRole).toString(), QStringLiteral("0"));
+
+        // property with notify signal is updated right away
+        obj.setIntProp(42);
+        QCOMPARE(changeSpy.size(), 1);
+        QCOMPARE(notifyIdx.data(Qt::DisplayRole).toString(), QStringLiteral("42"));
+
+        // property without notify signal gets updated by polling
+        QTRY_COMPARE(changeSpy.size(), 2);
+        QCOMPARE(pollIdx.data(Qt::DisplayRole).toString(), QStringLiteral("42"));
+    }
+
     void testGadgetRO()
     {
 #if QT_VERSION >= QT_VERSION_CHECK(5, 5, 0)
@@ -80,6 +80,10 @@ private:
         buffer.close();
         QMetaObject::invokeMethod(const_cast<FakeRemoteModelServer*>(this), "deliverMessage", Qt::QueuedConnection, Q_ARG(QByteArray, ba));
     }
+    void sendReply(const Message &msg) const override
+    {
+        sendMessage(msg);
+    }
 };
 
 class FakeRemoteModel : public RemoteModel
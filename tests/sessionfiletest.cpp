@@ -0,0 +1,144 @@
+/*
+  sessionfiletest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <common/sessionfile.h>
+#include <common/message.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QTemporaryDir>
+
+using namespace GammaRay;
+
+// compression must not shrink this below the chunk size
+static QByteArray incompressibleData(int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    quint32 state = 42;
+    for (int i = 0; i < size; ++i) {
+        state = state * 1103515245 + 12345;
+        data[i] = char(state >> 24);
+    }
+    return data;
+}
+
+class SessionFileTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testRoundTrip()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto fileName = dir.path() + QStringLiteral("/session.grs");
+
+        {
+            SessionFileWriter writer(fileName);
+            QVERIFY(writer.open(Message::highestSupportedDataVersion()));
+            writer.record(1, Protocol::ServerVersion, QByteArray("abc"));
+            writer.record(42, Protocol::ModelContentReply, incompressibleData(300000));
+            writer.record(43, Protocol::MethodCall, QByteArray());
+            writer.flush();
+            writer.record(42, Protocol::ModelReset, QByteArray("def"));
+        }
+
+        SessionFileReader reader;
+        QVERIFY(reader.open(fileName));
+        QCOMPARE(reader.protocolVersion(), Protocol::version());
+        QCOMPARE(reader.dataVersion(), Message::highestSupportedDataVersion());
+        QVERIFY(reader.startTime() > 0);
+        // the large message completes the first chunk
+        QCOMPARE(reader.chunkCount(), 3);
+        QCOMPARE(reader.findChunk(-1), 0);
+        QCOMPARE(reader.findChunk(reader.duration()), 2);
+
+        auto records = reader.readChunk(0);
+        QCOMPARE(records.size(), 2);
+        QCOMPARE(records.at(0).address, Protocol::ObjectAddress(1));
+        QCOMPARE(records.at(0).type, Protocol::MessageType(Protocol::ServerVersion));
+        QCOMPARE(records.at(0).payload, QByteArray("abc"));
+        QCOMPARE(records.at(1).address, Protocol::ObjectAddress(42));
+        QCOMPARE(records.at(1).payload, incompressibleData(300000));
+        QVERIFY(records.at(0).time <= records.at(1).time);
+
+        records = reader.readChunk(1);
+        QCOMPARE(records.size(), 1);
+        QCOMPARE(records.at(0).type, Protocol::MessageType(Protocol::MethodCall));
+        QVERIFY(records.at(0).payload.isEmpty());
+
+        records = reader.readChunk(2);
+        QCOMPARE(records.size(), 1);
+        QCOMPARE(records.at(0).type, Protocol::MessageType(Protocol::ModelReset));
+        QCOMPARE(records.at(0).payload, QByteArray("def"));
+    }
+
+    void testTruncated()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto fileName = dir.path() + QStringLiteral("/session.grs");
+
+        {
+            SessionFileWriter writer(fileName);
+            QVERIFY(writer.open(Message::highestSupportedDataVersion()));
+            writer.record(1, Protocol::ServerVersion, QByteArray("abc"));
+            writer.flush();
+            writer.record(42, Protocol::MethodCall, QByteArray(1000, 'x'));
+        }
+
+        // cut off the last chunk, as if the recording crashed while writing it
+        QFile file(fileName);
+        QVERIFY(file.open(QFile::ReadWrite));
+        QVERIFY(file.resize(file.size() - 10));
+        file.close();
+
+        SessionFileReader reader;
+        QVERIFY(reader.open(fileName));
+        QCOMPARE(reader.chunkCount(), 1);
+        QCOMPARE(reader.readChunk(0).size(), 1);
+    }
+
+    void testInvalidFile()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto fileName = dir.path() + QStringLiteral("/garbage");
+        QFile file(fileName);
+        QVERIFY(file.open(QFile::WriteOnly));
+        file.write(QByteArray(100, 'x'));
+        file.close();
+
+        SessionFileReader reader;
+        QVERIFY(!reader.open(fileName));
+        QVERIFY(!reader.errorString().isEmpty());
+    }
+};
+
+QTEST_MAIN(SessionFileTest)
+
+#include "sessionfiletest.moc"
@@ -0,0 +1,236 @@
+/*
+  sessionreplaytest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2018 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <core/remote/server.h>
+#include <core/remote/remotemodelserver.h>
+#include <client/sessionreplay.h>
+
+#include <common/message.h>
+
+#include <QElapsedTimer>
+#include <QStandardItemModel>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest/qtest.h>
+
+using namespace GammaRay;
+
+class SessionReplayTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QStandardItem *item(const char *text, const char *childText)
+    {
+        auto item = new QStandardItem(QString::fromLatin1(text));
+        item->appendRow(new QStandardItem(QString::fromLatin1(childText)));
+        return item;
+    }
+
+    static void waitUntil(const QElapsedTimer &clock, qint64 time)
+    {
+        QTest::qWait(qMax<qint64>(0, time - clock.elapsed()));
+    }
+
+    void send(const Message &msg)
+    {
+        msg.write(&m_replay);
+    }
+
+    /** Reads everything available, remembering the endpoint address from the greeting. */
+    void skipMessages()
+    {
+        while (Message::canReadMessage(&m_replay)) {
+            Protocol::ObjectAddress address;
+            Protocol::MessageType type;
+            QByteArray payload;
+            if (Message::readRawMessage(&m_replay, address, type, payload, m_scratchSpace)
+                && type == Protocol::ServerVersion)
+                m_endpointAddress = address;
+        }
+    }
+
+    /** Waits for the next reply of type @p type from the model, skipping everything else. */
+    bool readReply(Protocol::MessageType type, QByteArray *payload)
+    {
+        QElapsedTimer timeout;
+        timeout.start();
+        while (timeout.elapsed() < 5000) {
+            while (Message::canReadMessage(&m_replay)) {
+                Protocol::ObjectAddress address;
+                Protocol::MessageType messageType;
+                if (!Message::readRawMessage(&m_replay, address, messageType, *payload,
+                                             m_scratchSpace))
+                    continue;
+                if (address == m_modelAddress && messageType == type)
+                    return true;
+            }
+            QTest::qWait(10);
+        }
+        return false;
+    }
+
+    int rowCount(const Protocol::ModelIndex &parent)
+    {
+        Message request(m_modelAddress, Protocol::ModelRowColumnCountRequest);
+        request << quint32(1) << parent;
+        send(request);
+
+        QByteArray payload;
+        if (!readReply(Protocol::ModelRowColumnCountReply, &payload))
+            return -1;
+        const auto reply = Message::fromRawPayload(m_modelAddress,
+                                                   Protocol::ModelRowColumnCountReply, payload);
+        quint32 size;
+        Protocol::ModelIndex index;
+        qint32 rows, columns;
+        reply >> size >> index >> rows >> columns;
+        return rows;
+    }
+
+    QString text(const Protocol::ModelIndex &index)
+    {
+        Message request(m_modelAddress, Protocol::ModelContentRequest);
+        request << quint32(1) << index;
+        send(request);
+
+        QByteArray payload;
+        if (!readReply(Protocol::ModelContentReply, &payload))
+            return QString();
+        const auto reply = Message::fromRawPayload(m_modelAddress, Protocol::ModelContentReply,
+                                                   payload);
+        quint32 size;
+        Protocol::ModelIndex replyIndex;
+        QMap<int, QVariant> itemData;
+        qint32 flags;
+        reply >> size >> replyIndex >> itemData >> flags;
+        return itemData.value(Qt::DisplayRole).toString();
+    }
+
+    /** The replayed model as "item[child,...]" for each top-level item. */
+    QString modelState()
+    {
+        QStringList items;
+        const int rows = rowCount(Protocol::ModelIndex());
+        for (int row = 0; row < rows; ++row) {
+            Protocol::ModelIndex index;
+            index.push_back(Protocol::ModelIndexData(row, 0));
+            QStringList children;
+            const int childRows = rowCount(index);
+            for (int childRow = 0; childRow < childRows; ++childRow) {
+                auto childIndex = index;
+                childIndex.push_back(Protocol::ModelIndexData(childRow, 0));
+                children.push_back(text(childIndex));
+            }
+            items.push_back(text(index) + QLatin1Char('[') + children.join(QLatin1String(","))
+                            + QLatin1Char(']'));
+        }
+        return items.join(QLatin1String(" "));
+    }
+
+    SessionReplay m_replay;
+    Protocol::ObjectAddress m_endpointAddress;
+    Protocol::ObjectAddress m_modelAddress;
+    QByteArray m_scratchSpace;
+
+private slots:
+    void initTestCase()
+    {
+        m_endpointAddress = Protocol::InvalidObjectAddress;
+        m_modelAddress = Protocol::InvalidObjectAddress;
+    }
+
+    void testReplay()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto fileName = dir.path() + QStringLiteral("/session.grs");
+
+        qputenv("GAMMARAY_ServerAddress", "tcp://127.0.0.1");
+        qputenv("GAMMARAY_DISABLE_IO_THREAD", "1");
+        qputenv("GAMMARAY_RecordFile", fileName.toLocal8Bit());
+        QElapsedTimer clock;
+        clock.start();
+        {
+            Server server;
+            QStandardItemModel model;
+            model.appendRow(item("c", "c1"));
+            model.appendRow(item("a", "a1"));
+            model.appendRow(item("b", "b1"));
+            RemoteModelServer modelServer(QStringLiteral("com.kdab.GammaRay.SessionReplayTest"));
+            modelServer.setModel(&model);
+            m_modelAddress = server.objectAddress(modelServer.objectName());
+
+            // a layout change, and a change to an item that moved
+            waitUntil(clock, 500);
+            model.sort(0);
+            model.item(0)->child(0)->setText(QStringLiteral("a2"));
+
+            waitUntil(clock, 1000);
+            model.appendRow(item("d", "d1"));
+            model.removeRow(1);
+            model.insertRow(0, item("e", "e1"));
+            waitUntil(clock, 1500);
+        }
+        qunsetenv("GAMMARAY_RecordFile");
+        qunsetenv("GAMMARAY_DISABLE_IO_THREAD");
+        QVERIFY(m_modelAddress != Protocol::InvalidObjectAddress);
+
+        QVERIFY(m_replay.openRecording(fileName));
+        QVERIFY(m_replay.duration() >= 1000);
+        m_replay.setPosition(400);
+        skipMessages();
+        QVERIFY(m_endpointAddress != Protocol::InvalidObjectAddress);
+
+        Message negotiation(m_endpointAddress, Protocol::ClientDataVersionNegotiated);
+        negotiation << Message::highestSupportedDataVersion();
+        send(negotiation);
+        Message monitor(m_endpointAddress, Protocol::ObjectMonitored);
+        monitor << m_modelAddress;
+        send(monitor);
+
+        QCOMPARE(modelState(), QStringLiteral("c[c1] a[a1] b[b1]"));
+        QCOMPARE(m_replay.position(), qint64(400));
+
+        m_replay.setPosition(900);
+        QCOMPARE(modelState(), QStringLiteral("a[a2] b[b1] c[c1]"));
+
+        m_replay.setPosition(-1);
+        QCOMPARE(m_replay.position(), m_replay.duration());
+        QCOMPARE(modelState(), QStringLiteral("e[e1] a[a2] c[c1] d[d1]"));
+
+        // moving backwards rebuilds the state from the start
+        m_replay.setPosition(900);
+        QCOMPARE(modelState(), QStringLiteral("a[a2] b[b1] c[c1]"));
+        m_replay.setPosition(400);
+        QCOMPARE(modelState(), QStringLiteral("c[c1] a[a1] b[b1]"));
+    }
+};
+
+QTEST_MAIN(SessionReplayTest)
+
+#include "sessionreplaytest.moc"
@@ -320,6 +320,8 @@ MainWindow::MainWindow(QWidget *parent)
         ui->statusBar->hide();
         ui->menu_Diagnostics->menuAction()->setVisible(false);
     }
+    connect(ObjectBroker::object<ProbeControllerInterface *>(), SIGNAL(objectDiscoveryProgress(int,bool)),
+            this, SLOT(objectDiscoveryProgress(int,bool)));
 
     connect(this, SIGNAL(targetQuitRequested()), &m_stateManager, SLOT(saveState()));
 }
@@ -570,6 +572,19 @@ void MainWindow::logTransmissionRate(quint64 bytesRead, quint64 bytesWritten)
             arg(transmissionRateTX, 7, 'f', 3));
 }
 
+void MainWindow::objectDiscoveryProgress(int discoveredObjects, bool finished)
+{
+    if (finished) {
+        ui->statusBar->clearMessage();
+        if (qgetenv("GAMMARAY_DEVELOPERMODE").isEmpty())
+            ui->statusBar->hide();
+        return;
+    }
+
+    ui->statusBar->show();
+    ui->statusBar->showMessage(tr("Discovering existing objects, %1 found so far...").arg(discoveredObjects));
+}
+
 void GammaRay::MainWindow::setCodeNavigationIDE(QAction *action)
 {
     QSettings settings;
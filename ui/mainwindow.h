@@ -94,6 +94,7 @@ private slots:
     void detachProbe();
     void navigateToCode(const QUrl &url, int lineNumber, int columnNumber);
     void logTransmissionRate(quint64 bytesRead, quint64 bytesWritten);
+    void objectDiscoveryProgress(int discoveredObjects, bool finished);
     void setCodeNavigationIDE(QAction *action);
 
 private:
@@ -37,8 +37,10 @@ using namespace GammaRay;
 
 PaintAnalyzerReplayView::PaintAnalyzerReplayView(QWidget* parent)
     : RemoteViewWidget(parent)
+    , m_analyzer(nullptr)
     , m_showClipArea(true)
 {
+    connect(this, SIGNAL(frameChanged()), this, SLOT(requestCommandDetails()));
 }
 
 PaintAnalyzerReplayView::~PaintAnalyzerReplayView()
@@ -50,6 +52,35 @@ bool PaintAnalyzerReplayView::showClipArea() const
     return m_showClipArea;
 }
 
+void PaintAnalyzerReplayView::setPaintAnalyzer(PaintAnalyzerInterface *analyzer)
+{
+    if (m_analyzer)
+        disconnect(m_analyzer, nullptr, this, nullptr);
+    m_analyzer = analyzer;
+    if (m_analyzer) {
+        connect(m_analyzer, SIGNAL(commandDetailsAvailable(quint32,int,int)),
+                this, SLOT(commandDetailsAvailable(quint32,int,int)));
+    }
+    requestCommandDetails();
+}
+
+void PaintAnalyzerReplayView::requestCommandDetails()
+{
+    if (!m_analyzer)
+        return;
+    const auto data = frame().data().value<PaintAnalyzerFrameData>();
+    m_analyzer->requestCommandStream(data.commandStreamId);
+}
+
+void PaintAnalyzerReplayView::commandDetailsAvailable(quint32 streamId, int firstCommand, int lastCommand)
+{
+    // draw the decoration as soon as the chunk with the shown command arrived,
+    // rather than waiting for the entire stream
+    const auto data = frame().data().value<PaintAnalyzerFrameData>();
+    if (data.commandStreamId == streamId && data.command >= firstCommand && data.command <= lastCommand)
+        update();
+}
+
 void PaintAnalyzerReplayView::setShowClipArea(bool show)
 {
     m_showClipArea = show;
@@ -58,13 +89,18 @@ void PaintAnalyzerReplayView::setShowClipArea(bool show)
 
 void PaintAnalyzerReplayView::drawDecoration(QPainter* p)
 {
+    if (!m_analyzer || !m_showClipArea)
+        return;
     const auto data = frame().data().value<PaintAnalyzerFrameData>();
-    if (data.clipPath.isEmpty() || !m_showClipArea)
+    if (!m_analyzer->hasCommandDetails(data.commandStreamId, data.command))
+        return;
+    const auto clipPath = m_analyzer->commandDetails(data.commandStreamId, data.command).clipPath;
+    if (clipPath.isEmpty())
         return;
 
     QPainterPath invertedClipPath;
     invertedClipPath.addRect(frame().sceneRect());
-    invertedClipPath -= data.clipPath;
+    invertedClipPath -= clipPath;
 
     p->save();
     p->setTransform(QTransform().scale(zoom(), zoom()), true);
@@ -32,6 +32,7 @@
 #include "remoteviewwidget.h"
 
 namespace GammaRay {
+class PaintAnalyzerInterface;
 
 class PaintAnalyzerReplayView : public RemoteViewWidget
 {
@@ -42,13 +43,21 @@ public:
 
     bool showClipArea() const;
 
+    /** Sets the paint analyzer providing the command details shown on top of the frames. */
+    void setPaintAnalyzer(PaintAnalyzerInterface *analyzer);
+
 public slots:
     void setShowClipArea(bool show);
 
 protected:
     void drawDecoration(QPainter * p) override;
 
+private slots:
+    void requestCommandDetails();
+    void commandDetailsAvailable(quint32 streamId, int firstCommand, int lastCommand);
+
 private:
+    PaintAnalyzerInterface *m_analyzer;
     bool m_showClipArea;
 };
 }
@@ -120,6 +120,7 @@ void PaintAnalyzerWidget::setBaseName(const QString &name)
     ui->replayWidget->setName(name + QStringLiteral(".remoteView"));
 
     m_iface = ObjectBroker::object<PaintAnalyzerInterface*>(name);
+    ui->replayWidget->setPaintAnalyzer(m_iface);
     connect(m_iface, SIGNAL(hasArgumentDetailsChanged(bool)), this, SLOT(detailsChanged()));
     connect(m_iface, SIGNAL(hasStackTraceChanged(bool)), this, SLOT(detailsChanged()));
     detailsChanged();
@@ -113,6 +113,9 @@ QVariant MetaObjectTreeClientProxyModel::data(const QModelIndex &index, int role
     if ((role != Qt::BackgroundRole && role != Qt::ToolTipRole) || !m_qobjIndex.isValid())
         return QIdentityProxyModel::data(index, role);
 
+    if (index.column() > QMetaObjectModel::ObjectInclusiveAliveCountColumn)
+        return QIdentityProxyModel::data(index, role); // census columns are not relative to QObject
+
     if (!needsBackground(index))
         return QIdentityProxyModel::data(index, role); // top-level but not QObject, or QObject incl count
 
@@ -148,6 +151,14 @@ QVariant MetaObjectTreeClientProxyModel::headerData(int section, Qt::Orientation
                 return tr("Self Alive");
             case QMetaObjectModel::ObjectInclusiveAliveCountColumn:
                 return tr("Incl. Alive");
+            case QMetaObjectModel::ObjectPeakAliveCountColumn:
+                return tr("Peak Alive");
+            case QMetaObjectModel::ObjectCreationRateColumn:
+                return tr("Created/s");
+            case QMetaObjectModel::ObjectDestructionRateColumn:
+                return tr("Destroyed/s");
+            case QMetaObjectModel::ObjectAverageLifetimeColumn:
+                return tr("Avg. Lifetime (ms)");
             default:
                 return QVariant();
         }
@@ -163,6 +174,14 @@ QVariant MetaObjectTreeClientProxyModel::headerData(int section, Qt::Orientation
                 return tr("This column shows the number of objects created and not yet destroyed of a particular type.");
             case QMetaObjectModel::ObjectInclusiveAliveCountColumn:
                 return tr("This column shows the number of objects created and not yet destroyed that inherit from a particular type.");
+            case QMetaObjectModel::ObjectPeakAliveCountColumn:
+                return tr("This column shows the highest number of objects of a particular type alive at the same time.");
+            case QMetaObjectModel::ObjectCreationRateColumn:
+                return tr("This column shows the number of objects of a particular type created per second, averaged over the last second.");
+            case QMetaObjectModel::ObjectDestructionRateColumn:
+                return tr("This column shows the number of objects of a particular type destroyed per second, averaged over the last second.");
+            case QMetaObjectModel::ObjectAverageLifetimeColumn:
+                return tr("This column shows the average lifetime of the destroyed objects of a particular type.");
             default:
                 return QVariant();
         }
@@ -42,15 +42,21 @@ ResourceBrowserClient::~ResourceBrowserClient()
 {
 }
 
-void ResourceBrowserClient::downloadResource(const QString &sourceFilePath,
-                                             const QString &targetFilePath)
-{
-    Endpoint::instance()->invokeObject(objectName(), "downloadResource",
-                                       QVariantList() << sourceFilePath << targetFilePath);
-}
-
 void ResourceBrowserClient::selectResource(const QString &sourceFilePath, int line, int column)
 {
     Endpoint::instance()->invokeObject(objectName(), "selectResource",
                                        QVariantList() << sourceFilePath << line << column);
 }
+
+void ResourceBrowserClient::requestResourceData(int requestId, const QString &filePath,
+                                                qint64 offset, int size)
+{
+    Endpoint::instance()->invokeObject(objectName(), "requestResourceData",
+                                       QVariantList() << requestId << filePath << offset << size);
+}
+
+void ResourceBrowserClient::cancelResourceData(int requestId)
+{
+    Endpoint::instance()->invokeObject(objectName(), "cancelResourceData",
+                                       QVariantList() << requestId);
+}
@@ -41,10 +41,11 @@ public:
     explicit ResourceBrowserClient(QObject *parent);
     virtual ~ResourceBrowserClient();
 
-    void downloadResource(const QString &sourceFilePath,
-                          const QString &targetFilePath) override;
     void selectResource(const QString &sourceFilePath, int line = -1,
                         int column = -1) override;
+    void requestResourceData(int requestId, const QString &filePath, qint64 offset,
+                             int size) override;
+    void cancelResourceData(int requestId) override;
 };
 }
 
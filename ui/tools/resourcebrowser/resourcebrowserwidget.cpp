@@ -43,12 +43,17 @@
 #include <QFontDatabase>
 #include <QImageReader>
 #include <QMenu>
+#include <QProgressDialog>
 #include <QScrollBar>
 #include <QTimer>
 #include <QTextBlock>
+#include <QTextCodec>
 
 using namespace GammaRay;
 
+// number of downloads that may have a data request in flight at the same time
+static const int MaxActiveDownloads = 2;
+
 static QObject *createResourceBrowserClient(const QString & /*name*/, QObject *parent)
 {
     return new ResourceBrowserClient(parent);
@@ -59,15 +64,24 @@ ResourceBrowserWidget::ResourceBrowserWidget(QWidget *parent)
     , ui(new Ui::ResourceBrowserWidget)
     , m_stateManager(this)
     , m_interface(nullptr)
+    , m_nextRequestId(0)
+    , m_contentCache(64 * 1024) // 64 MB
 {
+    m_preview.size = 0;
+    m_preview.requestId = -1;
+    m_preview.requestPending = false;
+    m_preview.line = -1;
+    m_preview.column = -1;
+    m_preview.isImage = false;
+
     ObjectBroker::registerClientObjectFactoryCallback<ResourceBrowserInterface *>(
         createResourceBrowserClient);
     m_interface = ObjectBroker::object<ResourceBrowserInterface *>();
     connect(m_interface, SIGNAL(resourceDeselected()), this, SLOT(resourceDeselected()));
-    connect(m_interface, SIGNAL(resourceSelected(QByteArray,int,int)), this,
-            SLOT(resourceSelected(QByteArray,int,int)));
-    connect(m_interface, SIGNAL(resourceDownloaded(QString,QByteArray)), this,
-            SLOT(resourceDownloaded(QString,QByteArray)));
+    connect(m_interface, SIGNAL(resourceSelected(QString,QByteArray,qint64,int,int)), this,
+            SLOT(resourceSelected(QString,QByteArray,qint64,int,int)));
+    connect(m_interface, SIGNAL(resourceDataReceived(int,qint64,qint64,QByteArray)), this,
+            SLOT(resourceDataReceived(int,qint64,qint64,QByteArray)));
 
     ui->setupUi(this);
     auto resModel = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ResourceModel"));
@@ -94,10 +108,13 @@ ResourceBrowserWidget::ResourceBrowserWidget(QWidget *parent)
 #if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
     ui->textBrowser->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
 #endif
+    connect(ui->textBrowser->verticalScrollBar(), SIGNAL(valueChanged(int)), this,
+            SLOT(textScrolled(int)));
 }
 
 ResourceBrowserWidget::~ResourceBrowserWidget()
 {
+    cancelDownloads();
 }
 
 void ResourceBrowserWidget::selectResource(const QString &sourceFilePath, int line, int column)
@@ -129,23 +146,113 @@ void ResourceBrowserWidget::setupLayout()
 
 void ResourceBrowserWidget::resourceDeselected()
 {
+    cancelPreviewData();
+    m_preview.filePath.clear();
     ui->resourceLabel->setText(tr("Select a Resource to Preview"));
     ui->stackedWidget->setCurrentWidget(ui->contentLabelPage);
 }
 
-void ResourceBrowserWidget::resourceSelected(const QByteArray &contents, int line, int column)
+void ResourceBrowserWidget::resourceSelected(const QString &filePath, const QByteArray &contentKey,
+                                             qint64 size, int line, int column)
+{
+    cancelPreviewData();
+    m_preview.filePath = filePath;
+    m_preview.contentKey = contentKey;
+    m_preview.size = size;
+    m_preview.line = line;
+    m_preview.column = column;
+    m_preview.isImage = false;
+    m_preview.content.clear();
+    if (auto cached = m_contentCache.object(contentKey))
+        m_preview.content = *cached;
+
+    // only fetch the beginning for the preview, more is requested when needed
+    if (m_preview.content.size() < qMin<qint64>(size, ResourceBrowserInterface::MaxChunkSize))
+        requestPreviewData();
+    else
+        showPreview();
+}
+
+void ResourceBrowserWidget::resourceDataReceived(int requestId, qint64 offset, qint64 totalSize,
+                                                 const QByteArray &data)
+{
+    if (requestId == m_preview.requestId && m_preview.requestPending)
+        previewDataReceived(offset, totalSize, data);
+    else if (m_activeDownloads.contains(requestId))
+        downloadDataReceived(requestId, offset, totalSize, data);
+}
+
+void ResourceBrowserWidget::requestPreviewData()
+{
+    if (m_preview.filePath.isEmpty() || m_preview.requestPending
+        || m_preview.content.size() >= m_preview.size)
+        return;
+
+    // all chunks of the preview use the same transfer, which keeps the resource open
+    if (m_preview.requestId < 0)
+        m_preview.requestId = m_nextRequestId++;
+    m_preview.requestPending = true;
+    m_interface->requestResourceData(m_preview.requestId, m_preview.filePath,
+                                     m_preview.content.size(),
+                                     ResourceBrowserInterface::MaxChunkSize);
+}
+
+void ResourceBrowserWidget::cancelPreviewData()
+{
+    if (m_preview.requestId >= 0)
+        m_interface->cancelResourceData(m_preview.requestId);
+    m_preview.requestId = -1;
+    m_preview.requestPending = false;
+}
+
+void ResourceBrowserWidget::previewDataReceived(qint64 offset, qint64 totalSize,
+                                                const QByteArray &data)
+{
+    m_preview.requestPending = false;
+    if (totalSize < 0 || offset != m_preview.content.size()) {
+        resourceDeselected();
+        return;
+    }
+
+    const bool initialData = m_preview.content.isEmpty();
+    m_preview.content.append(data);
+    if (data.isEmpty()) // resource got smaller in the meantime
+        m_preview.size = m_preview.content.size();
+    if (m_preview.content.size() >= m_preview.size) // the transfer ended with this chunk
+        m_preview.requestId = -1;
+    m_contentCache.insert(m_preview.contentKey, new QByteArray(m_preview.content),
+                          qMax(1, m_preview.content.size() / 1024));
+
+    if (initialData || m_preview.isImage)
+        showPreview();
+    else
+        appendPreviewText(data);
+}
+
+void ResourceBrowserWidget::showPreview()
 {
     // try to decode as an image first, fall back to text otherwise
-    auto rawData = contents;
+    auto rawData = m_preview.content;
     QBuffer buffer(&rawData);
     buffer.open(QBuffer::ReadOnly);
     QImageReader reader(&buffer);
-    const auto img = reader.read();
-    if (!img.isNull()) {
-        ui->resourceLabel->setPixmap(QPixmap::fromImage(img));
-        ui->stackedWidget->setCurrentWidget(ui->contentLabelPage);
-        return;
+    if (reader.canRead()) {
+        m_preview.isImage = true;
+        // images can only be shown in full
+        if (m_preview.content.size() < m_preview.size) {
+            ui->resourceLabel->setText(tr("Loading..."));
+            ui->stackedWidget->setCurrentWidget(ui->contentLabelPage);
+            requestPreviewData();
+            return;
+        }
+        const auto img = reader.read();
+        if (!img.isNull()) {
+            ui->resourceLabel->setPixmap(QPixmap::fromImage(img));
+            ui->stackedWidget->setCurrentWidget(ui->contentLabelPage);
+            return;
+        }
     }
+    m_preview.isImage = false;
 
     // avoid re-highlighting the existing content when switching the syntax
     ui->textBrowser->clear();
@@ -158,13 +265,15 @@ void ResourceBrowserWidget::resourceSelected(const QByteArray &contents, int lin
     ui->textBrowser->setFileName(fileName);
 
     // TODO: make encoding configurable
-    ui->textBrowser->setPlainText(contents);
+    // the decoder keeps state, so multi-byte sequences split across chunks survive
+    m_previewDecoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+    ui->textBrowser->setPlainText(m_previewDecoder->toUnicode(m_preview.content));
 
     QTextDocument *document = ui->textBrowser->document();
-    QTextCursor cursor(document->findBlockByLineNumber(line - 1));
+    QTextCursor cursor(document->findBlockByLineNumber(m_preview.line - 1));
     if (!cursor.isNull()) {
-        if (column >= 1)
-            cursor.setPosition(cursor.position() + column - 1);
+        if (m_preview.column >= 1)
+            cursor.setPosition(cursor.position() + m_preview.column - 1);
         ui->textBrowser->setTextCursor(cursor);
     }
     ui->textBrowser->setFocus();
@@ -172,17 +281,112 @@ void ResourceBrowserWidget::resourceSelected(const QByteArray &contents, int lin
     ui->stackedWidget->setCurrentWidget(ui->contentTextPage);
 }
 
-void ResourceBrowserWidget::resourceDownloaded(const QString &targetFilePath,
-                                               const QByteArray &contents)
+void ResourceBrowserWidget::appendPreviewText(const QByteArray &data)
 {
-    QFile file(targetFilePath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        qWarning("Unable to write resource content to %s", qPrintable(targetFilePath));
+    Q_ASSERT(m_previewDecoder);
+    QTextCursor cursor(ui->textBrowser->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(m_previewDecoder->toUnicode(data));
+}
+
+void ResourceBrowserWidget::textScrolled(int value)
+{
+    // fetch more of the previewed text once the user scrolls to the end of what we have
+    if (m_preview.isImage || ui->stackedWidget->currentWidget() != ui->contentTextPage)
+        return;
+    if (value < ui->textBrowser->verticalScrollBar()->maximum())
+        return;
+    requestPreviewData();
+}
+
+void ResourceBrowserWidget::downloadResource(const QString &sourceFilePath,
+                                             const QString &targetFilePath)
+{
+    Download download;
+    download.sourceFilePath = sourceFilePath;
+    download.targetFilePath = targetFilePath;
+    download.file = nullptr;
+    download.offset = 0;
+    m_pendingDownloads.enqueue(download);
+
+    if (!m_downloadProgress) {
+        m_downloadProgress = new QProgressDialog(tr("Saving resources..."), tr("Cancel"), 0, 0, this);
+        m_downloadProgress->setMinimumDuration(500);
+        m_downloadProgress->setValue(0);
+        connect(m_downloadProgress.data(), SIGNAL(canceled()), this, SLOT(cancelDownloads()));
+    }
+    m_downloadProgress->setMaximum(m_downloadProgress->maximum() + 1);
+
+    startDownloads();
+}
+
+void ResourceBrowserWidget::startDownloads()
+{
+    while (m_activeDownloads.size() < MaxActiveDownloads && !m_pendingDownloads.isEmpty()) {
+        auto download = m_pendingDownloads.dequeue();
+        download.file = new QFile(download.targetFilePath);
+        if (!download.file->open(QIODevice::WriteOnly)) {
+            qWarning("Unable to write resource content to %s", qPrintable(download.targetFilePath));
+            delete download.file;
+            if (m_downloadProgress)
+                m_downloadProgress->setValue(m_downloadProgress->value() + 1);
+            continue;
+        }
+
+        // the next chunk is only requested once the previous one has been written,
+        // so neither side ever holds more than one chunk of a download in memory
+        const auto requestId = m_nextRequestId++;
+        m_activeDownloads.insert(requestId, download);
+        m_interface->requestResourceData(requestId, download.sourceFilePath, 0,
+                                         ResourceBrowserInterface::MaxChunkSize);
+    }
+
+    if (m_activeDownloads.isEmpty() && m_pendingDownloads.isEmpty() && m_downloadProgress)
+        m_downloadProgress->deleteLater();
+}
+
+void ResourceBrowserWidget::downloadDataReceived(int requestId, qint64 offset, qint64 totalSize,
+                                                 const QByteArray &data)
+{
+    auto &download = m_activeDownloads[requestId];
+    if (totalSize < 0 || offset != download.offset || download.file->write(data) != data.size()) {
+        qWarning("Unable to save resource %s to %s", qPrintable(download.sourceFilePath),
+                 qPrintable(download.targetFilePath));
+        finishDownload(requestId, false);
+        return;
+    }
+
+    download.offset += data.size();
+    if (download.offset < totalSize && !data.isEmpty()) {
+        m_interface->requestResourceData(requestId, download.sourceFilePath, download.offset,
+                                         ResourceBrowserInterface::MaxChunkSize);
         return;
     }
+    finishDownload(requestId, true);
+}
+
+void ResourceBrowserWidget::finishDownload(int requestId, bool success)
+{
+    const auto download = m_activeDownloads.take(requestId);
+    download.file->close();
+    if (!success) {
+        m_interface->cancelResourceData(requestId);
+        download.file->remove();
+    }
+    delete download.file;
 
-    file.write(contents);
-    file.close();
+    if (m_downloadProgress)
+        m_downloadProgress->setValue(m_downloadProgress->value() + 1);
+    startDownloads();
+}
+
+void ResourceBrowserWidget::cancelDownloads()
+{
+    m_pendingDownloads.clear();
+    foreach (const auto requestId, m_activeDownloads.keys())
+        finishDownload(requestId, false);
+    if (m_downloadProgress)
+        m_downloadProgress->deleteLater();
 }
 
 static QStringList collectDirectories(const QModelIndex &index, const QString &baseDirectory)
@@ -249,7 +453,7 @@ void ResourceBrowserWidget::handleCustomContextMenu(const QPoint &pos)
 
         // request all resource files
         foreach (const QString &filePath, collectFiles(selectedIndex, sourceDirectory))
-            m_interface->downloadResource(sourceDirectory + filePath, targetDirectory + filePath);
+            downloadResource(sourceDirectory + filePath, targetDirectory + filePath);
 
     } else {
         const QString sourceFilePath = selectedIndex.data(ResourceModel::FilePathRole).toString();
@@ -260,6 +464,6 @@ void ResourceBrowserWidget::handleCustomContextMenu(const QPoint &pos)
         if (targetFilePath.isEmpty())
             return;
 
-        m_interface->downloadResource(sourceFilePath, targetFilePath);
+        downloadResource(sourceFilePath, targetFilePath);
     }
 }
@@ -31,10 +31,17 @@
 
 #include <ui/uistatemanager.h>
 
+#include <QCache>
+#include <QHash>
+#include <QPointer>
+#include <QQueue>
 #include <QWidget>
 
 QT_BEGIN_NAMESPACE
+class QFile;
 class QItemSelection;
+class QProgressDialog;
+class QTextDecoder;
 QT_END_NAMESPACE
 
 namespace GammaRay {
@@ -57,15 +64,59 @@ public slots:
 private slots:
     void setupLayout();
     void resourceDeselected();
-    void resourceSelected(const QByteArray &contents, int line, int column);
-    void resourceDownloaded(const QString &targetFilePath, const QByteArray &contents);
+    void resourceSelected(const QString &filePath, const QByteArray &contentKey, qint64 size,
+                          int line, int column);
+    void resourceDataReceived(int requestId, qint64 offset, qint64 totalSize,
+                              const QByteArray &data);
+    void textScrolled(int value);
+    void cancelDownloads();
 
     void handleCustomContextMenu(const QPoint &pos);
 
 private:
+    void requestPreviewData();
+    void cancelPreviewData();
+    void previewDataReceived(qint64 offset, qint64 totalSize, const QByteArray &data);
+    void showPreview();
+    void appendPreviewText(const QByteArray &data);
+
+    void downloadResource(const QString &sourceFilePath, const QString &targetFilePath);
+    void startDownloads();
+    void downloadDataReceived(int requestId, qint64 offset, qint64 totalSize,
+                              const QByteArray &data);
+    void finishDownload(int requestId, bool success);
+
     QScopedPointer<Ui::ResourceBrowserWidget> ui;
     UIStateManager m_stateManager;
     ResourceBrowserInterface *m_interface;
+    int m_nextRequestId;
+
+    // the resource currently shown in the preview, only fetched as far as needed
+    struct Preview {
+        QString filePath;
+        QByteArray contentKey;
+        QByteArray content;
+        qint64 size;
+        // the transfer of the preview content, -1 if there is none
+        int requestId;
+        bool requestPending;
+        int line;
+        int column;
+        bool isImage;
+    } m_preview;
+    QScopedPointer<QTextDecoder> m_previewDecoder;
+    // already fetched resource content by content hash, cost is the size in kB
+    QCache<QByteArray, QByteArray> m_contentCache;
+
+    struct Download {
+        QString sourceFilePath;
+        QString targetFilePath;
+        QFile *file;
+        qint64 offset;
+    };
+    QQueue<Download> m_pendingDownloads;
+    QHash<int, Download> m_activeDownloads;
+    QPointer<QProgressDialog> m_downloadProgress;
 };
 }
 